@@ -206,6 +206,28 @@ void SPIClass::transfer(void *buf, size_t count) {
     }
 }
 
+void SPIClass::transferAsync(const void *buf, size_t count) {
+    if (!_hspi || !buf || count == 0) return;
+    wait(); // Only one transfer in flight
+    if (_hspi->hdmatx == NULL) {
+        // No DMA channel configured in CubeMX (SPI1_TX -> DMA1_Channel3), do it the slow way
+        HAL_SPI_Transmit(_hspi, (uint8_t*)buf, count, HAL_MAX_DELAY);
+        return;
+    }
+    HAL_SPI_Transmit_DMA(_hspi, (uint8_t*)buf, count);
+}
+
+bool SPIClass::busy() {
+    if (!_hspi) return false;
+    return HAL_SPI_GetState(_hspi) == HAL_SPI_STATE_BUSY_TX;
+}
+
+void SPIClass::wait() {
+    while (busy()) {
+        // The DMA transfer-complete IRQ moves the handle back to READY
+    }
+}
+
 // Helper for Adafruit compatibility (sometimes they use spiwrite)
 void spiwrite(uint8_t d) {
   SPI.transfer(d);
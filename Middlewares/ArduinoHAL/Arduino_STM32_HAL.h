@@ -90,6 +90,11 @@ public:
   void begin();
   uint8_t transfer(uint8_t data);
   void transfer(void *buf, size_t count); // For block transfers
+  // DMA block transfer (transmit only). buf must stay untouched until busy() returns false.
+  // Falls back to a blocking transfer if no TX DMA channel is linked to the SPI handle.
+  void transferAsync(const void *buf, size_t count);
+  bool busy();
+  void wait();
   void beginTransaction(SPISettings settings);
   void endTransaction(void);
 
@@ -0,0 +1,334 @@
+#include "ILI9341_Bus.h"
+#include <string.h> // For memset
+
+// Bytes on the wire for each window command: 1 command byte + 4 parameter bytes
+#define WINDOW_CMD_BYTES 5
+#define RAMWR_CMD_BYTES  1
+
+// --- ILI9341_Bus ---
+ILI9341_Bus::ILI9341_Bus(SPIClass* spi) : _spi(spi), _width(ILI9341_TFTWIDTH), _height(ILI9341_TFTHEIGHT) {
+  _cs_low = false;
+  _batch_depth = 0;
+  memset(&_stats, 0, sizeof(_stats));
+  memset(&_last_frame, 0, sizeof(_last_frame));
+  invalidate();
+}
+
+void ILI9341_Bus::begin(uint16_t width, uint16_t height) {
+  _width = width;
+  _height = height;
+  _batch_depth = 0;
+  invalidate();
+}
+
+void ILI9341_Bus::invalidate() {
+  // Something outside this layer talked to the controller (or toggled CS/DC),
+  // so nothing we remember about it can be trusted any more.
+  _col0 = _col1 = _row0 = _row1 = -1;
+  _ramwr_open = false;
+  _cur_x = _cur_y = -1;
+  _dc_state = -1;
+  _cs_low = false;
+  _last_px_x = _last_px_y = -1;
+}
+
+// --- Chip select / batching ---
+void ILI9341_Bus::selectChip() {
+  if (!_cs_low) {
+    HAL_GPIO_WritePin(ILI9341_CS_PORT, ILI9341_CS_PIN, GPIO_PIN_RESET);
+    _cs_low = true;
+  }
+}
+
+void ILI9341_Bus::startBatch() {
+  if (_batch_depth == 0 && _cs_low) {
+    // Plain Adafruit code would have raised CS at the last endWrite() and lowered it here
+    _stats.cs_toggles_elided += 2;
+  }
+  selectChip();
+  _batch_depth++;
+}
+
+void ILI9341_Bus::endBatch() {
+  if (_batch_depth > 0) _batch_depth--;
+  // CS is intentionally left asserted: the next batch continues where this one stopped.
+}
+
+void ILI9341_Bus::release() {
+  waitIdle();
+  if (_cs_low) {
+    HAL_GPIO_WritePin(ILI9341_CS_PORT, ILI9341_CS_PIN, GPIO_PIN_SET);
+    _cs_low = false;
+  }
+  // The controller terminates a RAMWR stream when CS goes high
+  _ramwr_open = false;
+}
+
+// --- Low level transfers ---
+void ILI9341_Bus::setDC(bool data) {
+  if (_dc_state != (int8_t)data) {
+    HAL_GPIO_WritePin(ILI9341_DC_PORT, ILI9341_DC_PIN, data ? GPIO_PIN_SET : GPIO_PIN_RESET);
+    _dc_state = data ? 1 : 0;
+  }
+}
+
+void ILI9341_Bus::sendCommand(uint8_t cmd) {
+  waitIdle(); // DC must not change under a running DMA transfer
+  selectChip();
+  setDC(false);
+  _spi->transfer(cmd);
+  setDC(true);
+  _stats.commands_sent++;
+  _stats.bytes_sent++;
+}
+
+void ILI9341_Bus::sendData(const uint8_t* data, uint32_t len) {
+  if (len == 0) return;
+  waitIdle();
+  selectChip();
+  setDC(true);
+  _spi->transfer((void*)data, len);
+  _stats.bytes_sent += len;
+}
+
+void ILI9341_Bus::writeCommand(uint8_t cmd, const uint8_t* params, uint8_t len) {
+  // Any foreign command ends the current memory write stream
+  _ramwr_open = false;
+  if (cmd == ILI9341_BUS_CMD_CASET || cmd == ILI9341_BUS_CMD_PASET || cmd == ILI9341_MADCTL) {
+    _col0 = _col1 = _row0 = _row1 = -1;
+  }
+  sendCommand(cmd);
+  sendData(params, len);
+}
+
+void ILI9341_Bus::setColumns(int16_t c0, int16_t c1) {
+  if (c0 == _col0 && c1 == _col1) {
+    _stats.commands_elided++;
+    _stats.bytes_saved += WINDOW_CMD_BYTES;
+    return;
+  }
+  uint8_t p[4] = { (uint8_t)(c0 >> 8), (uint8_t)c0, (uint8_t)(c1 >> 8), (uint8_t)c1 };
+  sendCommand(ILI9341_BUS_CMD_CASET);
+  sendData(p, 4);
+  _col0 = c0;
+  _col1 = c1;
+}
+
+void ILI9341_Bus::setRows(int16_t r0, int16_t r1) {
+  if (r0 == _row0 && r1 == _row1) {
+    _stats.commands_elided++;
+    _stats.bytes_saved += WINDOW_CMD_BYTES;
+    return;
+  }
+  uint8_t p[4] = { (uint8_t)(r0 >> 8), (uint8_t)r0, (uint8_t)(r1 >> 8), (uint8_t)r1 };
+  sendCommand(ILI9341_BUS_CMD_PASET);
+  sendData(p, 4);
+  _row0 = r0;
+  _row1 = r1;
+}
+
+// --- Window management ---
+void ILI9341_Bus::beginRect(int16_t x, int16_t y, int16_t w, int16_t h) {
+  int16_t x1 = x + w - 1;
+  int16_t y1 = y + h - 1;
+
+  // Does this write continue the open RAMWR stream exactly where it stopped?
+  if (_ramwr_open && x == _cur_x && y == _cur_y) {
+    bool fits_row = (h == 1 && _row0 == y && _row1 == y && _col1 >= x1);
+    bool fits_col = (w == 1 && _col0 == x && _col1 == x && _row1 >= y1);
+    bool same_win = (x == _col0 && y == _row0 && x1 == _col1 && y1 == _row1);
+    if (fits_row || fits_col || same_win) {
+      _stats.commands_elided += 3;
+      _stats.bytes_saved += 2 * WINDOW_CMD_BYTES + RAMWR_CMD_BYTES;
+      _last_px_x = x;
+      _last_px_y = y;
+      return;
+    }
+  }
+
+  // Pick the window. Spans are opened to the screen edge so an adjacent span
+  // (next sample of a trace, next glyph column, ...) can be appended later.
+  bool column_mode = (w == 1 && h > 1) ||
+                     (w == 1 && h == 1 && x == _last_px_x && y == _last_px_y + 1);
+  if (h == 1 && !column_mode) {
+    setColumns(x, _width - 1);
+    setRows(y, y);
+  } else if (column_mode) {
+    setColumns(x, x);
+    setRows(y, _height - 1);
+  } else {
+    setColumns(x, x1);
+    setRows(y, y1);
+  }
+  sendCommand(ILI9341_BUS_CMD_RAMWR);
+  _ramwr_open = true;
+  _cur_x = x;
+  _cur_y = y;
+  _last_px_x = x;
+  _last_px_y = y;
+}
+
+void ILI9341_Bus::advanceCursor(uint32_t count) {
+  int32_t win_w = _col1 - _col0 + 1;
+  int32_t win_h = _row1 - _row0 + 1;
+  if (win_w <= 0 || win_h <= 0) return;
+
+  // Fast paths for the single-row and single-column streams beginRect() opens
+  if (_cur_x + (int32_t)count <= _col1) {
+    _cur_x += count;
+    return;
+  }
+  if (win_w == 1 && _cur_y + (int32_t)count <= _row1) {
+    _cur_y += count;
+    return;
+  }
+  // General case: linear offset inside the window, wrapping like the controller does
+  uint32_t offset = (uint32_t)(_cur_y - _row0) * win_w + (_cur_x - _col0) + count;
+  offset %= (uint32_t)(win_w * win_h);
+  _cur_y = _row0 + offset / win_w;
+  _cur_x = _col0 + offset % win_w;
+}
+
+// --- Pixel data ---
+void ILI9341_Bus::writeColor(uint16_t color, uint32_t count) {
+  if (count == 0) return;
+  uint32_t chunk = (count < ILI9341_BUS_FILL_CHUNK) ? count : ILI9341_BUS_FILL_CHUNK;
+  for (uint32_t i = 0; i < chunk; i++) {
+    _fill_buf[2 * i] = color >> 8;
+    _fill_buf[2 * i + 1] = color & 0xFF;
+  }
+  advanceCursor(count);
+  while (count > 0) {
+    uint32_t n = (count < chunk) ? count : chunk;
+    sendData(_fill_buf, n * 2);
+    count -= n;
+  }
+}
+
+void ILI9341_Bus::writePixels(const uint16_t* colors, uint32_t count) {
+  advanceCursor(count);
+  while (count > 0) {
+    uint32_t n = (count < ILI9341_BUS_FILL_CHUNK) ? count : ILI9341_BUS_FILL_CHUNK;
+    for (uint32_t i = 0; i < n; i++) {
+      _fill_buf[2 * i] = colors[i] >> 8;
+      _fill_buf[2 * i + 1] = colors[i] & 0xFF;
+    }
+    sendData(_fill_buf, n * 2);
+    colors += n;
+    count -= n;
+  }
+}
+
+void ILI9341_Bus::writeRaw(const uint8_t* data, uint32_t len) {
+  advanceCursor(len / 2);
+  sendData(data, len);
+}
+
+void ILI9341_Bus::writeRawAsync(const uint8_t* data, uint32_t len) {
+  if (len == 0) return;
+  advanceCursor(len / 2);
+  if (!_cs_low || _dc_state != 1) {
+    // Back-to-back pixel blocks keep CS/DC as they are; only wait if a pin has to move
+    waitIdle();
+    selectChip();
+    setDC(true);
+  }
+  _spi->transferAsync(data, len); // Waits for the previous DMA transfer itself
+  _stats.bytes_sent += len;
+}
+
+void ILI9341_Bus::waitIdle() {
+  _spi->wait();
+}
+
+// --- Statistics ---
+void ILI9341_Bus::endFrame() {
+  _last_frame = _stats;
+  memset(&_stats, 0, sizeof(_stats));
+}
+
+
+// --- ILI9341_Display ---
+ILI9341_Display::ILI9341_Display(int8_t cs, int8_t dc, int8_t rst)
+    : Adafruit_ILI9341(cs, dc, rst), _bus(&SPI) {
+}
+
+void ILI9341_Display::begin(uint32_t freq) {
+  Adafruit_ILI9341::begin(freq); // Reset + init sequence through the stock driver
+  _bus.begin(width(), height());
+}
+
+void ILI9341_Display::startWrite(void) {
+  _bus.startBatch();
+}
+
+void ILI9341_Display::endWrite(void) {
+  _bus.endBatch();
+}
+
+void ILI9341_Display::setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) {
+  // Only reached from stock Adafruit paths that stream pixels behind our back
+  // (bitmaps, pushColors). Let them through and drop the cache.
+  Adafruit_ILI9341::setAddrWindow(x, y, w, h);
+  _bus.invalidate();
+}
+
+void ILI9341_Display::setRotation(uint8_t r) {
+  Adafruit_ILI9341::setRotation(r);
+  _bus.begin(width(), height());
+}
+
+bool ILI9341_Display::clipRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const {
+  if (w < 0) { x += w + 1; w = -w; }
+  if (h < 0) { y += h + 1; h = -h; }
+  if (x >= _width || y >= _height || w == 0 || h == 0) return false;
+  if (x < 0) { w += x; x = 0; }
+  if (y < 0) { h += y; y = 0; }
+  if (x + w > _width)  w = _width - x;
+  if (y + h > _height) h = _height - y;
+  return (w > 0 && h > 0);
+}
+
+void ILI9341_Display::writePixel(int16_t x, int16_t y, uint16_t color) {
+  if (x < 0 || y < 0 || x >= _width || y >= _height) return;
+  _bus.beginRect(x, y, 1, 1);
+  _bus.writeColor(color, 1);
+}
+
+void ILI9341_Display::drawPixel(int16_t x, int16_t y, uint16_t color) {
+  startWrite();
+  writePixel(x, y, color);
+  endWrite();
+}
+
+void ILI9341_Display::writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  if (!clipRect(x, y, w, h)) return;
+  _bus.beginRect(x, y, w, h);
+  _bus.writeColor(color, (uint32_t)w * h);
+}
+
+void ILI9341_Display::fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) {
+  startWrite();
+  writeFillRect(x, y, w, h, color);
+  endWrite();
+}
+
+void ILI9341_Display::writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  writeFillRect(x, y, w, 1, color);
+}
+
+void ILI9341_Display::writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  writeFillRect(x, y, 1, h, color);
+}
+
+void ILI9341_Display::drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) {
+  startWrite();
+  writeFillRect(x, y, w, 1, color);
+  endWrite();
+}
+
+void ILI9341_Display::drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) {
+  startWrite();
+  writeFillRect(x, y, 1, h, color);
+  endWrite();
+}
@@ -0,0 +1,126 @@
+#ifndef ILI9341_Bus_h
+#define ILI9341_Bus_h
+
+// Use our STM32 HAL compatibility layer
+#include "Arduino_STM32_HAL.h" // Provides SPIClass and the ILI9341_* pin definitions
+#include "Middlewares/Adafruit/ILI9341/Adafruit_ILI9341.h"
+
+// ILI9341 commands the bus layer issues itself
+#define ILI9341_BUS_CMD_CASET 0x2A // Column address set
+#define ILI9341_BUS_CMD_PASET 0x2B // Page (row) address set
+#define ILI9341_BUS_CMD_RAMWR 0x2C // Memory write
+
+// Pixels staged per SPI block transfer when streaming a solid color
+#define ILI9341_BUS_FILL_CHUNK 32
+
+// Per-frame traffic counters.
+// "Elided" commands are CASET/PASET/RAMWR that the window cache proved redundant.
+// bytes_saved counts command + parameter bytes that were not clocked out because of that.
+struct ILI9341_BusStats {
+  uint32_t commands_sent;
+  uint32_t commands_elided;
+  uint32_t bytes_sent;
+  uint32_t bytes_saved;
+  uint32_t cs_toggles_elided;
+};
+
+// Display command layer sitting below Adafruit_ILI9341.
+// It remembers the last address window and the controller's write pointer, so:
+//  - CASET/PASET are only sent when the column/page range actually changes,
+//  - a write that starts exactly where the previous RAMWR stream stopped is appended
+//    to that stream without any command at all,
+//  - CS stays asserted across startBatch()/endBatch() pairs (the TFT is the only
+//    device on SPI1; the touch controller is bit-banged on its own pins).
+class ILI9341_Bus {
+public:
+  ILI9341_Bus(SPIClass* spi);
+
+  // Forget all cached controller state (call after reset/init or foreign commands)
+  void begin(uint16_t width, uint16_t height);
+  void invalidate();
+
+  // Batching. CS is asserted on the first batch and only released by release().
+  void startBatch();
+  void endBatch();
+  void release();
+
+  // Open a write window for a w*h rectangle. Single-row and single-column requests
+  // are opened to the screen edge so that the next adjacent span can continue the
+  // same RAMWR stream.
+  void beginRect(int16_t x, int16_t y, int16_t w, int16_t h);
+  void writeColor(uint16_t color, uint32_t count);          // Solid color run
+  void writePixels(const uint16_t* colors, uint32_t count); // Native (little-endian) RGB565
+  void writeRaw(const uint8_t* data, uint32_t len);          // Pre-swapped big-endian stream
+  // Same as writeRaw() but via SPI DMA; data must stay valid until the next bus call or waitIdle()
+  void writeRawAsync(const uint8_t* data, uint32_t len);
+  void waitIdle();
+
+  // Any other command goes through here so the cache stays coherent
+  void writeCommand(uint8_t cmd, const uint8_t* params, uint8_t len);
+
+  // Counters. endFrame() latches the running counters into frameStats() and clears them.
+  void endFrame();
+  const ILI9341_BusStats& frameStats() const { return _last_frame; }
+  const ILI9341_BusStats& runningStats() const { return _stats; }
+
+private:
+  SPIClass* _spi;
+  uint16_t _width, _height;
+
+  bool _cs_low;
+  int8_t _dc_state;     // 0 = command, 1 = data, -1 = unknown
+  uint8_t _batch_depth;
+
+  // Cached controller state. Windows are inclusive ranges, -1 means unknown.
+  int16_t _col0, _col1, _row0, _row1;
+  bool _ramwr_open;     // True while a RAMWR stream is active and nothing else was sent
+  int16_t _cur_x, _cur_y; // Where the next pixel of the open stream lands
+  int16_t _last_px_x, _last_px_y; // Last write origin, to spot vertical pixel runs
+
+  ILI9341_BusStats _stats;
+  ILI9341_BusStats _last_frame;
+
+  uint8_t _fill_buf[ILI9341_BUS_FILL_CHUNK * 2];
+
+  void selectChip();
+  void setDC(bool data);
+  void sendCommand(uint8_t cmd);
+  void sendData(const uint8_t* data, uint32_t len);
+  void setColumns(int16_t c0, int16_t c1);
+  void setRows(int16_t r0, int16_t r1);
+  void advanceCursor(uint32_t count);
+};
+
+// Adafruit_ILI9341 with all pixel-writing primitives routed through ILI9341_Bus.
+// Drop-in replacement for the tft object: everything that takes an Adafruit_ILI9341*
+// keeps working, it just emits far fewer commands.
+class ILI9341_Display : public Adafruit_ILI9341 {
+public:
+  ILI9341_Display(int8_t cs, int8_t dc, int8_t rst);
+
+  void begin(uint32_t freq = 0);
+  ILI9341_Bus& bus() { return _bus; }
+
+  // Adafruit_GFX / Adafruit_SPITFT overrides
+  void startWrite(void) override;
+  void endWrite(void) override;
+  void setAddrWindow(uint16_t x, uint16_t y, uint16_t w, uint16_t h) override;
+  void setRotation(uint8_t r) override;
+
+  void drawPixel(int16_t x, int16_t y, uint16_t color) override;
+  void writePixel(int16_t x, int16_t y, uint16_t color) override;
+  void fillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+  void writeFillRect(int16_t x, int16_t y, int16_t w, int16_t h, uint16_t color) override;
+  void drawFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void drawFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+  void writeFastHLine(int16_t x, int16_t y, int16_t w, uint16_t color) override;
+  void writeFastVLine(int16_t x, int16_t y, int16_t h, uint16_t color) override;
+
+private:
+  ILI9341_Bus _bus;
+
+  // Clip a rectangle to the screen; returns false if nothing is left
+  bool clipRect(int16_t& x, int16_t& y, int16_t& w, int16_t& h) const;
+};
+
+#endif // ILI9341_Bus_h
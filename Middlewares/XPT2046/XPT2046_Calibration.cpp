@@ -0,0 +1,37 @@
+#include "XPT2046_Calibration.h"
+
+// Smallest usable determinant (raw units squared). Touch targets a few hundred raw
+// counts apart give determinants around 1e5..1e7.
+#define XPT2046_CAL_MIN_DET 1000
+
+// Division rounded to nearest, for either sign
+static int64_t roundDiv(int64_t num, int64_t den) {
+  if (den < 0) { num = -num; den = -den; }
+  return (num >= 0) ? (num + den / 2) / den : -((-num + den / 2) / den);
+}
+
+bool xpt2046SolveCalibration(const int16_t raw[3][2], const int16_t screen[3][2], XPT2046_Calibration* cal) {
+  // Work relative to point 2, which makes the offset term drop out of the 2x2 system
+  int64_t x0 = raw[0][0] - raw[2][0], y0 = raw[0][1] - raw[2][1];
+  int64_t x1 = raw[1][0] - raw[2][0], y1 = raw[1][1] - raw[2][1];
+  int64_t det = x0 * y1 - x1 * y0;
+  if (det > -XPT2046_CAL_MIN_DET && det < XPT2046_CAL_MIN_DET) return false;
+
+  int64_t sx0 = screen[0][0] - screen[2][0], sx1 = screen[1][0] - screen[2][0];
+  int64_t sy0 = screen[0][1] - screen[2][1], sy1 = screen[1][1] - screen[2][1];
+  const int64_t one = (int64_t)1 << XPT2046_CAL_SHIFT;
+
+  // Cramer's rule, scaled to Q16
+  int64_t a = roundDiv((sx0 * y1 - sx1 * y0) * one, det);
+  int64_t b = roundDiv((x0 * sx1 - x1 * sx0) * one, det);
+  int64_t d = roundDiv((sy0 * y1 - sy1 * y0) * one, det);
+  int64_t e = roundDiv((x0 * sy1 - x1 * sy0) * one, det);
+
+  // Offsets put point 2 exactly on its target; + one/2 makes the >> in apply round
+  int64_t c = (int64_t)screen[2][0] * one - a * raw[2][0] - b * raw[2][1] + one / 2;
+  int64_t f = (int64_t)screen[2][1] * one - d * raw[2][0] - e * raw[2][1] + one / 2;
+
+  cal->a = (int32_t)a; cal->b = (int32_t)b; cal->c = (int32_t)c;
+  cal->d = (int32_t)d; cal->e = (int32_t)e; cal->f = (int32_t)f;
+  return true;
+}
@@ -0,0 +1,29 @@
+#ifndef XPT2046_Calibration_h
+#define XPT2046_Calibration_h
+
+// Affine touch calibration. No HAL or pin access, so the solver can be checked on a host
+// against synthetic distortions (rotation, skew, axis swap, offset).
+#include <stdint.h>
+
+#define XPT2046_CAL_SHIFT 16 // Matrix coefficients are Q16 fixed point
+
+// screen_x = (a * raw_x + b * raw_y + c) >> XPT2046_CAL_SHIFT
+// screen_y = (d * raw_x + e * raw_y + f) >> XPT2046_CAL_SHIFT
+// A full affine map covers scale, offset, rotation, skew and swapped axes.
+struct XPT2046_Calibration {
+  int32_t a, b, c;
+  int32_t d, e, f;
+};
+
+// Solve the matrix from three raw/screen point pairs (raw[i][0] = x, raw[i][1] = y).
+// Returns false if the raw points are (nearly) collinear.
+bool xpt2046SolveCalibration(const int16_t raw[3][2], const int16_t screen[3][2], XPT2046_Calibration* cal);
+
+// Map one raw point with multiplies and shifts only
+inline void xpt2046ApplyCalibration(const XPT2046_Calibration& cal, int16_t raw_x, int16_t raw_y,
+                                    int16_t* screen_x, int16_t* screen_y) {
+  *screen_x = (int16_t)((cal.a * raw_x + cal.b * raw_y + cal.c) >> XPT2046_CAL_SHIFT);
+  *screen_y = (int16_t)((cal.d * raw_x + cal.e * raw_y + cal.f) >> XPT2046_CAL_SHIFT);
+}
+
+#endif // XPT2046_Calibration_h
@@ -0,0 +1,64 @@
+#include "XPT2046_Filter.h"
+
+void xpt2046SortSamples(uint16_t* v, uint8_t n) {
+  for (uint8_t i = 1; i < n; i++) {
+    uint16_t key = v[i];
+    int8_t j = i - 1;
+    while (j >= 0 && v[j] > key) {
+      v[j + 1] = v[j];
+      j--;
+    }
+    v[j + 1] = key;
+  }
+}
+
+uint16_t xpt2046TrimmedMean(uint16_t* v, uint8_t n) {
+  if (n == 0) return 0;
+  if (n < 3) return v[0];
+  xpt2046SortSamples(v, n);
+  uint32_t sum = 0;
+  for (uint8_t i = 1; i < n - 1; i++) {
+    sum += v[i];
+  }
+  uint8_t kept = n - 2;
+  return (uint16_t)((sum + kept / 2) / kept);
+}
+
+uint16_t xpt2046TrimmedSpread(const uint16_t* v, uint8_t n) {
+  if (n < 3) return 0;
+  return v[n - 2] - v[1];
+}
+
+uint16_t xpt2046TouchResistance(uint16_t x, uint16_t z1, uint16_t z2, uint16_t x_plate_ohms) {
+  if (z1 == 0) return 0xFFFF;
+  if (z2 <= z1) return 0; // Harder than the model can resolve
+  // Rx_plate * X / 4096 first keeps the product within 32 bits
+  uint32_t r = ((uint32_t)x_plate_ohms * x) >> 12;
+  r = r * (uint32_t)(z2 - z1) / z1;
+  return (r > 0xFFFE) ? 0xFFFE : (uint16_t)r;
+}
+
+void xpt2046ReduceBurst(uint16_t* xs, uint16_t* ys, uint16_t* z1s, uint16_t* z2s, uint16_t threshold,
+                        uint16_t* x, uint16_t* y, int16_t* z) {
+  uint16_t x_raw = xpt2046TrimmedMean(xs, XPT2046_AXIS_SAMPLES);
+  uint16_t y_raw = xpt2046TrimmedMean(ys, XPT2046_AXIS_SAMPLES);
+  uint16_t z1_raw = xpt2046TrimmedMean(z1s, XPT2046_Z_SAMPLES);
+  uint16_t z2_raw = xpt2046TrimmedMean(z2s, XPT2046_Z_SAMPLES);
+
+  // Pressure from the plate resistance; lower Rtouch means a firmer press
+  uint16_t r_touch = xpt2046TouchResistance(x_raw, z1_raw, z2_raw, XPT2046_X_PLATE_OHMS);
+  int16_t z_pressure = (r_touch >= XPT2046_RTOUCH_MAX) ? 0 : (int16_t)(XPT2046_RTOUCH_MAX - r_touch);
+
+  // The pen moved or lifted during the burst: not a stable point
+  bool stable = xpt2046TrimmedSpread(xs, XPT2046_AXIS_SAMPLES) <= XPT2046_MAX_SPREAD &&
+                xpt2046TrimmedSpread(ys, XPT2046_AXIS_SAMPLES) <= XPT2046_MAX_SPREAD;
+
+  if (!stable || z_pressure < threshold) { // If pressure is too low, invalidate x,y
+    x_raw = 0;
+    y_raw = 0;
+    z_pressure = 0;
+  }
+  *x = x_raw;
+  *y = y_raw;
+  *z = z_pressure;
+}
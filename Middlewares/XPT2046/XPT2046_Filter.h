@@ -0,0 +1,40 @@
+#ifndef XPT2046_Filter_h
+#define XPT2046_Filter_h
+
+// Pure sample-processing helpers for the XPT2046 driver.
+// No HAL or pin access here, so the same code runs against recorded raw traces on a host.
+#include <stdint.h>
+
+// Filtered sampling. A point is a burst of conversions (X..., Y..., Z1..., Z2...) that
+// can be spread over several calls; each axis is reduced with a trimmed mean.
+#define XPT2046_AXIS_SAMPLES   5    // X and Y readings per point (mean of the middle 3)
+#define XPT2046_Z_SAMPLES      3    // Z1 and Z2 readings per point (median)
+#define XPT2046_MAX_SPREAD     40   // Raw counts; a noisier X/Y burst is rejected
+#define XPT2046_X_PLATE_OHMS   400  // X-plate resistance of the panel
+#define XPT2046_RTOUCH_MAX     4000 // Ohms. Reported z = RTOUCH_MAX - Rtouch, so higher z = firmer press
+#define XPT2046_DEFAULT_PRESSURE_THRESHOLD 1000 // z below this is "not touched" (Rtouch > 3k)
+
+// Sort v[0..n) in place (insertion sort; n is a handful of samples)
+void xpt2046SortSamples(uint16_t* v, uint8_t n);
+
+// Sorts v, drops the lowest and highest sample and averages the rest (n >= 3).
+// With n == 3 this is the median.
+uint16_t xpt2046TrimmedMean(uint16_t* v, uint8_t n);
+
+// Range of the samples kept by xpt2046TrimmedMean (v must already be sorted).
+// A large spread means the pen moved or lifted during the burst.
+uint16_t xpt2046TrimmedSpread(const uint16_t* v, uint8_t n);
+
+// Touch resistance in ohms from the datasheet formula
+//   Rtouch = Rx_plate * (X / 4096) * (Z2 / Z1 - 1)
+// Returns 0xFFFF when Z1 is 0 (no contact).
+uint16_t xpt2046TouchResistance(uint16_t x, uint16_t z1, uint16_t z2, uint16_t x_plate_ohms);
+
+// One point from a burst of XPT2046_AXIS_SAMPLES X and Y and XPT2046_Z_SAMPLES Z1 and Z2
+// readings (the arrays are sorted in place). z is the pressure, XPT2046_RTOUCH_MAX - Rtouch.
+// When X or Y spread more than XPT2046_MAX_SPREAD (the pen moved or lifted) or z is below
+// threshold, x, y and z are all 0.
+void xpt2046ReduceBurst(uint16_t* xs, uint16_t* ys, uint16_t* z1s, uint16_t* z2s, uint16_t threshold,
+                        uint16_t* x, uint16_t* y, int16_t* z);
+
+#endif // XPT2046_Filter_h
@@ -7,8 +7,11 @@ XPT2046_Touchscreen::XPT2046_Touchscreen(uint8_t cs_pin, uint8_t irq_pin, uint8_
   _clk_pin = clk_pin;
   _mosi_pin = mosi_pin;
   _miso_pin = miso_pin;
-  _pressure_threshold = 10; // Default pressure threshold, can be adjusted
+  _pressure_threshold = XPT2046_DEFAULT_PRESSURE_THRESHOLD; // On the Z1/Z2 pressure scale, can be adjusted
   _calibrated = false;
+  _affine = false;
+  _seq_index = 0;
+  _clock_count = 0;
 }
 
 void XPT2046_Touchscreen::begin() {
@@ -31,9 +34,8 @@ bool XPT2046_Touchscreen::touched() {
   if (_irq_pin != 255) { // 255 or another value to signify not using IRQ
       return (digitalRead(_irq_pin) == LOW);
   }
-  // Fallback to pressure reading if IRQ not used
-  TS_Point p = getPoint();
-  return (p.z > _pressure_threshold);
+  // Fallback to a quick 8-bit pressure reading if IRQ not used
+  return pressedFast();
 }
 
 uint16_t XPT2046_Touchscreen::readData(uint8_t command) {
@@ -93,47 +95,130 @@ uint16_t XPT2046_Touchscreen::readData(uint8_t command) {
   return data;
 }
 
+// Chained sequence; see XPT2046_CLOCKS_PER_CONV_12BIT.
+// Clocks are numbered from 0 at the START bit of the first command. Frame k's control
+// byte goes out on clocks period*k .. period*k+7, its BUSY clock follows, and its result
+// (MSB first) is sampled on clocks period*k+9 onwards, overlapping frame k+1's command.
+void XPT2046_Touchscreen::readSequence(const uint8_t* commands, uint16_t* results, uint8_t count, bool eight_bit) {
+  if (count == 0) return;
+  const uint8_t period = eight_bit ? XPT2046_CLOCKS_PER_CONV_8BIT : XPT2046_CLOCKS_PER_CONV_12BIT;
+  const uint8_t data_bits = eight_bit ? 8 : 12;
+  const uint16_t total = sequenceClocks(count, eight_bit);
+
+  for (uint8_t i = 0; i < count; i++) results[i] = 0;
+
+  uint8_t tx_frame = 0;
+  uint8_t tx_pos = 0;      // Clock within the frame being commanded
+  uint8_t rx_frame = 0;
+  int8_t rx_pos = -9;      // Clock within the frame being read (negative until its first data bit)
+  uint8_t cmd = 0;
+
+  digitalWrite(_cs_pin, LOW);
+  for (uint16_t c = 0; c < total; c++) {
+    if (tx_pos == 0 && tx_frame < count) {
+      bool last = (tx_frame == count - 1);
+      cmd = commands[tx_frame] | (eight_bit ? XPT2046_CTRL_8BIT : XPT2046_CTRL_12BIT) |
+            (last ? XPT2046_CTRL_PD_IRQ : XPT2046_CTRL_REF_ON);
+    }
+    uint8_t mosi = (tx_frame < count && tx_pos < 8) ? ((cmd >> (7 - tx_pos)) & 0x01) : 0;
+
+    digitalWrite(_mosi_pin, mosi);
+    digitalWrite(_clk_pin, HIGH);
+    uint8_t miso = (digitalRead(_miso_pin) == HIGH) ? 1 : 0;
+    digitalWrite(_clk_pin, LOW);
+
+    if (rx_pos >= 0 && rx_pos < data_bits && rx_frame < count) {
+      results[rx_frame] = (results[rx_frame] << 1) | miso;
+    }
+
+    if (++tx_pos == period) { tx_pos = 0; tx_frame++; }
+    if (++rx_pos == period) { rx_pos = 0; rx_frame++; }
+  }
+  digitalWrite(_mosi_pin, LOW);
+  digitalWrite(_cs_pin, HIGH);
+  _clock_count += total;
+}
+
+uint16_t XPT2046_Touchscreen::sequenceClocks(uint8_t count, bool eight_bit) {
+  if (count == 0) return 0;
+  uint8_t period = eight_bit ? XPT2046_CLOCKS_PER_CONV_8BIT : XPT2046_CLOCKS_PER_CONV_12BIT;
+  uint8_t data_bits = eight_bit ? 8 : 12;
+  return (uint16_t)period * (count - 1) + 9 + data_bits;
+}
+
+bool XPT2046_Touchscreen::pressedFast() {
+  uint8_t cmd = XPT2046_CMD_READ_Z1;
+  uint16_t z1;
+  readSequence(&cmd, &z1, 1, true);
+  return z1 > XPT2046_PRESENCE_Z1_MIN;
+}
+
+// Channel of each sample slot in a filtered point: X..., Y..., Z1..., Z2...
+static void fillPointCommands(uint8_t* cmds) {
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < XPT2046_AXIS_SAMPLES; i++) cmds[n++] = XPT2046_CMD_READ_X;
+  for (uint8_t i = 0; i < XPT2046_AXIS_SAMPLES; i++) cmds[n++] = XPT2046_CMD_READ_Y;
+  for (uint8_t i = 0; i < XPT2046_Z_SAMPLES; i++) cmds[n++] = XPT2046_CMD_READ_Z1;
+  for (uint8_t i = 0; i < XPT2046_Z_SAMPLES; i++) cmds[n++] = XPT2046_CMD_READ_Z2;
+}
+
 TS_Point XPT2046_Touchscreen::getPoint() {
-  uint16_t x_raw, y_raw, z1_raw, z2_raw;
-  int16_t z_pressure;
+  // Whole point in one CS assertion
+  uint8_t cmds[XPT2046_SEQ_LEN];
+  uint16_t raw[XPT2046_SEQ_LEN];
+  fillPointCommands(cmds);
+  readSequence(cmds, raw, XPT2046_SEQ_LEN, false);
 
-  // XPT2046 requires settling time. A small delay can be useful.
-  // Typically, multiple readings are averaged. This is a basic version.
-  
-  // Power up ADC and reference, but keep IRQ disabled during sequenced reads
-  // spiWrite(XPT2046_CTRL_REF_ON | XPT2046_CTRL_12BIT); // Turn on ADC, VREF, 12-bit
-  // delayMicroseconds(10); // Allow VREF to settle
+  uint8_t n = 0;
+  for (uint8_t i = 0; i < XPT2046_AXIS_SAMPLES; i++) _xs[i] = raw[n++];
+  for (uint8_t i = 0; i < XPT2046_AXIS_SAMPLES; i++) _ys[i] = raw[n++];
+  for (uint8_t i = 0; i < XPT2046_Z_SAMPLES; i++) _z1s[i] = raw[n++];
+  for (uint8_t i = 0; i < XPT2046_Z_SAMPLES; i++) _z2s[i] = raw[n++];
+  finishSample();
+  return _sampled;
+}
 
-  x_raw = readData(XPT2046_CMD_READ_X | XPT2046_CTRL_12BIT | XPT2046_CTRL_PD_IRQ); // Read X, 12-bit, power down
-  y_raw = readData(XPT2046_CMD_READ_Y | XPT2046_CTRL_12BIT | XPT2046_CTRL_PD_IRQ); // Read Y, 12-bit, power down
-  
-  // Pressure reading (optional, can be simplified)
-  // For Z (pressure), we need to turn on the X/Y plates.
-  // Standard way: CMD_Z1 (0xB0), CMD_Z2 (0xC0)
-  // Z = Z1 - Z2 + X_PLATE_RESISTANCE * X_RAW / 4096
-  // A simpler pressure reading: just use one Z reading or average.
-  // Or use a formula like: z = x_raw * (z2_raw / z1_raw - 1)
-  // For now, a basic pressure reading from one of the Z commands:
-  z1_raw = readData(XPT2046_CMD_READ_Z1 | XPT2046_CTRL_12BIT | XPT2046_CTRL_PD_IRQ);
-  // z2_raw = readData(XPT2046_CMD_READ_Z2 | XPT2046_CTRL_12BIT | XPT2046_CTRL_PD_IRQ);
-
-  // Simple pressure: use z1_raw. Higher value means more pressure.
-  // Max value for 12-bit is 4095. A light touch might be a few hundred.
-  // Some libraries use a formula: pressure = 4095 - z1_raw (if z1 decreases with pressure)
-  // Or pressure = z1_raw (if z1 increases with pressure)
-  // Let's assume z1_raw increases with pressure.
-  z_pressure = z1_raw;
-  if (z_pressure < _pressure_threshold) { // If pressure is too low, invalidate x,y
-      x_raw = 0; // Or some other indicator like -1 if TS_Point used signed
-      y_raw = 0;
-      z_pressure = 0;
+void XPT2046_Touchscreen::startSample() {
+  _seq_index = 0;
+}
+
+bool XPT2046_Touchscreen::sampleStep() {
+  // One chained burst per axis. Readings of one axis are taken back to back: the first
+  // one after switching the drivers settles worst and is what the trimmed mean drops.
+  uint8_t cmds[XPT2046_AXIS_SAMPLES];
+  switch (_seq_index) {
+    case 0:
+      for (uint8_t i = 0; i < XPT2046_AXIS_SAMPLES; i++) cmds[i] = XPT2046_CMD_READ_X;
+      readSequence(cmds, _xs, XPT2046_AXIS_SAMPLES, false);
+      break;
+    case 1:
+      for (uint8_t i = 0; i < XPT2046_AXIS_SAMPLES; i++) cmds[i] = XPT2046_CMD_READ_Y;
+      readSequence(cmds, _ys, XPT2046_AXIS_SAMPLES, false);
+      break;
+    case 2:
+      for (uint8_t i = 0; i < XPT2046_Z_SAMPLES; i++) cmds[i] = XPT2046_CMD_READ_Z1;
+      readSequence(cmds, _z1s, XPT2046_Z_SAMPLES, false);
+      break;
+    default:
+      for (uint8_t i = 0; i < XPT2046_Z_SAMPLES; i++) cmds[i] = XPT2046_CMD_READ_Z2;
+      readSequence(cmds, _z2s, XPT2046_Z_SAMPLES, false);
+      break;
   }
 
-  TS_Point p = TS_Point(x_raw, y_raw, z_pressure);
+  if (++_seq_index < 4) return false;
+  finishSample();
+  _seq_index = 0;
+  return true;
+}
+
+void XPT2046_Touchscreen::finishSample() {
+  uint16_t x_raw, y_raw;
+  int16_t z_pressure;
+  xpt2046ReduceBurst(_xs, _ys, _z1s, _z2s, _pressure_threshold, &x_raw, &y_raw, &z_pressure);
+  _sampled = TS_Point(x_raw, y_raw, z_pressure);
   if (_calibrated) {
-    applyCalibration(p);
+    applyCalibration(_sampled);
   }
-  return p;
 }
 
 
@@ -148,6 +233,7 @@ uint8_t XPT2046_Touchscreen::spiTransfer(uint8_t data) {
     }
     digitalWrite(_clk_pin, LOW);
   }
+  _clock_count += 8;
   return reply;
 }
 
@@ -158,6 +244,7 @@ void XPT2046_Touchscreen::spiWrite(uint8_t data) {
     digitalWrite(_clk_pin, HIGH);
     digitalWrite(_clk_pin, LOW);
   }
+  _clock_count += 8;
 }
 
 // SPI Read (MISO only, send dummy 0x00 on MOSI)
@@ -177,6 +264,7 @@ uint8_t XPT2046_Touchscreen::spiRead() {
     digitalWrite(_clk_pin, LOW);
     //delayMicroseconds(1); // Small delay
   }
+  _clock_count += 8;
   return reply;
 }
 
@@ -190,9 +278,23 @@ void XPT2046_Touchscreen::setCalibration(int16_t x_min, int16_t x_max, int16_t y
     _screen_width = screen_width;
     _screen_height = screen_height;
     _rotate_touch = rotate; // If true, swap x/y and invert one axis for rotated display
+    _affine = false;
     _calibrated = true;
 }
 
+void XPT2046_Touchscreen::setAffineCalibration(const XPT2046_Calibration& cal, uint16_t screen_width, uint16_t screen_height) {
+    _cal = cal;
+    _screen_width = screen_width;
+    _screen_height = screen_height;
+    _affine = true;
+    _calibrated = true;
+}
+
+void XPT2046_Touchscreen::clearCalibration() {
+    _affine = false;
+    _calibrated = false;
+}
+
 void XPT2046_Touchscreen::applyCalibration(TS_Point &p) {
     if (!_calibrated || p.z < _pressure_threshold) { // Don't map if not touched or not calibrated
         p.x = -1; // Indicate invalid point if using signed, or map to 0,0
@@ -200,6 +302,15 @@ void XPT2046_Touchscreen::applyCalibration(TS_Point &p) {
         return;
     }
 
+    if (_affine) {
+        // Multiplies and shifts only; rotation, skew and axis swap are in the matrix
+        int16_t sx, sy;
+        xpt2046ApplyCalibration(_cal, p.x, p.y, &sx, &sy);
+        p.x = (sx < 0) ? 0 : (sx >= (int16_t)_screen_width) ? _screen_width - 1 : sx;
+        p.y = (sy < 0) ? 0 : (sy >= (int16_t)_screen_height) ? _screen_height - 1 : sy;
+        return;
+    }
+
     // Clamp raw values to calibration range
     p.x = (p.x < _x_min_raw) ? _x_min_raw : p.x;
     p.x = (p.x > _x_max_raw) ? _x_max_raw : p.x;
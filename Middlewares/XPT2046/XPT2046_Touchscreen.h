@@ -3,6 +3,8 @@
 
 // Use our STM32 HAL compatibility layer
 #include "Arduino_STM32_HAL.h" // Provides digitalWrite, digitalRead, pinMode, delayMicroseconds
+#include "XPT2046_Filter.h"    // Trimmed mean, spread and touch resistance helpers
+#include "XPT2046_Calibration.h" // Affine calibration matrix and solver
 
 // Data class for returning touch coordinates
 class TS_Point {
@@ -26,6 +28,17 @@ public:
 #define XPT2046_CTRL_ADC_ON 0x02 // ADC on, IRQ disabled
 #define XPT2046_CTRL_REF_ON 0x03 // ADC on, VREF on, IRQ disabled
 
+// Filtered sampling: burst sizes and limits are in XPT2046_Filter.h
+#define XPT2046_SEQ_LEN (2 * XPT2046_AXIS_SAMPLES + 2 * XPT2046_Z_SAMPLES)
+
+// Chained conversions: the next control byte is clocked in while the tail of the
+// previous result is still being clocked out (datasheet "15 clocks per conversion").
+// A sequence of n conversions costs CLOCKS_PER_CONV * (n - 1) + 9 + result bits clocks
+// under a single CS assertion, instead of 24 clocks and a CS cycle each.
+#define XPT2046_CLOCKS_PER_CONV_12BIT 15
+#define XPT2046_CLOCKS_PER_CONV_8BIT  12
+#define XPT2046_PRESENCE_Z1_MIN       8 // 8-bit Z1 above this means the panel is pressed
+
 class XPT2046_Touchscreen {
 public:
   // Constructor for bit-banged SPI
@@ -33,13 +46,37 @@ public:
 
   void begin();
   bool touched();
-  TS_Point getPoint();
+  TS_Point getPoint(); // Blocking: runs a whole filtered sample burst
 
-  // Raw data reading function
+  // Non-blocking filtered sampling: startSample(), then sampleStep() until it returns
+  // true. Each sampleStep() is one chained burst of a single axis (at most 81 clocks);
+  // the result is in sampledPoint().
+  void startSample();
+  bool sampleStep();
+  TS_Point sampledPoint() const { return _sampled; }
+  void setPressureThreshold(uint16_t threshold) { _pressure_threshold = threshold; }
+
+  // Raw data reading function (one conversion, 24 clocks, own CS cycle)
   uint16_t readData(uint8_t command);
 
+  // Run count conversions in one CS assertion with overlapped commands. commands[] are
+  // channel selects (XPT2046_CMD_READ_*); mode and power bits are added here: the ADC and
+  // reference stay on between conversions and the last one powers down with PENIRQ enabled.
+  void readSequence(const uint8_t* commands, uint16_t* results, uint8_t count, bool eight_bit);
+  static uint16_t sequenceClocks(uint8_t count, bool eight_bit);
+
+  // Fast presence check: one 8-bit Z1 conversion (17 clocks)
+  bool pressedFast();
+
+  // DCLK cycles generated since boot (for comparing read strategies)
+  uint32_t clockCount() const { return _clock_count; }
+  void resetClockCount() { _clock_count = 0; }
+
   // Calibration parameters (optional, can be set by user)
   void setCalibration(int16_t x_min, int16_t x_max, int16_t y_min, int16_t y_max, uint16_t screen_width, uint16_t screen_height, bool rotate);
+  // Affine calibration (see XPT2046_Calibration.h); takes precedence over setCalibration()
+  void setAffineCalibration(const XPT2046_Calibration& cal, uint16_t screen_width, uint16_t screen_height);
+  void clearCalibration(); // Report raw coordinates (used while calibrating)
   void applyCalibration(TS_Point &p);
 
 
@@ -52,6 +89,17 @@ private:
 
   uint16_t _pressure_threshold; // Threshold for touch detection
 
+  uint32_t _clock_count;
+
+  // Filtered sampling state (_seq_index counts axis groups: X, Y, Z1, Z2)
+  uint8_t _seq_index;
+  uint16_t _xs[XPT2046_AXIS_SAMPLES];
+  uint16_t _ys[XPT2046_AXIS_SAMPLES];
+  uint16_t _z1s[XPT2046_Z_SAMPLES];
+  uint16_t _z2s[XPT2046_Z_SAMPLES];
+  TS_Point _sampled;
+  void finishSample();
+
   // SPI bit-bang transfer
   uint8_t spiTransfer(uint8_t data);
   void spiWrite(uint8_t data);
@@ -62,6 +110,8 @@ private:
   int16_t _x_min_raw, _x_max_raw, _y_min_raw, _y_max_raw;
   uint16_t _screen_width, _screen_height;
   bool _rotate_touch; // if touch coordinates should be rotated
+  bool _affine;
+  XPT2046_Calibration _cal;
 };
 
 #endif // XPT2046_Touchscreen_h
@@ -0,0 +1,153 @@
+#include "IndexedFramebuffer.h"
+#include <string.h> // For memset
+
+// Constructor
+IndexedFramebuffer::IndexedFramebuffer(ILI9341_Display* display)
+    : tft(display),
+      area_x(0), area_y(0), area_w(0), area_h(0),
+      band_y0(0), band_rows(0),
+      render_cycles(0) {
+    memset(palette_be, 0, sizeof(palette_be));
+}
+
+void IndexedFramebuffer::set_area(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (w > IFB_MAX_WIDTH) w = IFB_MAX_WIDTH; // Wider areas are truncated, not wrapped
+    area_x = x;
+    area_y = y;
+    area_w = w;
+    area_h = h;
+}
+
+void IndexedFramebuffer::set_palette(uint8_t index, uint16_t color) {
+    if (index >= IFB_NUM_COLORS) return;
+    // Store byte-swapped so the line buffer is already in ILI9341 (big-endian) order
+    palette_be[index] = (uint16_t)((color << 8) | (color >> 8));
+}
+
+// --- Frame composition ---
+void IndexedFramebuffer::render(PaintFn paint, void* ctx) {
+    render_rows(0, area_h - 1, paint, ctx);
+}
+
+void IndexedFramebuffer::render_rows(int16_t row_from, int16_t row_to, PaintFn paint, void* ctx) {
+    if (!tft || !paint || area_w <= 0) return;
+    if (row_from < 0) row_from = 0;
+    if (row_to >= area_h) row_to = area_h - 1;
+    if (row_from > row_to) return;
+
+    uint32_t start_cycles = DWT->CYCCNT;
+    ILI9341_Bus& bus = tft->bus();
+
+    // One window for the whole update; every band streams into the same RAMWR
+    bus.startBatch();
+    bus.beginRect(area_x, area_y + row_from, area_w, row_to - row_from + 1);
+
+    uint8_t line_sel = 0;
+    for (band_y0 = row_from; band_y0 <= row_to; band_y0 += IFB_BAND_ROWS) {
+        band_rows = row_to - band_y0 + 1;
+        if (band_rows > IFB_BAND_ROWS) band_rows = IFB_BAND_ROWS;
+        paint(*this, ctx);
+        flush_band(line_sel);
+    }
+
+    bus.waitIdle(); // Line buffers may be reused by the next render
+    bus.endBatch();
+    render_cycles = DWT->CYCCNT - start_cycles;
+}
+
+void IndexedFramebuffer::flush_band(uint8_t& line_sel) {
+    ILI9341_Bus& bus = tft->bus();
+    int16_t full_bytes = area_w >> 2;
+    int16_t tail_pixels = area_w & 3;
+
+    for (int16_t r = 0; r < band_rows; ++r) {
+        // Expand palette indices into the free line buffer while DMA sends the other one
+        const uint8_t* src = plane[r];
+        uint16_t* dst = line_buf[line_sel];
+        for (int16_t i = 0; i < full_bytes; ++i) {
+            uint8_t b = *src++;
+            dst[0] = palette_be[b & 3];
+            dst[1] = palette_be[(b >> 2) & 3];
+            dst[2] = palette_be[(b >> 4) & 3];
+            dst[3] = palette_be[b >> 6];
+            dst += 4;
+        }
+        for (int16_t i = 0; i < tail_pixels; ++i) {
+            *dst++ = palette_be[(*src >> (2 * i)) & 3];
+        }
+        bus.writeRawAsync((const uint8_t*)line_buf[line_sel], (uint32_t)area_w * 2);
+        line_sel ^= 1;
+    }
+}
+
+// --- Drawing primitives ---
+void IndexedFramebuffer::fill_span(uint8_t* row, int16_t x0, int16_t x1, uint8_t index) {
+    uint8_t fill = (uint8_t)(index * 0x55); // Index replicated into all four pixel slots
+    while (x0 <= x1 && (x0 & 3)) {
+        uint8_t shift = (x0 & 3) * 2;
+        row[x0 >> 2] = (row[x0 >> 2] & ~(3 << shift)) | (index << shift);
+        x0++;
+    }
+    if (x1 - x0 >= 3) {
+        int16_t bytes = (x1 - x0 + 1) >> 2;
+        memset(&row[x0 >> 2], fill, bytes);
+        x0 += bytes * 4;
+    }
+    while (x0 <= x1) {
+        uint8_t shift = (x0 & 3) * 2;
+        row[x0 >> 2] = (row[x0 >> 2] & ~(3 << shift)) | (index << shift);
+        x0++;
+    }
+}
+
+void IndexedFramebuffer::clear(uint8_t index) {
+    memset(plane, (uint8_t)(index * 0x55), (size_t)band_rows * IFB_STRIDE);
+}
+
+void IndexedFramebuffer::pixel(int16_t x, int16_t y, uint8_t index) {
+    int16_t r = y - band_y0;
+    if (r < 0 || r >= band_rows || x < 0 || x >= area_w) return;
+    uint8_t shift = (x & 3) * 2;
+    plane[r][x >> 2] = (plane[r][x >> 2] & ~(3 << shift)) | (index << shift);
+}
+
+void IndexedFramebuffer::hline(int16_t x, int16_t y, int16_t w, uint8_t index) {
+    int16_t r = y - band_y0;
+    if (r < 0 || r >= band_rows || w <= 0) return;
+    int16_t x1 = x + w - 1;
+    if (x < 0) x = 0;
+    if (x1 >= area_w) x1 = area_w - 1;
+    if (x > x1) return;
+    fill_span(plane[r], x, x1, index);
+}
+
+void IndexedFramebuffer::vline(int16_t x, int16_t y0, int16_t y1, uint8_t index) {
+    if (x < 0 || x >= area_w) return;
+    if (y0 > y1) { int16_t t = y0; y0 = y1; y1 = t; }
+    // Clip to the band
+    int16_t r0 = y0 - band_y0;
+    int16_t r1 = y1 - band_y0;
+    if (r1 < 0 || r0 >= band_rows) return;
+    if (r0 < 0) r0 = 0;
+    if (r1 >= band_rows) r1 = band_rows - 1;
+
+    uint8_t shift = (x & 3) * 2;
+    uint8_t mask = ~(3 << shift);
+    uint8_t bits = index << shift;
+    int16_t col = x >> 2;
+    for (int16_t r = r0; r <= r1; ++r) {
+        plane[r][col] = (plane[r][col] & mask) | bits;
+    }
+}
+
+void IndexedFramebuffer::dashed_hline(int16_t x, int16_t y, int16_t w, uint8_t index, uint8_t period) {
+    int16_t r = y - band_y0;
+    if (r < 0 || r >= band_rows) return;
+    if (period < 2) { hline(x, y, w, index); return; }
+    // Dash on for the first half of each period
+    for (int16_t i = 0; i < w; i += period) {
+        int16_t dash = period / 2;
+        if (i + dash > w) dash = w - i;
+        hline(x + i, y, dash, index);
+    }
+}
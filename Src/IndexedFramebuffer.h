@@ -0,0 +1,63 @@
+#ifndef INDEXED_FRAMEBUFFER_H
+#define INDEXED_FRAMEBUFFER_H
+
+#include <stdint.h>
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // For ILI9341_Display / ILI9341_Bus
+
+// Configuration constants
+#define IFB_MAX_WIDTH   320 // Widest area that can be rendered (pixels)
+#define IFB_BAND_ROWS   32  // Rows composed in RAM at a time. 32 rows = 2.5 KB.
+                            // Setting this to the area height (e.g. 230) gives a full
+                            // 2-bpp plane (~18 KB) and a single band per frame.
+#define IFB_STRIDE      ((IFB_MAX_WIDTH + 3) / 4) // Bytes per row, 4 pixels per byte
+#define IFB_NUM_COLORS  4
+
+// Palette-indexed (2 bits per pixel) off-screen renderer.
+// A frame is composed band by band: the paint callback draws the whole scene with the
+// primitives below, which clip to the band currently held in RAM. Each finished band is
+// expanded to RGB565 one line at a time into a DMA line buffer while the previous line
+// is still going out, and all bands stream into a single ILI9341 window. Cost per frame
+// is therefore fixed by the area size, not by how busy the waveform is.
+class IndexedFramebuffer {
+public:
+    typedef void (*PaintFn)(IndexedFramebuffer& fb, void* ctx);
+
+    IndexedFramebuffer(ILI9341_Display* display);
+
+    // Screen rectangle covered by the framebuffer
+    void set_area(int16_t x, int16_t y, int16_t w, int16_t h);
+    void set_palette(uint8_t index, uint16_t color);
+
+    // Compose and push the whole area, or only rows [row_from, row_to] (area-relative)
+    void render(PaintFn paint, void* ctx);
+    void render_rows(int16_t row_from, int16_t row_to, PaintFn paint, void* ctx);
+
+    // Drawing primitives. Coordinates are relative to the area; everything is clipped
+    // to the band being composed, so the painter never needs to know about bands.
+    void clear(uint8_t index);
+    void pixel(int16_t x, int16_t y, uint8_t index);
+    void hline(int16_t x, int16_t y, int16_t w, uint8_t index);
+    void vline(int16_t x, int16_t y0, int16_t y1, uint8_t index); // Inclusive, any order
+    void dashed_hline(int16_t x, int16_t y, int16_t w, uint8_t index, uint8_t period);
+
+    int16_t width() const { return area_w; }
+    int16_t height() const { return area_h; }
+    uint32_t last_render_cycles() const { return render_cycles; } // DWT cycles of last render
+
+private:
+    ILI9341_Display* tft;
+
+    int16_t area_x, area_y, area_w, area_h;
+    int16_t band_y0;   // First area row held in plane[0]
+    int16_t band_rows; // Rows valid in the current band
+
+    uint8_t plane[IFB_BAND_ROWS][IFB_STRIDE];
+    uint16_t palette_be[IFB_NUM_COLORS];       // Byte-swapped for the SPI stream
+    uint16_t line_buf[2][IFB_MAX_WIDTH];       // Ping-pong RGB565 lines for SPI DMA
+    uint32_t render_cycles;
+
+    void fill_span(uint8_t* row, int16_t x0, int16_t x1, uint8_t index);
+    void flush_band(uint8_t& line_sel);
+};
+
+#endif // INDEXED_FRAMEBUFFER_H
@@ -1,12 +1,83 @@
 #include "LogicAnalyzer.h"
-#include <stdio.h> // For sprintf if used for labels
 
 // Constructor
 LogicAnalyzer::LogicAnalyzer(TIM_HandleTypeDef* timer_handle, Adafruit_ILI9341* display_handle)
     : htim_sample(timer_handle),
       tft(display_handle),
+      sample_buf(nullptr),
+      capacity(0),
+      depth(0),
+      depth_request(LA_MAX_DEPTH),
+      mode(LA_MODE_SAMPLES),
+      rle_buf(nullptr),
+      rle_capacity(0),
+      rle_span(LA_RLE_DEFAULT_SPAN),
+      rle_total(0),
+      rle_since(0),
+      rle_last(0),
+      rle_gap(false),
+      tstats(),
+      htim_edge(nullptr),
+      dma_lender(nullptr),
+      edge_ch4_write(0),
+      edge_now(0),
+      edge_span(LA_EDGE_DEFAULT_SPAN),
+      edge_last_t(0),
+      edge_state(0),
+      htim_state(nullptr),
+      state_rising(true),
+      sstats(),
+      htim_count(nullptr),
+      trig_count(0),
+      trig_pre_pct(LA_TRIG_DEFAULT_PRE_PCT),
+      trig_prev(0),
+      trig_chunk(0),
+      trig_scanned(0),
+      trig_now(0),
+      trig_at(0),
+      trig_end(0),
+      trig_stats(),
+      mix_hw(nullptr),
+      mix_adc(nullptr),
+      mix_saved_adc(),
+      mix_saved_dma_mode(0),
+      mix_ratio(LA_MIX_MIN_RATIO),
+      mix_n(0),
+      mix_len(0),
+      mix_buf(nullptr),
+      mix_phase(0),
+      mix_running(false),
+      mix_done(false),
+      mix_trig(false),
+      mix_trig_rising(true),
+      mix_trig_level(2048),
+      mix_prev(0),
+      mix_scanned(0),
+      ann_list(nullptr),
+      ann_count(0),
+      ann_rows(0),
+      live(false),
+      frame_valid(false),
+      frame_columns(0),
+      frame_marker(-1),
+      frames(0),
+      view_start(0),
+      view_len(0),
+      seek_points(0),
+      seek_stride(0),
+      frame_first(0),
+      frame_span(0),
+      cursors_placed(false),
+      meas(),
+      meas_valid(false),
+      measure_ch(0),
+      held(false),
       current_sample_index(0),
-      current_la_status(LA_IDLE) { // Initialize status to IDLE
+      current_la_status(LA_IDLE), // Initialize status to IDLE
+      last_arm_fault(LA_ARM_OK),
+      stats(),
+      probe_result(),
+      start_cycles(0) {
     if (tft) {
         screen_width = tft->width();
         screen_height = tft->height();
@@ -15,86 +86,1218 @@ LogicAnalyzer::LogicAnalyzer(TIM_HandleTypeDef* timer_handle, Adafruit_ILI9341*
         screen_width = 320;
         screen_height = 240;
     }
-    channel_height = screen_height / LA_NUM_CHANNELS;
+    area_y = 0;
+    area_h = screen_height;
+    for (int k = 0; k < 2; ++k) {
+        cursors[k] = 0;
+        cursor_col[k] = -1;
+    }
+    update_layout();
     wave_area_x_start = 30; // Small margin for channel names/labels
     wave_area_width = screen_width - wave_area_x_start - 5; // And a bit of end margin
+    // Captures deeper than the width are compressed onto it by draw_waveforms()
+}
+
+void LogicAnalyzer::set_capture_buffer(uint8_t* buf, uint32_t len) {
+    if (current_la_status == LA_CAPTURING) return;
+    sample_buf = (la_sample_t*)buf;
+    capacity = buf ? len / sizeof(la_sample_t) : 0;
+    depth = (capacity < LA_MAX_DEPTH) ? capacity : LA_MAX_DEPTH;
+    depth_request = LA_MAX_DEPTH;
+    mix_done = false;
+    // Records follow the staging ring (arena base is word aligned, the ring a multiple of 4)
+    rle_buf = (capacity > LA_RLE_STAGE_SAMPLES) ? (uint32_t*)(sample_buf + LA_RLE_STAGE_SAMPLES) : nullptr;
+    rle_capacity = rle_buf ? (capacity - LA_RLE_STAGE_SAMPLES) * sizeof(la_sample_t) / 4 : 0;
+    // Edge mode keeps its capture rings in the staging area instead
+    for (int k = 0; k < 4; ++k) {
+        edge_ring[k] = rle_buf ? (uint16_t*)buf + k * LA_EDGE_RING : nullptr;
+    }
+    current_sample_index = 0;
+    current_la_status = LA_IDLE;
+}
+
+void LogicAnalyzer::set_capture_mode(LA_CaptureMode new_mode) {
+    if (current_la_status == LA_CAPTURING || new_mode == mode) return;
+    mode = new_mode;
+    if (mode != LA_MODE_SAMPLES) set_mixed_signal(false); // Sample mode only
+    // The buffer holds the other format now
+    current_sample_index = 0;
+    current_la_status = LA_IDLE;
+}
+
+LA_TriggerStage LogicAnalyzer::make_trigger_stage(const LA_TriggerCondition cond[LA_NUM_CHANNELS]) {
+    LA_TriggerStage st = { 0, 0, 0 };
+    for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) {
+        la_sample_t bit = (la_sample_t)(1 << ch);
+        switch (cond[ch]) {
+            case LA_TRIG_LOW:     st.level_mask |= bit; break;
+            case LA_TRIG_HIGH:    st.level_mask |= bit; st.level_value |= bit; break;
+            case LA_TRIG_RISING:  st.level_mask |= bit; st.level_value |= bit; st.edge_mask |= bit; break;
+            case LA_TRIG_FALLING: st.level_mask |= bit; st.edge_mask |= bit; break;
+            case LA_TRIG_EITHER:  st.edge_mask |= bit; break;
+            default: break; // Don't care
+        }
+    }
+    return st;
+}
+
+void LogicAnalyzer::set_trigger(const LA_TriggerStage* stages, uint8_t count) {
+    if (current_la_status == LA_CAPTURING) return;
+    if (!stages) count = 0;
+    if (count > LA_TRIG_MAX_STAGES) count = LA_TRIG_MAX_STAGES;
+    for (uint8_t i = 0; i < count; ++i) trig_stages[i] = stages[i];
+    trig_count = count;
+}
+
+void LogicAnalyzer::set_pretrigger_percent(uint8_t pct) {
+    trig_pre_pct = (pct > LA_TRIG_MAX_PRE_PCT) ? LA_TRIG_MAX_PRE_PCT : pct;
+}
+
+void LogicAnalyzer::set_mixed_adc(ADC_HandleTypeDef* hadc, uint16_t ratio) {
+    if (current_la_status == LA_CAPTURING) return;
+    if (!hadc) set_mixed_signal(false);
+    mix_hw = hadc;
+    if (mix_adc) mix_adc = hadc;
+    mix_ratio = (ratio < LA_MIX_MIN_RATIO) ? LA_MIX_MIN_RATIO : ratio;
+}
+
+void LogicAnalyzer::set_mixed_signal(bool on) {
+    if (current_la_status == LA_CAPTURING) return;
+    ADC_HandleTypeDef* hadc = (on && mode == LA_MODE_SAMPLES) ? mix_hw : nullptr;
+    if (hadc == mix_adc) return;
+    mix_adc = hadc;
+    mix_done = false;
+    update_layout(); // The analog band comes or goes
+}
+
+void LogicAnalyzer::set_analog_trigger(bool on, uint16_t level, bool rising) {
+    if (current_la_status == LA_CAPTURING) return;
+    mix_trig = on;
+    mix_trig_level = level;
+    mix_trig_rising = rising;
+}
+
+LogicSamples LogicAnalyzer::samples() const {
+    uint32_t n = (is_capturing() || held) ? 0 : current_sample_index;
+    if (mode == LA_MODE_TRANSITIONS || mode == LA_MODE_EDGES) {
+        LogicSamples view(rle_buf, n ? tstats.records : 0, n, LA_CHANNEL_MASK);
+        if (n) view.set_index(seek_starts, seek_points, seek_stride);
+        return view;
+    }
+    return LogicSamples(sample_buf, n, LA_CHANNEL_MASK);
+}
+
+uint32_t LogicAnalyzer::max_sample_hz() const {
+    return probe_result.max_hz ? probe_result.max_hz : timer_clock_hz() / LA_MIN_TIMER_TICKS;
+}
+
+uint32_t LogicAnalyzer::compression_x100() const {
+    if (tstats.records == 0) return 0;
+    // Against the raw capture format, one la_sample_t per sample
+    return (uint32_t)((uint64_t)tstats.samples * sizeof(la_sample_t) * 100 / (tstats.records * 4));
+}
+
+void LogicAnalyzer::set_capture_depth(uint32_t samples) {
+    if (current_la_status == LA_CAPTURING) return;
+    depth_request = samples;
+    if (samples > capacity) samples = capacity;
+    if (samples > LA_MAX_DEPTH) samples = LA_MAX_DEPTH;
+    depth = samples;
+}
+
+void LogicAnalyzer::set_display_area(int16_t y, int16_t h) {
+    area_y = y;
+    area_h = h;
+    update_layout();
+}
+
+void LogicAnalyzer::set_annotations(const LA_Annotation* list, uint16_t count, uint8_t rows) {
+    ann_list = list;
+    ann_count = list ? count : 0;
+    if (rows != ann_rows) {
+        ann_rows = rows;
+        update_layout(); // Channels move down to make room; display() redraws the grid
+    }
+}
+
+void LogicAnalyzer::update_layout() {
+    // Annotation rows, then the analog band (mixed signal), then the channels
+    int16_t top = ann_rows * LA_ANN_ROW_H + (mix_adc ? LA_MIX_ANALOG_H : 0);
+    chan_y = area_y + top;
+    channel_height = (area_h - top) / LA_NUM_CHANNELS;
+    frame_valid = false; // Slots moved: the next frame is drawn whole
+}
+
+// Sampling timer helpers
+uint32_t LogicAnalyzer::timer_clock_hz() {
+    // TIM2 is on APB1; its clock is 2x PCLK1 whenever the APB1 prescaler is not 1
+    // (72 MHz with the 36 MHz APB1 of the .ioc clock tree)
+    uint32_t pclk1 = HAL_RCC_GetPCLK1Freq();
+    return ((RCC->CFGR & RCC_CFGR_PPRE1) == RCC_CFGR_PPRE1_DIV1) ? pclk1 : pclk1 * 2;
+}
+
+uint32_t LogicAnalyzer::program_timer(uint32_t ticks) {
+    if (ticks < LA_MIN_TIMER_TICKS) ticks = LA_MIN_TIMER_TICKS;
+    uint32_t prescaler_val = (ticks - 1) >> 16; // ARR is 16 bits; prescale only slow rates
+    uint32_t arr_val = ticks / (prescaler_val + 1) - 1;
+
+    __HAL_TIM_DISABLE(htim_sample);
+    __HAL_TIM_SET_PRESCALER(htim_sample, prescaler_val);
+    __HAL_TIM_SET_AUTORELOAD(htim_sample, arr_val);
+    __HAL_TIM_SET_COUNTER(htim_sample, 0);
+    htim_sample->Instance->EGR = TIM_EGR_UG; // Load PSC now, before any DMA request is enabled
+    __HAL_TIM_CLEAR_FLAG(htim_sample, TIM_FLAG_UPDATE);
 
-    // Ensure LA_BUFFER_SAMPLES is not greater than drawable width
-    if (LA_BUFFER_SAMPLES > wave_area_width) {
-        // This would be an issue, ideally LA_BUFFER_SAMPLES should match screen width pixels available for waveform
-        // For now, we proceed, but drawing might be truncated or require scaling.
-        // The current design draws 1 sample per horizontal pixel up to LA_BUFFER_SAMPLES or wave_area_width.
+    return timer_clock_hz() / ((prescaler_val + 1) * (arr_val + 1));
+}
+
+void LogicAnalyzer::stop_sampling() {
+    if (mode == LA_MODE_EDGES) {
+        HAL_TIM_Base_Stop_IT(htim_sample); // Drain tick
+        stop_edges();
+    } else if (mode == LA_MODE_STATE) {
+        stop_state();
+    } else if (stats.dma) {
+        __HAL_TIM_DISABLE_DMA(htim_sample, TIM_DMA_UPDATE);
+        __HAL_TIM_DISABLE(htim_sample);
+        if (trigger_enabled()) stop_counter();
+        if (mix_running) stop_mixed();
+    } else {
+        HAL_TIM_Base_Stop_IT(htim_sample);
     }
 }
 
+void LogicAnalyzer::set_dma_mode(uint32_t dma_mode) {
+    DMA_HandleTypeDef* hdma = sample_dma();
+    if (!hdma) return;
+    if (hdma->Init.Mode == dma_mode && hdma->Init.MemDataAlignment == LA_Traits::dma_mem_align) return;
+    hdma->Init.Mode = dma_mode; // CubeMX sets up DMA_NORMAL; the transition ring needs circular
+    hdma->Init.MemDataAlignment = LA_Traits::dma_mem_align; // Byte or halfword, as la_sample_t
+    HAL_DMA_Init(hdma);
+}
+
+DMA_HandleTypeDef* LogicAnalyzer::sample_dma() const {
+    // Linked by CubeMX in MX_TIM2_Init (__HAL_LINKDMA(htim, hdma[TIM_DMA_ID_UPDATE], hdma_tim2_up))
+    return htim_sample ? htim_sample->hdma[TIM_DMA_ID_UPDATE] : NULL;
+}
+
 // Control methods
 void LogicAnalyzer::begin(uint32_t sample_freq_hz) {
     if (!htim_sample || current_la_status == LA_CAPTURING) return; // Don't restart if already capturing
+    if (!sample_buf || depth == 0) return; // No capture memory assigned
+    if (held) return; // Still being sent out
+    last_arm_fault = LA_ARM_OK;
+    ann_count = 0; // They belong to the capture about to be replaced
+    frame_valid = false; // Callers redraw the background first (rearm() keeps it)
+    view_start = 0;      // Whole capture (rearm() keeps the window too)
+    view_len = 0;
+    seek_points = 0;     // Rebuilt when the capture is displayed
+    cursors_placed = false;
+    meas_valid = false;
+
+    if (mode == LA_MODE_EDGES) { // Timestamps instead of samples; the rate does not apply
+        if (begin_edges()) stats.requested_hz = sample_freq_hz;
+        return;
+    }
+    if (mode == LA_MODE_STATE) { // Paced by the target's clock
+        if (begin_state()) stats.requested_hz = 0;
+        return;
+    }
+
+    DMA_HandleTypeDef* hdma = sample_dma();
+    // The encoder works on DMA halves; there is no per-sample fallback for it
+    if (mode == LA_MODE_TRANSITIONS && (!hdma || rle_capacity == 0 || rle_span == 0)) return;
+    // Same for the trigger scan, which also needs the sample counter, and for mixed signal
+    bool triggered = (mode == LA_MODE_SAMPLES && trigger_enabled());
+    bool mixed = (mode == LA_MODE_SAMPLES && mix_adc);
+    if (triggered && (!hdma || !htim_count)) return;
+    if (mixed && (!hdma || !htim_edge || (DMA1_Channel1->CCR & DMA_CCR_EN))) return; // Scope still running
+
+    uint32_t timer_clock_freq = timer_clock_hz();
+    if (timer_clock_freq == 0 || sample_freq_hz == 0) { // Safety check if clock config is not found
+        return;
+    }
+
+    // Never faster than the DMA was measured to sustain (or the hard limit if not probed)
+    stats.requested_hz = sample_freq_hz;
+    uint32_t max_hz = max_sample_hz();
+    if (sample_freq_hz > max_hz) sample_freq_hz = max_hz;
+    stats.timer_hz = program_timer(timer_clock_freq / sample_freq_hz);
+    stats.elapsed_cycles = 0;
+
+    // Depth as set, unless a mixed capture gives part of the arena to the ADC
+    depth = depth_request;
+    if (depth > capacity) depth = capacity;
+    if (depth > LA_MAX_DEPTH) depth = LA_MAX_DEPTH;
+    mix_done = false;
+    if (mixed && !split_mixed(stats.timer_hz)) return;
+    if (triggered && depth < LA_TRIG_CHUNKS * LA_TRIG_STOP_SLACK) return;
+    if (mixed && !begin_mixed(triggered)) return;
 
     current_sample_index = 0;
+    trig_stats = LA_TriggerStats();
     current_la_status = LA_CAPTURING;
 
-    // Configure timer PSC and ARR
-    // Assuming PCLK1 is the clock source for TIM2 (common case)
-    // And PCLK1 is 72MHz as discussed.
-    uint32_t timer_clock_freq = HAL_RCC_GetPCLK1Freq(); 
-    // If timer is TIM1 (APB2), use HAL_RCC_GetPCLK2Freq()
-    // For STM32F103, if APB1 Prescaler is /1, PCLK1 = HCLK (e.g. 72MHz)
-    // If APB1 Prescaler is /2, PCLK1 = HCLK/2 (e.g. 36MHz)
-    // The previous .ioc file set APB1 Prescaler to /2 (36MHz), and APB2 to /1 (72MHz)
-    // Let's assume TIM2 is used, so PCLK1 is 36MHz.
-    // If the problem statement's 72MHz for timer is firm, PCLK1 must be 72MHz OR TIM1/TIM8 used.
-    // Re-evaluating based on previous .ioc: PCLK1 = 36MHz.
-    // So, for 1MHz sampling (1us period):
-    // 36MHz / 1MHz = 36. So, (PSC+1)*(ARR+1) = 36.
-    // If PSC = 0, ARR = 35.
-    // If PSC = 1, ARR = 17. ( (1+1)*(17+1) = 2*18 = 36 )
-    // Let's choose PSC=0 for higher resolution adjustments.
-    // ARR = (timer_clock_freq / sample_freq_hz) - 1;
-
-    if (timer_clock_freq == 0) { // Safety check if clock config is not found
-        // Fallback or error
+    stats.dma = (hdma != NULL);
+    if (!hdma) {
+        // No DMA channel configured in CubeMX (TIM2_UP -> DMA1_Channel2), one interrupt per sample
+        start_cycles = DWT->CYCCNT;
+        HAL_TIM_Base_Start_IT(htim_sample);
         return;
     }
-    
-    uint32_t prescaler_val = 0; // Default for simplicity
-    uint32_t arr_val = (timer_clock_freq / (prescaler_val + 1) / sample_freq_hz) - 1;
 
-    __HAL_TIM_SET_PRESCALER(htim_sample, prescaler_val);
-    __HAL_TIM_SET_AUTORELOAD(htim_sample, arr_val);
-
-    HAL_TIM_Base_Start_IT(htim_sample);
+    // The first sample is taken one period after the counter starts
+    if (mode == LA_MODE_TRANSITIONS) {
+        rle_total = 0;
+        rle_since = 0;
+        rle_gap = false;
+        tstats = LA_TransitionStats();
+        set_dma_mode(DMA_CIRCULAR);
+        HAL_DMA_Start_IT(hdma, (uint32_t)&LA_PORT->IDR, (uint32_t)sample_buf, LA_RLE_STAGE_SAMPLES);
+    } else if (triggered) {
+        begin_triggered();
+    } else {
+        set_dma_mode(DMA_NORMAL);
+        HAL_DMA_Start_IT(hdma, (uint32_t)&LA_PORT->IDR, (uint32_t)sample_buf, depth);
+    }
+    __HAL_TIM_ENABLE_DMA(htim_sample, TIM_DMA_UPDATE);
+    start_cycles = DWT->CYCCNT;
+    __HAL_TIM_ENABLE(htim_sample);
 }
 
 void LogicAnalyzer::stop() {
     if (!htim_sample) return;
-    HAL_TIM_Base_Stop_IT(htim_sample);
+    stop_sampling();
     if (current_la_status == LA_CAPTURING) { // If stopped during capture, move to IDLE
+        if (stats.dma && mode != LA_MODE_EDGES && mode != LA_MODE_STATE) HAL_DMA_Abort(sample_dma());
         current_la_status = LA_IDLE;
     }
     // If stopped after capture done, status remains LA_DONE_PENDING_DISPLAY or LA_DONE_DISPLAYED
 }
 
-// Called by timer ISR
-void LogicAnalyzer::process_capture_ISR() {
-    if (current_la_status != LA_CAPTURING) return;
-
-    if (current_sample_index < LA_BUFFER_SAMPLES) {
-        // Read PC0-PC3 (Channels 0-3)
-        uint8_t ch0_state = HAL_GPIO_ReadPin(LA_CH0_PORT, LA_CH0_PIN) == GPIO_PIN_SET ? 1 : 0;
-        uint8_t ch1_state = HAL_GPIO_ReadPin(LA_CH1_PORT, LA_CH1_PIN) == GPIO_PIN_SET ? 1 : 0;
-        uint8_t ch2_state = HAL_GPIO_ReadPin(LA_CH2_PORT, LA_CH2_PIN) == GPIO_PIN_SET ? 1 : 0;
-        uint8_t ch3_state = HAL_GPIO_ReadPin(LA_CH3_PORT, LA_CH3_PIN) == GPIO_PIN_SET ? 1 : 0;
-
-        la_buffer[0][current_sample_index] = ch0_state;
-        la_buffer[1][current_sample_index] = ch1_state;
-        la_buffer[2][current_sample_index] = ch2_state;
-        la_buffer[3][current_sample_index] = ch3_state;
+// Called by timer ISR (fallback path without DMA)
+bool LogicAnalyzer::process_capture_ISR() {
+    if (current_la_status != LA_CAPTURING) return false;
+    if (mode == LA_MODE_EDGES) return edge_drain();
 
+    if (current_sample_index < depth) {
+        // One read of the port, same layout the DMA writes (PCn is bit n)
+        sample_buf[current_sample_index] = (la_sample_t)LA_PORT->IDR;
         current_sample_index++;
     } else { // Buffer full
         HAL_TIM_Base_Stop_IT(htim_sample); // Stop timer directly from ISR for speed
+        stats.elapsed_cycles = DWT->CYCCNT - start_cycles;
         current_la_status = LA_DONE_PENDING_DISPLAY;
+        return true;
+    }
+    return false;
+}
+
+void LogicAnalyzer::finish_capture() {
+    stats.elapsed_cycles = DWT->CYCCNT - start_cycles;
+    stop_sampling();
+    if (mode == LA_MODE_TRANSITIONS || (mode == LA_MODE_SAMPLES && trigger_enabled())) {
+        HAL_DMA_Abort(sample_dma()); // Circular: it would otherwise keep going
+    }
+    current_la_status = LA_DONE_PENDING_DISPLAY;
+}
+
+// Called from the DMA half-transfer interrupt
+bool LogicAnalyzer::capture_half_ISR() {
+    if (mode != LA_MODE_TRANSITIONS) return false; // Sample mode only needs the end
+    return encode_half(0);
+}
+
+// Called from the DMA transfer-complete interrupt
+bool LogicAnalyzer::capture_complete_ISR() {
+    if (mode == LA_MODE_TRANSITIONS) return encode_half(1);
+    if (current_la_status != LA_CAPTURING) return false;
+    current_sample_index = depth;
+    if (mix_running) finish_mixed(depth);
+    finish_capture();
+    return true;
+}
+
+bool LogicAnalyzer::encode_half(uint32_t half) {
+    if (current_la_status != LA_CAPTURING) return false;
+    uint32_t start = DWT->CYCCNT;
+    const uint32_t half_len = LA_RLE_STAGE_SAMPLES / 2;
+    uint32_t n = half_len;
+    if (n > rle_span - rle_total) n = rle_span - rle_total;
+
+    // The DMA should be filling the other half by now. If it is already back in this one,
+    // the interrupt came too late and these samples are being overwritten: skip them but
+    // keep counting time, so later timestamps stay right.
+    uint32_t write_pos = LA_RLE_STAGE_SAMPLES - sample_dma()->Instance->CNDTR;
+    if (write_pos / half_len == half) {
+        tstats.overruns++;
+        rle_since += n;
+        rle_total += n;
+        rle_gap = true;
+    } else {
+        const la_sample_t* p = sample_buf + half * half_len;
+        if (rle_gap && tstats.records > 0 && (p[0] & LA_CHANNEL_MASK) != rle_last) {
+            tstats.dropped_transitions++; // Recorded below, but late and maybe not alone
+        }
+        rle_gap = false;
+
+        la_sample_t last = rle_last;
+        uint32_t since = rle_since;
+        uint32_t records = tstats.records;
+        uint32_t i = 0;
+        for (; i < n; ++i) {
+            la_sample_t s = p[i] & LA_CHANNEL_MASK;
+            if (s != last || since == LA_Record::max_delta || records == 0) {
+                if (records == rle_capacity) {
+                    tstats.full = true;
+                    break;
+                }
+                if (s != last && records > 0) tstats.transitions++;
+                rle_buf[records++] = LA_Record::make(since, s);
+                last = s;
+                since = 0;
+            }
+            since++;
+        }
+        rle_last = last;
+        rle_since = since;
+        tstats.records = records;
+        rle_total += i;
+    }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > tstats.encode_max_cycles) tstats.encode_max_cycles = cycles;
+
+    if (!tstats.full && rle_total < rle_span) return false;
+    tstats.samples = rle_total;
+    current_sample_index = rle_total;
+    finish_capture();
+    return true;
+}
+
+// Triggered capture
+void LogicAnalyzer::begin_triggered() {
+    trig_chunk = depth / LA_TRIG_CHUNKS;
+    trig_scanned = 0;
+    trig_now = 0;
+    trig_at = 0;
+    trig_end = 0;
+
+    // No DMA interrupts: TIM3 paces the scans
+    set_dma_mode(DMA_CIRCULAR);
+    HAL_DMA_Start(sample_dma(), (uint32_t)&LA_PORT->IDR, (uint32_t)sample_buf, depth);
+
+    // TIM2 update -> TRGO -> TIM3 (ITR1) in external clock mode: TIM3 counts samples
+    TIM_TypeDef* sample_tim = htim_sample->Instance;
+    sample_tim->CR2 = (sample_tim->CR2 & ~TIM_CR2_MMS) | TIM_CR2_MMS_1;
+    TIM_TypeDef* cnt = htim_count->Instance;
+    cnt->CR1 = 0;
+    cnt->DIER = 0;
+    cnt->PSC = 0;
+    cnt->ARR = 0xFFFF;
+    cnt->CCMR1 = 0; // Frozen outputs; only the compare flags are used
+    cnt->CCER = 0;
+    cnt->SMCR = TIM_SMCR_TS_0 | TIM_SMCR_SMS;
+    cnt->EGR = TIM_EGR_UG;
+    cnt->CNT = 0;
+    cnt->CCR2 = trig_chunk;
+    cnt->SR = 0;
+    cnt->DIER = TIM_DIER_CC2IE;
+    cnt->CR1 = TIM_CR1_CEN; // Counts only when TIM2 runs
+}
+
+void LogicAnalyzer::stop_counter() {
+    if (!htim_count) return;
+    TIM_TypeDef* cnt = htim_count->Instance;
+    cnt->CR1 = 0;
+    cnt->DIER = 0;
+    cnt->SR = 0;
+    cnt->SMCR = 0;
+}
+
+uint32_t LogicAnalyzer::trigger_count_now() {
+    // Called at least once per chunk (far less than the 16-bit wrap)
+    uint16_t c = (uint16_t)htim_count->Instance->CNT;
+    trig_now += (uint16_t)(c - (uint16_t)trig_now);
+    return trig_now;
+}
+
+bool LogicAnalyzer::arm_trigger_stop() {
+    TIM_TypeDef* cnt = htim_count->Instance;
+    cnt->DIER = 0;
+    cnt->CCR1 = (uint16_t)trig_end;
+    cnt->SR = ~TIM_SR_CC1IF;
+    cnt->DIER = TIM_DIER_CC1IE;
+    // The compare fires only on an exact match: if the count is already there, stop now
+    return (int32_t)(trigger_count_now() - trig_end) >= 0;
+}
+
+// Called from the TIM3 CC2 interrupt, once per chunk
+bool LogicAnalyzer::trigger_scan_ISR() {
+    if (current_la_status != LA_CAPTURING || !trigger_enabled() || trig_stats.triggered) return false;
+    uint32_t start = DWT->CYCCNT;
+    TIM_TypeDef* cnt = htim_count->Instance;
+    cnt->CCR2 = (uint16_t)(cnt->CCR2 + trig_chunk);
+    uint32_t now = trigger_count_now();
+    bool found = (mix_adc && mix_trig) ? scan_analog(now) : scan_pattern(now);
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > trig_stats.scan_max_cycles) trig_stats.scan_max_cycles = cycles;
+    if (!found) return false;
+
+    trig_stats.triggered = true;
+    uint32_t post = depth - depth * trig_pre_pct / 100;
+    if (post > depth - LA_TRIG_STOP_SLACK) post = depth - LA_TRIG_STOP_SLACK;
+    trig_end = trig_at + post;
+    if (trig_end < depth) trig_end = depth; // Early trigger: still fill the buffer once
+    if (!arm_trigger_stop()) return false;
+    finish_triggered();
+    return true;
+}
+
+bool LogicAnalyzer::scan_pattern(uint32_t now) {
+    // Everything the DMA has written since the last scan, up to its current position
+    uint32_t pos = (depth - sample_dma()->Instance->CNDTR) % depth;
+    if (now - trig_scanned >= depth) {
+        // The scan fell a whole buffer behind: those samples are gone, resume at the DMA
+        trig_stats.overruns++;
+        trig_scanned = now - ((now % depth + depth - pos) % depth);
+        trig_prev = sample_buf[(pos + depth - 1) % depth];
+    }
+    uint32_t i = trig_scanned % depth;
+    uint32_t avail = (pos + depth - i) % depth;
+    if (trig_scanned == 0 && avail > 0) trig_prev = sample_buf[0]; // No edge into the first sample
+
+    // Two compares per sample against the current stage (see LA_TriggerStage)
+    const LA_TriggerStage* st = &trig_stages[trig_stats.stage];
+    la_sample_t prev = trig_prev;
+    uint32_t k = 0;
+    bool found = false;
+    while (k < avail) {
+        la_sample_t s = sample_buf[i];
+        k++;
+        if ((s & st->level_mask) == st->level_value && ((s ^ prev) & st->edge_mask) == st->edge_mask) {
+            if (++trig_stats.stage == trig_count) {
+                found = true;
+                break;
+            }
+            st++;
+        }
+        prev = s;
+        if (++i == depth) i = 0;
+    }
+    trig_prev = prev;
+    trig_scanned += k;
+    if (found) trig_at = trig_scanned - 1;
+    return found;
+}
+
+// Same walk over the ADC ring: conversion c was taken with sample c * mix_n
+bool LogicAnalyzer::scan_analog(uint32_t now) {
+    uint32_t m = mix_len;
+    uint32_t convs = (now + mix_n - 1) / mix_n; // Triggered so far
+    uint32_t pos = (m - mix_adc->DMA_Handle->Instance->CNDTR) % m;
+    if (convs - mix_scanned >= m) {
+        trig_stats.overruns++;
+        mix_scanned = convs - ((convs % m + m - pos) % m);
+        mix_prev = mix_buf[(pos + m - 1) % m];
+    }
+    uint32_t i = mix_scanned % m;
+    uint32_t avail = (pos + m - i) % m;
+    if (mix_scanned == 0 && avail > 0) mix_prev = mix_buf[0];
+
+    uint16_t prev = mix_prev;
+    uint16_t level = mix_trig_level;
+    uint32_t k = 0;
+    bool found = false;
+    while (k < avail) {
+        uint16_t v = mix_buf[i];
+        k++;
+        if (mix_trig_rising ? (prev < level && v >= level) : (prev > level && v <= level)) {
+            found = true;
+            break;
+        }
+        prev = v;
+        if (++i == m) i = 0;
+    }
+    mix_prev = prev;
+    mix_scanned += k;
+    if (found) trig_at = (mix_scanned - 1) * mix_n;
+    return found;
+}
+
+// Called from the TIM3 CC1 interrupt at the end of the post-trigger part
+bool LogicAnalyzer::trigger_stop_ISR() {
+    if (current_la_status != LA_CAPTURING || !trig_stats.triggered) return false;
+    finish_triggered();
+    return true;
+}
+
+// Reverse a range in place (three of these rotate a ring)
+template <typename T>
+static void reverse_range(T* a, uint32_t n) {
+    for (uint32_t i = 0, j = n; i + 1 < j; ++i) {
+        --j;
+        T t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+    }
+}
+
+la_sample_t* LogicAnalyzer::hold_capture(uint32_t* count) {
+    if (is_capturing() || held || mode == LA_MODE_TRANSITIONS || mode == LA_MODE_EDGES) return nullptr;
+    held = true;
+    *count = current_sample_index;
+    return sample_buf;
+}
+
+void LogicAnalyzer::finish_triggered() {
+    __HAL_TIM_DISABLE(htim_sample); // No more requests; TIM3 stops counting with it
+    uint32_t total = trigger_count_now();
+    // The last request may still be in flight; it lands within a few bus cycles
+    DMA_Channel_TypeDef* ch = sample_dma()->Instance;
+    for (int n = 0; n < 16 && (depth - ch->CNDTR) % depth != total % depth; ++n) {
+    }
+    uint32_t oldest = (depth - ch->CNDTR) % depth; // Next write position
+
+    // Rotate the ring so samples() starts with the oldest sample (2 * depth sample swaps)
+    reverse_range(sample_buf, oldest);
+    reverse_range(sample_buf + oldest, depth - oldest);
+    reverse_range(sample_buf, depth);
+
+    uint32_t since = total - trig_at; // Samples from the trigger to the end, trigger included
+    trig_stats.trigger_index = (since <= depth) ? depth - since : 0;
+    current_sample_index = depth;
+    if (mix_running) finish_mixed(total);
+    finish_capture();
+}
+
+// Mixed signal capture
+bool LogicAnalyzer::split_mixed(uint32_t rate_hz) {
+    uint32_t n = mix_ratio;
+    uint32_t min_n = (rate_hz + LA_MIX_ADC_MAX_HZ - 1) / LA_MIX_ADC_MAX_HZ; // ADC keeps up
+    if (n < min_n) n = min_n;
+    // Each conversion (2 bytes) comes with n samples; 1 byte may go to aligning the analog part
+    uint32_t bytes = capacity * sizeof(la_sample_t);
+    uint32_t m = (bytes > 2) ? (bytes - 2) / (n * sizeof(la_sample_t) + 2) : 0;
+    if (m > depth / n) m = depth / n;
+    if (m == 0) return false;
+    mix_n = (uint16_t)n;
+    mix_len = m;
+    depth = m * n; // Whole conversions, so both rings wrap together
+    mix_buf = (uint16_t*)(((uintptr_t)(sample_buf + depth) + 1) & ~(uintptr_t)1);
+    return true;
+}
+
+bool LogicAnalyzer::begin_mixed(bool circular) {
+    // ADC: one conversion per TIM4 CC4 rising edge instead of continuous, into the arena
+    mix_saved_adc = mix_adc->Init;
+    mix_saved_dma_mode = mix_adc->DMA_Handle->Init.Mode;
+    mix_adc->Init.ContinuousConvMode = DISABLE;
+    mix_adc->Init.ExternalTrigConv = ADC_EXTERNALTRIGCONV_T4_CC4;
+    HAL_ADC_Init(mix_adc);
+    mix_adc->DMA_Handle->Init.Mode = circular ? DMA_CIRCULAR : DMA_NORMAL;
+    HAL_DMA_Init(mix_adc->DMA_Handle);
+    if (HAL_ADC_Start_DMA(mix_adc, (uint32_t*)mix_buf, mix_len) != HAL_OK) {
+        stop_mixed();
+        return false;
+    }
+
+    // TIM4 counts TIM2 updates modulo n. It starts one count before the wrap, so the first
+    // update already gives a rising CC4: conversion 0 is taken with sample 0.
+    TIM_TypeDef* sample_tim = htim_sample->Instance;
+    sample_tim->CR2 = (sample_tim->CR2 & ~TIM_CR2_MMS) | TIM_CR2_MMS_1;
+    TIM_TypeDef* tim = htim_edge->Instance;
+    tim->CR1 = 0;
+    tim->DIER = 0;
+    tim->CCER = 0;
+    tim->PSC = 0;
+    tim->ARR = mix_n - 1;
+    tim->CCR4 = 1;
+    tim->CCMR2 = TIM_CCMR2_OC4M_2 | TIM_CCMR2_OC4M_1; // PWM 1: OC4REF high while CNT == 0
+    tim->CCER = TIM_CCER_CC4E; // PB9 stays a GPIO, so nothing reaches the pin
+    tim->SMCR = TIM_SMCR_TS_0 | TIM_SMCR_SMS; // ITR1 = TIM2 TRGO, external clock
+    tim->EGR = TIM_EGR_UG;
+    tim->CNT = mix_n - 1;
+    tim->SR = 0;
+    tim->CR1 = TIM_CR1_CEN; // Counts only when TIM2 runs
+
+    mix_phase = 0;
+    mix_prev = 0;
+    mix_scanned = 0;
+    mix_running = true;
+    return true;
+}
+
+void LogicAnalyzer::stop_mixed() {
+    TIM_TypeDef* tim = htim_edge->Instance;
+    tim->CR1 = 0;
+    tim->CCER = 0;
+    tim->CCMR2 = 0;
+    tim->SMCR = 0;
+    tim->SR = 0;
+    HAL_ADC_Stop_DMA(mix_adc);
+    mix_adc->Init = mix_saved_adc;
+    HAL_ADC_Init(mix_adc);
+    mix_adc->DMA_Handle->Init.Mode = mix_saved_dma_mode;
+    HAL_DMA_Init(mix_adc->DMA_Handle);
+    mix_running = false;
+}
+
+void LogicAnalyzer::finish_mixed(uint32_t total) {
+    // Conversions triggered: one with sample 0, then every mix_n. The last may still be
+    // converting; wait for its transfer.
+    uint32_t m = mix_len;
+    uint32_t convs = (total + mix_n - 1) / mix_n;
+    DMA_Channel_TypeDef* ch = mix_adc->DMA_Handle->Instance;
+    for (int n = 0; n < LA_MIX_SETTLE_SPINS && (m - ch->CNDTR) % m != convs % m; ++n) {
+    }
+    uint32_t oldest = (m - ch->CNDTR) % m;
+    reverse_range(mix_buf, oldest);
+    reverse_range(mix_buf + oldest, m - oldest);
+    reverse_range(mix_buf, m);
+    // Analog 0 is conversion convs - m, taken with absolute sample (convs - m) * mix_n;
+    // samples() starts at absolute sample total - depth, with depth = m * mix_n
+    mix_phase = convs * mix_n - total;
+    mix_done = true;
+}
+
+// DMA channels borrowed from their HAL handles (edge and state modes): registers saved
+// on the way in, handed back disabled with the configuration the handle set up
+static void borrow_dma(DMA_Channel_TypeDef* ch, uint32_t saved[4]) {
+    saved[0] = ch->CCR;
+    saved[1] = ch->CNDTR;
+    saved[2] = ch->CPAR;
+    saved[3] = ch->CMAR;
+    ch->CCR = 0;
+}
+
+static void return_dma(DMA_Channel_TypeDef* ch, const uint32_t saved[4]) {
+    ch->CCR = 0;
+    ch->CNDTR = saved[1];
+    ch->CPAR = saved[2];
+    ch->CMAR = saved[3];
+    ch->CCR = saved[0] & ~DMA_CCR_EN;
+}
+
+// Edge timestamp capture
+bool LogicAnalyzer::begin_edges() {
+    if (!htim_edge || rle_capacity == 0 || edge_span == 0) return false;
+    uint32_t timer_clock_freq = timer_clock_hz(); // TIM4 is on APB1 as well
+    if (timer_clock_freq == 0) return false;
+
+    // The host link stops its RX ring (and holds back TX) for the length of the capture
+    if (dma_lender && !dma_lender(true, LA_EDGE_LENT_DMA)) {
+        last_arm_fault = LA_ARM_DMA_BUSY; // A transmission is going out
+        return false;
+    }
+    DMA_Channel_TypeDef* ch[3] = { DMA1_Channel1, DMA1_Channel4, DMA1_Channel5 };
+    for (int k = 0; k < 3; ++k) {
+        if (ch[k]->CCR & DMA_CCR_EN) { // Scope (or another user) still running
+            if (dma_lender) dma_lender(false, LA_EDGE_LENT_DMA);
+            last_arm_fault = LA_ARM_DMA_BUSY;
+            return false;
+        }
+    }
+
+    TIM_TypeDef* tim = htim_edge->Instance;
+    tim->CR1 = 0;
+    tim->DIER = 0;
+    tim->CCER = 0; // CCxS can only be written with the channel off
+    tim->PSC = 0;
+    tim->ARR = 0xFFFF;
+    // IC1/IC3 on their own inputs, IC2/IC4 on the same TI1/TI3 (indirect), no filter
+    tim->CCMR1 = TIM_CCMR1_CC1S_0 | TIM_CCMR1_CC2S_1;
+    tim->CCMR2 = TIM_CCMR2_CC3S_0 | TIM_CCMR2_CC4S_1;
+    tim->CCER = TIM_CCER_CC1E | TIM_CCER_CC2E | TIM_CCER_CC2P | TIM_CCER_CC3E | TIM_CCER_CC4E | TIM_CCER_CC4P;
+    tim->EGR = TIM_EGR_UG; // CNT = 0
+    tim->SR = 0;
+
+    // Borrow the DMA channels of the TIM4 CC1..CC3 requests: circular 16-bit rings, no interrupts
+    volatile uint32_t* ccr[3] = { &tim->CCR1, &tim->CCR2, &tim->CCR3 };
+    for (int k = 0; k < 3; ++k) {
+        borrow_dma(ch[k], saved_dma[k]);
+        ch[k]->CPAR = (uint32_t)ccr[k];
+        ch[k]->CMAR = (uint32_t)edge_ring[k];
+        ch[k]->CNDTR = LA_EDGE_RING;
+        ch[k]->CCR = DMA_CCR_PL | DMA_CCR_MSIZE_0 | DMA_CCR_PSIZE_0 | DMA_CCR_MINC | DMA_CCR_CIRC | DMA_CCR_EN;
+    }
+    DMA1->IFCR = DMA_IFCR_CGIF1 | DMA_IFCR_CGIF4 | DMA_IFCR_CGIF5;
+
+    for (int k = 0; k < 4; ++k) edge_read[k] = 0;
+    edge_ch4_write = 0;
+    edge_now = 0;
+    edge_last_t = 0;
+    tstats = LA_TransitionStats();
+    stats.timer_hz = timer_clock_freq; // One timeline sample per timer tick
+    stats.elapsed_cycles = 0;
+    stats.dma = true;
+
+    // Level at time 0; an edge between this read and the counter start shows up as a
+    // repeated direction and is counted in dropped_transitions
+    uint32_t idr = GPIOB->IDR;
+    edge_state = ((idr & LA_EDGE_CH0_PIN) ? 1 : 0) | ((idr & LA_EDGE_CH1_PIN) ? 2 : 0);
+    rle_buf[0] = LA_Record::make(0, edge_state);
+    tstats.records = 1;
+
+    current_sample_index = 0;
+    current_la_status = LA_CAPTURING;
+
+    tim->DIER = TIM_DIER_CC1DE | TIM_DIER_CC2DE | TIM_DIER_CC3DE | TIM_DIER_CC4IE;
+    program_timer(LA_EDGE_DRAIN_TICKS);
+    start_cycles = DWT->CYCCNT;
+    tim->CR1 = TIM_CR1_CEN;
+    HAL_TIM_Base_Start_IT(htim_sample);
+    return true;
+}
+
+void LogicAnalyzer::stop_edges() {
+    if (!htim_edge) return;
+    TIM_TypeDef* tim = htim_edge->Instance;
+    if (!(tim->CR1 & TIM_CR1_CEN)) return;
+    tim->CR1 = 0;
+    tim->DIER = 0;
+    tim->CCER = 0;
+    tim->SR = 0;
+
+    DMA_Channel_TypeDef* ch[3] = { DMA1_Channel1, DMA1_Channel4, DMA1_Channel5 };
+    for (int k = 0; k < 3; ++k) return_dma(ch[k], saved_dma[k]);
+    DMA1->IFCR = DMA_IFCR_CGIF1 | DMA_IFCR_CGIF4 | DMA_IFCR_CGIF5;
+    if (dma_lender) dma_lender(false, LA_EDGE_LENT_DMA);
+}
+
+// Called from the TIM4 capture interrupt (CH4 only, the others go by DMA)
+void LogicAnalyzer::edge_capture_ISR() {
+    if (!htim_edge) return;
+    uint16_t v = htim_edge->Instance->CCR4; // Reading clears CC4IF
+    if (current_la_status != LA_CAPTURING || mode != LA_MODE_EDGES) return;
+    uint16_t w = edge_ch4_write;
+    uint16_t next = (w + 1 == LA_EDGE_RING) ? 0 : w + 1;
+    if (next == edge_read[3]) { // Drain is behind; same interrupt priority as TIM2, so no race
+        tstats.overruns++;
+        return;
+    }
+    edge_ring[3][w] = v;
+    edge_ch4_write = next;
+}
+
+bool LogicAnalyzer::append_record(uint32_t rec) {
+    if (tstats.records == rle_capacity) {
+        tstats.full = true;
+        return false;
+    }
+    rle_buf[tstats.records++] = rec;
+    return true;
+}
+
+bool LogicAnalyzer::edge_emit(uint32_t t, la_sample_t state) {
+    if (state == edge_state) { // Same direction twice: the edge in between was lost
+        tstats.dropped_transitions++;
+        return true;
+    }
+    if (t < edge_last_t) t = edge_last_t; // Streams are merged in order; only jitter at a drain boundary
+    uint32_t delta = t - edge_last_t;
+    while (delta > LA_Record::max_delta) {
+        if (!append_record(LA_Record::make(LA_Record::max_delta, edge_state))) return false;
+        delta -= LA_Record::max_delta;
+    }
+    if (!append_record(LA_Record::make(delta, state))) return false;
+    edge_last_t = t;
+    edge_state = state;
+    tstats.transitions++;
+    return true;
+}
+
+bool LogicAnalyzer::edge_drain() {
+    uint32_t start = DWT->CYCCNT;
+    DMA_Channel_TypeDef* ch[3] = { DMA1_Channel1, DMA1_Channel4, DMA1_Channel5 };
+
+    // Write positions first, then the counter: every capture seen is older than the count
+    uint16_t write[4];
+    for (int k = 0; k < 3; ++k) {
+        uint32_t left = ch[k]->CNDTR;
+        write[k] = (left >= LA_EDGE_RING) ? 0 : LA_EDGE_RING - left;
+    }
+    write[3] = edge_ch4_write;
+    uint16_t cnt = (uint16_t)htim_edge->Instance->CNT;
+    edge_now += (uint16_t)(cnt - (uint16_t)edge_now); // Drains are far less than a wrap apart
+
+    // A DMA ring found (nearly) full may have lapped since the last drain: its order is
+    // lost, so skip it and let the merge count the missing edges
+    uint16_t avail[4];
+    for (int k = 0; k < 4; ++k) {
+        avail[k] = (uint16_t)((write[k] + LA_EDGE_RING - edge_read[k]) % LA_EDGE_RING);
+        if (k < 3 && avail[k] >= LA_EDGE_RING - 1) {
+            tstats.overruns++;
+            edge_read[k] = write[k];
+            avail[k] = 0;
+        }
+    }
+
+    // Merge the four streams, oldest capture first. Extending to 32 bits is exact because
+    // each capture lies within one wrap before edge_now.
+    while (!tstats.full) {
+        int oldest = -1;
+        uint32_t oldest_t = 0;
+        for (int k = 0; k < 4; ++k) {
+            if (avail[k] == 0) continue;
+            uint16_t v = edge_ring[k][edge_read[k]];
+            uint32_t t = edge_now - (uint16_t)((uint16_t)edge_now - v);
+            if (oldest < 0 || t < oldest_t) {
+                oldest = k;
+                oldest_t = t;
+            }
+        }
+        if (oldest < 0) break;
+        if (++edge_read[oldest] == LA_EDGE_RING) edge_read[oldest] = 0;
+        avail[oldest]--;
+
+        la_sample_t bit = (oldest < 2) ? 1 : 2;    // Streams 0/1 are PB6, 2/3 are PB8
+        bool rising = (oldest & 1) == 0;        // Even streams capture rising edges
+        if (oldest_t >= edge_span) break;       // Past the end of the capture
+        edge_emit(oldest_t, rising ? (edge_state | bit) : (edge_state & ~bit));
+    }
+
+    uint32_t cycles = DWT->CYCCNT - start;
+    if (cycles > tstats.encode_max_cycles) tstats.encode_max_cycles = cycles;
+
+    if (!tstats.full && edge_now < edge_span) return false;
+    uint32_t span = tstats.full ? edge_last_t : edge_span;
+    if (span <= edge_last_t) span = edge_last_t + 1; // The last record needs a run of its own
+    tstats.samples = span;
+    current_sample_index = span;
+    finish_capture();
+    return true;
+}
+
+// State capture
+uint32_t LogicAnalyzer::state_max_hz() const {
+    // TIM1 is on APB2; 2x PCLK2 whenever the APB2 prescaler is not 1 (72 MHz in the .ioc)
+    uint32_t pclk2 = HAL_RCC_GetPCLK2Freq();
+    uint32_t tclk = ((RCC->CFGR & RCC_CFGR_PPRE2) == RCC_CFGR_PPRE2_DIV1) ? pclk2 : pclk2 * 2;
+    uint32_t max_hz = tclk / LA_MIN_TIMER_TICKS;
+    // Each edge is the same transfer as a sampled capture, so the probed rate applies
+    if (probe_result.max_hz && probe_result.max_hz < max_hz) max_hz = probe_result.max_hz;
+    return max_hz;
+}
+
+bool LogicAnalyzer::begin_state() {
+    if (!htim_state || depth < 2) return false;
+    // The host link holds back TX for the length of the capture (RX goes on)
+    if (dma_lender && !dma_lender(true, LA_STATE_LENT_DMA)) {
+        last_arm_fault = LA_ARM_DMA_BUSY; // A transmission is going out
+        return false;
+    }
+    DMA_Channel_TypeDef* ch = DMA1_Channel4;
+    if (ch->CCR & DMA_CCR_EN) { // Owner of the channel still running
+        if (dma_lender) dma_lender(false, LA_STATE_LENT_DMA);
+        last_arm_fault = LA_ARM_DMA_BUSY;
+        return false;
+    }
+
+    TIM_TypeDef* tim = htim_state->Instance;
+    tim->CR1 = 0;
+    tim->DIER = 0;
+    tim->SMCR = 0;
+    tim->CCER = 0;
+    tim->CCMR1 = 0; // CC1/CC2 frozen compares: flags only, no outputs
+    tim->PSC = 0;
+    tim->ARR = 0xFFFF;
+    tim->CCR1 = depth; // Last edge of the capture (depth <= LA_MAX_DEPTH fits)
+    tim->CCR2 = 1;     // First edge: the clock measurement starts there
+    tim->EGR = TIM_EGR_UG; // CNT = 0
+    tim->SR = 0;
+    // External clock mode 1 on ETRF: every clock edge counts and is a trigger event.
+    // No ETR filter or prescaler; ETP inverts the input for falling edges.
+    tim->SMCR = (state_rising ? 0 : TIM_SMCR_ETP) | TIM_SMCR_TS | TIM_SMCR_SMS;
+
+    // Port (word) to buffer (la_sample_t), one transfer per trigger request, no interrupts
+    borrow_dma(ch, saved_dma[0]);
+    ch->CPAR = (uint32_t)&LA_PORT->IDR;
+    ch->CMAR = (uint32_t)sample_buf;
+    ch->CNDTR = depth;
+    ch->CCR = DMA_CCR_PL | (sizeof(la_sample_t) == 2 ? DMA_CCR_MSIZE_0 : 0) | DMA_CCR_PSIZE_1 | DMA_CCR_MINC | DMA_CCR_EN;
+    DMA1->IFCR = DMA_IFCR_CGIF4;
+
+    sstats = LA_StateStats();
+    trig_stats = LA_TriggerStats();
+    stats.timer_hz = 0; // Measured at the end
+    stats.elapsed_cycles = 0;
+    stats.dma = true;
+    current_sample_index = 0;
+    current_la_status = LA_CAPTURING;
+
+    tim->DIER = TIM_DIER_TDE | TIM_DIER_CC1IE | TIM_DIER_CC2IE;
+    start_cycles = DWT->CYCCNT;
+    tim->CR1 = TIM_CR1_CEN;
+    return true;
+}
+
+void LogicAnalyzer::stop_state() {
+    if (!htim_state) return;
+    TIM_TypeDef* tim = htim_state->Instance;
+    if (!(tim->CR1 & TIM_CR1_CEN)) return;
+    tim->CR1 = 0;
+    tim->DIER = 0;
+    tim->SMCR = 0;
+    tim->SR = 0;
+    return_dma(DMA1_Channel4, saved_dma[0]);
+    DMA1->IFCR = DMA_IFCR_CGIF4;
+    if (dma_lender) dma_lender(false, LA_STATE_LENT_DMA);
+}
+
+// Called from the TIM1 CC2 interrupt on the first clock edge
+void LogicAnalyzer::state_start_ISR() {
+    if (current_la_status != LA_CAPTURING || mode != LA_MODE_STATE) return;
+    start_cycles = DWT->CYCCNT;
+}
+
+// Called from the TIM1 CC1 interrupt on the depth-th clock edge
+bool LogicAnalyzer::state_stop_ISR() {
+    if (current_la_status != LA_CAPTURING || mode != LA_MODE_STATE) return false;
+    uint32_t now = DWT->CYCCNT;
+    // Requests off first, so edges after the last one add nothing. The transfer of the last
+    // edge took far less than the interrupt entry (see probe_max_rate()), so the count
+    // left is final: one per edge whose request was merged into the next.
+    htim_state->Instance->DIER = 0;
+    uint32_t left = DMA1_Channel4->CNDTR;
+
+    sstats.clocks = depth;
+    sstats.lost = left;
+    stats.elapsed_cycles = now - start_cycles; // First to last edge, both at interrupt latency
+    if (stats.elapsed_cycles) {
+        sstats.clock_hz = (uint32_t)((uint64_t)(depth - 1) * HAL_RCC_GetHCLKFreq() / stats.elapsed_cycles);
+    }
+    stats.timer_hz = sstats.clock_hz; // Decoders take it as the sample rate
+    current_sample_index = depth - left;
+    stop_sampling();
+    current_la_status = LA_DONE_PENDING_DISPLAY;
+    return true;
+}
+
+uint32_t LogicAnalyzer::effective_rate_hz() const {
+    if (stats.elapsed_cycles == 0) return 0;
+    // Includes the completion interrupt latency, so slightly below timer_hz when nothing was lost
+    return (uint32_t)((uint64_t)current_sample_index * HAL_RCC_GetHCLKFreq() / stats.elapsed_cycles);
+}
+
+LA_RateProbe LogicAnalyzer::probe_max_rate() {
+    probe_result = LA_RateProbe();
+    DMA_HandleTypeDef* hdma = sample_dma();
+    uint32_t timer_clock_freq = timer_clock_hz();
+    if (!hdma || timer_clock_freq == 0 || current_la_status == LA_CAPTURING) return probe_result;
+    if (!sample_buf || capacity < LA_PROBE_SAMPLES) return probe_result;
+    set_dma_mode(DMA_NORMAL);
+
+    uint32_t cycles_per_tick = HAL_RCC_GetHCLKFreq() / timer_clock_freq; // 1 with the .ioc clock tree
+    if (cycles_per_tick == 0) cycles_per_tick = 1;
+    uint32_t prev_lost = 0;
+
+    for (uint32_t ticks = LA_MIN_TIMER_TICKS; ticks <= LA_PROBE_MAX_TICKS; ++ticks) {
+        program_timer(ticks);
+
+        __disable_irq(); // Poll the end exactly; nothing else may delay the timestamp
+        if (HAL_DMA_Start(hdma, (uint32_t)&htim_sample->Instance->CNT, (uint32_t)sample_buf, LA_PROBE_SAMPLES) != HAL_OK) {
+            __enable_irq();
+            break;
+        }
+        __HAL_TIM_ENABLE_DMA(htim_sample, TIM_DMA_UPDATE);
+        uint32_t start = DWT->CYCCNT;
+        __HAL_TIM_ENABLE(htim_sample);
+        while (hdma->Instance->CNDTR != 0) {
+        }
+        uint32_t elapsed = DWT->CYCCNT - start;
+        __HAL_TIM_DISABLE_DMA(htim_sample, TIM_DMA_UPDATE);
+        __HAL_TIM_DISABLE(htim_sample);
+        __enable_irq();
+        HAL_DMA_PollForTransfer(hdma, HAL_DMA_FULL_TRANSFER, 1); // Clears TC, handle back to READY
+
+        // Each sample is CNT at the moment of the transfer = ticks since its request
+        uint32_t min_lat = 0xFF, max_lat = 0;
+        for (int i = 0; i < LA_PROBE_SAMPLES; ++i) {
+            if (sample_buf[i] < min_lat) min_lat = sample_buf[i];
+            if (sample_buf[i] > max_lat) max_lat = sample_buf[i];
+        }
+
+        // The last request fires LA_PROBE_SAMPLES periods after the start; time beyond that,
+        // its service latency and the poll loop means requests were merged (lost)
+        uint32_t period = ticks * cycles_per_tick;
+        uint32_t expected = LA_PROBE_SAMPLES * period + max_lat * cycles_per_tick + LA_PROBE_POLL_CYCLES;
+        uint32_t lost = (elapsed > expected) ? (elapsed - expected + period / 2) / period : 0;
+        if (lost == 0) {
+            probe_result.max_hz = timer_clock_freq / ticks;
+            probe_result.min_latency = min_lat;
+            probe_result.max_latency = max_lat;
+            probe_result.lost_at_next = prev_lost;
+            break;
+        }
+        prev_lost = lost;
+    }
+
+    // The buffer now holds probe data, not a capture
+    current_sample_index = 0;
+    current_la_status = LA_IDLE;
+    return probe_result;
+}
+
+// View window
+void LogicAnalyzer::view_window(uint32_t n, uint32_t& first, uint32_t& span) const {
+    span = (view_len == 0 || view_len > n) ? n : view_len;
+    uint32_t min_span = (uint32_t)view_columns(); // At least one sample per column
+    if (min_span > n) min_span = n;
+    if (span < min_span) span = min_span;
+    first = (view_start > n - span) ? n - span : view_start;
+}
+
+void LogicAnalyzer::set_view(uint32_t first, uint32_t span) {
+    view_start = first; // Clamped against the capture when drawn
+    view_len = span;
+}
+
+void LogicAnalyzer::zoom(int steps, uint32_t anchor) {
+    uint32_t n = samples().size();
+    if (n == 0) return;
+    uint32_t first, span;
+    view_window(n, first, span);
+    uint64_t new_span = span;
+    for (; steps > 0 && new_span > 1; --steps) new_span >>= 1;
+    for (; steps < 0 && new_span < n; ++steps) new_span <<= 1;
+    if (new_span > n) new_span = n;
+
+    // Same fraction of the window on either side of the anchor
+    if (anchor < first) anchor = first;
+    uint64_t before = (uint64_t)(anchor - first) * new_span / span;
+    set_view((anchor > before) ? anchor - (uint32_t)before : 0, (new_span == n) ? 0 : (uint32_t)new_span);
+}
+
+uint32_t LogicAnalyzer::view_first() const {
+    uint32_t first, span;
+    view_window(samples().size(), first, span);
+    return first;
+}
+
+uint32_t LogicAnalyzer::view_span() const {
+    uint32_t first, span;
+    view_window(samples().size(), first, span);
+    return span;
+}
+
+int16_t LogicAnalyzer::view_columns() const {
+    return (wave_area_width < LA_MAX_COLUMNS) ? wave_area_width : LA_MAX_COLUMNS;
+}
+
+uint32_t LogicAnalyzer::sample_at(int16_t x) const {
+    uint32_t first, span;
+    view_window(samples().size(), first, span);
+    uint32_t columns = (uint32_t)view_columns();
+    if (columns > span) columns = span;
+    if (columns == 0) return 0;
+    int32_t col = x - wave_area_x_start;
+    if (col < 0) col = 0;
+    if ((uint32_t)col >= columns) col = columns - 1;
+    return first + (uint32_t)((uint64_t)col * span / columns);
+}
+
+// Cursors
+int16_t LogicAnalyzer::cursor_x(uint8_t which) const {
+    if (!frame_valid || which > 1 || frame_span == 0) return -1;
+    uint32_t s = cursors[which];
+    if (s < frame_first || s - frame_first >= frame_span) return -1;
+    return wave_area_x_start + (int16_t)((uint64_t)(s - frame_first) * frame_columns / frame_span);
+}
+
+void LogicAnalyzer::set_cursor(uint8_t which, uint32_t sample) {
+    if (which > 1) return;
+    cursors[which] = sample;
+    cursors_placed = true;
+    // Drawn with the next frame unless the panel shows a finished one
+    if (!tft || !frame_valid || !is_capture_done()) return;
+    int16_t x = cursor_x(which);
+    int16_t col = (x < 0) ? -1 : x - wave_area_x_start;
+    if (col == cursor_col[which]) return;
+    int16_t old = cursor_col[which];
+    cursor_col[which] = col;
+    restore_column(old);
+    draw_cursor_column(col);
+}
+
+uint64_t LogicAnalyzer::samples_to_ns(uint32_t samples) const {
+    if (stats.timer_hz == 0) return 0;
+    return (uint64_t)samples * 1000000000ULL / stats.timer_hz;
+}
+
+int8_t LogicAnalyzer::channel_at(int16_t x, int16_t y) const {
+    if (x < 0 || x >= wave_area_x_start + wave_area_width || y < chan_y || channel_height <= 0) return -1;
+    int16_t ch = (y - chan_y) / channel_height;
+    return (ch < LA_NUM_CHANNELS) ? (int8_t)ch : -1;
+}
+
+// Measurements
+const LA_ChannelMeasure& LogicAnalyzer::measure(uint8_t ch) {
+    if (!meas_valid && !is_capturing()) build_measurements();
+    return meas[ch < LA_NUM_CHANNELS ? ch : 0];
+}
+
+// One pass over the runs of the capture (per edge for transition captures) updates every
+// channel that changes at each run boundary; queries are then table lookups.
+void LogicAnalyzer::build_measurements() {
+    for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) meas[ch] = LA_ChannelMeasure();
+    meas_valid = true;
+    LogicSamples view = samples();
+    uint32_t n = view.size();
+    if (n == 0) return;
+
+    uint32_t last_edge[LA_NUM_CHANNELS];
+    uint32_t first_rise[LA_NUM_CHANNELS];
+    uint32_t high_total[LA_NUM_CHANNELS];    // Complete high pulses so far
+    uint32_t high_at_first[LA_NUM_CHANNELS]; // ...at the first rising edge
+    la_sample_t started = 0;                 // Channels past their first edge
+    la_sample_t rose = 0;                    // ...past their first rising edge
+    for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) high_total[ch] = 0;
+
+    la_sample_t prev = view.sample(0);
+    for (uint32_t i = view.run_end(0); i < n; i = view.run_end(i)) {
+        la_sample_t s = view.sample(i);
+        la_sample_t edges = s ^ prev;
+        for (uint8_t ch = 0; edges; ++ch, edges >>= 1) {
+            if (!(edges & 1)) continue;
+            la_sample_t bit = (la_sample_t)(1 << ch);
+            LA_ChannelMeasure& m = meas[ch];
+            m.edges++;
+            if (started & bit) { // A complete pulse ends here
+                uint32_t width = i - last_edge[ch];
+                if (m.min_pulse == 0 || width < m.min_pulse) m.min_pulse = width;
+                if (width > m.max_pulse) m.max_pulse = width;
+                if (prev & bit) high_total[ch] += width;
+            }
+            started |= bit;
+            last_edge[ch] = i;
+            if (!(s & bit)) continue;
+            if (!(rose & bit)) {
+                rose |= bit;
+                first_rise[ch] = i;
+                high_at_first[ch] = high_total[ch];
+            } else {
+                m.periods++;
+                m.period_span = i - first_rise[ch];
+                m.high_in_span = high_total[ch] - high_at_first[ch];
+            }
+        }
+        prev = s;
+    }
+}
+
+// Checkpoint every seek_stride-th record of a transition capture (see LogicSamples::set_index)
+void LogicAnalyzer::build_seek_index() {
+    seek_points = 0;
+    if ((mode != LA_MODE_TRANSITIONS && mode != LA_MODE_EDGES) || is_capturing()) return;
+    uint32_t records = tstats.records;
+    if (records == 0) return;
+    seek_stride = (records + LA_SEEK_POINTS - 1) / LA_SEEK_POINTS;
+    uint32_t start = 0;
+    for (uint32_t k = 0; k < records; ++k) {
+        start += LA_Record::delta(rle_buf[k]); // The first record's delta is 0
+        if (k % seek_stride == 0) seek_starts[seek_points++] = start;
     }
 }
 
@@ -106,22 +1309,33 @@ void LogicAnalyzer::draw_grid_static() {
     // For now, let it clear its designated area.
     // tft->fillScreen(LA_BG_COLOR); // Or clear only waveform area if buttons are separate
 
-    // Draw channel dividers and names
-    const char* ch_names[] = {"CH0", "CH1", "CH2", "CH3"};
-    uint16_t ch_colors[] = {LA_CHANNEL_COLOR_0, LA_CHANNEL_COLOR_1, LA_CHANNEL_COLOR_2, LA_CHANNEL_COLOR_3};
+    // Draw channel dividers and names (colors repeat every four channels on the wider builds)
+    const uint16_t ch_colors[] = {LA_CHANNEL_COLOR_0, LA_CHANNEL_COLOR_1, LA_CHANNEL_COLOR_2, LA_CHANNEL_COLOR_3};
+    char ch_name[5] = {'C', 'H'};
 
     for (int i = 0; i < LA_NUM_CHANNELS; ++i) {
-        int16_t y_channel_mid = (i * channel_height) + (channel_height / 2);
+        int16_t y_channel_mid = chan_y + (i * channel_height) + (channel_height / 2);
         
         // Draw horizontal line for channel separation (optional, if channel_height is large enough)
         if (i > 0) {
-            tft->drawHorizontalLine(0, i * channel_height, screen_width, LA_GRID_COLOR);
+            tft->drawHorizontalLine(0, chan_y + i * channel_height, screen_width, LA_GRID_COLOR);
         }
         
         tft->setCursor(2, y_channel_mid - 4); // Adjust for text size
-        tft->setTextColor(ch_colors[i]);
+        uint8_t k = 2; // "CH" then one or two digits
+        if (i >= 10) ch_name[k++] = (char)('0' + i / 10);
+        ch_name[k++] = (char)('0' + i % 10);
+        ch_name[k] = '\0';
+        tft->setTextColor(ch_colors[i % 4]);
         tft->setTextSize(1);
-        tft->print(ch_names[i]);
+        tft->print(ch_name);
+    }
+
+    if (mix_adc) { // Analog band of a mixed-signal capture
+        tft->drawHorizontalLine(0, chan_y - 1, screen_width, LA_GRID_COLOR);
+        tft->setCursor(2, chan_y - LA_MIX_ANALOG_H / 2 - 4);
+        tft->setTextColor(LA_ANALOG_COLOR);
+        tft->print("ADC");
     }
     
     // Vertical grid lines for time (optional)
@@ -135,58 +1349,244 @@ void LogicAnalyzer::draw_grid_static() {
 
 void LogicAnalyzer::draw_waveforms() {
     if (!tft) return;
-    
-    // Clear only the waveform area before drawing new waveforms
-    // Assuming channel names and static grid are outside this specific waveform area if not redrawing them.
-    // For simplicity, if draw_grid_static was called, it might have prepared the background.
-    // If this is called repeatedly for "live" view (not current design), this clear is essential.
-    _tft->fillRect(wave_area_x_start, 0, wave_area_width, screen_height, LA_BG_COLOR);
 
+    LogicSamples view = samples();
+    uint32_t n = view.size();
+    if (n == 0) {
+        tft->fillRect(wave_area_x_start, area_y, wave_area_width, area_h, LA_BG_COLOR);
+        frame_valid = false;
+        return;
+    }
 
-    uint16_t ch_colors[] = {LA_CHANNEL_COLOR_0, LA_CHANNEL_COLOR_1, LA_CHANNEL_COLOR_2, LA_CHANNEL_COLOR_3};
-    int16_t y_offset_high = channel_height / 4;      // Position for logic HIGH line within a channel's slot
-    int16_t y_offset_low = (channel_height * 3) / 4; // Position for logic LOW line
+    uint32_t first, span;
+    view_window(n, first, span);
+    uint32_t columns = (uint32_t)view_columns();
+    if (columns > span) columns = span;
+    if (!cursors_placed) {
+        cursors[0] = first + span / 4;
+        cursors[1] = first + (uint32_t)((uint64_t)span * 3 / 4);
+        cursors_placed = true;
+    }
+    int16_t marker = -1;
+    if (mode == LA_MODE_SAMPLES && trig_stats.triggered &&
+        trig_stats.trigger_index >= first && trig_stats.trigger_index - first < span) {
+        marker = (int16_t)((uint64_t)(trig_stats.trigger_index - first) * columns / span);
+    }
 
-    int samples_to_draw = (current_sample_index < wave_area_width) ? current_sample_index : wave_area_width;
-    if (samples_to_draw > LA_BUFFER_SAMPLES) samples_to_draw = LA_BUFFER_SAMPLES;
+    // With the same columns as the frame on the panel, only what changed is redrawn;
+    // otherwise every column is, and the slots right of the last one are cleared.
+    bool full = !frame_valid || columns != frame_columns;
+    int16_t slots_y = chan_y;
+    int16_t slots_end = chan_y + LA_NUM_CHANNELS * channel_height;
+    int16_t area_end = area_y + area_h;
+    if (full && columns < (uint32_t)wave_area_width) {
+        int16_t x = wave_area_x_start + columns, w = wave_area_width - columns;
+        tft->fillRect(x, slots_y, w, slots_end - slots_y, LA_BG_COLOR);
+        for (int ch = 1; ch < LA_NUM_CHANNELS; ++ch) tft->drawHorizontalLine(x, chan_y + ch * channel_height, w, LA_GRID_COLOR);
+    }
 
+    // Annotation rows and analog band above the slots, leftover rows below: repainted whole
+    if (slots_y > area_y) tft->fillRect(wave_area_x_start, area_y, wave_area_width, slots_y - area_y, LA_BG_COLOR);
+    if (mix_adc) tft->drawHorizontalLine(wave_area_x_start, chan_y - 1, wave_area_width, LA_GRID_COLOR); // Band separator
+    if (area_end > slots_end) tft->fillRect(wave_area_x_start, slots_end, wave_area_width, area_end - slots_end, LA_BG_COLOR);
+    if (marker >= 0) { // Under the traces
+        int16_t x = wave_area_x_start + marker;
+        if (slots_y > area_y) tft->drawVerticalLine(x, area_y, slots_y - area_y, LA_TRIGGER_COLOR);
+        if (area_end > slots_end) tft->drawVerticalLine(x, slots_end, area_end - slots_end, LA_TRIGGER_COLOR);
+    }
 
-    for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) {
-        int16_t y_channel_base = ch * channel_height;
-        int16_t prev_y = 0;
-
-        for (int i = 0; i < samples_to_draw; ++i) {
-            int16_t current_y_pos;
-            if (la_buffer[ch][i] == 1) { // Logic HIGH
-                current_y_pos = y_channel_base + y_offset_high;
-            } else { // Logic LOW
-                current_y_pos = y_channel_base + y_offset_low;
-            }
+    // One column per sample while the window fits, otherwise each column covers a range of
+    // samples. A single pass over the window, run by run, XORs each run's state with the one
+    // before it: channels changing once in the column collect in 'once', again in 'twice'
+    // (a transition count saturating at 2).
+    // Each channel collects the columns where it differs from the panel into runs, and a
+    // run is cleared and redrawn as soon as it ends.
+    int16_t run_start[LA_NUM_CHANNELS]; // First column of the open run (-1 none)
+    for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) run_start[ch] = -1;
+    la_sample_t prev = view.sample(first); // Seek index: O(log n) for a transition capture
+    uint32_t i = first;
 
-            if (i > 0) { // Draw line from previous sample to current
-                // Vertical line for transition
-                if (prev_y != current_y_pos) {
-                    tft->drawVerticalLine(wave_area_x_start + i, 
-                                          (prev_y < current_y_pos ? prev_y : current_y_pos), 
-                                          abs(current_y_pos - prev_y), 
-                                          ch_colors[ch]);
-                }
-                // Horizontal line for current state
-                tft->drawHorizontalLine(wave_area_x_start + i, current_y_pos, 1, ch_colors[ch]);
-            } else { // First sample
-                 tft->drawHorizontalLine(wave_area_x_start + i, current_y_pos, 1, ch_colors[ch]);
+    for (uint32_t col = 0; col < columns; ++col) {
+        uint32_t end = first + (uint32_t)((uint64_t)(col + 1) * span / columns); // Edge captures span up to 2^32 ticks
+        la_sample_t once = 0, twice = 0; // Edges from the last state before the column on
+        while (i < end) { // Run by run: sparse transition captures cost per edge, not per sample
+            la_sample_t s = view.sample(i);
+            la_sample_t edges = s ^ prev;
+            twice |= once & edges;
+            once |= edges;
+            prev = s;
+            i = view.run_end(i);
+        }
+        // prev is now the state at the end of the column
+
+        la_sample_t changed = (la_sample_t)((col_level[col] ^ prev) | (col_toggle[col] ^ once) | (col_dense[col] ^ twice));
+        bool marker_moved = (marker != frame_marker) && ((int16_t)col == marker || (int16_t)col == frame_marker);
+        bool under_cursor = ((int16_t)col == cursor_col[0] || (int16_t)col == cursor_col[1]); // Redrawn below
+        if (full || marker_moved || under_cursor) changed = (la_sample_t)~0;
+        col_level[col] = prev;
+        col_toggle[col] = once;
+        col_dense[col] = twice;
+
+        for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) {
+            if (changed & (la_sample_t)(1 << ch)) {
+                if (run_start[ch] < 0) run_start[ch] = (int16_t)col;
+            } else if (run_start[ch] >= 0) {
+                draw_channel_run(ch, (uint16_t)run_start[ch], (uint16_t)col, marker);
+                run_start[ch] = -1;
             }
-            prev_y = current_y_pos;
+        }
+    }
+    for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) {
+        if (run_start[ch] >= 0) draw_channel_run(ch, (uint16_t)run_start[ch], (uint16_t)columns, marker);
+    }
+
+    frame_valid = true;
+    frame_columns = (uint16_t)columns;
+    frame_marker = marker;
+    frame_first = first;
+    frame_span = span;
+    frames++;
+
+    for (int k = 0; k < 2; ++k) { // On top of the traces
+        int16_t x = cursor_x(k);
+        cursor_col[k] = (x < 0) ? -1 : x - wave_area_x_start;
+        draw_cursor_column(cursor_col[k]);
+    }
+
+    draw_analog(columns, first, span);
+    draw_annotations(columns, first, span);
+}
+
+// Clear columns [from, to) of one channel slot and draw them from col_level/col_toggle/
+// col_dense. Steady stretches go out as one horizontal line, dense ones as one bar.
+void LogicAnalyzer::draw_channel_run(int ch, uint16_t from, uint16_t to, int16_t marker) {
+    const uint16_t ch_colors[] = {LA_CHANNEL_COLOR_0, LA_CHANNEL_COLOR_1, LA_CHANNEL_COLOR_2, LA_CHANNEL_COLOR_3};
+    int16_t y_channel_base = chan_y + ch * channel_height;
+    int16_t y_high = y_channel_base + channel_height / 4;      // Logic HIGH line within the slot
+    int16_t y_low = y_channel_base + (channel_height * 3) / 4; // Logic LOW line
+    la_sample_t bit = (la_sample_t)(1 << ch);
+    uint16_t color = ch_colors[ch % 4];
+    uint16_t dim = (color >> 1) & 0x7BEF; // Half intensity in RGB565
+
+    tft->fillRect(wave_area_x_start + from, y_channel_base, to - from, channel_height, LA_BG_COLOR);
+    if (ch > 0) tft->drawHorizontalLine(wave_area_x_start + from, y_channel_base, to - from, LA_GRID_COLOR); // Separator
+    if (marker >= (int16_t)from && marker < (int16_t)to) {
+        tft->drawVerticalLine(wave_area_x_start + marker, y_channel_base, channel_height, LA_TRIGGER_COLOR);
+    }
+
+    uint16_t col = from;
+    while (col < to) {
+        int16_t x = wave_area_x_start + col;
+        uint16_t end = col + 1;
+        if (col_dense[col] & bit) { // Activity bar: both rails, dimmed in between
+            while (end < to && (col_dense[end] & bit)) end++;
+            tft->fillRect(x, y_high + 1, end - col, y_low - y_high - 1, dim);
+            tft->drawHorizontalLine(x, y_high, end - col, color);
+            tft->drawHorizontalLine(x, y_low, end - col, color);
+        } else if (col_toggle[col] & bit) { // A single transition in this column
+            tft->drawVerticalLine(x, y_high, y_low - y_high + 1, color);
+        } else {
+            la_sample_t level = col_level[col] & bit;
+            while (end < to && !(col_toggle[end] & bit) && (col_level[end] & bit) == level) end++;
+            tft->drawHorizontalLine(x, level ? y_high : y_low, end - col, color);
+        }
+        col = end;
+    }
+}
+
+void LogicAnalyzer::draw_cursor_column(int16_t col) {
+    if (col < 0) return;
+    tft->drawVerticalLine(wave_area_x_start + col, chan_y, LA_NUM_CHANNELS * channel_height, LA_CURSOR_COLOR);
+}
+
+void LogicAnalyzer::restore_column(int16_t col) {
+    if (col < 0) return;
+    for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) draw_channel_run(ch, (uint16_t)col, (uint16_t)col + 1, frame_marker);
+    if (col == cursor_col[0] || col == cursor_col[1]) draw_cursor_column(col); // The other one is still there
+}
+
+void LogicAnalyzer::draw_analog(uint32_t columns, uint32_t first, uint32_t span) {
+    uint32_t count = analog_count();
+    if (count == 0) return;
+    int16_t top = chan_y - LA_MIX_ANALOG_H + 2; // Band above the channels, 2 px margins
+    int16_t h = LA_MIX_ANALOG_H - 4;
+
+    // Analog sample j sits at samples() index j * mix_n + mix_phase. A column spans the
+    // min/max of its conversions and the last one before it, so the trace stays connected
+    // when columns are narrower than a conversion.
+    uint32_t j = (first > mix_phase) ? (first - mix_phase + mix_n - 1) / mix_n : 0; // First in the window
+    if (j > count) j = count;
+    uint16_t last = mix_buf[j ? j - 1 : 0];
+    for (uint32_t col = 0; col < columns; ++col) {
+        uint32_t end = first + (uint32_t)((uint64_t)(col + 1) * span / columns);
+        uint16_t lo = last, hi = last;
+        while (j < count && j * mix_n + mix_phase < end) {
+            last = mix_buf[j++];
+            if (last < lo) lo = last;
+            if (last > hi) hi = last;
+        }
+        int16_t y_hi = top + (h - 1) - (int16_t)((uint32_t)hi * (h - 1) / 4095); // 12-bit results
+        int16_t y_lo = top + (h - 1) - (int16_t)((uint32_t)lo * (h - 1) / 4095);
+        tft->drawVerticalLine(wave_area_x_start + col, y_hi, y_lo - y_hi + 1, LA_ANALOG_COLOR);
+    }
+}
+
+// Four hex digits at most, two for values that fit a byte
+static char* fmt_hex(char* out, uint16_t v) {
+    static const char digits[] = "0123456789ABCDEF";
+    for (int shift = (v > 0xFF) ? 12 : 4; shift >= 0; shift -= 4) *out++ = digits[(v >> shift) & 0xF];
+    *out = '\0';
+    return out;
+}
+
+void LogicAnalyzer::draw_annotations(uint32_t columns, uint32_t first, uint32_t span) {
+    if (ann_rows == 0) return;
+    tft->fillRect(wave_area_x_start, area_y, wave_area_width, ann_rows * LA_ANN_ROW_H, LA_BG_COLOR);
+    tft->setTextSize(1);
+
+    for (uint16_t k = 0; k < ann_count; ++k) {
+        const LA_Annotation& a = ann_list[k];
+        if (a.start >= first + span) break; // In capture order: the rest is beyond this view
+        if (a.end < first) continue;
+        uint32_t start = (a.start > first) ? a.start - first : 0; // Clipped to the window
+        uint32_t last = ((a.end < first + span) ? a.end : first + span - 1) - first;
+        int16_t x0 = wave_area_x_start + (int16_t)((uint64_t)start * columns / span);
+        int16_t x1 = wave_area_x_start + (int16_t)((uint64_t)last * columns / span);
+        int16_t y = area_y + ((a.flags & LA_ANN_ROW2) ? LA_ANN_ROW_H : 0);
+        uint16_t color = (a.flags & (LA_ANN_ERROR | LA_ANN_NACK)) ? LA_ANN_ERROR_COLOR : LA_ANN_COLOR;
+        tft->setTextColor(color);
+
+        if (a.type == LA_ANN_START || a.type == LA_ANN_STOP) { // Bus conditions: one letter
+            tft->setCursor(x0, y + 1);
+            tft->print(a.type == LA_ANN_START ? "S" : "P");
+            continue;
+        }
+
+        // Bracket over the span, value inside when it fits (6 px per character)
+        tft->drawVerticalLine(x0, y + 1, LA_ANN_ROW_H - 2, color);
+        tft->drawVerticalLine(x1, y + 1, LA_ANN_ROW_H - 2, color);
+        tft->drawHorizontalLine(x0, y + LA_ANN_ROW_H - 2, x1 - x0 + 1, color);
+        char text[8];
+        char* p = text;
+        if (a.type == LA_ANN_ADDRESS) *p++ = (a.flags & LA_ANN_READ) ? 'R' : 'W';
+        p = fmt_hex(p, a.value);
+        if ((p - text) * 6 <= x1 - x0 - 2) {
+            tft->setCursor(x0 + 2, y + 1);
+            tft->print(text);
         }
     }
 }
 
 
 void LogicAnalyzer::display() {
-    if (!tft || !la_capture_done_flag) return;
+    if (!tft || !is_capture_done() || held) return;
 
-    draw_grid();      // Clear screen and draw grid/labels
-    draw_waveforms(); // Draw the captured waveforms
+    if (seek_points == 0) build_seek_index();
+    // Names and separators only when the frame is drawn whole (layout changed, or something
+    // painted over it): inside the waveform area each repainted run draws its own separator
+    // segment, so redrawing them every frame would only overwrite the cursors.
+    if (!frame_valid) draw_grid_static();
+    draw_waveforms(); // Draw the captured waveforms (only what changed, when possible)
 
     // After displaying, the data is considered viewed.
     // current_la_status remains LA_DONE_PENDING_DISPLAY until acknowledge_display_done() is called
@@ -221,6 +1621,18 @@ void LogicAnalyzer::arm_new_capture() {
     // For now, arm_new_capture is simple; begin() is the main entry to start capture.
 }
 
+void LogicAnalyzer::rearm() {
+    if (current_la_status == LA_CAPTURING) return;
+    bool keep = frame_valid; // Nothing repainted the waveform area since the last frame
+    uint32_t first = view_start, span = view_len;
+    bool placed = cursors_placed;
+    begin(stats.requested_hz); // 0 in state mode, which does not use it
+    frame_valid = keep;
+    view_start = first;
+    view_len = span;
+    cursors_placed = placed;
+}
+
 // Deprecated old helper methods (replaced by get_status())
 // bool LogicAnalyzer::is_capturing() const {
 //     return current_la_status == LA_CAPTURING;
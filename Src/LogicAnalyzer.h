@@ -4,21 +4,122 @@
 #include "stm32f1xx_hal.h" // For TIM_HandleTypeDef, GPIO
 #include "Middlewares/Adafruit/GFX/Adafruit_GFX.h"
 #include "Middlewares/Adafruit/ILI9341/Adafruit_ILI9341.h"
+#include "LogicSamples.h" // Read-only view of the packed sample stream
+#include "LogicDecoder.h" // Annotations drawn above the traces
 
 // Configuration constants
-#define LA_NUM_CHANNELS 4
-#define LA_BUFFER_SAMPLES 320 // Max samples, typically screen width
-
-// GPIO Pin definitions for Logic Analyzer Channels (PC0-PC3)
-// These are logical definitions; the actual CubeMX init sets them as inputs.
-#define LA_CH0_PORT GPIOC
-#define LA_CH0_PIN  GPIO_PIN_0
-#define LA_CH1_PORT GPIOC
-#define LA_CH1_PIN  GPIO_PIN_1
-#define LA_CH2_PORT GPIOC
-#define LA_CH2_PIN  GPIO_PIN_2
-#define LA_CH3_PORT GPIOC
-#define LA_CH3_PIN  GPIO_PIN_3
+#ifndef LA_NUM_CHANNELS
+#define LA_NUM_CHANNELS 4 // 4, 8 or 16 (build flag -DLA_NUM_CHANNELS=...)
+#endif
+#define LA_CHANNEL_MASK ((1 << LA_NUM_CHANNELS) - 1) // Port bits that are channels
+#define LA_MAX_DEPTH    65535 // DMA transfer count is 16 bits, in samples whatever their width
+#define LA_PROBE_SAMPLES 320  // Samples per step of probe_max_rate()
+
+// Sample width per channel count. Up to 8 channels a sample is one byte, so the 4- and
+// 8-channel builds store as many samples as before; 16 channels take a half-word each.
+// Other channel counts have no specialization and fail to compile.
+template <int Channels> struct LA_SampleTraits;
+template <> struct LA_SampleTraits<4> {
+    typedef uint8_t sample_t;
+    static const uint32_t dma_mem_align = DMA_MDATAALIGN_BYTE;
+};
+template <> struct LA_SampleTraits<8> {
+    typedef uint8_t sample_t;
+    static const uint32_t dma_mem_align = DMA_MDATAALIGN_BYTE;
+};
+template <> struct LA_SampleTraits<16> {
+    typedef uint16_t sample_t;
+    static const uint32_t dma_mem_align = DMA_MDATAALIGN_HALFWORD;
+};
+typedef LA_SampleTraits<LA_NUM_CHANNELS> LA_Traits;
+typedef LA_Traits::sample_t la_sample_t;
+typedef LogicSamplesT<la_sample_t> LogicSamples;
+typedef LogicSamples::Record LA_Record;
+
+// Sampling engine: each TIM2 update event requests DMA1 Channel 2 (TIM2_UP), which copies
+// the low byte (16 channels: half-word) of LA_PORT->IDR into the sample buffer. One port
+// read per sample and no CPU time; channel n is bit n of each sample. F1 GPIO registers
+// only take word reads, so the channels must start at pin 0 of the port. On this board the
+// low pins of GPIOA (TFT, SPI1) and GPIOB (scope ADC on PB0, TIM4 captures on PB6) are
+// taken, which leaves GPIOC: PC0..PC(N-1).
+#ifndef LA_PORT
+#define LA_PORT              GPIOC
+#define LA_PORT_DEFAULT      // PC0..PC(N-1)
+#endif
+
+// Package pin count. The LQFP48 (STM32F103C8, as in the .ioc) bonds only PC13..PC15, so
+// none of PC0..PC15 is on its pins, whatever the width: the channels need a 64-pin part
+// (F103RB/RC: -DLA_PACKAGE_PINS=64) with all of GPIOC. No other port has a free run of low
+// pins on this board (PA0-PA2 TFT, PA5-PA7 SPI1, PB0 scope ADC, PB6 TIM4); a board that frees
+// one names it with -DLA_PORT=GPIOx.
+#ifndef LA_PACKAGE_PINS
+#define LA_PACKAGE_PINS      48
+#endif
+#if defined(LA_PORT_DEFAULT) && LA_PACKAGE_PINS < 64
+#error "The LA samples PC0..PC(LA_NUM_CHANNELS-1), which the 48-pin STM32F103C8 does not bond; build with -DLA_PACKAGE_PINS=64 for an LQFP64 part, or -DLA_PORT=GPIOx for a port whose low pins are free"
+#endif
+#define LA_MIN_TIMER_TICKS   4  // Shortest sample period accepted (18 MHz at a 72 MHz timer clock)
+#define LA_PROBE_MAX_TICKS   72 // probe_max_rate() sweeps down to 1 MHz
+#define LA_PROBE_POLL_CYCLES 8  // Cycles between the last transfer and the poll loop seeing it
+
+// Transition (run-length) mode: the DMA fills a small circular staging ring and the
+// half/complete interrupts encode each half into records (see LogicSamples.h) as it fills.
+// Storage then grows with the number of edges, not with time.
+#define LA_RLE_STAGE_SAMPLES 512     // Staging ring; each half gives the encoder half-ring time
+#define LA_RLE_DEFAULT_SPAN  1000000 // Samples per transition capture (1 s at 1 MHz)
+
+// Edge timestamp mode: no sampling at all. TIM4 input captures latch the counter (72 MHz,
+// 13.9 ns per tick) on every edge of PB6 (channel 0) and PB8 (channel 1). F1 timers cannot
+// capture both edges on one channel, so each input feeds a pair: CH1 rising / CH2 falling
+// (indirect) on TI1, CH3 rising / CH4 falling on TI3. CH1..CH3 are copied by DMA1 Channels
+// 1/4/5 into small rings; TIM4 has no CH4 request, so CH4 is stored by its capture
+// interrupt. The otherwise idle TIM2 interrupts every LA_EDGE_DRAIN_TICKS to extend the
+// 16-bit captures to 32-bit times and merge the four streams into the same transition
+// records as LA_MODE_TRANSITIONS, with one timeline sample per timer tick.
+// DMA1 Channel 1 belongs to the scope ADC: edge captures refuse to start while it runs.
+// Channels 4/5 are the host link's (USART1 TX/RX); a capture asks the lender (see
+// set_dma_lender()) for them and gives them back when it stops.
+#define LA_EDGE_RING         64       // Captures per stream ring (4 rings fill the staging area)
+#define LA_EDGE_DRAIN_TICKS  8192     // Drain period; must stay well under the 65536-tick wrap
+#define LA_EDGE_DEFAULT_SPAN 72000000 // Ticks per edge capture (1 s)
+#define LA_EDGE_LENT_DMA     ((1UL << 4) | (1UL << 5)) // DMA1 Channels asked of the lender
+#define LA_EDGE_CH0_PIN      GPIO_PIN_6 // GPIOB, TIM4_CH1
+#define LA_EDGE_CH1_PIN      GPIO_PIN_8 // GPIOB, TIM4_CH3
+
+// State mode: one sample per edge of the target's own clock instead of per TIM2 tick. The
+// clock goes to PA12 (TIM1_ETR). TIM1 counts its edges (external clock mode 1 on ETRF, the
+// polarity picks the edge) and every counted edge raises the TIM1_TRIG request, whose DMA1
+// Channel 4 copies LA_PORT->IDR to the sample buffer; the channel is lent by the host link
+// (TX only, commands still arrive) and borrowed at register level like those of edge mode. CC1 matches on the depth-th edge and ends the capture:
+// whatever the DMA has not transferred by then belongs to edges whose request was lost.
+// ETR edges must be at least LA_MIN_TIMER_TICKS timer clocks apart (18 MHz at 72 MHz).
+#define LA_STATE_CLK_PIN GPIO_PIN_12 // GPIOA, TIM1_ETR
+#define LA_STATE_LENT_DMA (1UL << 4)  // DMA1 Channel 4
+
+// Trigger (sample mode): the DMA runs circular over the whole capture buffer while TIM3,
+// clocked by TIM2's update (TRGO -> ITR1), counts samples. Every 1/LA_TRIG_CHUNKS of the
+// buffer its CC2 interrupt scans the new samples for the trigger; once found, CC1 is set
+// to the sample where the post-trigger part is complete and its interrupt stops TIM2.
+// A trigger is seen up to one chunk late, so the post-trigger part must be longer than that.
+#define LA_TRIG_MAX_STAGES      4  // Sequence length
+#define LA_TRIG_CHUNKS          8  // Scans per pass over the buffer
+#define LA_TRIG_MAX_PRE_PCT     (100 - 100 / LA_TRIG_CHUNKS)
+#define LA_TRIG_DEFAULT_PRE_PCT 10
+#define LA_TRIG_STOP_SLACK      32 // Samples taken while the stop interrupt is entered (18 MHz worst case)
+
+// Mixed signal (sample mode): ADC1 converts in step with the samples. TIM4, clocked by
+// TIM2's update (TRGO -> ITR1) like TIM3, divides it by the ratio and its CC4 (PWM, high
+// for one count per period) is the ADC's external trigger, so conversion j lands on sample
+// j * ratio. The ADC DMA writes the second part of the arena. TIM4 is the edge mode timer
+// and ADC1 the scope's: mixed captures need both idle.
+#define LA_MIX_ADC_MAX_HZ   600000 // 12 MHz ADC clock / (7.5 + 12.5 cycles), as in the .ioc
+#define LA_MIX_MIN_RATIO    2      // TIM4 cannot count with ARR = 0
+#define LA_MIX_SETTLE_SPINS 64     // Polls for the last conversion (20 ADC clocks = 120 cycles)
+#define LA_MIX_ANALOG_H     60     // Height of the analog band above the channels
+
+// GPIO pins of the channels (LA_PORT pins 0..N-1). This is a logical definition;
+// the actual CubeMX init sets them as inputs.
+#define LA_CHANNEL_PINS LA_CHANNEL_MASK
 
 // Colors for Logic Analyzer display
 #define LA_BG_COLOR         ILI9341_BLACK
@@ -26,9 +127,97 @@
 #define LA_CHANNEL_COLOR_0  ILI9341_GREEN
 #define LA_CHANNEL_COLOR_1  ILI9341_YELLOW
 #define LA_CHANNEL_COLOR_2  ILI9341_CYAN
-#define LA_CHANNEL_COLOR_3  ILI9341_MAGENTA
+#define LA_CHANNEL_COLOR_3  ILI9341_MAGENTA // Channels 4 and up repeat the four colors
 #define LA_TEXT_COLOR       ILI9341_WHITE
+#define LA_TRIGGER_COLOR    ILI9341_ORANGE // Trigger position marker
+#define LA_ANN_COLOR        ILI9341_WHITE  // Decoder annotations
+#define LA_ANN_ERROR_COLOR  ILI9341_RED    // ...with an error/NACK flag
+#define LA_ANN_ROW_H        10             // Height of one annotation row above the channels
+#define LA_ANALOG_COLOR     ILI9341_GREENYELLOW // Mixed-signal analog trace
+#define LA_MAX_COLUMNS      320            // Widest waveform area (per-column state kept for live redraws)
 
+// Overview of deep captures: a column covering several samples shows, per channel, whether
+// it stayed low, stayed high, changed once or changed more often. The last is drawn as a
+// dimmed activity bar between the rails, since its edges cannot be told apart at that zoom.
+// Transition captures get a seek index of LA_SEEK_POINTS checkpoints (4 bytes each) so a
+// zoomed or panned view starts drawing without walking the records before it.
+#define LA_SEEK_POINTS      64
+#define LA_CURSOR_COLOR     ILI9341_WHITE  // Time cursors A and B
+
+
+// Timing of the last capture (read from the debugger or the UI)
+struct LA_CaptureStats {
+    uint32_t requested_hz;   // Rate passed to begin()
+    uint32_t timer_hz;       // Rate actually programmed (PSC/ARR quantized, clamped)
+    uint32_t elapsed_cycles; // DWT cycles from timer start to the completion interrupt
+    bool dma;                // false = per-sample interrupt fallback (no DMA handle linked)
+};
+
+// Transition capture counters (valid after a capture in LA_MODE_TRANSITIONS)
+struct LA_TransitionStats {
+    uint32_t samples;             // Samples covered by the capture
+    uint32_t records;             // Records stored (initial state and run splits included)
+    uint32_t transitions;         // Edges stored
+    uint32_t overruns;            // Staging halves (edge mode: rings) overwritten before the encoder reached them
+    uint32_t dropped_transitions; // State changes seen across those gaps (at least one edge lost each);
+                                  // edge mode: two edges in the same direction, the one between was lost
+    uint32_t encode_max_cycles;   // Longest encoder run for one half (must stay under half the ring time)
+    bool full;                    // Ended early because the record storage ran out
+};
+
+// State capture outcome (valid after a capture in LA_MODE_STATE)
+struct LA_StateStats {
+    uint32_t clocks;   // Clock edges counted
+    uint32_t lost;     // ...whose sample was not stored (DMA request merged with the next)
+    uint32_t clock_hz; // Average clock rate over the capture
+};
+
+// Per-channel timing over a whole capture, in samples (capture_stats().timer_hz per second).
+// Built in one pass over the capture's runs the first time any channel is asked for.
+struct LA_ChannelMeasure {
+    uint32_t edges;        // Transitions
+    uint32_t periods;      // Rising edge to rising edge, between the first and last rising edge
+    uint32_t period_span;  // Samples from the first to the last rising edge
+    uint32_t high_in_span; // ...of which the channel was high (duty = high_in_span / period_span)
+    uint32_t min_pulse;    // Shortest and longest complete high or low pulse (0 if none)
+    uint32_t max_pulse;
+};
+
+// Per-channel trigger condition
+enum LA_TriggerCondition {
+    LA_TRIG_DONT_CARE,
+    LA_TRIG_LOW,
+    LA_TRIG_HIGH,
+    LA_TRIG_RISING,
+    LA_TRIG_FALLING,
+    LA_TRIG_EITHER // Any change
+};
+
+// One trigger stage, all channels combined. A sample s (previous sample p) matches when
+//   (s & level_mask) == level_value && ((s ^ p) & edge_mask) == edge_mask
+// so evaluation is the same two compares whatever the conditions are.
+struct LA_TriggerStage {
+    la_sample_t level_mask;  // Channels that must be at a level (HIGH/LOW, and RISING/FALLING after the edge)
+    la_sample_t level_value;
+    la_sample_t edge_mask;   // Channels that must have changed since the previous sample
+};
+
+// Outcome of the last triggered capture
+struct LA_TriggerStats {
+    bool triggered;           // The final stage matched
+    uint8_t stage;            // Stages matched so far (while waiting)
+    uint32_t trigger_index;   // Position of the trigger sample in samples()
+    uint32_t overruns;        // Scans that found samples already overwritten (trigger may be missed)
+    uint32_t scan_max_cycles; // Longest scan of one chunk
+};
+
+// Result of probe_max_rate()
+struct LA_RateProbe {
+    uint32_t max_hz;      // Fastest rate with no lost DMA requests (0 = not probed / none found)
+    uint32_t min_latency;  // DMA service latency at that rate, in timer ticks
+    uint32_t max_latency;  // max_latency - min_latency is the sampling jitter
+    uint32_t lost_at_next; // Requests lost at the next faster rate that was tried
+};
 
 class LogicAnalyzer {
 public:
@@ -39,48 +228,345 @@ public:
     void begin(uint32_t sample_freq_hz); // Starts capture
     void stop();                         // Stops capture
 
-    // Called by timer ISR to capture one sample set across channels
-    void process_capture_ISR();
+    // Capture mode: every sample, only the samples where a channel changes, timer
+    // timestamps of every edge (LA_MODE_EDGES; capture_stats().timer_hz is then the tick
+    // rate), or one sample per external clock edge (LA_MODE_STATE; timer_hz is the
+    // measured clock rate)
+    enum LA_CaptureMode { LA_MODE_SAMPLES, LA_MODE_TRANSITIONS, LA_MODE_EDGES, LA_MODE_STATE };
+    void set_capture_mode(LA_CaptureMode mode);
+    LA_CaptureMode capture_mode() const { return mode; }
+    void set_transition_span(uint32_t samples) { rle_span = samples; } // Length of a transition capture
+    void set_edge_span(uint32_t ticks) { edge_span = ticks; }           // Length of an edge capture
+    void set_edge_timer(TIM_HandleTypeDef* htim) { htim_edge = htim; }  // TIM4, for LA_MODE_EDGES
+    // Called with true before an edge or state capture takes DMA1 channels (bit n of
+    // 'channels' is Channel n; false refuses them), and with false once they are restored
+    typedef bool (*LA_DmaLender)(bool lend, uint32_t channels);
+    void set_dma_lender(LA_DmaLender fn) { dma_lender = fn; }
+    const LA_TransitionStats& transition_stats() const { return tstats; }
+    void set_state_timer(TIM_HandleTypeDef* htim) { htim_state = htim; } // TIM1, for LA_MODE_STATE
+    void set_state_edge(bool rising) { state_rising = rising; }           // Clock edge that samples
+    bool state_edge_rising() const { return state_rising; }
+    uint32_t state_max_hz() const; // Fastest clock kept up with: the ETR limit, or the probed DMA rate if lower
+    const LA_StateStats& state_stats() const { return sstats; }
 
-    // Called from main loop when capture is done to show data
+    // Trigger (LA_MODE_SAMPLES only). With count 0 (the default) begin() records at once.
+    // Otherwise stages match one after the other, each on a later sample than the one
+    // before; the last one is the trigger. pretrigger_pct of the buffer is kept from before
+    // it (capped at LA_TRIG_MAX_PRE_PCT). Needs the sample counter timer (TIM3).
+    static LA_TriggerStage make_trigger_stage(const LA_TriggerCondition cond[LA_NUM_CHANNELS]);
+    void set_trigger(const LA_TriggerStage* stages, uint8_t count);
+    void set_pretrigger_percent(uint8_t pct);
+    void set_trigger_timer(TIM_HandleTypeDef* htim) { htim_count = htim; }
+    bool trigger_enabled() const { return trig_count > 0 || (mix_adc && mix_trig); }
+    bool is_waiting_for_trigger() const { return current_la_status == LA_CAPTURING && trigger_enabled() && !trig_stats.triggered; }
+    const LA_TriggerStats& trigger_stats() const { return trig_stats; }
+    uint32_t compression_x100() const; // Raw bytes / record bytes of the last transition capture, x100
+
+    // Mixed signal (LA_MODE_SAMPLES): ADC1 (hadc, given at init) converts once every 'ratio'
+    // samples, raised if needed so it stays under LA_MIX_ADC_MAX_HZ, and the arena is split
+    // so both records cover the same time. Triggers stop both. The analog trigger, when on,
+    // replaces the pattern stages: the capture triggers where the trace crosses 'level'.
+    // Needs the TIM4 handle (set_edge_timer()). set_mixed_signal() turns it on and off
+    // between captures; another capture mode turns it off.
+    void set_mixed_adc(ADC_HandleTypeDef* hadc, uint16_t ratio);
+    void set_mixed_signal(bool on);
+    void set_analog_trigger(bool on, uint16_t level, bool rising);
+    bool mixed_available() const { return mix_hw != nullptr; }
+    bool mixed_enabled() const { return mix_adc != nullptr; }
+    // Analog part of the last mixed capture: sample j was converted at samples() index
+    // j * analog_ratio() + analog_offset()
+    const uint16_t* analog_samples() const { return mix_buf; }
+    uint32_t analog_count() const { return (mix_done && !is_capturing()) ? mix_len : 0; }
+    uint16_t analog_ratio() const { return mix_n; }
+    uint32_t analog_offset() const { return mix_phase; }
+
+    // Sample storage, normally the capture arena (all RAM not used elsewhere; len in bytes,
+    // word aligned). Depth defaults to the whole buffer (capped at LA_MAX_DEPTH samples).
+    // In transition mode the first LA_RLE_STAGE_SAMPLES samples are the staging ring, the
+    // rest holds records.
+    void set_capture_buffer(uint8_t* buf, uint32_t len);
+    void set_capture_depth(uint32_t samples);
+    uint32_t capture_depth() const { return depth; }
+    uint32_t capture_capacity() const { return capacity; } // In samples
+    uint32_t max_sample_hz() const; // Fastest rate begin() accepts: the probed one, or the timer limit
+
+    // Samples of the last capture (empty while capturing), same view for both modes
+    LogicSamples samples() const;
+
+    // Raw capture (sample and state modes) handed out for rearranging in place, e.g. newest
+    // sample first for SUMP clients (sump_stream_prepare()); nullptr for record captures or
+    // while capturing. Until release_capture(), which the holder calls once the samples are
+    // back in order, samples() is empty, nothing is drawn and begin() refuses to overwrite it.
+    la_sample_t* hold_capture(uint32_t* count);
+    void release_capture() { held = false; }
+    bool is_held() const { return held; }
+
+    // Called by the TIM2 update interrupt: one sample in the fallback path (no update DMA
+    // linked), or a drain of the capture rings in edge mode. Returns true when the capture ended.
+    bool process_capture_ISR();
+
+    // Called from the TIM4 channel 4 capture interrupt (edge mode, PB8 falling edges)
+    void edge_capture_ISR();
+
+    // Called from the TIM3 compare interrupts while a trigger capture runs: CC2 scans the
+    // samples written since the last scan, CC1 ends the capture. True when it ended.
+    bool trigger_scan_ISR();
+    bool trigger_stop_ISR();
+
+    // Called from the TIM1 compare interrupts in state mode: CC2 on the first clock edge
+    // (starts the rate measurement), CC1 on the depth-th one. True when it ended a capture.
+    void state_start_ISR();
+    bool state_stop_ISR();
+
+    // Called from the TIM2_UP DMA half/transfer-complete callbacks. Return true if this
+    // ended a capture (post SCHED_EVT_LA_DONE). In transition mode they run the encoder
+    // for the half that just filled: that has to happen before the DMA comes back around,
+    // so unlike other processing it cannot wait for a task.
+    bool capture_half_ISR();
+    bool capture_complete_ISR();
+
+    // Blocking sweep from LA_MIN_TIMER_TICKS up to LA_PROBE_MAX_TICKS: at each period, the
+    // DMA copies TIM2->CNT instead of the port, so every sample is the number of ticks
+    // between the update event and the transfer. The first period where the capture took
+    // no longer than its samples (no merged requests) is the maximum sustainable rate;
+    // begin() clamps to it from then on. Discards any capture in the buffer. Interrupts
+    // are off for each step (at most LA_PROBE_SAMPLES * LA_PROBE_MAX_TICKS cycles).
+    // CNT sits behind the slower APB1 bridge, so the result is a conservative bound for
+    // GPIOC on APB2; other DMA traffic at probe time (scope ADC, display SPI) is included.
+    LA_RateProbe probe_max_rate();
+    const LA_RateProbe& rate_probe() const { return probe_result; }
+
+    const LA_CaptureStats& capture_stats() const { return stats; }
+    uint32_t effective_rate_hz() const; // Samples per second over elapsed_cycles
+
+    // Called from main loop when capture is done to show data. Consecutive frames with the
+    // same number of columns are drawn incrementally: each column's channel states are kept,
+    // and only the column runs of a channel whose state changed are cleared and redrawn.
     void display();
+    uint32_t frame_count() const { return frames; } // Captures displayed so far
+
+    // View window into the capture, in samples() indices. A span of 0 (the default, and after
+    // begin()) shows the whole capture; the span is kept to at least one sample per column and
+    // the window inside the capture. display() draws the finished capture again with it.
+    void set_view(uint32_t first, uint32_t span);
+    void zoom(int steps, uint32_t anchor); // x2 in per step (out when negative), anchor stays put
+    uint32_t view_first() const;
+    uint32_t view_span() const;
+    int16_t view_columns() const;          // Columns the window is drawn on
+    uint32_t sample_at(int16_t x) const;   // First sample of the column at screen x
+    bool in_wave_area(int16_t x, int16_t y) const {
+        return x >= wave_area_x_start && x < wave_area_x_start + wave_area_width && y >= area_y && y < area_y + area_h;
+    }
     void draw_grid_static(); // Draws only the static parts of the grid (lines, names)
+    void set_display_area(int16_t y, int16_t h); // Vertical band used for the channels
+
+    // Decoder output to draw above the traces (positions are indices into samples()).
+    // The list is not copied; rows (LogicDecoder::rows()) reserves that many rows, 0 for none.
+    void set_annotations(const LA_Annotation* list, uint16_t count, uint8_t rows);
 
     // Status enum and helper methods
     enum LA_Status { LA_IDLE, LA_CAPTURING, LA_DONE_PENDING_DISPLAY, LA_DONE_DISPLAYED };
     LA_Status get_status() const;
     
-    // bool is_capturing() const; // Replaced by get_status()
-    // bool is_capture_done() const { return la_capture_done_flag; } // Replaced
+    // Convenience wrappers around get_status(), used by the UI
+    bool is_capturing() const { return current_la_status == LA_CAPTURING; }
+    bool is_capture_done() const { return current_la_status == LA_DONE_PENDING_DISPLAY || current_la_status == LA_DONE_DISPLAYED; }
+    bool is_display_pending() const { return current_la_status == LA_DONE_PENDING_DISPLAY; }
+    // Why the last begin() did not start a capture: a DMA channel it borrows was in use
+    // (edge mode: scope ADC or a host transmission; state mode: a host transmission)
+    enum LA_ArmFault { LA_ARM_OK, LA_ARM_DMA_BUSY };
+    LA_ArmFault arm_fault() const { return last_arm_fault; }
     void acknowledge_display_done(); // Call after display() has been handled by main loop
-    // bool is_display_pending() const { return la_display_pending; } // Replaced
 
     // New method for button interaction to clear "Done" state for re-arming
     void arm_new_capture();
 
+    // Live view: the main loop calls rearm() after each capture has been displayed, which
+    // starts the next one with the same rate and mode. begin() assumes the waveform area was
+    // redrawn (full repaint on the next frame); rearm() keeps the incremental state.
+    void set_live(bool on) { live = on; }
+    bool is_live() const { return live; }
+    void rearm();
+
+    // Time cursors A (0) and B (1), in samples() indices. They are placed at a quarter and
+    // three quarters of the view when a new capture is first displayed (rearm() keeps them).
+    // Moving one repaints only its old column, from the per-column state of the frame on the
+    // panel, and its new one.
+    void set_cursor(uint8_t which, uint32_t sample);
+    uint32_t cursor(uint8_t which) const { return cursors[which]; }
+    int16_t cursor_x(uint8_t which) const; // Screen column, -1 if not on the panel
+    uint64_t samples_to_ns(uint32_t samples) const; // 0 without a sample rate
+
+    // Measurements of one channel over the whole capture; the UI shows measure_channel()'s
+    const LA_ChannelMeasure& measure(uint8_t ch);
+    void set_measure_channel(uint8_t ch) { if (ch < LA_NUM_CHANNELS) measure_ch = ch; }
+    uint8_t measure_channel() const { return measure_ch; }
+    int8_t channel_at(int16_t x, int16_t y) const; // Channel slot at a screen point, -1 if none
+
+    // Something else painted over the waveform area: the next display() draws it all
+    void invalidate_frame() { frame_valid = false; }
+
 
 private:
     // Member variables
     TIM_HandleTypeDef* htim_sample;      // Pointer to the HAL Timer handle
     Adafruit_ILI9341* tft;               // Pointer to the TFT display object
 
-    uint8_t la_buffer[LA_NUM_CHANNELS][LA_BUFFER_SAMPLES]; // Buffer for captured samples
+    la_sample_t* sample_buf; // One port read per sample, written by the DMA
+    uint32_t capacity;       // Samples that fit in sample_buf
+    uint32_t depth;        // Samples per capture
+    uint32_t depth_request;  // As set; depth is this, shortened for a mixed capture
+    LA_CaptureMode mode;
+
+    // Transition encoder state
+    uint32_t* rle_buf;             // Records, after the staging ring
+    uint32_t rle_capacity;         // Records that fit
+    uint32_t rle_span;             // Samples per transition capture
+    uint32_t rle_total;            // Samples encoded (or skipped) so far
+    uint32_t rle_since;            // Samples since the last record
+    la_sample_t rle_last;          // State of the last record
+    bool rle_gap;                  // Last half was skipped (overrun)
+    LA_TransitionStats tstats;
+
+    // Edge timestamp state
+    TIM_HandleTypeDef* htim_edge;
+    LA_DmaLender dma_lender;       // Host link: DMA1 Channels 4/5 (edge and state modes)
+    uint16_t* edge_ring[4];        // Rising/falling of channel 0, rising/falling of channel 1
+    uint16_t edge_read[4];         // Next ring entry to merge
+    volatile uint16_t edge_ch4_write; // CH4 ring is filled by its interrupt, not by DMA
+    uint32_t edge_now;             // Extended TIM4 count at the last drain
+    uint32_t edge_span;
+    uint32_t edge_last_t;          // Time of the last record
+    la_sample_t edge_state;
+    uint32_t saved_dma[3][4];      // Borrowed DMA channels, edge or state mode (CCR, CNDTR, CPAR, CMAR)
+
+    // State mode
+    TIM_HandleTypeDef* htim_state; // TIM1, counts the external clock
+    bool state_rising;
+    LA_StateStats sstats;
+
+    // Trigger state
+    TIM_HandleTypeDef* htim_count;  // TIM3, counts TIM2 updates
+    LA_TriggerStage trig_stages[LA_TRIG_MAX_STAGES];
+    uint8_t trig_count;
+    uint8_t trig_pre_pct;
+    la_sample_t trig_prev;          // Last sample scanned
+    uint32_t trig_chunk;            // Samples between scans
+    uint32_t trig_scanned;          // Samples scanned so far (absolute)
+    uint32_t trig_now;              // Extended TIM3 count at the last scan
+    uint32_t trig_at;               // Absolute index of the trigger sample
+    uint32_t trig_end;              // Absolute sample count at which to stop
+    LA_TriggerStats trig_stats;
+
+    // Mixed signal state
+    ADC_HandleTypeDef* mix_hw;      // As set; mix_adc is it while mixed signal is on
+    ADC_HandleTypeDef* mix_adc;
+    ADC_InitTypeDef mix_saved_adc;  // Scope configuration, restored after each capture
+    uint32_t mix_saved_dma_mode;
+    uint16_t mix_ratio;             // As set
+    uint16_t mix_n;                 // Samples per conversion in the last capture
+    uint32_t mix_len;               // Conversions per capture (ring length when triggered)
+    uint16_t* mix_buf;              // After the samples in the arena
+    uint32_t mix_phase;             // samples() index of analog sample 0
+    bool mix_running;
+    bool mix_done;                  // mix_buf holds a finished capture
+    bool mix_trig;                  // Analog trigger on
+    bool mix_trig_rising;
+    uint16_t mix_trig_level;
+    uint16_t mix_prev;              // Last conversion scanned
+    uint32_t mix_scanned;           // Conversions scanned so far (absolute)
     // volatile bool la_capture_done_flag;  // Replaced by LA_Status
     // volatile bool la_display_pending;    // Replaced by LA_Status
     volatile uint32_t current_sample_index; // Current position in the buffer
     // volatile bool capturing_active;      // Replaced by LA_Status
     volatile LA_Status current_la_status; // Current operational status
+    LA_ArmFault last_arm_fault;
+
+    LA_CaptureStats stats;
+    LA_RateProbe probe_result;
+    volatile uint32_t start_cycles; // DWT->CYCCNT when the timer was enabled
 
     // Display properties
     int16_t screen_width;
     int16_t screen_height;
+    int16_t area_y;                  // Top of the channel area (below the status bar)
+    int16_t area_h;                  // Height of the channel area (above the button bar)
+    int16_t chan_y;                  // Top of the first channel (below the annotation rows)
     int16_t channel_height;          // Vertical space per channel on display
     int16_t wave_area_x_start;
     int16_t wave_area_width;
 
+    // Sampling timer helpers
+    static uint32_t timer_clock_hz();     // APB1 timer clock (2x PCLK1 when APB1 is divided)
+    uint32_t program_timer(uint32_t ticks); // Set PSC/ARR for a period, returns the rate
+    void stop_sampling();                 // Timer and its DMA request off
+    void set_dma_mode(uint32_t dma_mode); // DMA_NORMAL or DMA_CIRCULAR, memory width from LA_Traits
+    bool encode_half(uint32_t half);      // Transition encoder, true when the capture ended
+    void finish_capture();                // From an ISR: stop and mark done
+    bool append_record(uint32_t rec);     // Edge mode; false (and full set) when out of space
+    bool begin_edges();                   // TIM4 captures and their DMA rings on
+    void stop_edges();                    // ...and off again, borrowed DMA channels restored
+    bool begin_state();                   // TIM1 on the external clock, DMA1 Channel 4 on its trigger request
+    void stop_state();
+    bool edge_drain();                    // Merge new captures into records, true when the capture ended
+    bool edge_emit(uint32_t t, la_sample_t state);
+    void begin_triggered();               // Circular sampling with the TIM3 sample counter
+    uint32_t trigger_count_now();         // Extended TIM3 count
+    bool arm_trigger_stop();              // CC1 at trig_end; true if that point has already passed
+    void stop_counter();                  // TIM3 off
+    void finish_triggered();              // Linearize the ring around the trigger, mark done
+    bool scan_pattern(uint32_t now);      // Trigger scans (set trig_at when found)
+    bool scan_analog(uint32_t now);
+    bool split_mixed(uint32_t rate_hz);   // Ratio and arena split for a mixed capture
+    bool begin_mixed(bool circular);      // ADC on the TIM4 trigger, TIM4 on TIM2's updates
+    void stop_mixed();                    // ...and the scope's ADC configuration back
+    void finish_mixed(uint32_t total);    // Rotate the analog ring to match the samples
+    DMA_HandleTypeDef* sample_dma() const;
+
+    // Annotations
+    const LA_Annotation* ann_list;
+    uint16_t ann_count;
+    uint8_t ann_rows;
+
+    // Frame on the panel, for incremental redraws
+    bool live;
+    bool frame_valid;                       // col_level/col_toggle are what the panel shows
+    uint16_t frame_columns;
+    int16_t frame_marker;                   // Trigger marker column (-1 none)
+    uint32_t frames;
+    la_sample_t col_level[LA_MAX_COLUMNS];  // Channel levels at the end of each column
+    la_sample_t col_toggle[LA_MAX_COLUMNS]; // Channels that changed inside each column
+    la_sample_t col_dense[LA_MAX_COLUMNS];  // ...more than once (activity bar)
+
+    // View window (0 span = whole capture) and the transition seek index
+    uint32_t view_start;
+    uint32_t view_len;
+    uint32_t seek_starts[LA_SEEK_POINTS];
+    uint32_t seek_points;                   // 0 = not built (raw capture, or since begin())
+    uint32_t seek_stride;
+    void build_seek_index();
+    void view_window(uint32_t n, uint32_t& first, uint32_t& span) const;
+    uint32_t frame_first;                   // Window of the frame on the panel
+    uint32_t frame_span;
+
+    // Cursors and measurements
+    uint32_t cursors[2];
+    bool cursors_placed;                    // False until the first frame of a capture
+    int16_t cursor_col[2];                  // Columns they are drawn on (-1 none)
+    LA_ChannelMeasure meas[LA_NUM_CHANNELS];
+    bool meas_valid;
+    uint8_t measure_ch;
+    bool held;                              // Capture handed out by hold_capture()
+    void build_measurements();
+    void draw_cursor_column(int16_t col);   // Cursor line through the channel slots
+    void restore_column(int16_t col);       // Column as the frame drew it, cursors included
+
     // Internal drawing methods
-    void draw_grid();
+    void update_layout();
     void draw_waveforms();
+    void draw_channel_run(int ch, uint16_t from, uint16_t to, int16_t marker);
+    void draw_annotations(uint32_t columns, uint32_t first, uint32_t span);
+    void draw_analog(uint32_t columns, uint32_t first, uint32_t span);
 };
 
 #endif // LOGIC_ANALYZER_H
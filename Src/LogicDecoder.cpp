@@ -0,0 +1,276 @@
+#include "LogicDecoder.h"
+
+void LogicDecoder::add(uint32_t start, uint32_t end, uint8_t type, uint16_t value, uint8_t flags) {
+    if (num == LA_DECODE_MAX_ANNOTATIONS) {
+        overflow = true;
+        return;
+    }
+    LA_Annotation& a = items[num++];
+    a.start = start;
+    a.end = end;
+    a.value = value;
+    a.type = type;
+    a.flags = flags;
+    uint8_t row = (flags & LA_ANN_ROW2) ? 2 : 1;
+    if (row > rows_used) rows_used = row;
+}
+
+// Feed a decoder the capture one run at a time: state s holds for samples [start, end)
+template <typename T, class D>
+static void walk(const LogicSamplesT<T>& view, D& d, const LogicDecoder& out) {
+    uint32_t n = view.size();
+    for (uint32_t i = 0; i < n && !out.overflowed();) {
+        uint32_t s = view.sample(i); // Before run_end(): the view's cursor only moves forward
+        uint32_t e = view.run_end(i);
+        d.feed(i, e, s);
+        i = e;
+    }
+}
+
+// --- UART ---
+// The frame layout is a table with one entry per bit, built from the framing settings.
+// Every bit is taken at its centre, counted from the start edge in Q16 samples per bit,
+// so rounding never accumulates over a frame.
+enum UartField { UART_START, UART_DATA, UART_PARITY, UART_STOP };
+#define UART_MAX_FRAME_BITS 13 // Start, 9 data, parity, 2 stop
+
+class UartDecoder {
+public:
+    UartDecoder(LogicDecoder& out, const LA_UartConfig& cfg, uint32_t sample_hz)
+        : out(out), cfg(cfg), num_bits(0), in_frame(false), prev_level(-1) {
+        spb_q16 = (uint32_t)(((uint64_t)sample_hz << 16) / cfg.baud);
+        uint8_t data_bits = (cfg.data_bits < 5) ? 5 : (cfg.data_bits > 9 ? 9 : cfg.data_bits);
+        uint8_t stop_bits = (cfg.stop_bits > 1) ? 2 : 1;
+        field[num_bits++] = UART_START;
+        for (uint8_t i = 0; i < data_bits; ++i) field[num_bits++] = UART_DATA;
+        if (cfg.parity) field[num_bits++] = UART_PARITY;
+        for (uint8_t i = 0; i < stop_bits; ++i) field[num_bits++] = UART_STOP;
+    }
+
+    void feed(uint32_t start, uint32_t end, uint32_t s) {
+        int level = ((s >> cfg.ch) & 1) ^ (cfg.inverted ? 1 : 0);
+        if (!in_frame && prev_level == 1 && level == 0) { // Mark to space: start bit
+            in_frame = true;
+            frame_start = start;
+            bit = 0;
+            value = 0;
+            ones = 0;
+            error = false;
+            point = bit_centre(0);
+        }
+        while (in_frame && point < end) take_bit(level);
+        prev_level = level;
+    }
+
+private:
+    LogicDecoder& out;
+    const LA_UartConfig& cfg;
+    uint32_t spb_q16;
+    uint8_t field[UART_MAX_FRAME_BITS];
+    uint8_t num_bits;
+
+    bool in_frame;
+    int prev_level; // -1 until the first run: a capture starting low has no start edge
+    uint32_t frame_start;
+    uint32_t point; // Next bit centre
+    uint8_t bit;
+    uint16_t value;
+    uint8_t ones;
+    bool error;
+
+    uint32_t bit_centre(uint32_t b) const {
+        return frame_start + (uint32_t)(((uint64_t)(2 * b + 1) * spb_q16) >> 17);
+    }
+
+    void take_bit(int level) {
+        switch (field[bit]) {
+            case UART_START:
+                if (level) { // Back to mark before the centre: a glitch, not a frame
+                    in_frame = false;
+                    return;
+                }
+                break;
+            case UART_DATA:
+                value |= (uint16_t)level << (bit - 1);
+                ones += level;
+                break;
+            case UART_PARITY:
+                ones += level;
+                break;
+            case UART_STOP:
+                if (!level) error = true; // Framing error (or break)
+                break;
+        }
+        if (++bit < num_bits) {
+            point = bit_centre(bit);
+            return;
+        }
+        if (cfg.parity && ((ones & 1) != 0) != (cfg.parity == 1)) error = true;
+        uint32_t frame_end = frame_start + (uint32_t)(((uint64_t)num_bits * spb_q16) >> 16) - 1;
+        out.add(frame_start, frame_end, LA_ANN_DATA, value, error ? LA_ANN_ERROR : 0);
+        in_frame = false;
+    }
+};
+
+// --- SPI ---
+// Per mode: clock level while idle, and whether data is sampled on the rising edge
+static const struct {
+    uint8_t idle;
+    uint8_t sample_on_rise;
+} spi_modes[4] = {
+    { 0, 1 }, // Mode 0: CPOL 0, CPHA 0
+    { 0, 0 }, // Mode 1: CPOL 0, CPHA 1
+    { 1, 0 }, // Mode 2: CPOL 1, CPHA 0
+    { 1, 1 }, // Mode 3: CPOL 1, CPHA 1
+};
+
+class SpiDecoder {
+public:
+    SpiDecoder(LogicDecoder& out, const LA_SpiConfig& cfg)
+        : out(out), cfg(cfg), prev_clk(spi_modes[cfg.mode & 3].idle), bits(0), mosi(0), miso(0) {
+        sample_level = spi_modes[cfg.mode & 3].sample_on_rise;
+        word_bits = (cfg.bits < 1) ? 1 : (cfg.bits > 16 ? 16 : cfg.bits);
+    }
+
+    void feed(uint32_t start, uint32_t end, uint32_t s) {
+        uint8_t clk = (s >> cfg.clk) & 1;
+        bool selected = (cfg.cs == LA_DECODE_NO_CHANNEL) || !((s >> cfg.cs) & 1);
+        if (!selected) {
+            bits = 0; // A word cut short by CS is dropped
+        } else if (clk != prev_clk && clk == sample_level) {
+            if (bits == 0) {
+                word_start = start;
+                mosi = 0;
+                miso = 0;
+            }
+            shift(mosi, (s >> cfg.mosi) & 1);
+            if (cfg.miso != LA_DECODE_NO_CHANNEL) shift(miso, (s >> cfg.miso) & 1);
+            if (++bits == word_bits) {
+                out.add(word_start, start, LA_ANN_DATA, mosi, 0);
+                if (cfg.miso != LA_DECODE_NO_CHANNEL) out.add(word_start, start, LA_ANN_DATA, miso, LA_ANN_ROW2);
+                bits = 0;
+            }
+        }
+        prev_clk = clk;
+    }
+
+private:
+    LogicDecoder& out;
+    const LA_SpiConfig& cfg;
+    uint8_t sample_level; // Clock level right after a sampling edge
+    uint8_t word_bits;
+    uint8_t prev_clk;
+    uint8_t bits;
+    uint16_t mosi, miso;
+    uint32_t word_start;
+
+    void shift(uint16_t& word, uint8_t b) {
+        if (cfg.msb_first) word = (uint16_t)((word << 1) | b);
+        else word |= (uint16_t)b << bits;
+    }
+};
+
+// --- I2C ---
+// Bus event for each change of (SCL, SDA), indexed by previous SCL, SDA and new SCL, SDA
+enum I2cEvent { I2C_NONE, I2C_START, I2C_STOP, I2C_BIT };
+static const uint8_t i2c_events[16] = {
+    I2C_NONE, I2C_NONE, I2C_BIT,  I2C_BIT,  // SCL low, SDA low  -> ...
+    I2C_NONE, I2C_NONE, I2C_BIT,  I2C_BIT,  // SCL low, SDA high -> ...
+    I2C_NONE, I2C_NONE, I2C_NONE, I2C_STOP, // SCL high, SDA low -> SDA rises with SCL high
+    I2C_NONE, I2C_NONE, I2C_START, I2C_NONE, // SCL high, SDA high -> SDA falls with SCL high
+};
+
+class I2cDecoder {
+public:
+    I2cDecoder(LogicDecoder& out, const LA_I2cConfig& cfg)
+        : out(out), cfg(cfg), prev(0xFF), active(false), bits(0), value(0), address_byte(false) {}
+
+    void feed(uint32_t start, uint32_t end, uint32_t s) {
+        uint8_t lines = (uint8_t)((((s >> cfg.scl) & 1) << 1) | ((s >> cfg.sda) & 1));
+        if (prev == 0xFF) { // First run: only the bus state
+            prev = lines;
+            return;
+        }
+        switch (i2c_events[(prev << 2) | lines]) {
+            case I2C_START: // Also a repeated start; a byte in progress is dropped
+                out.add(start, start, LA_ANN_START, 0, 0);
+                active = true;
+                address_byte = true;
+                bits = 0;
+                value = 0;
+                break;
+            case I2C_STOP:
+                out.add(start, start, LA_ANN_STOP, 0, 0);
+                active = false;
+                break;
+            case I2C_BIT:
+                if (active) take_bit(start, lines & 1);
+                break;
+            default:
+                break;
+        }
+        prev = lines;
+    }
+
+private:
+    LogicDecoder& out;
+    const LA_I2cConfig& cfg;
+    uint8_t prev; // Previous (SCL << 1 | SDA), 0xFF before the first run
+    bool active;  // Between start and stop
+    uint8_t bits;
+    uint8_t value;
+    bool address_byte;
+    uint32_t byte_start;
+
+    void take_bit(uint32_t t, uint8_t sda) {
+        if (bits == 0) byte_start = t;
+        if (bits < 8) { // MSB first
+            value = (uint8_t)((value << 1) | sda);
+            bits++;
+            return;
+        }
+        uint8_t flags = sda ? LA_ANN_NACK : 0; // Ninth bit: the receiver pulls SDA low to ACK
+        if (address_byte) {
+            out.add(byte_start, t, LA_ANN_ADDRESS, value >> 1, flags | ((value & 1) ? LA_ANN_READ : 0));
+            address_byte = false;
+        } else {
+            out.add(byte_start, t, LA_ANN_DATA, value, flags);
+        }
+        bits = 0;
+        value = 0;
+    }
+};
+
+template <typename T>
+uint16_t LogicDecoder::decode(const LogicSamplesT<T>& view, uint32_t sample_hz, const LA_DecoderConfig& cfg) {
+    num = 0;
+    overflow = false;
+    rows_used = 0;
+    if (view.size() == 0 || sample_hz == 0) return 0;
+
+    switch (cfg.type) {
+        case LA_DECODER_UART:
+            // Bit centres need at least a few samples per bit to land inside the bit
+            if (cfg.uart.baud && sample_hz / cfg.uart.baud >= 3) {
+                UartDecoder d(*this, cfg.uart, sample_hz);
+                walk(view, d, *this);
+            }
+            break;
+        case LA_DECODER_SPI: {
+            SpiDecoder d(*this, cfg.spi);
+            walk(view, d, *this);
+            break;
+        }
+        case LA_DECODER_I2C: {
+            I2cDecoder d(*this, cfg.i2c);
+            walk(view, d, *this);
+            break;
+        }
+        default:
+            break;
+    }
+    return num;
+}
+
+template uint16_t LogicDecoder::decode(const LogicSamplesT<uint8_t>&, uint32_t, const LA_DecoderConfig&);
+template uint16_t LogicDecoder::decode(const LogicSamplesT<uint16_t>&, uint32_t, const LA_DecoderConfig&);
@@ -0,0 +1,89 @@
+#ifndef LOGIC_DECODER_H
+#define LOGIC_DECODER_H
+
+#include <stdint.h>
+#include "LogicSamples.h" // Captures are read through the view, raw or transitions alike
+
+// Protocol decoders over a logic capture. Each one is a small state machine fed with the
+// capture run by run (a run is a stretch where no channel changes), so a decode is one
+// forward pass whose cost follows the number of edges, not the depth. No HAL access:
+// decoders can be run on a host against synthesized streams.
+#define LA_DECODE_MAX_ANNOTATIONS 64   // Fixed storage; later annotations are dropped (overflowed())
+#define LA_DECODE_NO_CHANNEL      0xFF // Optional line not connected (SPI CS/MISO)
+
+enum LA_AnnotationType {
+    LA_ANN_DATA,    // Byte/word (UART frame, SPI word, I2C data byte)
+    LA_ANN_ADDRESS, // I2C address byte: value is the 7-bit address
+    LA_ANN_START,   // I2C start / repeated start
+    LA_ANN_STOP     // I2C stop
+};
+
+// Annotation flags
+#define LA_ANN_ERROR   0x01 // Parity/framing error (UART)
+#define LA_ANN_NACK    0x02 // I2C byte was not acknowledged
+#define LA_ANN_READ    0x04 // I2C address with R/W = 1
+#define LA_ANN_ROW2    0x08 // Second annotation row (SPI MISO)
+
+struct LA_Annotation {
+    uint32_t start; // First sample covered
+    uint32_t end;   // Last sample covered
+    uint16_t value;
+    uint8_t type;   // LA_AnnotationType
+    uint8_t flags;
+};
+
+enum LA_DecoderType { LA_DECODER_NONE, LA_DECODER_UART, LA_DECODER_SPI, LA_DECODER_I2C };
+
+struct LA_UartConfig {
+    uint8_t ch;
+    uint32_t baud;
+    uint8_t data_bits; // 5..9, LSB first
+    uint8_t parity;    // 0 none, 1 odd, 2 even
+    uint8_t stop_bits; // 1 or 2
+    bool inverted;     // Idle low (RS-232 levels after a non-inverting buffer)
+};
+
+struct LA_SpiConfig {
+    uint8_t clk, mosi, miso, cs; // miso/cs may be LA_DECODE_NO_CHANNEL; CS is active low
+    uint8_t mode;                // 0..3 (CPOL << 1 | CPHA)
+    uint8_t bits;                // Word size, 1..16
+    bool msb_first;
+};
+
+struct LA_I2cConfig {
+    uint8_t scl, sda;
+};
+
+struct LA_DecoderConfig {
+    LA_DecoderType type;
+    LA_UartConfig uart;
+    LA_SpiConfig spi;
+    LA_I2cConfig i2c;
+};
+
+class LogicDecoder {
+public:
+    LogicDecoder() : num(0), overflow(false), rows_used(0) {}
+
+    // Decode the whole capture (sample_hz is its sample rate: LA_CaptureStats::timer_hz).
+    // Replaces the previous annotations; returns how many there are now. Instantiated for
+    // 8- and 16-bit samples.
+    template <typename T>
+    uint16_t decode(const LogicSamplesT<T>& view, uint32_t sample_hz, const LA_DecoderConfig& cfg);
+
+    const LA_Annotation* annotations() const { return items; }
+    uint16_t count() const { return num; }
+    bool overflowed() const { return overflow; }
+    uint8_t rows() const { return rows_used; } // Annotation rows needed (0 = nothing to show)
+
+    // Used by the protocol state machines
+    void add(uint32_t start, uint32_t end, uint8_t type, uint16_t value, uint8_t flags);
+
+private:
+    LA_Annotation items[LA_DECODE_MAX_ANNOTATIONS];
+    uint16_t num;
+    bool overflow;
+    uint8_t rows_used;
+};
+
+#endif // LOGIC_DECODER_H
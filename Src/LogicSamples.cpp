@@ -0,0 +1,73 @@
+#include "LogicSamples.h"
+
+template <typename T>
+void LogicSamplesT<T>::seek(uint32_t i) const {
+    uint32_t next_point = idx_points ? cur_rec / idx_stride + 1 : 0;
+    if (idx_points && (i < cur_start || (next_point < idx_points && i >= idx_starts[next_point]))) {
+        // Last checkpoint at or before i (starts[0] is 0)
+        uint32_t lo = 0, hi = idx_points;
+        while (hi - lo > 1) {
+            uint32_t mid = (lo + hi) / 2;
+            if (idx_starts[mid] <= i) lo = mid;
+            else hi = mid;
+        }
+        cur_rec = lo * idx_stride;
+        cur_start = idx_starts[lo];
+    } else if (i < cur_start) { // Going backwards: restart from the first record
+        cur_rec = 0;
+        cur_start = 0;
+    }
+    while (cur_rec + 1 < num_recs) {
+        uint32_t next_start = cur_start + Record::delta(recs[cur_rec + 1]);
+        if (next_start > i) break;
+        cur_rec++;
+        cur_start = next_start;
+    }
+}
+
+template <typename T>
+uint32_t LogicSamplesT<T>::run_end(uint32_t i) const {
+    if (i >= count) return count;
+    if (buf) {
+        T s = buf[i] & mask;
+        uint32_t j = i + 1;
+        while (j < count && (buf[j] & mask) == s) j++;
+        return j;
+    }
+
+    seek(i);
+    T s = Record::state(recs[cur_rec]) & mask;
+    uint32_t start = cur_start;
+    // Records that keep the masked state (run splits, unconnected pins) are not edges
+    for (uint32_t k = cur_rec + 1; k < num_recs; ++k) {
+        start += Record::delta(recs[k]);
+        if (start >= count) break;
+        if ((Record::state(recs[k]) & mask) != s) return start;
+    }
+    return count;
+}
+
+template <typename T>
+uint32_t LogicSamplesT<T>::next_edge(uint8_t ch, uint32_t from) const {
+    if (from == 0) from = 1;
+    if (from >= count) return count;
+    T bit = (T)(1 << ch);
+
+    if (buf) {
+        T prev = buf[from - 1] & bit;
+        for (uint32_t i = from; i < count; ++i) {
+            if ((buf[i] & bit) != prev) return i;
+        }
+        return count;
+    }
+
+    T prev = sample(from - 1) & bit;
+    for (uint32_t i = run_end(from - 1); i < count; i = run_end(i)) {
+        if ((sample(i) & bit) != prev) return i;
+    }
+    return count;
+}
+
+// The two sample widths the logic analyzer can be built with
+template class LogicSamplesT<uint8_t>;
+template class LogicSamplesT<uint16_t>;
@@ -0,0 +1,96 @@
+#ifndef LOGIC_SAMPLES_H
+#define LOGIC_SAMPLES_H
+
+#include <stdint.h>
+
+// Transition record (run-length capture): samples since the previous record in the upper
+// bits, the new channel state in the low 8 * sizeof(T) bits (24-bit deltas for 8-bit
+// samples, 16-bit for 16-bit samples). The first record (delta 0) holds the initial state;
+// a run longer than max_delta is split by a record repeating the state.
+template <typename T>
+struct LA_RecordFormat {
+    enum { state_bits = 8 * sizeof(T) };
+    static const uint32_t max_delta = 0xFFFFFFFFUL >> state_bits;
+    static uint32_t make(uint32_t delta, T state) { return (delta << state_bits) | state; }
+    static uint32_t delta(uint32_t rec) { return rec >> state_bits; }
+    static T state(uint32_t rec) { return (T)rec; }
+};
+
+// Read-only view of a logic capture, either
+//  - raw: one T per sample, exactly as the DMA copied it from the port, or
+//  - transitions: records as written by the run-length encoder.
+// Channel n is bit n in both; bits outside 'mask' (unconnected port pins) read as 0.
+// Renderers and decoders use the same calls for both, so neither cares how it was stored.
+// T is uint8_t for up to 8 channels and uint16_t for 16 (both instantiated in LogicSamples.cpp).
+template <typename T>
+class LogicSamplesT {
+public:
+    typedef LA_RecordFormat<T> Record;
+
+    LogicSamplesT(const T* data, uint32_t count, T mask = (T)~0)
+        : buf(data), recs(nullptr), num_recs(0), count(count), mask(mask), cur_rec(0), cur_start(0),
+          idx_starts(nullptr), idx_points(0), idx_stride(0) {}
+    LogicSamplesT(const uint32_t* records, uint32_t num_records, uint32_t span, T mask = (T)~0)
+        : buf(nullptr), recs(records), num_recs(num_records), count(num_records ? span : 0), mask(mask),
+          cur_rec(0), cur_start(0), idx_starts(nullptr), idx_points(0), idx_stride(0) {}
+
+    // Seek index for transition captures: starts[k] is the first sample of record k * stride.
+    // Lookups that go backwards or past the next checkpoint binary-search it and then walk at
+    // most 'stride' records, so jumping anywhere costs O(log n) instead of a walk from the start.
+    void set_index(const uint32_t* starts, uint32_t points, uint32_t stride) {
+        idx_starts = starts;
+        idx_points = stride ? points : 0;
+        idx_stride = stride;
+    }
+
+    uint32_t size() const { return count; }
+    bool is_transitions() const { return recs != nullptr; }
+
+    // All channels at sample i. Sequential (forward) access is O(1) for transition
+    // captures too; the view keeps a cursor on the last record looked up.
+    T sample(uint32_t i) const {
+        if (buf) return buf[i] & mask;
+        seek(i);
+        return Record::state(recs[cur_rec]) & mask;
+    }
+    bool level(uint8_t ch, uint32_t i) const { return (sample(i) >> ch) & 1; }
+
+    // First index after i where any channel differs from sample(i) (size() if none).
+    // Lets renderers step from run to run instead of sample to sample.
+    uint32_t run_end(uint32_t i) const;
+
+    // First index at or after 'from' where channel ch differs from the sample before it
+    // (size() if it never changes). Walks a channel edge by edge instead of bit by bit.
+    uint32_t next_edge(uint8_t ch, uint32_t from) const;
+
+    // Iterator over one channel's levels
+    class ChannelIterator {
+    public:
+        ChannelIterator(const LogicSamplesT* view, uint8_t ch, uint32_t i) : view(view), ch(ch), i(i) {}
+        bool operator*() const { return view->level(ch, i); }
+        ChannelIterator& operator++() { ++i; return *this; }
+        bool operator!=(const ChannelIterator& other) const { return i != other.i; }
+    private:
+        const LogicSamplesT* view;
+        uint8_t ch;
+        uint32_t i;
+    };
+    ChannelIterator channel_begin(uint8_t ch) const { return ChannelIterator(this, ch, 0); }
+    ChannelIterator channel_end(uint8_t ch) const { return ChannelIterator(this, ch, count); }
+
+private:
+    const T* buf;           // Raw samples (nullptr for transitions)
+    const uint32_t* recs;   // Transition records (nullptr for raw)
+    uint32_t num_recs;
+    uint32_t count;         // Samples covered
+    T mask;
+
+    mutable uint32_t cur_rec;   // Record holding the last sample looked up
+    mutable uint32_t cur_start; // Its first sample index
+    const uint32_t* idx_starts;
+    uint32_t idx_points;
+    uint32_t idx_stride;
+    void seek(uint32_t i) const;
+};
+
+#endif // LOGIC_SAMPLES_H
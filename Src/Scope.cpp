@@ -1,10 +1,12 @@
 #include "Scope.h"
 #include <string.h> // For memcpy
+#include "ui_text.h" // For error messages without printf
 
 // Constructor
-Oscilloscope::Oscilloscope(ADC_HandleTypeDef* hadc_ptr, Adafruit_ILI9341* tft_display)
+Oscilloscope::Oscilloscope(ADC_HandleTypeDef* hadc_ptr, ILI9341_Display* tft_display)
     : hadc(hadc_ptr),
       tft(tft_display),
+      wave_fb(tft_display),
       dma_cplt_flag(false),
       dma_half_cplt_flag(false),
       trigger_level(2048), // Default trigger level (mid-point for 12-bit ADC)
@@ -13,7 +15,15 @@ Oscilloscope::Oscilloscope(ADC_HandleTypeDef* hadc_ptr, Adafruit_ILI9341* tft_di
       last_trigger_time(0),
       search_offset_first_half(0), 
       search_offset_second_half(0),
-      is_running_flag(false) { // Initialize is_running_flag to false
+      frame_counter(0),
+      freeze_pending(false),
+      frozen(false),
+      resume_after_record(false),
+      record_trigger(0),
+      record_oldest(0),
+      is_running_flag(false),
+      trace_data(nullptr),
+      trace_len(0) { // Initialize is_running_flag to false
     // Initialize screen dimensions from TFT object
     if (tft) {
         screen_width = tft->width();
@@ -29,7 +39,14 @@ Oscilloscope::Oscilloscope(ADC_HandleTypeDef* hadc_ptr, Adafruit_ILI9341* tft_di
     wave_y = 5;
     wave_w = screen_width - 10;
     wave_h = screen_height - 10;
-    
+    trigger_pos_px = wave_w / 4;
+
+    wave_fb.set_area(wave_x, wave_y, wave_w, wave_h);
+    wave_fb.set_palette(SCOPE_PAL_BG, SCOPE_BG_COLOR);
+    wave_fb.set_palette(SCOPE_PAL_GRID, SCOPE_GRID_COLOR);
+    wave_fb.set_palette(SCOPE_PAL_TRACE, SCOPE_WAVEFORM_COLOR);
+    wave_fb.set_palette(SCOPE_PAL_MARKER, SCOPE_MARKER_COLOR);
+
     // Ensure display_buffer in Scope.h is large enough for screen_width.
     // The current display_buffer[320] in Scope.h should be fine for typical screens like 240x320 or 320x240.
     // If screen_width > 320, this buffer would be too small.
@@ -37,6 +54,16 @@ Oscilloscope::Oscilloscope(ADC_HandleTypeDef* hadc_ptr, Adafruit_ILI9341* tft_di
     // For now, we rely on display_buffer being large enough.
 }
 
+void Oscilloscope::setWaveArea(int16_t x, int16_t y, int16_t w, int16_t h) {
+    if (w > 320) w = 320; // display_buffer capacity
+    wave_x = x;
+    wave_y = y;
+    wave_w = w;
+    wave_h = h;
+    trigger_pos_px = wave_w / 4;
+    wave_fb.set_area(wave_x, wave_y, wave_w, wave_h);
+}
+
 // Initialization
 void Oscilloscope::begin() {
     if (!hadc) return; // Safety check
@@ -47,10 +74,9 @@ void Oscilloscope::begin() {
         // Handle ADC start error if necessary
         // For example, print to UART or display an error on TFT
         if (tft) {
-            tft->setCursor(10, 10);
-            tft->setTextColor(ILI9341_RED);
-            tft->setTextSize(1);
-            tft->printf("ADC DMA Start Error: %d", status);
+            char msg[32];
+            ui_fmt_int(ui_fmt_str(msg, "ADC DMA Start Error: "), status);
+            ui_text_draw(10, 10, msg, 1, ILI9341_RED, ILI9341_BLACK);
         }
         return;
     }
@@ -63,6 +89,10 @@ void Oscilloscope::begin() {
 
 // Control methods
 void Oscilloscope::start() {
+    if (frozen) { // A held record would be overwritten; run once it is released
+        resume_after_record = true;
+        return;
+    }
     if (!hadc || is_running_flag) return;
     HAL_StatusTypeDef status = HAL_ADC_Start_DMA(hadc, (uint32_t*)adc_buffer, ADC_BUFFER_SIZE);
     if (status == HAL_OK) {
@@ -76,15 +106,15 @@ void Oscilloscope::start() {
         // Handle ADC start error
         if (tft) {
             // This is just an example, real error handling might be more sophisticated
-            tft->setCursor(10, screen_height - 10); // Assuming screen_height is initialized
-            tft->setTextColor(ILI9341_RED);
-            tft->setTextSize(1);
-            tft->printf("ADC Start Err: %d", status);
+            char msg[32];
+            ui_fmt_int(ui_fmt_str(msg, "ADC Start Err: "), status);
+            ui_text_draw(10, screen_height - 10, msg, 1, ILI9341_RED, ILI9341_BLACK);
         }
     }
 }
 
 void Oscilloscope::stop() {
+    resume_after_record = false;
     if (!hadc || !is_running_flag) return;
     HAL_StatusTypeDef status = HAL_ADC_Stop_DMA(hadc);
     if (status == HAL_OK) {
@@ -92,10 +122,9 @@ void Oscilloscope::stop() {
     } else {
         // Handle ADC stop error
          if (tft) {
-            tft->setCursor(10, screen_height - 10);
-            tft->setTextColor(ILI9341_RED);
-            tft->setTextSize(1);
-            tft->printf("ADC Stop Err: %d", status);
+            char msg[32];
+            ui_fmt_int(ui_fmt_str(msg, "ADC Stop Err: "), status);
+            ui_text_draw(10, screen_height - 10, msg, 1, ILI9341_RED, ILI9341_BLACK);
         }
     }
 }
@@ -168,8 +197,8 @@ void Oscilloscope::prepareDisplayData(uint16_t* src_buffer_half, int src_buffer_
     if (display_width > 320) display_width = 320; // Cap at physical buffer size from Scope.h
 
     // Calculate how many samples to show before the trigger point
-    // For simplicity, let's try to center the trigger point if possible, or place it at 1/4th of the screen.
-    int pre_trigger_samples = display_width / 4;
+    // The trigger point sits at trigger_pos_px (1/4th of the screen by default).
+    int pre_trigger_samples = trigger_pos_px;
 
     for (int i = 0; i < display_width; ++i) {
         // Calculate the effective index in the full adc_buffer
@@ -202,67 +231,176 @@ void Oscilloscope::prepareDisplayData(uint16_t* src_buffer_half, int src_buffer_
 }
 
 
-// Draw Grid
-void Oscilloscope::drawGrid() {
-    if (!tft) return;
+// Reverse a range in place (three of these rotate a ring)
+static void reverse_range(uint16_t* a, uint32_t n) {
+    for (uint32_t i = 0, j = n; i + 1 < j; ++i) {
+        --j;
+        uint16_t t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+    }
+}
+
+// Called as soon as the trigger is found, before the frame is drawn: the DMA refills a half
+// in well under a millisecond at the fast rates, while a redraw takes tens. The write
+// position is read after the stop, so it is final. If it lies in the half that holds the
+// trigger, the DMA had already lapped it (the task ran late): the scope runs on and the
+// freeze waits for the next triggered frame.
+bool Oscilloscope::haltForRecord(int half_start) {
+    stop();
+    if (is_running_flag) return false; // ADC did not stop; nothing is frozen
+    record_oldest = (ADC_BUFFER_SIZE - hadc->DMA_Handle->Instance->CNDTR) % ADC_BUFFER_SIZE;
+    if (record_oldest >= (uint32_t)half_start && record_oldest < (uint32_t)half_start + ADC_BUFFER_SIZE / 2) {
+        start();
+        return false;
+    }
+    freeze_pending = false;
+    return true;
+}
 
-    tft->fillRect(wave_x, wave_y, wave_w, wave_h, SCOPE_BG_COLOR);
+// The ring holds ADC_BUFFER_SIZE consecutive samples ending just before the write position
+// (the trigger, its pre-trigger samples and what the other half got after it)
+void Oscilloscope::freezeRecord(int trigger_index) {
+    uint32_t oldest = record_oldest;
+    reverse_range(adc_buffer, oldest);
+    reverse_range(adc_buffer + oldest, ADC_BUFFER_SIZE - oldest);
+    reverse_range(adc_buffer, ADC_BUFFER_SIZE);
+    record_trigger = (trigger_index + ADC_BUFFER_SIZE - oldest) % ADC_BUFFER_SIZE;
+    frozen = true;
+    resume_after_record = true;
+}
+
+void Oscilloscope::release_record() {
+    if (!frozen) return;
+    frozen = false;
+    if (resume_after_record) start();
+}
+
+// Sampling time SMPx (1.5 .. 239.5 cycles, in half cycles here) plus 12.5 cycles of conversion
+static const uint16_t sample_half_cycles[8] = { 3, 15, 27, 57, 83, 111, 143, 479 };
+
+uint32_t Oscilloscope::setSampleRate(uint32_t hz) {
+    if (!hadc) return 0;
+    ADC_TypeDef* adc = hadc->Instance;
+    uint32_t adc_clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC);
+    uint32_t smp = 0;
+    for (uint32_t i = 7; i > 0; --i) {
+        if ((uint64_t)adc_clock * 2 / (sample_half_cycles[i] + 25) >= hz) {
+            smp = i;
+            break;
+        }
+    }
+    uint32_t ch = adc->SQR3 & 0x1F;
+    if (ch < 10) adc->SMPR2 = (adc->SMPR2 & ~(7UL << (3 * ch))) | (smp << (3 * ch));
+    else adc->SMPR1 = (adc->SMPR1 & ~(7UL << (3 * (ch - 10)))) | (smp << (3 * (ch - 10)));
+    return sample_rate_hz();
+}
 
-    // Draw grid lines
+uint32_t Oscilloscope::sample_rate_hz() const {
+    if (!hadc) return 0;
+    ADC_TypeDef* adc = hadc->Instance;
+    uint32_t ch = adc->SQR3 & 0x1F; // The one regular channel
+    uint32_t smp = (ch < 10) ? (adc->SMPR2 >> (3 * ch)) & 7 : (adc->SMPR1 >> (3 * (ch - 10))) & 7;
+    uint32_t adc_clock = HAL_RCCEx_GetPeriphCLKFreq(RCC_PERIPHCLK_ADC);
+    return (uint32_t)((uint64_t)adc_clock * 2 / (sample_half_cycles[smp] + 25));
+}
+
+// Paint callback for the waveform framebuffer: grid, trigger markers, then the trace.
+// Called once per band; the framebuffer clips every primitive to the band in RAM.
+void Oscilloscope::paintWaveArea(IndexedFramebuffer& fb, void* ctx) {
+    Oscilloscope* self = (Oscilloscope*)ctx;
+    int16_t w = fb.width();
+    int16_t h = fb.height();
+
+    fb.clear(SCOPE_PAL_BG);
+
+    // Grid lines
     int num_horizontal_lines = 5; // Example
     int num_vertical_lines = 10;  // Example
-
-    // Horizontal lines
     for (int i = 0; i <= num_horizontal_lines; ++i) {
-        int16_t y_pos = wave_y + (i * wave_h / num_horizontal_lines);
-        if (i == num_horizontal_lines) y_pos -=1; // Ensure last line is visible
-        tft->drawHorizontalLine(wave_x, y_pos, wave_w, SCOPE_GRID_COLOR);
+        int16_t y_pos = i * h / num_horizontal_lines;
+        if (i == num_horizontal_lines) y_pos -= 1; // Ensure last line is visible
+        fb.hline(0, y_pos, w, SCOPE_PAL_GRID);
     }
-
-    // Vertical lines
     for (int i = 0; i <= num_vertical_lines; ++i) {
-        int16_t x_pos = wave_x + (i * wave_w / num_vertical_lines);
-        if (i == num_vertical_lines) x_pos -=1; // Ensure last line is visible
-        tft->drawVerticalLine(x_pos, wave_y, wave_h, SCOPE_GRID_COLOR);
+        int16_t x_pos = i * w / num_vertical_lines;
+        if (i == num_vertical_lines) x_pos -= 1; // Ensure last line is visible
+        fb.vline(x_pos, 0, h - 1, SCOPE_PAL_GRID);
+    }
+
+    // Trigger level (dashed) and trigger position (ticks at top and bottom)
+    fb.dashed_hline(0, self->levelRow(self->trigger_level), w, SCOPE_PAL_MARKER, 6);
+    fb.vline(self->trigger_pos_px, 0, SCOPE_MARKER_TICK_LEN - 1, SCOPE_PAL_MARKER);
+    fb.vline(self->trigger_pos_px, h - SCOPE_MARKER_TICK_LEN, h - 1, SCOPE_PAL_MARKER);
+
+    // Trace: one vertical span per column joins sample i to sample i+1
+    if (self->trace_data) {
+        const uint16_t* data = self->trace_data;
+        int n = (self->trace_len < w) ? self->trace_len : w;
+        for (int i = 0; i < n - 1; ++i) {
+            fb.vline(i, data[i], data[i + 1], SCOPE_PAL_TRACE);
+        }
+        if (n == 1) fb.pixel(0, data[0], SCOPE_PAL_TRACE);
     }
-    triggered_once = false; // Reset this so waveform clears correctly first time after grid
 }
 
-// Draw Waveform
-void Oscilloscope::drawWaveform(uint16_t* data, int data_len, uint16_t color) {
-    if (!tft) return;
+void Oscilloscope::renderWaveArea() {
+    wave_fb.render(&Oscilloscope::paintWaveArea, this);
+}
+
+int16_t Oscilloscope::levelRow(int level) const {
+    int16_t row = (int16_t)(wave_h - ((int32_t)level * wave_h) / 4095);
+    return (row >= wave_h) ? wave_h - 1 : row;
+}
 
-    // Clear only the waveform area (already done by drawGrid if grid is redrawn,
-    // but good to have if grid is static)
-    // More efficiently, only clear the part of the waveform that was drawn last time.
-    // For single-shot style, clearing the whole area before drawing is fine.
-    if (triggered_once) { // Avoid clearing grid on first draw
-         tft->fillRect(wave_x, wave_y, wave_w, wave_h, SCOPE_BG_COLOR);
-         // Optional: Redraw grid if clearing the whole area.
-         // For now, assume grid is static or redrawn by user explicitly.
-         // If we cleared, we should redraw grid. A better way is to save background.
-         // Let's redraw grid for now, or make drawGrid clear and draw.
-         // The current drawGrid clears and draws. So call it before drawWaveform if clearing is needed.
-         // This is inefficient. A better approach would be to draw the old waveform in BG_COLOR.
-         // For now, the process() will call drawGrid() then drawWaveform().
+// The paint callback still composes grid, markers and the last trace (trace_data keeps
+// pointing at it), so re-rendering a few rows restores everything under the old marker.
+void Oscilloscope::moveTriggerLevel(int level) {
+    int16_t old_row = levelRow(trigger_level);
+    setTrigger(level, trigger_edge);
+    int16_t new_row = levelRow(trigger_level);
+    if (!tft || old_row == new_row) return;
+
+    if (old_row > new_row) { int16_t t = old_row; old_row = new_row; new_row = t; }
+    if (new_row - old_row < 8) {
+        wave_fb.render_rows(old_row, new_row, &Oscilloscope::paintWaveArea, this); // One window
+    } else {
+        wave_fb.render_rows(old_row, old_row, &Oscilloscope::paintWaveArea, this);
+        wave_fb.render_rows(new_row, new_row, &Oscilloscope::paintWaveArea, this);
     }
+}
 
+void Oscilloscope::moveTriggerPosition(int16_t px) {
+    if (px < 0) px = 0;
+    if (px > wave_w - 1) px = wave_w - 1;
+    if (px == trigger_pos_px) return;
+    trigger_pos_px = px; // prepareDisplayData() uses it from the next frame on
+    if (!tft) return;
+    wave_fb.render_rows(0, SCOPE_MARKER_TICK_LEN - 1, &Oscilloscope::paintWaveArea, this);
+    wave_fb.render_rows(wave_h - SCOPE_MARKER_TICK_LEN, wave_h - 1, &Oscilloscope::paintWaveArea, this);
+}
+
+// Draw Grid
+void Oscilloscope::drawGrid() {
+    if (!tft) return;
+    trace_data = nullptr; // Grid and markers only
+    renderWaveArea();
+    triggered_once = false;
+}
+
+// Draw Waveform
+void Oscilloscope::drawWaveform(uint16_t* data, int data_len, uint16_t color) {
+    if (!tft) return;
 
     // data_len should be wave_w
-    // The `data` array contains scaled Y coordinates (0 to wave_h-1)
-    for (int i = 0; i < data_len - 1; ++i) {
-        // Ensure points are within the waveform display area boundaries
-        int16_t y1 = wave_y + data[i];
-        int16_t y2 = wave_y + data[i+1];
-
-        // Clamp to prevent drawing outside wave_y to wave_y + wave_h
-        y1 = (y1 < wave_y) ? wave_y : y1;
-        y1 = (y1 >= wave_y + wave_h) ? (wave_y + wave_h - 1) : y1;
-        y2 = (y2 < wave_y) ? wave_y : y2;
-        y2 = (y2 >= wave_y + wave_h) ? (wave_y + wave_h - 1) : y2;
-        
-        tft->drawLine(wave_x + i, y1, wave_x + i + 1, y2, color);
-    }
+    // The `data` array contains scaled Y coordinates (0 to wave_h-1); the framebuffer
+    // clips anything outside the waveform area.
+    // The whole area (grid + markers + trace) is composed off-screen and pushed at once,
+    // so the previous trace never has to be erased on the panel.
+    wave_fb.set_palette(SCOPE_PAL_TRACE, color);
+    trace_data = data;
+    trace_len = data_len;
+    renderWaveArea();
     triggered_once = true;
 }
 
@@ -291,11 +429,16 @@ void Oscilloscope::process() {
 
         if (trigger_idx != -1) {
             // Trigger found
+            int half_start = (int)(buffer_to_process - adc_buffer);
+            bool freeze = freeze_pending && haltForRecord(half_start); // Before anything slow
             prepareDisplayData(buffer_to_process, buffer_half_len, trigger_idx);
-            
-            drawGrid(); 
+            if (freeze) freezeRecord(half_start + trigger_idx); // After the display copy, which reads the ring
+
+            // Grid, markers and trace are composed together; no separate drawGrid() pass
             drawWaveform(display_buffer, wave_w, SCOPE_WAVEFORM_COLOR);
-            
+            frame_counter++;
+            if (freeze) return;
+
             // Update the search offset for the half that was just processed,
             // so the next search in this same half (if re-processed before next DMA event for this half)
             // starts after the found trigger.
@@ -4,6 +4,8 @@
 #include "stm32f1xx_hal.h" // For ADC_HandleTypeDef
 #include "Middlewares/Adafruit/GFX/Adafruit_GFX.h" // For Adafruit_ILI9341
 #include "Middlewares/Adafruit/ILI9341/Adafruit_ILI9341.h" // For Adafruit_ILI9341
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // For ILI9341_Display
+#include "IndexedFramebuffer.h" // Off-screen composition of the waveform area
 
 // Configuration constants
 #define ADC_BUFFER_SIZE 1024 // Size of the DMA buffer (can be tuned)
@@ -13,6 +15,17 @@
 #define SCOPE_BG_COLOR       ILI9341_BLACK
 #define SCOPE_GRID_COLOR     ILI9341_DARKGREY
 #define SCOPE_WAVEFORM_COLOR ILI9341_GREEN
+#define SCOPE_MARKER_COLOR   ILI9341_ORANGE // Trigger level / position markers
+
+// Palette indices used in the waveform framebuffer
+#define SCOPE_PAL_BG     0
+#define SCOPE_PAL_GRID   1
+#define SCOPE_PAL_TRACE  2
+#define SCOPE_PAL_MARKER 3
+
+#define SCOPE_MARKER_TICK_LEN 5 // Trigger position ticks at the top and bottom of the area
+
+#define SCOPE_VREF_MV 3300 // ADC full scale (VDDA), for the scaling sent with capture records
 
 class Oscilloscope {
 public:
@@ -23,7 +36,7 @@ public:
     };
 
     // Constructor
-    Oscilloscope(ADC_HandleTypeDef* hadc_ptr, Adafruit_ILI9341* tft_display);
+    Oscilloscope(ADC_HandleTypeDef* hadc_ptr, ILI9341_Display* tft_display);
 
     // Initialization
     void begin(); // Starts ADC DMA, sets up initial state
@@ -40,19 +53,53 @@ public:
     void start(); 
     void stop();  
     bool is_running() const { return is_running_flag; }
+    uint32_t frame_count() const { return frame_counter; } // Number of waveforms drawn so far
+
+    // Capture record. After freeze_next(), the next triggered frame stops the ADC as soon as
+    // its trigger is found: the DMA buffer then holds the last ADC_BUFFER_SIZE samples, rotated in
+    // place into time order, with the trigger at record_trigger_index(). The holder may
+    // rewrite the buffer. release_record() runs the scope again, unless stop() was called
+    // in the meantime; start() while frozen only asks for that.
+    void freeze_next() { freeze_pending = true; }
+    bool is_frozen() const { return frozen; }
+    uint16_t* record() { return frozen ? adc_buffer : nullptr; } // ADC_BUFFER_SIZE samples
+    uint32_t record_trigger_index() const { return record_trigger; }
+    void release_record();
+    uint32_t sample_rate_hz() const; // From the ADC clock and the channel's sampling time
+    // Timebase: the channel's sampling time is set to the longest one that still gives at
+    // least hz (the shortest if none does). Takes effect from the next conversion.
+    uint32_t setSampleRate(uint32_t hz);
 
     // DMA Callback Forwarders - to be called by global HAL ADC Callbacks
     void HAL_ADC_ConvCpltCallback_Forwarder();
     void HAL_ADC_ConvHalfCpltCallback_Forwarder();
 
-    // Drawing functions
-    void drawGrid();
+    // Screen rectangle of the waveform area (defaults to the whole screen minus a margin)
+    void setWaveArea(int16_t x, int16_t y, int16_t w, int16_t h);
+    bool inWaveArea(int16_t x, int16_t y) const {
+        return x >= wave_x && x < wave_x + wave_w && y >= wave_y && y < wave_y + wave_h;
+    }
+    int16_t waveWidth() const { return wave_w; }
+    int16_t waveHeight() const { return wave_h; }
+
+    // Trigger position: column of the trigger point within the waveform area
+    int16_t getTriggerPosition() const { return trigger_pos_px; }
+
+    // Interactive changes: update the setting and repaint only the marker rows it
+    // affects (old and new), leaving the rest of the waveform area untouched.
+    void moveTriggerLevel(int level);
+    void moveTriggerPosition(int16_t px);
+
+    // Drawing functions. Both compose the full waveform area off-screen and push it
+    // in one window, so nothing is ever cleared on the panel (no flicker).
+    void drawGrid();     // Grid and trigger markers only
     void drawWaveform(uint16_t* display_data, int data_len, uint16_t color);
 
 private:
     // Member variables
     ADC_HandleTypeDef* hadc;      // Pointer to the HAL ADC handle
-    Adafruit_ILI9341* tft;        // Pointer to the TFT display object
+    ILI9341_Display* tft;         // Pointer to the TFT display object
+    IndexedFramebuffer wave_fb;   // 2-bpp band renderer for the waveform area
 
     uint16_t adc_buffer[ADC_BUFFER_SIZE]; // DMA buffer for ADC samples
     volatile bool dma_cplt_flag;          // DMA transfer complete flag
@@ -76,16 +123,30 @@ private:
     int16_t wave_h;
     
     uint16_t display_buffer[320]; // Max common screen width. Will use up to screen_width.
+    uint16_t* trace_data;         // Trace handed to the paint callback (nullptr = grid only)
+    int trace_len;
+    int16_t trigger_pos_px;       // Column of the trigger point within the waveform area
 
     // Helper methods
     int findTrigger(uint16_t* buffer_to_search, int buffer_len, int search_offset);
     void prepareDisplayData(uint16_t* src_buffer, int src_buffer_len, int trigger_index);
+    bool haltForRecord(int half_start);   // Stop the ADC; false if the DMA lapped that half
+    void freezeRecord(int trigger_index); // Rotate the halted buffer (trigger index in adc_buffer)
+    void renderWaveArea();
+    int16_t levelRow(int level) const; // Row of the dashed trigger level line
+    static void paintWaveArea(IndexedFramebuffer& fb, void* ctx);
 
     // Internal state
     bool triggered_once; // To draw grid only once initially if needed, or manage first trigger
     uint32_t last_trigger_time; // For timeout or re-arm logic (advanced)
     int search_offset_first_half; // To optimize findTrigger search in the first half
     int search_offset_second_half; // To optimize findTrigger search in the second half
+    uint32_t frame_counter;       // Incremented each time a triggered waveform is drawn
+    bool freeze_pending;          // Freeze after the next triggered frame
+    bool frozen;                  // adc_buffer is a capture record, handed out
+    bool resume_after_record;     // Run again when the record is released
+    uint32_t record_trigger;
+    uint32_t record_oldest;       // Write position when the ADC stopped: the oldest sample
 };
 
 #endif // SCOPE_H
@@ -0,0 +1,99 @@
+#include "ScopeFrame.h"
+
+// Reflected polynomial 0xEDB88320, a nibble at a time: 64 bytes of table instead of 1 KB
+static const uint32_t crc_nibble[16] = {
+    0x00000000, 0x1DB71064, 0x3B6E20C8, 0x26D930AC, 0x76DC4190, 0x6B6B51F4, 0x4DB26158, 0x5005713C,
+    0xEDB88320, 0xF00F9344, 0xD6D6A3E8, 0xCB61B38C, 0x9B64C2B0, 0x86D3D2D4, 0xA00AE278, 0xBDBDF21C,
+};
+
+static inline uint32_t crc_byte(uint32_t crc, uint8_t b) {
+    crc ^= b;
+    crc = (crc >> 4) ^ crc_nibble[crc & 0x0F];
+    return (crc >> 4) ^ crc_nibble[crc & 0x0F];
+}
+
+uint32_t scope_crc_update(uint32_t crc, const uint8_t* data, uint32_t len) {
+    for (uint32_t i = 0; i < len; ++i) crc = crc_byte(crc, data[i]);
+    return crc;
+}
+
+uint32_t scope_frame_payload_len(uint32_t samples) {
+    return (samples + 1) / 2 * 3;
+}
+
+static void put16(uint8_t* p, uint16_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+}
+
+static void put32(uint8_t* p, uint32_t v) {
+    p[0] = (uint8_t)v;
+    p[1] = (uint8_t)(v >> 8);
+    p[2] = (uint8_t)(v >> 16);
+    p[3] = (uint8_t)(v >> 24);
+}
+
+static uint16_t get16(const uint8_t* p) {
+    return (uint16_t)(p[0] | (p[1] << 8));
+}
+
+static uint32_t get32(const uint8_t* p) {
+    return p[0] | ((uint32_t)p[1] << 8) | ((uint32_t)p[2] << 16) | ((uint32_t)p[3] << 24);
+}
+
+uint16_t scope_frame_write_header(uint8_t* out, const ScopeFrameHeader& h) {
+    put32(out + 0, SCOPE_FRAME_MAGIC);
+    put16(out + 4, SCOPE_FRAME_VERSION);
+    put16(out + 6, SCOPE_FRAME_HEADER_LEN);
+    put32(out + 8, h.sample_rate_hz);
+    put32(out + 12, h.sample_count);
+    put32(out + 16, h.trigger_index);
+    put32(out + 20, h.nv_per_lsb);
+    put16(out + 24, h.offset_code);
+    out[26] = h.bits;
+    out[27] = h.flags;
+    put32(out + 28, scope_frame_payload_len(h.sample_count));
+    return SCOPE_FRAME_HEADER_LEN;
+}
+
+bool scope_frame_read_header(const uint8_t* in, ScopeFrameHeader* h, uint16_t* header_len) {
+    if (get32(in) != SCOPE_FRAME_MAGIC || get16(in + 4) != SCOPE_FRAME_VERSION) return false;
+    *header_len = get16(in + 6);
+    if (*header_len < SCOPE_FRAME_HEADER_LEN) return false;
+    h->sample_rate_hz = get32(in + 8);
+    h->sample_count = get32(in + 12);
+    h->trigger_index = get32(in + 16);
+    h->nv_per_lsb = get32(in + 20);
+    h->offset_code = get16(in + 24);
+    h->bits = in[26];
+    h->flags = in[27];
+    if (h->bits == 0 || h->bits > 16) return false;
+    return get32(in + 28) == scope_frame_payload_len(h->sample_count);
+}
+
+uint32_t scope_frame_pack(uint16_t* samples, uint32_t count, uint32_t* crc) {
+    // Pair k is read from bytes 4k..4k+3 before bytes 3k..3k+2 are written: the output
+    // never catches up with input that has not been read yet
+    uint8_t* out = (uint8_t*)samples;
+    uint32_t c = *crc;
+    for (uint32_t i = 0; i < count; i += 2) {
+        uint16_t a = samples[i] & 0x0FFF;
+        uint16_t b = (i + 1 < count) ? (samples[i + 1] & 0x0FFF) : 0;
+        uint8_t b0 = (uint8_t)a;
+        uint8_t b1 = (uint8_t)((a >> 8) | (b << 4));
+        uint8_t b2 = (uint8_t)(b >> 4);
+        *out++ = b0;
+        *out++ = b1;
+        *out++ = b2;
+        c = crc_byte(crc_byte(crc_byte(c, b0), b1), b2);
+    }
+    *crc = c;
+    return scope_frame_payload_len(count);
+}
+
+void scope_frame_unpack(const uint8_t* payload, uint32_t count, uint16_t* out) {
+    for (uint32_t i = 0; i < count; i += 2, payload += 3) {
+        out[i] = (uint16_t)(payload[0] | ((payload[1] & 0x0F) << 8));
+        if (i + 1 < count) out[i + 1] = (uint16_t)((payload[1] >> 4) | (payload[2] << 4));
+    }
+}
@@ -0,0 +1,62 @@
+#ifndef SCOPE_FRAME_H
+#define SCOPE_FRAME_H
+
+#include <stdint.h>
+
+// Binary frame of one scope capture, as sent on the host link by ScopeStream and read by
+// Tools/scope_decode.cpp. All fields little-endian:
+//   header  SCOPE_FRAME_HEADER_LEN bytes (layout below)
+//   payload 12-bit samples, two per three bytes: a[7:0], a[11:8] | b[3:0] << 4, b[11:4]
+//           (an odd count is padded with a zero sample)
+//   trailer CRC-32 (IEEE 802.3, as zlib's crc32()) of header and payload
+// No HAL access: the firmware and the host tool build the same file.
+#define SCOPE_FRAME_MAGIC      0x31504353UL // "SCP1"
+#define SCOPE_FRAME_VERSION    1
+#define SCOPE_FRAME_HEADER_LEN 32
+#define SCOPE_FRAME_CRC_LEN    4
+
+#define SCOPE_FRAME_TRIGGERED  0x01 // flags: the capture is aligned on a trigger
+#define SCOPE_FRAME_FALLING    0x02 // ...on a falling edge
+
+// Header layout (offset: field)
+//    0: magic            u32
+//    4: version          u16
+//    6: header_len       u16  (readers skip fields they do not know)
+//    8: sample_rate_hz   u32
+//   12: sample_count     u32
+//   16: trigger_index    u32  (sample of the trigger)
+//   20: nv_per_lsb       u32  (volts = (code - offset_code) * nv_per_lsb / 1e9)
+//   24: offset_code      u16
+//   26: bits             u8   (12)
+//   27: flags            u8   (SCOPE_FRAME_*)
+//   28: payload_len      u32
+struct ScopeFrameHeader {
+    uint32_t sample_rate_hz;
+    uint32_t sample_count;
+    uint32_t trigger_index;
+    uint32_t nv_per_lsb;
+    uint16_t offset_code;
+    uint8_t bits;
+    uint8_t flags;
+};
+
+uint32_t scope_frame_payload_len(uint32_t samples);
+
+// Serialize a header (payload_len from sample_count); returns SCOPE_FRAME_HEADER_LEN
+uint16_t scope_frame_write_header(uint8_t* out, const ScopeFrameHeader& h);
+// Parse one; false if the magic, version or lengths do not fit. *header_len is the
+// length the sender used (>= SCOPE_FRAME_HEADER_LEN).
+bool scope_frame_read_header(const uint8_t* in, ScopeFrameHeader* h, uint16_t* header_len);
+
+// Pack count samples in place, from 16 bits each to the payload format (the buffer is
+// read ahead of every write), updating crc over the packed bytes. Returns the payload length.
+uint32_t scope_frame_pack(uint16_t* samples, uint32_t count, uint32_t* crc);
+// Unpack a payload into count samples
+void scope_frame_unpack(const uint8_t* payload, uint32_t count, uint16_t* out);
+
+// Running CRC-32: start with SCOPE_CRC_INIT, finish with scope_crc_final()
+#define SCOPE_CRC_INIT 0xFFFFFFFFUL
+uint32_t scope_crc_update(uint32_t crc, const uint8_t* data, uint32_t len);
+inline uint32_t scope_crc_final(uint32_t crc) { return ~crc; }
+
+#endif // SCOPE_FRAME_H
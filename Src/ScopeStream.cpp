@@ -0,0 +1,63 @@
+#include "ScopeStream.h"
+#include "host_link.h"
+
+ScopeStream::ScopeStream(Oscilloscope* scope)
+    : scope(scope), continuous(false), pending(false), sending(false), send_start(0), st() {}
+
+void ScopeStream::set_continuous(bool on) {
+    continuous = on;
+    if (on) request();
+}
+
+void ScopeStream::request() {
+    if (pending || sending) return;
+    pending = true;
+    scope->freeze_next();
+}
+
+void ScopeStream::on_scope_frozen() {
+    if (!pending || sending || !scope->is_frozen()) return;
+    pending = false;
+    uint32_t start = DWT->CYCCNT;
+
+    ScopeFrameHeader h;
+    h.sample_rate_hz = scope->sample_rate_hz();
+    h.sample_count = ADC_BUFFER_SIZE;
+    h.trigger_index = scope->record_trigger_index();
+    h.nv_per_lsb = (uint32_t)((uint64_t)SCOPE_VREF_MV * 1000000 / 4096);
+    h.offset_code = 0;
+    h.bits = 12;
+    h.flags = SCOPE_FRAME_TRIGGERED | (scope->getTriggerEdge() == Oscilloscope::FALLING ? SCOPE_FRAME_FALLING : 0);
+    scope_frame_write_header(header, h);
+
+    uint32_t crc = scope_crc_update(SCOPE_CRC_INIT, header, SCOPE_FRAME_HEADER_LEN);
+    uint16_t* rec = scope->record();
+    uint32_t len = scope_frame_pack(rec, ADC_BUFFER_SIZE, &crc);
+    crc = scope_crc_final(crc);
+    for (int k = 0; k < SCOPE_FRAME_CRC_LEN; ++k) trailer[k] = (uint8_t)(crc >> (8 * k));
+    st.pack_cycles = DWT->CYCCNT - start;
+
+    HostLinkPart parts[3] = {
+        { header, SCOPE_FRAME_HEADER_LEN, 1 },
+        { rec, len, 1 }, // The packed record, straight from the scope's buffer
+        { trailer, SCOPE_FRAME_CRC_LEN, 1 },
+    };
+    if (!host_link_send_parts(parts, 3)) { // Link busy (a SUMP reply): skip this frame
+        scope->release_record();
+        if (continuous) request();
+        return;
+    }
+    st.frame_bytes = SCOPE_FRAME_HEADER_LEN + len + SCOPE_FRAME_CRC_LEN;
+    send_start = DWT->CYCCNT;
+    sending = true;
+}
+
+void ScopeStream::on_tx_done() {
+    if (!sending || host_link_busy()) return; // Also posted when the LA gives the link back
+    st.send_cycles = DWT->CYCCNT - send_start;
+    st.bytes_per_s = st.send_cycles ? (uint32_t)((uint64_t)st.frame_bytes * HAL_RCC_GetHCLKFreq() / st.send_cycles) : 0;
+    st.frames++;
+    sending = false;
+    scope->release_record(); // Runs the scope again unless it was stopped meanwhile
+    if (continuous) request();
+}
@@ -0,0 +1,45 @@
+#ifndef SCOPE_STREAM_H
+#define SCOPE_STREAM_H
+
+#include <stdint.h>
+#include "ScopeFrame.h"
+#include "Scope.h"
+
+// Sends frozen scope captures to the host as ScopeFrame frames on the host link. The
+// record is packed in place in the scope's DMA buffer (12 bits per sample, CRC taken in
+// the same pass) and sent from there, so the only other memory is the header and trailer.
+// Continuous: every triggered frame the link can keep up with (the scope pauses for each
+// transmission). On demand: request() sends the next triggered frame.
+struct ScopeStreamStats {
+    uint32_t frames;          // Frames sent
+    uint32_t frame_bytes;     // Size of the last one on the wire
+    uint32_t pack_cycles;     // Rotation is done by the scope; this is pack + CRC
+    uint32_t send_cycles;     // First byte handed to the DMA to the last one sent
+    uint32_t bytes_per_s;     // Throughput of the last frame
+};
+
+class ScopeStream {
+public:
+    explicit ScopeStream(Oscilloscope* scope);
+
+    void set_continuous(bool on);
+    bool is_continuous() const { return continuous; }
+    void request(); // Send the next triggered frame
+
+    void on_scope_frozen(); // After the scope task: pack and send a frozen record
+    void on_tx_done();      // SCHED_EVT_HOST_TX: give the record back, run the scope again
+    bool is_sending() const { return sending; }
+    const ScopeStreamStats& stats() const { return st; }
+
+private:
+    Oscilloscope* scope;
+    bool continuous;
+    bool pending;  // A frame was asked for (freeze armed)
+    bool sending;
+    uint8_t header[SCOPE_FRAME_HEADER_LEN];
+    uint8_t trailer[SCOPE_FRAME_CRC_LEN];
+    uint32_t send_start;
+    ScopeStreamStats st;
+};
+
+#endif // SCOPE_STREAM_H
@@ -0,0 +1,52 @@
+#ifndef SCPI_COMMANDS_H
+#define SCPI_COMMANDS_H
+
+// The SCPI command set: X(pattern, handler) for each command, in table order. ScpiServer
+// builds its table from it with the handlers in ScpiServer.cpp; the host tests build theirs
+// with stand-ins of the same names (Tests/scpi_stand_in.h), so both parse the same headers.
+// No HAL: pattern syntax is ScpiParser's.
+#define SCPI_COMMAND_LIST(X) \
+    X("*IDN?", cmd_idn) \
+    X("*RST", cmd_rst) \
+    X("*CLS", cmd_cls) \
+    X("*OPC?", cmd_opc_q) \
+    X("SYSTem:ERRor?", cmd_err_q) \
+    X("SYSTem:STATistics?", cmd_stats_q) \
+    X("MODE", cmd_mode) \
+    X("MODE?", cmd_mode_q) \
+    X("SCOPe:RUN", cmd_scope_run) \
+    X("SCOPe:STOP", cmd_scope_stop) \
+    X("SCOPe:STATe?", cmd_scope_state_q) \
+    X("SCOPe:FRAMes?", cmd_scope_frames_q) \
+    X("SCOPe:TRIGger:LEVel", cmd_trig_level) \
+    X("SCOPe:TRIGger:LEVel?", cmd_trig_level_q) \
+    X("SCOPe:TRIGger:SLOPe", cmd_trig_slope) \
+    X("SCOPe:TRIGger:SLOPe?", cmd_trig_slope_q) \
+    X("SCOPe:TRIGger:POSition", cmd_trig_pos) \
+    X("SCOPe:TRIGger:POSition?", cmd_trig_pos_q) \
+    X("SCOPe:SRATe", cmd_srate) \
+    X("SCOPe:SRATe?", cmd_srate_q) \
+    X("SCOPe:DATA:SEND", cmd_data_send) \
+    X("SCOPe:DATA:CONTinuous", cmd_data_cont) \
+    X("SCOPe:DATA:CONTinuous?", cmd_data_cont_q) \
+    X("LA:RATE", cmd_la_rate) \
+    X("LA:RATE?", cmd_la_rate_q) \
+    X("LA:MODE", cmd_la_mode) \
+    X("LA:MODE?", cmd_la_mode_q) \
+    X("LA:ARM", cmd_la_arm) \
+    X("LA:STOP", cmd_la_stop) \
+    X("LA:LIVE", cmd_la_live) \
+    X("LA:LIVE?", cmd_la_live_q) \
+    X("LA:MIXed", cmd_la_mixed) \
+    X("LA:MIXed?", cmd_la_mixed_q) \
+    X("LA:STATe?", cmd_la_state_q) \
+    X("LA:SAMPles?", cmd_la_samples_q) \
+    X("LA:CURSor:DELTa?", cmd_la_cursor_delta_q) \
+    X("LA:MEASure:EDGes?", cmd_meas_edges_q) \
+    X("LA:MEASure:FREQuency?", cmd_meas_freq_q) \
+    X("LA:MEASure:DUTY?", cmd_meas_duty_q) \
+    X("LA:MEASure:PWIDth?", cmd_meas_pwidth_q)
+
+#define SCPI_COMMAND_ENTRY(pattern, handler) { pattern, handler },
+
+#endif // SCPI_COMMANDS_H
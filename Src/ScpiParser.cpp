@@ -0,0 +1,317 @@
+#include "ScpiParser.h"
+
+ScpiParser::ScpiParser(const ScpiCommand* table, uint8_t count, void* ctx)
+    : table(table), table_len(count), ctx(ctx), len(0), overrun(false), out_len(0), item_open(false),
+      out_full(false), args(nullptr), args_end(nullptr), err_count(0), lines_done(0), commands_done(0) {
+    out[0] = '\0';
+}
+
+static char upper(char c) {
+    return (c >= 'a' && c <= 'z') ? (char)(c - 'a' + 'A') : c;
+}
+
+static bool is_space(char c) {
+    return c == ' ' || c == '\t' || c == '\r';
+}
+
+bool ScpiParser::feed(uint8_t b) {
+    if (b != '\n') {
+        if (overrun) return false;
+        if (len == SCPI_LINE_MAX) { // Keep nothing of it: a truncated command could still match
+            overrun = true;
+            len = 0;
+            error(SCPI_ERR_INPUT_OVERRUN);
+            return false;
+        }
+        line[len++] = (char)b;
+        return false;
+    }
+    bool skipped = overrun;
+    overrun = false;
+    line[len] = '\0';
+    out_len = 0;
+    out_full = false;
+    if (!skipped) execute_line();
+    len = 0;
+    if (out_len) out[out_len++] = '\n'; // Room kept by put(), also after an overflow
+    out[out_len] = '\0';
+    lines_done++;
+    return true;
+}
+
+void ScpiParser::execute_line() {
+    const char* p = line;
+    const char* end = line + len;
+    while (p < end) {
+        const char* q = p;
+        while (q < end && *q != ';') q++;
+        execute(p, q);
+        p = q + 1;
+    }
+}
+
+void ScpiParser::execute(const char* cmd, const char* end) {
+    while (cmd < end && is_space(*cmd)) cmd++;
+    if (cmd == end) return; // Empty command (";;", trailing ';' or a blank line)
+    if (*cmd == ':') cmd++; // Root specifier: every command starts there anyway
+
+    const char* hdr_end = cmd;
+    while (hdr_end < end && !is_space(*hdr_end)) hdr_end++;
+    const ScpiCommand* c = lookup(cmd, hdr_end);
+    if (!c) {
+        error(SCPI_ERR_UNDEFINED);
+        return;
+    }
+    args = hdr_end;
+    args_end = end;
+    bool query = (hdr_end[-1] == '?');
+    if (query && out_len && !out_full) put(";", 1); // Results of successive queries
+    item_open = false;
+    c->fn(*this, ctx);
+    commands_done++;
+}
+
+// One mnemonic of a pattern ("TRIGger") against one of the input ("trig" / "TRIGGER")
+static bool mnemonic_matches(const char* pat, const char* pat_end, const char* in, const char* in_end) {
+    uint8_t short_len = 0;
+    while (pat + short_len < pat_end && !(pat[short_len] >= 'a' && pat[short_len] <= 'z')) short_len++;
+    uint8_t in_len = (uint8_t)(in_end - in);
+    if (in_len != short_len && in_len != (uint8_t)(pat_end - pat)) return false;
+    for (uint8_t i = 0; i < in_len; ++i) {
+        if (upper(in[i]) != upper(pat[i])) return false;
+    }
+    return true;
+}
+
+const ScpiCommand* ScpiParser::lookup(const char* hdr, const char* hdr_end) const {
+    bool query = (hdr_end > hdr && hdr_end[-1] == '?');
+    if (query) hdr_end--;
+    for (uint8_t i = 0; i < table_len; ++i) {
+        const char* pat = table[i].pattern;
+        const char* pat_end = pat;
+        while (*pat_end) pat_end++;
+        bool pat_query = (pat_end > pat && pat_end[-1] == '?');
+        if (pat_query != query) continue;
+        if (pat_query) pat_end--;
+
+        // Mnemonic by mnemonic
+        const char* a = pat;
+        const char* b = hdr;
+        bool ok = true;
+        while (ok) {
+            const char* a_end = a;
+            while (a_end < pat_end && *a_end != ':') a_end++;
+            const char* b_end = b;
+            while (b_end < hdr_end && *b_end != ':') b_end++;
+            ok = mnemonic_matches(a, a_end, b, b_end);
+            if (a_end == pat_end || b_end == hdr_end) {
+                ok = ok && (a_end == pat_end) && (b_end == hdr_end);
+                break;
+            }
+            a = a_end + 1;
+            b = b_end + 1;
+        }
+        if (ok) return &table[i];
+    }
+    return nullptr;
+}
+
+const char* ScpiParser::next_arg(const char** end) {
+    const char* p = args;
+    while (p < args_end && is_space(*p)) p++;
+    if (p == args_end) return nullptr;
+    const char* q = p;
+    while (q < args_end && *q != ',') q++;
+    args = (q < args_end) ? q + 1 : q;
+    while (q > p && is_space(q[-1])) q--;
+    *end = q;
+    return p;
+}
+
+bool ScpiParser::has_arg() const {
+    for (const char* p = args; p < args_end; ++p) {
+        if (!is_space(*p)) return true;
+    }
+    return false;
+}
+
+// Decimal with optional sign, fraction and exponent, truncated to an integer
+static bool parse_number(const char* p, const char* end, bool* neg, uint32_t* v) {
+    *neg = false;
+    if (p < end && (*p == '+' || *p == '-')) *neg = (*p++ == '-');
+    uint64_t mant = 0;
+    int digits = 0, frac = 0, exp = 0;
+    bool in_frac = false;
+    for (; p < end && ((*p >= '0' && *p <= '9') || (*p == '.' && !in_frac)); ++p) {
+        if (*p == '.') {
+            in_frac = true;
+            continue;
+        }
+        if (mant < 1000000000000ULL) { // Further digits cannot change a 32-bit result
+            mant = mant * 10 + (uint64_t)(*p - '0');
+            if (in_frac) frac++;
+        } else if (!in_frac) {
+            exp++;
+        }
+        digits++;
+    }
+    if (digits == 0) return false;
+    if (p < end && (*p == 'e' || *p == 'E')) {
+        ++p;
+        bool eneg = false;
+        if (p < end && (*p == '+' || *p == '-')) eneg = (*p++ == '-');
+        int e = 0;
+        if (p == end) return false;
+        for (; p < end && *p >= '0' && *p <= '9'; ++p) {
+            if (e < 100) e = e * 10 + (*p - '0');
+        }
+        exp += eneg ? -e : e;
+    }
+    if (p != end) return false;
+    for (exp -= frac; exp < 0 && mant; ++exp) mant /= 10;
+    for (; exp > 0 && mant; --exp) {
+        mant *= 10;
+        if (mant > 0xFFFFFFFFULL) return false;
+    }
+    if (mant > 0xFFFFFFFFULL) return false;
+    *v = (uint32_t)mant;
+    return true;
+}
+
+bool ScpiParser::arg_uint(uint32_t* v) {
+    const char* end;
+    const char* p = next_arg(&end);
+    if (!p) {
+        error(SCPI_ERR_MISSING_PARAM);
+        return false;
+    }
+    bool neg;
+    if (!parse_number(p, end, &neg, v)) {
+        error(SCPI_ERR_ILLEGAL_PARAM);
+        return false;
+    }
+    if (neg && *v) {
+        error(SCPI_ERR_RANGE);
+        return false;
+    }
+    return true;
+}
+
+bool ScpiParser::arg_int(int32_t* v) {
+    const char* end;
+    const char* p = next_arg(&end);
+    if (!p) {
+        error(SCPI_ERR_MISSING_PARAM);
+        return false;
+    }
+    bool neg;
+    uint32_t u;
+    if (!parse_number(p, end, &neg, &u)) {
+        error(SCPI_ERR_ILLEGAL_PARAM);
+        return false;
+    }
+    if (u > (neg ? 0x80000000UL : 0x7FFFFFFFUL)) {
+        error(SCPI_ERR_RANGE);
+        return false;
+    }
+    *v = neg ? (int32_t)(0 - u) : (int32_t)u;
+    return true;
+}
+
+int8_t ScpiParser::arg_choice(const char* const* choices, uint8_t n) {
+    const char* end;
+    const char* p = next_arg(&end);
+    if (!p) {
+        error(SCPI_ERR_MISSING_PARAM);
+        return -1;
+    }
+    for (uint8_t i = 0; i < n; ++i) {
+        const char* c = choices[i];
+        const char* c_end = c;
+        while (*c_end) c_end++;
+        if (mnemonic_matches(c, c_end, p, end)) return (int8_t)i;
+    }
+    error(SCPI_ERR_ILLEGAL_PARAM);
+    return -1;
+}
+
+void ScpiParser::put(const char* s, uint16_t n) {
+    if (out_full) return;
+    if (out_len + n > SCPI_REPLY_MAX - 1) { // Room kept for the '\n'
+        out_full = true;
+        error(SCPI_ERR_TOO_MUCH_DATA);
+        // No separator before the item that did not fit
+        if (out_len && (out[out_len - 1] == ',' || out[out_len - 1] == ';')) out_len--;
+        return;
+    }
+    for (uint16_t i = 0; i < n; ++i) out[out_len++] = s[i];
+}
+
+void ScpiParser::out_str(const char* s) {
+    if (item_open) put(",", 1);
+    item_open = true;
+    uint16_t n = 0;
+    while (s[n]) n++;
+    put(s, n);
+}
+
+void ScpiParser::out_uint(uint32_t v) {
+    char buf[11];
+    char* p = buf + sizeof(buf) - 1;
+    *p = '\0';
+    do {
+        *--p = (char)('0' + v % 10);
+        v /= 10;
+    } while (v);
+    out_str(p);
+}
+
+void ScpiParser::out_int(int32_t v) {
+    if (v >= 0) {
+        out_uint((uint32_t)v);
+        return;
+    }
+    char buf[12];
+    char* p = buf + sizeof(buf) - 1;
+    uint32_t u = 0 - (uint32_t)v;
+    *p = '\0';
+    do {
+        *--p = (char)('0' + u % 10);
+        u /= 10;
+    } while (u);
+    *--p = '-';
+    out_str(p);
+}
+
+void ScpiParser::error(int16_t code) {
+    if (err_count < SCPI_ERROR_QUEUE) errors[err_count++] = code;
+    else errors[SCPI_ERROR_QUEUE - 1] = SCPI_ERR_QUEUE_OVERFLOW;
+}
+
+static const char* error_text(int16_t code) {
+    switch (code) {
+        case SCPI_ERR_NONE:           return "No error";
+        case SCPI_ERR_SYNTAX:         return "Syntax error";
+        case SCPI_ERR_MISSING_PARAM:  return "Missing parameter";
+        case SCPI_ERR_UNDEFINED:      return "Undefined header";
+        case SCPI_ERR_SETTINGS:       return "Settings conflict";
+        case SCPI_ERR_RANGE:          return "Data out of range";
+        case SCPI_ERR_DATA_STALE:     return "Data corrupt or stale";
+        case SCPI_ERR_ILLEGAL_PARAM:  return "Illegal parameter value";
+        case SCPI_ERR_TOO_MUCH_DATA:  return "Too much data";
+        case SCPI_ERR_QUEUE_OVERFLOW: return "Queue overflow";
+        case SCPI_ERR_INPUT_OVERRUN:  return "Input buffer overrun";
+        default:                      return "Execution error";
+    }
+}
+
+int16_t ScpiParser::pop_error(const char** msg) {
+    int16_t code = SCPI_ERR_NONE;
+    if (err_count) {
+        code = errors[0];
+        for (uint8_t i = 1; i < err_count; ++i) errors[i - 1] = errors[i];
+        err_count--;
+    }
+    *msg = error_text(code);
+    return code;
+}
@@ -0,0 +1,99 @@
+#ifndef SCPI_PARSER_H
+#define SCPI_PARSER_H
+
+#include <stdint.h>
+
+// SCPI-style command lines for bench automation: "SCOP:TRIG:LEV 2048;:SCOP:TRIG:LEV?\n".
+// Bytes are fed one at a time as they arrive; a line is executed when its '\n' comes in.
+// Headers match a table of patterns whose capitals are the short form ("TRIGger" accepts
+// TRIG and TRIGGER, any case); every command after a ';' starts from the root. Nothing is
+// allocated and no HAL is used: the parser can be driven on a host.
+#define SCPI_LINE_MAX    64 // Longer lines are dropped with -363
+#define SCPI_REPLY_MAX   96 // Replies of one line
+#define SCPI_ERROR_QUEUE 4  // Oldest errors are kept, the last slot becomes -350
+
+// Error codes (SCPI-99 numbers)
+#define SCPI_ERR_NONE              0
+#define SCPI_ERR_SYNTAX         -102
+#define SCPI_ERR_MISSING_PARAM  -109
+#define SCPI_ERR_UNDEFINED      -113
+#define SCPI_ERR_EXECUTION      -200
+#define SCPI_ERR_SETTINGS       -221 // Settings conflict (e.g. not while capturing)
+#define SCPI_ERR_RANGE          -222
+#define SCPI_ERR_TOO_MUCH_DATA  -223 // Reply longer than its buffer
+#define SCPI_ERR_DATA_STALE     -230 // No finished capture to measure
+#define SCPI_ERR_ILLEGAL_PARAM  -224
+#define SCPI_ERR_QUEUE_OVERFLOW -350
+#define SCPI_ERR_INPUT_OVERRUN  -363
+
+class ScpiParser;
+typedef void (*ScpiHandler)(ScpiParser& p, void* ctx);
+
+struct ScpiCommand {
+    const char* pattern; // "SCOPe:TRIGger:LEVel?" ('?' only for the query form)
+    ScpiHandler fn;
+};
+
+class ScpiParser {
+public:
+    ScpiParser(const ScpiCommand* table, uint8_t count, void* ctx);
+
+    // Multiplexing with a binary protocol on the same link: a printable byte outside a
+    // line starts one, and the line takes every byte up to its '\n'
+    static bool starts_line(uint8_t b) { return b > ' ' && b < 0x7F; }
+    bool in_line() const { return len > 0 || overrun; }
+
+    // One byte of input. True when it ended a line: the line has been executed and reply()
+    // holds its query results ("" if none), '\n'-terminated.
+    bool feed(uint8_t b);
+    const char* reply() const { return out; }
+    uint16_t reply_len() const { return out_len; }
+    uint32_t lines() const { return lines_done; }
+    uint32_t commands() const { return commands_done; }
+
+    // For handlers: arguments of the current command, in order
+    bool arg_uint(uint32_t* v);  // Integer or decimal with exponent ("1E6", "2.5e3"); queues an error when false
+    bool arg_int(int32_t* v);
+    int8_t arg_choice(const char* const* choices, uint8_t n); // Index of a mnemonic, -1 (error queued)
+    bool has_arg() const;
+
+    // For handlers: results of a query (items of one query are separated by ',')
+    void out_str(const char* s);
+    void out_uint(uint32_t v);
+    void out_int(int32_t v);
+
+    void error(int16_t code);
+    int16_t pop_error(const char** msg); // SCPI_ERR_NONE ("No error") when empty
+    void clear_errors() { err_count = 0; }
+
+private:
+    const ScpiCommand* table;
+    uint8_t table_len;
+    void* ctx;
+
+    char line[SCPI_LINE_MAX + 1];
+    uint8_t len;
+    bool overrun; // Line too long: skip to its end
+
+    char out[SCPI_REPLY_MAX + 1];
+    uint16_t out_len;
+    bool item_open;  // The current query wrote a result already (next one gets a ',')
+    bool out_full;
+
+    const char* args; // Rest of the current command's parameters
+    const char* args_end;
+
+    int16_t errors[SCPI_ERROR_QUEUE];
+    uint8_t err_count;
+
+    uint32_t lines_done;
+    uint32_t commands_done;
+
+    void execute_line();
+    void execute(const char* cmd, const char* end);
+    const ScpiCommand* lookup(const char* hdr, const char* hdr_end) const;
+    const char* next_arg(const char** end); // Trimmed, nullptr if none
+    void put(const char* s, uint16_t n);
+};
+
+#endif // SCPI_PARSER_H
@@ -0,0 +1,423 @@
+#include "ScpiServer.h"
+#include "ScpiCommands.h"
+#include "host_link.h"
+#include "touch_handler.h" // ui_enter_mode(), la_arm(), set_la_rate_hz(): what the buttons do
+
+static const char* const on_off[] = { "OFF", "ON" };
+
+static ScpiTargets* targets(void* ctx) {
+    return (ScpiTargets*)ctx;
+}
+
+// Commands that change what runs need its screen (as the buttons do), and leave a
+// capture armed by SUMP alone
+static bool in_mode(ScpiParser& p, OperatingMode mode) {
+    if (current_mode == mode) return true;
+    p.error(SCPI_ERR_SETTINGS);
+    return false;
+}
+
+static bool la_free(ScpiParser& p, ScpiTargets* t) {
+    if (!t->sump->capture_owned()) return true;
+    p.error(SCPI_ERR_SETTINGS);
+    return false;
+}
+
+static bool channel_arg(ScpiParser& p, uint8_t* ch) {
+    uint32_t v;
+    if (!p.arg_uint(&v)) return false;
+    if (v >= LA_NUM_CHANNELS) {
+        p.error(SCPI_ERR_RANGE);
+        return false;
+    }
+    *ch = (uint8_t)v;
+    return true;
+}
+
+// Measurements are of a finished capture
+static const LA_ChannelMeasure* measure_arg(ScpiParser& p, ScpiTargets* t) {
+    uint8_t ch;
+    if (!channel_arg(p, &ch)) return nullptr;
+    if (!t->la->is_capture_done()) {
+        p.error(SCPI_ERR_DATA_STALE);
+        return nullptr;
+    }
+    return &t->la->measure(ch);
+}
+
+static uint32_t clamp_ns(uint64_t ns) {
+    return ns > 0xFFFFFFFFULL ? 0xFFFFFFFFUL : (uint32_t)ns;
+}
+
+/* Common commands */
+static void cmd_idn(ScpiParser& p, void* ctx) {
+    p.out_str(SCPI_IDN);
+}
+
+static void cmd_rst(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    if (current_mode == MODE_CALIBRATE) {
+        p.error(SCPI_ERR_SETTINGS);
+        return;
+    }
+    t->stream->set_continuous(false);
+    ui_enter_mode(MODE_MENU); // Stops the scope and the LA
+    t->scope->setTrigger(2048, Oscilloscope::RISING);
+    if (t->sump->capture_owned()) return;
+    t->la->set_live(false);
+    t->la->set_capture_mode(LogicAnalyzer::LA_MODE_SAMPLES);
+    t->la->set_trigger(nullptr, 0);
+    set_la_rate_hz(LA_DEFAULT_RATE_HZ);
+}
+
+static void cmd_cls(ScpiParser& p, void* ctx) {
+    p.clear_errors();
+}
+
+static void cmd_opc_q(ScpiParser& p, void* ctx) {
+    p.out_uint(1); // Commands complete before the next one is read
+}
+
+static void cmd_err_q(ScpiParser& p, void* ctx) {
+    const char* msg;
+    p.out_int(p.pop_error(&msg));
+    char quoted[32];
+    uint8_t n = 0;
+    quoted[n++] = '"';
+    while (*msg && n < sizeof(quoted) - 2) quoted[n++] = *msg++;
+    quoted[n++] = '"';
+    quoted[n] = '\0';
+    p.out_str(quoted);
+}
+
+static void cmd_stats_q(ScpiParser& p, void* ctx) {
+    const ScpiStats* s = targets(ctx)->stats;
+    p.out_uint(s->lines);
+    p.out_uint(s->commands);
+    p.out_uint(s->last_cycles); // Of the line before this one
+    p.out_uint(s->max_cycles);
+    p.out_uint(s->dropped);
+}
+
+/* Mode */
+static const char* const modes[] = { "MENU", "SCOPe", "LA" };
+static const OperatingMode mode_values[] = { MODE_MENU, MODE_OSCILLOSCOPE, MODE_LOGIC_ANALYZER };
+
+static void cmd_mode(ScpiParser& p, void* ctx) {
+    int8_t m = p.arg_choice(modes, 3);
+    if (m < 0) return;
+    if (current_mode == MODE_CALIBRATE) { // The touch calibration has the screen
+        p.error(SCPI_ERR_SETTINGS);
+        return;
+    }
+    if (current_mode != mode_values[m]) ui_enter_mode(mode_values[m]);
+}
+
+static void cmd_mode_q(ScpiParser& p, void* ctx) {
+    switch (current_mode) {
+        case MODE_OSCILLOSCOPE:   p.out_str("SCOP"); break;
+        case MODE_LOGIC_ANALYZER: p.out_str("LA"); break;
+        case MODE_CALIBRATE:      p.out_str("CAL"); break;
+        default:                  p.out_str("MENU"); break;
+    }
+}
+
+/* Scope */
+static void cmd_scope_run(ScpiParser& p, void* ctx) {
+    if (in_mode(p, MODE_OSCILLOSCOPE)) targets(ctx)->scope->start();
+}
+
+static void cmd_scope_stop(ScpiParser& p, void* ctx) {
+    if (in_mode(p, MODE_OSCILLOSCOPE)) targets(ctx)->scope->stop();
+}
+
+static void cmd_scope_state_q(ScpiParser& p, void* ctx) {
+    p.out_str(targets(ctx)->scope->is_running() ? "RUN" : "STOP");
+}
+
+static void cmd_scope_frames_q(ScpiParser& p, void* ctx) {
+    p.out_uint(targets(ctx)->scope->frame_count());
+}
+
+static void cmd_trig_level(ScpiParser& p, void* ctx) {
+    Oscilloscope* scope = targets(ctx)->scope;
+    uint32_t level;
+    if (!p.arg_uint(&level)) return;
+    if (level > 4095) {
+        p.error(SCPI_ERR_RANGE);
+        return;
+    }
+    // On its screen the markers move as with a drag; elsewhere only the setting changes
+    if (current_mode == MODE_OSCILLOSCOPE) scope->moveTriggerLevel((int)level);
+    else scope->setTrigger((int)level, scope->getTriggerEdge());
+}
+
+static void cmd_trig_level_q(ScpiParser& p, void* ctx) {
+    p.out_int(targets(ctx)->scope->getTriggerLevel());
+}
+
+static const char* const slopes[] = { "POSitive", "NEGative" };
+
+static void cmd_trig_slope(ScpiParser& p, void* ctx) {
+    Oscilloscope* scope = targets(ctx)->scope;
+    int8_t s = p.arg_choice(slopes, 2);
+    if (s < 0) return;
+    scope->setTrigger(scope->getTriggerLevel(), s ? Oscilloscope::FALLING : Oscilloscope::RISING);
+}
+
+static void cmd_trig_slope_q(ScpiParser& p, void* ctx) {
+    p.out_str(targets(ctx)->scope->getTriggerEdge() == Oscilloscope::FALLING ? "NEG" : "POS");
+}
+
+static void cmd_trig_pos(ScpiParser& p, void* ctx) {
+    Oscilloscope* scope = targets(ctx)->scope;
+    uint32_t px;
+    if (!p.arg_uint(&px)) return;
+    if (px >= (uint32_t)scope->waveWidth()) {
+        p.error(SCPI_ERR_RANGE);
+        return;
+    }
+    if (in_mode(p, MODE_OSCILLOSCOPE)) scope->moveTriggerPosition((int16_t)px); // Repaints the markers
+}
+
+static void cmd_trig_pos_q(ScpiParser& p, void* ctx) {
+    p.out_int(targets(ctx)->scope->getTriggerPosition());
+}
+
+static void cmd_srate(ScpiParser& p, void* ctx) {
+    uint32_t hz;
+    if (!p.arg_uint(&hz)) return;
+    if (hz == 0) {
+        p.error(SCPI_ERR_RANGE);
+        return;
+    }
+    targets(ctx)->scope->setSampleRate(hz);
+}
+
+static void cmd_srate_q(ScpiParser& p, void* ctx) {
+    p.out_uint(targets(ctx)->scope->sample_rate_hz());
+}
+
+// The next triggered frame goes out as a binary ScopeFrame (Tools/scope_decode.cpp)
+static void cmd_data_send(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    if (!in_mode(p, MODE_OSCILLOSCOPE)) return;
+    if (!t->scope->is_running()) {
+        p.error(SCPI_ERR_SETTINGS);
+        return;
+    }
+    t->stream->request();
+}
+
+static void cmd_data_cont(ScpiParser& p, void* ctx) {
+    int8_t on = p.arg_choice(on_off, 2);
+    if (on >= 0) targets(ctx)->stream->set_continuous(on == 1);
+}
+
+static void cmd_data_cont_q(ScpiParser& p, void* ctx) {
+    p.out_uint(targets(ctx)->stream->is_continuous() ? 1 : 0);
+}
+
+/* Logic analyzer */
+static void cmd_la_rate(ScpiParser& p, void* ctx) {
+    LogicAnalyzer* la = targets(ctx)->la;
+    uint32_t hz;
+    if (!p.arg_uint(&hz)) return;
+    if (hz == 0 || hz > la->max_sample_hz()) {
+        p.error(SCPI_ERR_RANGE);
+        return;
+    }
+    set_la_rate_hz(hz); // For the next Arm or Live capture
+}
+
+static void cmd_la_rate_q(ScpiParser& p, void* ctx) {
+    p.out_uint(la_rate_hz());
+}
+
+static const char* const la_modes[] = { "SAMPles", "TRANsitions", "EDGes", "STATe" };
+static const LogicAnalyzer::LA_CaptureMode la_mode_values[] = {
+    LogicAnalyzer::LA_MODE_SAMPLES, LogicAnalyzer::LA_MODE_TRANSITIONS,
+    LogicAnalyzer::LA_MODE_EDGES, LogicAnalyzer::LA_MODE_STATE,
+};
+
+static void cmd_la_mode(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    int8_t m = p.arg_choice(la_modes, 4);
+    if (m < 0 || !la_free(p, t)) return;
+    if (t->la->is_capturing()) { // As the Mode button: not while a capture runs
+        p.error(SCPI_ERR_SETTINGS);
+        return;
+    }
+    t->la->set_capture_mode(la_mode_values[m]);
+}
+
+static void cmd_la_mode_q(ScpiParser& p, void* ctx) {
+    static const char* const names[] = { "SAMP", "TRAN", "EDG", "STAT" };
+    p.out_str(names[targets(ctx)->la->capture_mode()]);
+}
+
+static void cmd_la_arm(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    if (!in_mode(p, MODE_LOGIC_ANALYZER) || !la_free(p, t)) return;
+    if (t->la->is_capturing()) t->la->stop(); // Always a new capture (Arm would cancel)
+    la_arm();
+    if (!t->la->is_capturing()) p.error(SCPI_ERR_EXECUTION);
+}
+
+static void cmd_la_stop(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    if (!la_free(p, t)) return;
+    t->la->set_live(false);
+    if (t->la->is_capturing()) t->la->stop();
+}
+
+static void cmd_la_live(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    int8_t on = p.arg_choice(on_off, 2);
+    if (on < 0) return;
+    if (on == 0) {
+        t->la->set_live(false); // The capture running then still completes
+        return;
+    }
+    if (!in_mode(p, MODE_LOGIC_ANALYZER) || !la_free(p, t)) return;
+    t->la->set_live(true);
+    if (!t->la->is_capturing()) la_arm();
+}
+
+static void cmd_la_live_q(ScpiParser& p, void* ctx) {
+    p.out_uint(targets(ctx)->la->is_live() ? 1 : 0);
+}
+
+// As the Mode button's "Mixed": sample mode with PB0 on ADC1, between captures
+static void cmd_la_mixed(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    int8_t on = p.arg_choice(on_off, 2);
+    if (on < 0 || !la_free(p, t)) return;
+    if (t->la->is_capturing() || (on && t->la->capture_mode() != LogicAnalyzer::LA_MODE_SAMPLES)) {
+        p.error(SCPI_ERR_SETTINGS);
+        return;
+    }
+    if (on && !t->la->mixed_available()) {
+        p.error(SCPI_ERR_EXECUTION); // No ADC wired in
+        return;
+    }
+    t->la->set_mixed_signal(on == 1);
+}
+
+static void cmd_la_mixed_q(ScpiParser& p, void* ctx) {
+    p.out_uint(targets(ctx)->la->mixed_enabled() ? 1 : 0);
+}
+
+static void cmd_la_state_q(ScpiParser& p, void* ctx) {
+    LogicAnalyzer* la = targets(ctx)->la;
+    if (la->is_capturing()) p.out_str(la->is_waiting_for_trigger() ? "WAIT" : "RUN");
+    else p.out_str(la->is_capture_done() ? "DONE" : "IDLE");
+}
+
+static void cmd_la_samples_q(ScpiParser& p, void* ctx) {
+    LogicAnalyzer* la = targets(ctx)->la;
+    p.out_uint(la->is_capture_done() ? la->samples().size() : 0);
+}
+
+static void cmd_la_cursor_delta_q(ScpiParser& p, void* ctx) {
+    LogicAnalyzer* la = targets(ctx)->la;
+    if (!la->is_capture_done()) { // Cursors are on a finished capture, as measurements
+        p.error(SCPI_ERR_DATA_STALE);
+        return;
+    }
+    uint32_t a = la->cursor(0), b = la->cursor(1);
+    p.out_uint(clamp_ns(la->samples_to_ns(a > b ? a - b : b - a)));
+}
+
+static void cmd_meas_edges_q(ScpiParser& p, void* ctx) {
+    const LA_ChannelMeasure* m = measure_arg(p, targets(ctx));
+    if (m) p.out_uint(m->edges);
+}
+
+// Hz, from the rising edges between the first and the last one
+static void cmd_meas_freq_q(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    const LA_ChannelMeasure* m = measure_arg(p, t);
+    if (!m) return;
+    uint32_t hz = m->period_span ? (uint32_t)((uint64_t)m->periods * t->la->capture_stats().timer_hz / m->period_span) : 0;
+    p.out_uint(hz);
+}
+
+// Percent with one decimal ("33.3")
+static void cmd_meas_duty_q(ScpiParser& p, void* ctx) {
+    const LA_ChannelMeasure* m = measure_arg(p, targets(ctx));
+    if (!m) return;
+    uint32_t permille = m->period_span ? (uint32_t)((uint64_t)m->high_in_span * 1000 / m->period_span) : 0;
+    char buf[8];
+    uint8_t n = 0;
+    if (permille >= 1000) buf[n++] = '1';
+    if (permille >= 100) buf[n++] = (char)('0' + permille / 100 % 10);
+    buf[n++] = (char)('0' + permille / 10 % 10);
+    buf[n++] = '.';
+    buf[n++] = (char)('0' + permille % 10);
+    buf[n] = '\0';
+    p.out_str(buf);
+}
+
+// Shortest and longest complete pulse, ns
+static void cmd_meas_pwidth_q(ScpiParser& p, void* ctx) {
+    ScpiTargets* t = targets(ctx);
+    const LA_ChannelMeasure* m = measure_arg(p, t);
+    if (!m) return;
+    p.out_uint(clamp_ns(t->la->samples_to_ns(m->min_pulse)));
+    p.out_uint(clamp_ns(t->la->samples_to_ns(m->max_pulse)));
+}
+
+// Checked in order: the common ones first, as bench scripts send them most
+static const ScpiCommand commands[] = {
+    SCPI_COMMAND_LIST(SCPI_COMMAND_ENTRY)
+};
+
+ScpiServer::ScpiServer(Oscilloscope* scope, LogicAnalyzer* la, ScopeStream* stream, SumpServer* sump)
+    : parser(commands, sizeof(commands) / sizeof(commands[0]), &tgt), wait_buf(0), tx_active(false), st() {
+    tgt.scope = scope;
+    tgt.la = la;
+    tgt.stream = stream;
+    tgt.sump = sump;
+    tx_len[0] = tx_len[1] = 0;
+    tgt.stats = &st;
+}
+
+bool ScpiServer::feed(uint8_t byte) {
+    uint32_t start = DWT->CYCCNT;
+    if (!parser.feed(byte)) return false;
+    st.last_cycles = DWT->CYCCNT - start;
+    if (st.last_cycles > st.max_cycles) st.max_cycles = st.last_cycles;
+    st.lines = parser.lines();
+    st.commands = parser.commands();
+
+    uint16_t n = parser.reply_len();
+    if (n) {
+        uint16_t& len = tx_len[wait_buf];
+        if (len + n > SCPI_REPLY_MAX) {
+            st.dropped++;
+            parser.error(SCPI_ERR_TOO_MUCH_DATA);
+        } else {
+            const char* r = parser.reply();
+            for (uint16_t i = 0; i < n; ++i) tx[wait_buf][len++] = r[i];
+        }
+        flush();
+    }
+    return true;
+}
+
+void ScpiServer::flush() {
+    if (tx_active || tx_len[wait_buf] == 0) return;
+    // Shares the link with SUMP replies and scope frames: if one is going out, the
+    // replies wait for its SCHED_EVT_HOST_TX
+    if (!host_link_send(tx[wait_buf], tx_len[wait_buf], 1)) return;
+    tx_active = true;
+    wait_buf ^= 1;
+    tx_len[wait_buf] = 0;
+}
+
+void ScpiServer::on_tx_done() {
+    if (host_link_busy()) return; // Another sender went first; its completion comes back here
+    tx_active = false; // The link is idle: whatever was out, ours included, has been sent
+    flush();
+}
@@ -0,0 +1,70 @@
+#ifndef SCPI_SERVER_H
+#define SCPI_SERVER_H
+
+#include <stdint.h>
+#include "ScpiParser.h"
+#include "Scope.h"
+#include "LogicAnalyzer.h"
+#include "ScopeStream.h"
+#include "SumpServer.h"
+
+// Remote control of the device for bench scripts: SCPI-style command lines on the host
+// link (host_link.h), next to the SUMP protocol (the host task hands a byte to whichever
+// one it belongs to). Commands act through the same functions as the panel's buttons
+// (touch_handler.h), so screen and settings stay in step; queries read the settings and
+// the LA measurements. Replies go out from two buffers: one on the wire, one collecting
+// the replies of the lines that end meanwhile.
+//
+//   *IDN? *RST *CLS *OPC? SYSTem:ERRor? SYSTem:STATistics?
+//   MODE SCOPe|LA|MENU, MODE?
+//   SCOPe:RUN SCOPe:STOP SCOPe:STATe? SCOPe:FRAMes?
+//   SCOPe:TRIGger:LEVel <0..4095> SCOPe:TRIGger:SLOPe POSitive|NEGative SCOPe:TRIGger:POSition <px>
+//   SCOPe:SRATe <Hz> SCOPe:DATA:SEND SCOPe:DATA:CONTinuous ON|OFF
+//   LA:RATE <Hz> LA:MODE SAMPles|TRANsitions|EDGes|STATe LA:ARM LA:STOP LA:LIVE ON|OFF LA:STATe?
+//   LA:SAMPles? LA:CURSor:DELTa? LA:MEASure:EDGes|FREQuency|DUTY|PWIDth? <ch>
+// Settings also have a query form (LEVel?, SLOPe?, SRATe?, RATE?, ...).
+#define SCPI_IDN "STM32 custom boards,Scope-LA,0,1.0"
+
+struct ScpiStats {
+    uint32_t lines;       // Command lines executed
+    uint32_t commands;    // Commands in them
+    uint32_t last_cycles; // DWT cycles to execute the last line (parse, act, format)
+    uint32_t max_cycles;
+    uint32_t dropped;     // Replies lost because both buffers were full
+};
+
+// What the command handlers act on
+struct ScpiTargets {
+    Oscilloscope* scope;
+    LogicAnalyzer* la;
+    ScopeStream* stream;
+    SumpServer* sump; // Its captures are not disturbed
+    const ScpiStats* stats;
+};
+
+class ScpiServer {
+public:
+    ScpiServer(Oscilloscope* scope, LogicAnalyzer* la, ScopeStream* stream, SumpServer* sump);
+
+    // A printable byte outside a SUMP command starts a line; the line takes every byte
+    // up to its '\n'
+    bool wants(uint8_t byte) const {
+        return parser.in_line() || (!tgt.sump->in_command() && ScpiParser::starts_line(byte));
+    }
+    bool feed(uint8_t byte); // True when a line was executed (settings may have changed)
+    void on_tx_done();       // SCHED_EVT_HOST_TX: send the replies that waited for the link
+    const ScpiStats& stats() const { return st; }
+
+private:
+    ScpiParser parser;
+    ScpiTargets tgt;
+    char tx[2][SCPI_REPLY_MAX];
+    uint16_t tx_len[2];
+    uint8_t wait_buf; // Collecting replies; the other one is on the wire while tx_active
+    bool tx_active;
+    ScpiStats st;
+
+    void flush();
+};
+
+#endif // SCPI_SERVER_H
@@ -0,0 +1,161 @@
+#include "SumpProtocol.h"
+
+void SumpProtocol::reset() {
+    s.divider = 99; // 1 MHz
+    s.read_count = 4096;
+    s.delay_count = 4096;
+    s.flags = 0;
+    for (int k = 0; k < SUMP_MAX_STAGES; ++k) {
+        s.stages[k].mask = 0;
+        s.stages[k].value = 0;
+        s.stages[k].config = 0;
+    }
+    in_long = false;
+    arg_len = 0;
+}
+
+uint8_t SumpProtocol::feed(uint8_t byte) {
+    if (in_long) { // Argument bytes can be anything, 0x00 included
+        arg[arg_len++] = byte;
+        if (arg_len < 4) return SUMP_CMD_NONE;
+        in_long = false;
+        arg_len = 0;
+        uint32_t v = arg[0] | ((uint32_t)arg[1] << 8) | ((uint32_t)arg[2] << 16) | ((uint32_t)arg[3] << 24);
+        if (cmd >= SUMP_TRIG_MASK && cmd < SUMP_TRIG_MASK + 4 * SUMP_MAX_STAGES) {
+            SumpTriggerStage& st = s.stages[(cmd - SUMP_TRIG_MASK) >> 2];
+            switch (cmd & 3) {
+                case 0: st.mask = v; break;
+                case 1: st.value = v; break;
+                case 2: st.config = v; break;
+                default: return SUMP_CMD_UNKNOWN;
+            }
+            return SUMP_CMD_SETTING;
+        }
+        switch (cmd) {
+            case SUMP_SET_DIVIDER:
+                s.divider = v & 0xFFFFFF;
+                break;
+            case SUMP_SET_COUNTS:
+                s.read_count = ((v & 0xFFFF) + 1) * 4;
+                s.delay_count = ((v >> 16) + 1) * 4;
+                break;
+            case SUMP_SET_FLAGS:
+                s.flags = v;
+                break;
+            default:
+                return SUMP_CMD_UNKNOWN;
+        }
+        return SUMP_CMD_SETTING;
+    }
+
+    if (byte & 0x80) {
+        cmd = byte;
+        in_long = true;
+        return SUMP_CMD_NONE;
+    }
+    switch (byte) {
+        case 0x00: return SUMP_CMD_RESET;
+        case 0x01: return SUMP_CMD_RUN;
+        case 0x02: return SUMP_CMD_ID;
+        case 0x04: return SUMP_CMD_METADATA;
+        case 0x11: return SUMP_CMD_XON;
+        case 0x13: return SUMP_CMD_XOFF;
+        default:   return SUMP_CMD_UNKNOWN;
+    }
+}
+
+uint8_t SumpProtocol::group_mask(uint8_t available) const {
+    uint8_t m = 0;
+    for (uint8_t g = 0; g < available && g < 4; ++g) {
+        if (!(s.flags & (1UL << (SUMP_FLAG_GROUPS_OFF_SHIFT + g)))) m |= (uint8_t)(1 << g);
+    }
+    return m;
+}
+
+bool SumpProtocol::plan_run(uint8_t sample_bytes, uint32_t channel_mask, SumpRunPlan* plan) const {
+    plan->rate_hz = rate_hz();
+    plan->depth = s.read_count;
+    plan->stages = 0;
+    for (int k = 0; k < SUMP_MAX_STAGES; ++k) {
+        const SumpTriggerStage& st = s.stages[k];
+        uint32_t mask = st.mask & channel_mask;
+        if (!mask) continue;
+        plan->stage_mask[plan->stages] = mask;
+        plan->stage_value[plan->stages] = st.value & mask;
+        plan->stages++;
+        if (st.config & SUMP_TRIG_START) break;
+    }
+    uint32_t pre = (s.delay_count < s.read_count) ? s.read_count - s.delay_count : 0;
+    plan->pretrigger_pct = (plan->stages && s.read_count) ? (uint8_t)((uint64_t)pre * 100 / s.read_count) : 0;
+    plan->lanes = group_mask(sample_bytes);
+    return plan->lanes != 0;
+}
+
+template <typename T>
+static void reverse_samples(T* a, uint32_t n) {
+    for (uint32_t i = 0, j = n; i + 1 < j; ++i) {
+        --j;
+        T t = a[i];
+        a[i] = a[j];
+        a[j] = t;
+    }
+}
+
+static inline uint8_t swap_bytes(uint8_t v) { return v; }
+static inline uint16_t swap_bytes(uint16_t v) { return (uint16_t)((v >> 8) | (v << 8)); }
+
+template <typename T>
+SumpStream sump_stream_prepare(T* samples, uint32_t count, uint8_t lanes) {
+    reverse_samples(samples, count);
+    uint8_t all = (uint8_t)((1u << sizeof(T)) - 1);
+    SumpStream out = { samples, count * (uint32_t)sizeof(T), 1 };
+    if ((lanes & all) == all || sizeof(T) == 1) return out; // Whole samples
+    if (lanes & 2) { // Upper byte alone: swap it down
+        for (uint32_t i = 0; i < count; ++i) samples[i] = swap_bytes(samples[i]);
+    }
+    out.count = count;
+    out.width = 2;
+    return out;
+}
+
+template <typename T>
+void sump_stream_restore(T* samples, uint32_t count, uint8_t lanes) {
+    uint8_t all = (uint8_t)((1u << sizeof(T)) - 1);
+    if (sizeof(T) > 1 && (lanes & all) != all && (lanes & 2)) {
+        for (uint32_t i = 0; i < count; ++i) samples[i] = swap_bytes(samples[i]);
+    }
+    reverse_samples(samples, count);
+}
+
+template SumpStream sump_stream_prepare<uint8_t>(uint8_t*, uint32_t, uint8_t);
+template SumpStream sump_stream_prepare<uint16_t>(uint16_t*, uint32_t, uint8_t);
+template void sump_stream_restore<uint8_t>(uint8_t*, uint32_t, uint8_t);
+template void sump_stream_restore<uint16_t>(uint16_t*, uint32_t, uint8_t);
+
+// Metadata: tagged fields, strings NUL-terminated, 32-bit values big-endian, 0x00 at the end
+static uint8_t* put_u32(uint8_t* p, uint8_t key, uint32_t v) {
+    *p++ = key;
+    *p++ = (uint8_t)(v >> 24);
+    *p++ = (uint8_t)(v >> 16);
+    *p++ = (uint8_t)(v >> 8);
+    *p++ = (uint8_t)v;
+    return p;
+}
+
+uint16_t SumpProtocol::metadata(uint8_t* out, uint16_t max, const char* name, uint32_t probes,
+                                uint32_t sample_bytes, uint32_t max_rate_hz) {
+    uint16_t name_len = 0;
+    while (name[name_len]) name_len++;
+    uint16_t len = 1 + name_len + 1 + 4 * 5 + 1;
+    if (len > max) return 0;
+
+    uint8_t* p = out;
+    *p++ = 0x01; // Device name
+    for (uint16_t i = 0; i <= name_len; ++i) *p++ = (uint8_t)name[i];
+    p = put_u32(p, 0x20, probes);
+    p = put_u32(p, 0x21, sample_bytes); // Sample memory
+    p = put_u32(p, 0x23, max_rate_hz);
+    p = put_u32(p, 0x24, 2);            // Protocol version
+    *p++ = 0x00;
+    return (uint16_t)(p - out);
+}
@@ -0,0 +1,112 @@
+#ifndef SUMP_PROTOCOL_H
+#define SUMP_PROTOCOL_H
+
+#include <stdint.h>
+
+// SUMP / Openbench Logic Sniffer command set, as spoken by sigrok's "ols" driver and
+// PulseView. Commands are one byte (bit 7 clear) or five: the command byte and a 32-bit
+// little-endian argument. The parser only collects settings and reports each command as
+// it completes; acting on them is up to the caller (SumpServer), which takes the capture
+// settings from plan_run() and lays the capture out with sump_stream_prepare(). No HAL
+// access: all of it can be run on a host against recorded byte streams.
+#define SUMP_CLOCK_HZ      100000000UL // Rates are given as dividers of this clock
+#define SUMP_MAX_STAGES    4
+#define SUMP_GROUP_BITS    8           // Channels per group (one byte per sample per group)
+
+enum SumpCommand {
+    SUMP_CMD_NONE,     // Byte consumed, command not complete yet
+    SUMP_CMD_RESET,    // 0x00
+    SUMP_CMD_RUN,      // 0x01: arm with the current settings
+    SUMP_CMD_ID,       // 0x02: reply "1ALS"
+    SUMP_CMD_METADATA, // 0x04: reply with metadata()
+    SUMP_CMD_XON,      // 0x11
+    SUMP_CMD_XOFF,     // 0x13
+    SUMP_CMD_SETTING,  // Any long command; settings() holds the new value
+    SUMP_CMD_UNKNOWN   // Short command this device does not implement
+};
+
+// Long commands
+#define SUMP_TRIG_MASK     0xC0 // + 4 * stage
+#define SUMP_TRIG_VALUES   0xC1 // + 4 * stage
+#define SUMP_TRIG_CONFIG   0xC2 // + 4 * stage: delay[15:0], level[17:16], channel[24:20], serial[26], start[27]
+#define SUMP_SET_DIVIDER   0x80 // rate = SUMP_CLOCK_HZ / (divider + 1), 24 bits
+#define SUMP_SET_COUNTS    0x81 // read count / 4 - 1 [15:0], delay count / 4 - 1 [31:16]
+#define SUMP_SET_FLAGS     0x82 // SUMP_FLAG_*
+
+#define SUMP_FLAG_GROUPS_OFF_SHIFT 2    // Bits 2..5: channel group n disabled
+#define SUMP_FLAG_EXTERNAL_CLOCK   0x40
+
+#define SUMP_TRIG_START    (1UL << 27) // Stage fires the capture
+
+struct SumpTriggerStage {
+    uint32_t mask;   // Channels that take part
+    uint32_t value;  // Their levels
+    uint32_t config;
+};
+
+struct SumpSettings {
+    uint32_t divider;
+    uint32_t read_count;  // Samples to send back
+    uint32_t delay_count; // ...of which after the trigger
+    uint32_t flags;
+    SumpTriggerStage stages[SUMP_MAX_STAGES];
+};
+
+// A run command in the logic analyzer's terms. Stages are in order and the last one fires
+// the capture: those after the start bit, and those with none of the device's channels,
+// are left out (serial stages and per-stage delays are not supported).
+struct SumpRunPlan {
+    uint32_t rate_hz;
+    uint32_t depth;                        // Samples (the read count)
+    uint8_t stages;                        // 0: capture at once
+    uint32_t stage_mask[SUMP_MAX_STAGES];  // Channels that take part
+    uint32_t stage_value[SUMP_MAX_STAGES]; // Their levels
+    uint8_t pretrigger_pct;                // Share of the capture before the trigger
+    uint8_t lanes;                         // Enabled groups, bit n = group n = byte n of a sample
+};
+
+// How a laid-out capture goes out: host_link_send(data, count, width) arguments. Width 2
+// sends the low byte of each halfword.
+struct SumpStream {
+    const void* data;
+    uint32_t count;
+    uint8_t width;
+};
+
+class SumpProtocol {
+public:
+    SumpProtocol() { reset(); }
+
+    void reset(); // Settings back to their defaults, partial command dropped
+    uint8_t feed(uint8_t byte); // Returns a SumpCommand
+    bool in_command() const { return in_long; } // Argument bytes of a long command still to come
+
+    const SumpSettings& settings() const { return s; }
+    uint32_t rate_hz() const { return SUMP_CLOCK_HZ / (s.divider + 1); }
+    uint8_t group_mask(uint8_t available) const; // Enabled groups among the first 'available', bit n = group n
+    // Settings of the last commands for a device with sample_bytes groups whose channels
+    // are channel_mask; false if no group is enabled
+    bool plan_run(uint8_t sample_bytes, uint32_t channel_mask, SumpRunPlan* plan) const;
+
+    // Metadata reply (command 0x04) into out; returns its length (0 if max is too small)
+    static uint16_t metadata(uint8_t* out, uint16_t max, const char* name, uint32_t probes,
+                             uint32_t sample_bytes, uint32_t max_rate_hz);
+
+private:
+    SumpSettings s;
+    uint8_t cmd;     // Long command being received
+    uint8_t arg[4];
+    uint8_t arg_len; // Argument bytes received, 0 between commands
+    bool in_long;
+};
+
+// Lay out count samples (oldest first) in place for sending, newest first with one byte per
+// enabled lane: whole samples for all lanes, otherwise the low byte of each. A single upper
+// lane of 16-bit samples is swapped into the low byte. sump_stream_restore() puts the
+// buffer back. Instantiated for uint8_t and uint16_t samples.
+template <typename T>
+SumpStream sump_stream_prepare(T* samples, uint32_t count, uint8_t lanes);
+template <typename T>
+void sump_stream_restore(T* samples, uint32_t count, uint8_t lanes);
+
+#endif // SUMP_PROTOCOL_H
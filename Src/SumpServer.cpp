@@ -0,0 +1,90 @@
+#include "SumpServer.h"
+#include "host_link.h"
+
+SumpServer::SumpServer(LogicAnalyzer* la)
+    : la(la), owned(false), sending(false), lanes(0), out(nullptr), out_count(0) {}
+
+void SumpServer::feed(uint8_t byte) {
+    switch (proto.feed(byte)) {
+        case SUMP_CMD_RESET: // Sent five times in a row: must stay cheap and idempotent
+            if (owned && la->is_capturing()) la->stop();
+            if (!sending) owned = false;
+            break;
+        case SUMP_CMD_ID:
+            for (uint8_t k = 0; k < 4; ++k) reply[k] = (uint8_t)SUMP_DEVICE_ID[k];
+            host_link_send(reply, 4, 1);
+            break;
+        case SUMP_CMD_METADATA:
+            reply_metadata();
+            break;
+        case SUMP_CMD_RUN:
+            arm();
+            break;
+        default: // Settings are kept by the parser; XON/XOFF and unknown commands ignored
+            break;
+    }
+}
+
+void SumpServer::reply_metadata() {
+    uint32_t bytes = la->capture_capacity() * sizeof(la_sample_t);
+    uint16_t len = SumpProtocol::metadata(reply, sizeof(reply), SUMP_DEVICE_NAME, LA_NUM_CHANNELS,
+                                          bytes, la->max_sample_hz());
+    if (len) host_link_send(reply, len, 1);
+}
+
+void SumpServer::arm() {
+    if (sending) return; // The last capture is still going out of the buffer
+    SumpRunPlan plan;
+    if (!proto.plan_run(sizeof(la_sample_t), LA_CHANNEL_MASK, &plan)) return; // No group enabled
+    if (la->is_capturing()) la->stop();
+    la->set_live(false); // The host reads one capture per run command
+    la->set_capture_mode(LogicAnalyzer::LA_MODE_SAMPLES);
+    la->set_capture_depth(plan.depth);
+
+    LA_TriggerStage stages[LA_TRIG_MAX_STAGES];
+    uint8_t count = 0;
+    for (uint8_t k = 0; k < plan.stages && count < LA_TRIG_MAX_STAGES; ++k) {
+        LA_TriggerCondition cond[LA_NUM_CHANNELS];
+        for (int ch = 0; ch < LA_NUM_CHANNELS; ++ch) {
+            if (!((plan.stage_mask[k] >> ch) & 1)) cond[ch] = LA_TRIG_DONT_CARE;
+            else cond[ch] = ((plan.stage_value[k] >> ch) & 1) ? LA_TRIG_HIGH : LA_TRIG_LOW;
+        }
+        stages[count++] = LogicAnalyzer::make_trigger_stage(cond);
+    }
+    la->set_trigger(stages, count);
+    if (count) la->set_pretrigger_percent(plan.pretrigger_pct);
+
+    lanes = plan.lanes;
+    la->begin(plan.rate_hz);
+    owned = la->is_capturing();
+}
+
+void SumpServer::on_la_done() {
+    if (!owned || sending || !la->is_capture_done()) return;
+    uint32_t count = 0;
+    la_sample_t* data = la->hold_capture(&count);
+    if (!data) {
+        owned = false;
+        return;
+    }
+    uint32_t n = proto.settings().read_count;
+    if (n > count) n = count; // Depth is capped by the buffer (metadata reports its size)
+    SumpStream st = sump_stream_prepare(data, n, lanes);
+    if (!host_link_send(st.data, st.count, st.width)) { // Link still busy with a reply: give the capture back
+        sump_stream_restore(data, n, lanes);
+        la->release_capture();
+        owned = false;
+        return;
+    }
+    out = data;
+    out_count = n;
+    sending = true;
+}
+
+void SumpServer::on_tx_done() {
+    if (!sending || host_link_busy()) return; // Also posted when the LA gives the link back
+    sump_stream_restore(out, out_count, lanes); // Oldest first again
+    la->release_capture();
+    sending = false;
+    owned = false;
+}
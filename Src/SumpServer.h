@@ -0,0 +1,41 @@
+#ifndef SUMP_SERVER_H
+#define SUMP_SERVER_H
+
+#include <stdint.h>
+#include "SumpProtocol.h"
+#include "LogicAnalyzer.h"
+
+// The logic analyzer as a SUMP device on the host link (host_link.h), for sigrok/PulseView's
+// "ols" driver. A run command arms a sample-mode capture with the host's rate, read count,
+// delay count and trigger stages (SumpProtocol::plan_run()); when it completes, the capture
+// is held and laid out in place (sump_stream_prepare(): newest first, the SUMP order, one
+// byte per enabled channel group per sample), sent straight from the capture buffer, then
+// put back in order for the panel. A run with no group enabled is ignored.
+#define SUMP_DEVICE_NAME "STM32 LA"
+#define SUMP_DEVICE_ID   "1ALS" // Reply to the ID command
+
+class SumpServer {
+public:
+    explicit SumpServer(LogicAnalyzer* la);
+
+    void feed(uint8_t byte); // A byte from the host link: answer and arm on complete commands
+    bool in_command() const { return proto.in_command(); }
+    void on_la_done(); // SCHED_EVT_LA_DONE: stream a capture the host asked for
+    void on_tx_done(); // SCHED_EVT_HOST_TX: capture back in order once it is out
+    bool capture_owned() const { return owned; } // A host-armed capture runs or is being sent
+
+private:
+    LogicAnalyzer* la;
+    SumpProtocol proto;
+    bool owned;
+    bool sending;        // The capture buffer is laid out for the host and on its way out
+    uint8_t lanes;       // Groups the host enabled for the armed run
+    la_sample_t* out;    // Held capture being sent...
+    uint32_t out_count;  // ...and its samples
+    uint8_t reply[32]; // ID and metadata replies (must outlive their transmission)
+
+    void arm();
+    void reply_metadata();
+};
+
+#endif // SUMP_SERVER_H
@@ -0,0 +1,98 @@
+#include "capture_arena.h"
+#include <errno.h>
+#include <stddef.h>
+
+#ifdef CAPTURE_ARENA_STATIC_BYTES
+static uint8_t arena_static[CAPTURE_ARENA_STATIC_BYTES] __attribute__((aligned(4)));
+#else
+// Defined by the CubeMX linker script. The sizes are absolute symbols: their address is the value.
+extern "C" uint8_t _end;            // End of .bss, start of the heap
+extern "C" uint8_t _estack;         // Top of RAM, initial stack pointer
+extern "C" uint8_t _Min_Heap_Size;
+extern "C" uint8_t _Min_Stack_Size;
+#endif
+
+static uint8_t* arena_base = nullptr;
+static uint32_t arena_size = 0;
+static uint32_t* guard_lo = nullptr; // Heap side
+static uint32_t* guard_hi = nullptr; // Stack side
+static uint32_t faults = 0;
+
+#define GUARD_BYTES (CAPTURE_ARENA_GUARD_WORDS * 4)
+
+static void fill_guard(uint32_t* g) {
+    for (int i = 0; i < CAPTURE_ARENA_GUARD_WORDS; ++i) g[i] = CAPTURE_ARENA_CANARY;
+}
+
+static bool guard_intact(const uint32_t* g) {
+    for (int i = 0; i < CAPTURE_ARENA_GUARD_WORDS; ++i) {
+        if (g[i] != CAPTURE_ARENA_CANARY) return false;
+    }
+    return true;
+}
+
+void capture_arena_init() {
+#ifdef CAPTURE_ARENA_STATIC_BYTES
+    uintptr_t lo = (uintptr_t)arena_static;
+    uintptr_t hi = lo + CAPTURE_ARENA_STATIC_BYTES;
+#else
+    // The heap reservation stays untouched in case anything calls malloc
+    uintptr_t lo = (uintptr_t)&_end + (uintptr_t)&_Min_Heap_Size;
+    uintptr_t hi = (uintptr_t)&_estack - (uintptr_t)&_Min_Stack_Size - CAPTURE_ARENA_STACK_MARGIN;
+#endif
+    lo = (lo + 3) & ~(uintptr_t)3;
+    hi &= ~(uintptr_t)3;
+    if (hi < lo + 2 * GUARD_BYTES) {
+        arena_base = nullptr;
+        arena_size = 0;
+        return;
+    }
+    guard_lo = (uint32_t*)lo;
+    guard_hi = (uint32_t*)(hi - GUARD_BYTES);
+    fill_guard(guard_lo);
+    fill_guard(guard_hi);
+    arena_base = (uint8_t*)(lo + GUARD_BYTES);
+    arena_size = (uint32_t)(hi - lo - 2 * GUARD_BYTES);
+}
+
+uint8_t* capture_arena_base() {
+    return arena_base;
+}
+
+uint32_t capture_arena_size() {
+    return arena_size;
+}
+
+bool capture_arena_check() {
+    if (!guard_lo) return true;
+    bool ok = true;
+    if (!guard_intact(guard_lo)) {
+        fill_guard(guard_lo);
+        ok = false;
+    }
+    if (!guard_intact(guard_hi)) {
+        fill_guard(guard_hi);
+        ok = false;
+    }
+    if (!ok) faults++;
+    return ok;
+}
+
+uint32_t capture_arena_faults() {
+    return faults;
+}
+
+#ifndef CAPTURE_ARENA_STATIC_BYTES
+// newlib's heap growth, bounded by the heap reservation instead of the stack
+extern "C" void* _sbrk(ptrdiff_t incr) {
+    static uint8_t* heap_end = &_end;
+    uint8_t* limit = &_end + (uintptr_t)&_Min_Heap_Size;
+    if (heap_end + incr > limit) {
+        errno = ENOMEM;
+        return (void*)-1;
+    }
+    uint8_t* prev = heap_end;
+    heap_end += incr;
+    return prev;
+}
+#endif
@@ -0,0 +1,32 @@
+#ifndef CAPTURE_ARENA_H
+#define CAPTURE_ARENA_H
+
+#include <stdint.h>
+
+// Capture memory: all RAM left between the end of .bss (plus the heap reservation) and
+// the reserved stack, taken from the linker script symbols. Whatever the other modules
+// (scope DMA buffer, framebuffer band, glyph cache) do not use becomes capture depth.
+#define CAPTURE_ARENA_STACK_MARGIN 256 // Extra room kept below _Min_Stack_Size
+
+// Guard words at both edges, outside capture_arena_base()/size(): a stack deeper than
+// its reservation, a heap past its own, or a capture past the end overwrites them
+#define CAPTURE_ARENA_GUARD_WORDS 8
+#define CAPTURE_ARENA_CANARY      0x5AFEC0DEUL
+
+// Define to use a fixed static array instead (linker scripts without the CubeMX symbols)
+// #define CAPTURE_ARENA_STATIC_BYTES 8192
+
+// Without CAPTURE_ARENA_STATIC_BYTES this file provides _sbrk(), which stops the heap at
+// _Min_Heap_Size (the start of the arena). Leave the CubeMX-generated sysmem.c out of the
+// build: its _sbrk lets the heap grow up to the stack, through the capture memory.
+
+void capture_arena_init();
+uint8_t* capture_arena_base(); // Word aligned
+uint32_t capture_arena_size(); // Bytes
+
+// After each capture: true if both guards are intact. A broken guard is counted and
+// written again, so the next intrusion is caught too.
+bool capture_arena_check();
+uint32_t capture_arena_faults();
+
+#endif // CAPTURE_ARENA_H
@@ -0,0 +1,119 @@
+#include "host_link.h"
+
+static UART_HandleTypeDef* link_uart = nullptr;
+static uint8_t rx_ring[HOST_LINK_RX_SIZE];
+static volatile uint16_t rx_head = 0; // Written by the RX event
+static uint16_t rx_tail = 0;          // Task side
+
+static HostLinkPart tx_parts[HOST_LINK_MAX_PARTS]; // Transmission in progress
+static uint8_t tx_num_parts = 0;
+static uint8_t tx_part = 0;              // Part being sent
+static const uint8_t* tx_next = nullptr; // Rest of that part
+static uint32_t tx_left = 0;             // Items not yet handed to the DMA
+static volatile bool tx_busy = false;
+static volatile uint32_t dma_lent = 0; // HOST_LINK_DMA_* lent to the LA
+static volatile bool rx_restarted = false; // The ring started again at 0 (tail is task side)
+
+void host_link_init(UART_HandleTypeDef* huart) {
+    link_uart = huart;
+    if (!huart) return;
+    rx_head = rx_tail = 0;
+    // hdmarx is DMA_CIRCULAR in the .ioc: the ring never stops, the events only report
+    HAL_UARTEx_ReceiveToIdle_DMA(huart, rx_ring, HOST_LINK_RX_SIZE);
+}
+
+void host_link_rx_event_ISR(uint16_t pos) {
+    rx_head = (pos >= HOST_LINK_RX_SIZE) ? 0 : pos; // Full point: wrapped to the start
+}
+
+uint16_t host_link_read(uint8_t* out, uint16_t max) {
+    if (rx_restarted) { // Unread bytes from before the lend are gone with the old ring
+        rx_restarted = false;
+        rx_tail = 0;
+    }
+    uint16_t head = rx_head;
+    uint16_t n = 0;
+    while (rx_tail != head && n < max) {
+        out[n++] = rx_ring[rx_tail];
+        rx_tail = (rx_tail + 1) % HOST_LINK_RX_SIZE;
+    }
+    return n;
+}
+
+// Memory side width of the TX channel (the UART side stays bytes)
+static void set_tx_width(uint8_t width) {
+    DMA_HandleTypeDef* hdma = link_uart->hdmatx;
+    uint32_t align = (width == 2) ? DMA_MDATAALIGN_HALFWORD : DMA_MDATAALIGN_BYTE;
+    if (hdma->Init.MemDataAlignment == align) return;
+    hdma->Init.MemDataAlignment = align;
+    HAL_DMA_Init(hdma);
+}
+
+// Next chunk of the current part, moving on to the next non-empty part when it is done.
+// False when there is nothing left.
+static bool send_chunk() {
+    while (tx_left == 0) {
+        if (++tx_part >= tx_num_parts) return false;
+        tx_next = (const uint8_t*)tx_parts[tx_part].data;
+        tx_left = tx_parts[tx_part].count;
+        if (tx_left) set_tx_width(tx_parts[tx_part].width);
+    }
+    uint16_t n = (tx_left > HOST_LINK_TX_CHUNK) ? HOST_LINK_TX_CHUNK : (uint16_t)tx_left;
+    const uint8_t* p = tx_next;
+    tx_next += (uint32_t)n * tx_parts[tx_part].width;
+    tx_left -= n;
+    HAL_UART_Transmit_DMA(link_uart, (uint8_t*)p, n);
+    return true;
+}
+
+bool host_link_send_parts(const HostLinkPart* parts, uint8_t count) {
+    if (!link_uart || tx_busy || (dma_lent & HOST_LINK_DMA_TX)) return false;
+    if (count > HOST_LINK_MAX_PARTS) return false;
+    for (uint8_t i = 0; i < count; ++i) tx_parts[i] = parts[i];
+    tx_num_parts = count;
+    tx_part = 0;
+    tx_next = count ? (const uint8_t*)parts[0].data : nullptr;
+    tx_left = count ? parts[0].count : 0;
+    if (tx_left) set_tx_width(parts[0].width);
+    tx_busy = true;
+    if (!send_chunk()) tx_busy = false; // All parts empty
+    return true;
+}
+
+bool host_link_send(const void* data, uint32_t count, uint8_t width) {
+    HostLinkPart part = { data, count, width };
+    return host_link_send_parts(&part, 1);
+}
+
+bool host_link_tx_done_ISR() {
+    if (!tx_busy) return false;
+    if (send_chunk()) return false;
+    // The HAL leaves a finished normal-mode channel enabled; clear it so the LA's state mode
+    // can borrow Channel 4 between transmissions
+    __HAL_DMA_DISABLE(link_uart->hdmatx);
+    tx_busy = false;
+    return true;
+}
+
+bool host_link_busy() {
+    return tx_busy;
+}
+
+bool host_link_lend_dma(bool lend, uint32_t channels) {
+    if (!link_uart) return true; // No link: the channels are free
+    channels &= HOST_LINK_DMA_TX | HOST_LINK_DMA_RX;
+    if (lend) {
+        if ((channels & HOST_LINK_DMA_TX) && tx_busy) return false;
+        dma_lent |= channels;
+        if (channels & HOST_LINK_DMA_RX) HAL_UART_AbortReceive(link_uart); // Channel 5 off, no callback
+    } else {
+        uint32_t back = dma_lent & channels;
+        if (back & HOST_LINK_DMA_RX) {
+            rx_head = 0;
+            rx_restarted = true;
+            HAL_UARTEx_ReceiveToIdle_DMA(link_uart, rx_ring, HOST_LINK_RX_SIZE);
+        }
+        dma_lent &= ~back;
+    }
+    return true;
+}
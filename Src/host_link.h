@@ -0,0 +1,47 @@
+#ifndef HOST_LINK_H
+#define HOST_LINK_H
+
+#include <stdint.h>
+#include "stm32f1xx_hal.h" // For UART_HandleTypeDef
+
+// Serial link to a bench PC on USART1 (PA9 TX, PA10 RX), both directions on DMA.
+// RX runs forever into a circular ring; the UART's idle-line event (and the ring's half
+// and full points) report how far it got, so a command is seen as soon as the host stops
+// sending, with no per-byte interrupt. TX sends one caller-owned buffer (or a short list
+// of them, back to back) at a time straight from memory, split into DMA-sized chunks.
+// DMA1 Channel 4 (TX) and 5 (RX) are also what the LA's timestamp and state modes borrow,
+// through host_link_lend_dma(): a timestamp capture takes both, a state capture TX only.
+#define HOST_LINK_RX_SIZE   64     // Ring bytes; commands are a few bytes long
+#define HOST_LINK_TX_CHUNK  0xFFFF // Items per DMA transfer (CNDTR is 16 bits)
+#define HOST_LINK_MAX_PARTS 3      // Buffers in one transmission (header, payload, trailer)
+
+struct HostLinkPart {
+    const void* data;
+    uint32_t count; // Items
+    uint8_t width;  // Bytes per item, see host_link_send()
+};
+
+void host_link_init(UART_HandleTypeDef* huart); // Starts the RX ring
+
+// ISR side (HAL_UARTEx_RxEventCallback / HAL_UART_TxCpltCallback)
+void host_link_rx_event_ISR(uint16_t pos); // Ring position reported by the event
+bool host_link_tx_done_ISR();              // Starts the next chunk; true once everything is out
+
+// Task side
+uint16_t host_link_read(uint8_t* out, uint16_t max); // Bytes received since the last read
+// Send count items of 'width' bytes (1 or 2) from data, which must stay untouched until
+// the transmission is done. With width 2 only the low byte of each item goes out (the DMA
+// reads halfwords and writes bytes), which sends one byte lane of 16-bit samples in place.
+bool host_link_send(const void* data, uint32_t count, uint8_t width); // false while busy
+// Several buffers as one transmission: nothing else is sent between them
+bool host_link_send_parts(const HostLinkPart* parts, uint8_t count);
+bool host_link_busy();
+// Lend DMA1 channels (true) or take them back (false); bit n of 'channels' is Channel n,
+// others are ignored. Lending TX fails while a transmission is going out, and sends fail
+// until it is back. Lending RX stops the ring: bytes received meanwhile are lost (it
+// restarts empty). Safe from interrupt context.
+#define HOST_LINK_DMA_TX (1UL << 4) // DMA1 Channel 4
+#define HOST_LINK_DMA_RX (1UL << 5) // DMA1 Channel 5
+bool host_link_lend_dma(bool lend, uint32_t channels);
+
+#endif // HOST_LINK_H
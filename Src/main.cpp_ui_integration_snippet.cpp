@@ -12,6 +12,16 @@
 #include "LogicAnalyzer.h"
 #include "Middlewares/ArduinoHAL/Arduino_STM32_HAL.h" // For TFT CS control if needed, and XPT2046
 #include "Middlewares/XPT2046/XPT2046_Touchscreen.h"
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // Window-caching command layer under Adafruit_ILI9341
+#include "scheduler.h" // Event queue + run-to-completion tasks, WFI when idle
+#include "touch_input.h" // PENIRQ-driven touch state machine (press/move/release events)
+#include "touch_calibration.h" // Affine calibration flow, matrix kept in flash
+#include "capture_arena.h" // Free RAM after .bss/heap/stack, used as LA capture memory
+#include "LogicDecoder.h" // UART/SPI/I2C annotations over LA captures
+#include "host_link.h" // USART1 to a bench PC, DMA both ways
+#include "SumpServer.h" // SUMP/OLS device for sigrok/PulseView on the host link
+#include "ScopeStream.h" // Scope captures as CRC-checked binary frames on the host link
+#include "ScpiServer.h" // SCPI-style remote control for bench scripts, on the same link
 /* USER CODE END Includes */
 
 /* USER CODE BEGIN PV */
@@ -21,41 +31,290 @@ OperatingMode current_mode = MODE_MENU; // Initial mode
 // TFT and Touchscreen objects
 // Ensure hspi1 is initialized if using HAL SPI for TFT. Our ArduinoHAL layer uses it.
 // The TFT constructor uses pin aliases that map to HAL GPIO calls in Arduino_STM32_HAL.cpp
-Adafruit_ILI9341 tft(TFT_CS_PIN_ALIAS, TFT_DC_PIN_ALIAS, TFT_RST_PIN_ALIAS);
+// ILI9341_Display is an Adafruit_ILI9341 whose pixel writes go through ILI9341_Bus,
+// which skips redundant CASET/PASET/RAMWR commands and keeps CS asserted between batches.
+ILI9341_Display tft(TFT_CS_PIN_ALIAS, TFT_DC_PIN_ALIAS, TFT_RST_PIN_ALIAS);
 XPT2046_Touchscreen ts(XPT2046_CS_PIN_ALIAS, XPT2046_IRQ_PIN_ALIAS, XPT2046_CLK_PIN_ALIAS, XPT2046_DIN_PIN_ALIAS, XPT2046_DO_PIN_ALIAS);
 
 // Application module objects
 // Ensure hadc1 and htim2 are declared extern or defined here if this is the main compilation unit for them.
 extern ADC_HandleTypeDef hadc1; // Defined in adc.c by CubeMX
 extern TIM_HandleTypeDef htim2; // Defined in tim.c by CubeMX
+extern DMA_HandleTypeDef hdma_tim2_up; // TIM2_UP -> DMA1_Channel2, linked to htim2 in tim.c
+extern TIM_HandleTypeDef htim3; // LA sample counter for triggered captures, defined in tim.c
+extern TIM_HandleTypeDef htim4; // LA edge timestamps (input capture on PB6/PB8), defined in tim.c
+extern TIM_HandleTypeDef htim1; // LA state mode (external clock on PA12/ETR), defined in tim.c
+extern UART_HandleTypeDef huart1; // Host link (PA9/PA10, DMA1 Ch4 TX, Ch5 RX circular), defined in usart.c
 Oscilloscope myScope(&hadc1, &tft);
 LogicAnalyzer myLogicAnalyzer(&htim2, &tft);
+SumpServer sump_server(&myLogicAnalyzer);
+// Frozen scope captures to the host (Tools/scope_decode.cpp writes them as CSV or WAV).
+// scope_stream.set_continuous(true) sends every frame the link keeps up with,
+// scope_stream.request() the next one; scope_stream.stats() has the measured throughput.
+ScopeStream scope_stream(&myScope);
+// Command lines ("MODE LA;:LA:RATE 2E6;:LA:ARM") share the link with SUMP: a printable
+// byte outside a SUMP command starts one. scpi_server.stats() has the per-line cycle cost.
+ScpiServer scpi_server(&myScope, &myLogicAnalyzer, &scope_stream, &sump_server);
+
+// Protocol decoder run on every finished LA capture (LA_DECODER_NONE = off), e.g.
+//   la_decoder_cfg.type = LA_DECODER_UART; la_decoder_cfg.uart = { 0, 115200, 8, 0, 1, false };
+//   la_decoder_cfg.type = LA_DECODER_SPI;  la_decoder_cfg.spi = { 0, 1, 2, 3, 0, 8, true };
+//   la_decoder_cfg.type = LA_DECODER_I2C;  la_decoder_cfg.i2c = { 0, 1 };
+LogicDecoder la_decoder;
+LA_DecoderConfig la_decoder_cfg = { LA_DECODER_NONE };
 
 bool initial_mode_drawn = false; // Flag to ensure initial mode UI is drawn once
 
+// Refreshed once per second by the stats task (read them from the debugger)
+struct LoopStats {
+    uint32_t scope_frames_per_s; // Waveforms drawn in the last second
+    uint32_t la_frames_per_s;    // LA captures displayed in the last second (live view)
+    uint32_t busy_permille;      // CPU time spent in tasks; the rest was spent in WFI
+    uint8_t queue_max_depth;
+    uint32_t la_decode_cycles;   // Last protocol decode (must stay well under a frame)
+};
+LoopStats loop_stats;
+
 /* USER CODE END PV */
 
 /* HAL Callback Implementations (should be in main.c or stm32f1xx_it.c) */
 // These are already provided in scope and LA snippets, ensure they are unique and correct in final main.c
+// ISRs only record state and post an event; all processing runs in the tasks below.
+// A mixed-signal LA capture borrows ADC1 too; its buffer is not the scope's.
 void HAL_ADC_ConvCpltCallback(ADC_HandleTypeDef* hadc) {
-  if (hadc->Instance == ADC1) { 
+  if (hadc->Instance == ADC1 && myScope.is_running()) { 
     myScope.HAL_ADC_ConvCpltCallback_Forwarder();
+    sched_post(SCHED_EVT_ADC_FULL);
   }
 }
 
 void HAL_ADC_ConvHalfCpltCallback(ADC_HandleTypeDef* hadc) {
-  if (hadc->Instance == ADC1) { 
+  if (hadc->Instance == ADC1 && myScope.is_running()) { 
     myScope.HAL_ADC_ConvHalfCpltCallback_Forwarder();
+    sched_post(SCHED_EVT_ADC_HALF);
+  }
+}
+
+// Logic analyzer DMA (DMA1_Channel2_IRQHandler -> HAL_DMA_IRQHandler). In transition
+// mode each half of the staging ring is encoded here, in interrupt context.
+static void la_dma_half(DMA_HandleTypeDef* hdma) {
+  if (myLogicAnalyzer.capture_half_ISR()) {
+    sched_post(SCHED_EVT_LA_DONE);
+  }
+}
+
+static void la_dma_complete(DMA_HandleTypeDef* hdma) {
+  if (myLogicAnalyzer.capture_complete_ISR()) {
+    sched_post(SCHED_EVT_LA_DONE);
   }
 }
 
 void HAL_TIM_PeriodElapsedCallback(TIM_HandleTypeDef *htim) {
-  if (htim->Instance == htim2.Instance) { 
-    myLogicAnalyzer.process_capture_ISR();
+  // Only without the DMA channel (per-sample fallback), or as the ring drain in edge mode
+  if (htim->Instance == htim2.Instance) {
+    if (myLogicAnalyzer.process_capture_ISR()) {
+      sched_post(SCHED_EVT_LA_DONE);
+    }
   }
   // Add other timer callbacks (e.g. HAL_IncTick if TIMx is SysTick source)
 }
 
+// TIM4 CH4 (PB8 falling edges) has no DMA request; its captures are stored here. CH1..CH3
+// are moved by DMA and raise no interrupt.
+void HAL_TIM_IC_CaptureCallback(TIM_HandleTypeDef *htim) {
+  if (htim->Instance == htim4.Instance && htim->Channel == HAL_TIM_ACTIVE_CHANNEL_4) {
+    myLogicAnalyzer.edge_capture_ISR();
+  }
+}
+
+// TIM3 counts LA samples during a triggered capture: CC2 paces the trigger scans, CC1
+// marks the end of the post-trigger part (compare flags only, no output pins)
+void HAL_TIM_OC_DelayElapsedCallback(TIM_HandleTypeDef *htim) {
+  if (htim->Instance == htim3.Instance) {
+    bool done = (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_1) ? myLogicAnalyzer.trigger_stop_ISR()
+                                                            : myLogicAnalyzer.trigger_scan_ISR();
+    if (done) {
+      sched_post(SCHED_EVT_LA_DONE);
+    }
+  }
+  // TIM1 counts the external clock in state mode (TIM1_CC_IRQHandler): CC2 is the first
+  // edge, CC1 the last one
+  if (htim->Instance == htim1.Instance) {
+    if (htim->Channel == HAL_TIM_ACTIVE_CHANNEL_2) {
+      myLogicAnalyzer.state_start_ISR();
+    } else if (myLogicAnalyzer.state_stop_ISR()) {
+      sched_post(SCHED_EVT_LA_DONE);
+    }
+  }
+}
+
+// Host link: the RX ring reports idle line, half and full; TX moves on to the next chunk
+void HAL_UARTEx_RxEventCallback(UART_HandleTypeDef *huart, uint16_t Size) {
+  if (huart->Instance == USART1) {
+    host_link_rx_event_ISR(Size);
+    sched_post(SCHED_EVT_HOST_RX);
+  }
+}
+
+void HAL_UART_TxCpltCallback(UART_HandleTypeDef *huart) {
+  if (huart->Instance == USART1 && host_link_tx_done_ISR()) {
+    sched_post(SCHED_EVT_HOST_TX);
+  }
+}
+
+// Edge and state captures borrow DMA1 Channels 4/5 from the link (called from the task or,
+// when a capture ends, from its interrupt). Senders turned away meanwhile wait for a
+// SCHED_EVT_HOST_TX, so one is posted when the channels come back.
+static bool la_dma_lender(bool lend, uint32_t channels) {
+  if (!host_link_lend_dma(lend, channels)) return false;
+  if (!lend) sched_post(SCHED_EVT_HOST_TX);
+  return true;
+}
+
+// PA8 (XPT2046 PENIRQ) is configured as EXTI falling edge in MX_GPIO_Init
+void HAL_GPIO_EXTI_Callback(uint16_t GPIO_Pin) {
+  if (GPIO_Pin == XPT2046_IRQ_PIN) {
+    sched_post(SCHED_EVT_TOUCH);
+  }
+}
+
+// Replaces the weak HAL version to add a once-per-second stats event and to
+// step the touch state machine while a touch is in progress
+void HAL_IncTick(void) {
+  uwTick += uwTickFreq;
+  if ((uwTick % 1000U) == 0U) {
+    sched_post(SCHED_EVT_STATS);
+  }
+  if (touch_input_active() && (uwTick % TOUCH_SAMPLE_PERIOD_MS) == 0U) {
+    sched_post(SCHED_EVT_TOUCH);
+  }
+}
+
+/* Tasks (run to completion from sched_run(), never from an ISR) */
+static void task_touch(uint8_t event, void* ctx) {
+  // One axis burst per step; a point in progress re-queues itself behind any pending
+  // scope/LA events instead of holding the CPU for the whole point
+  if (touch_input_step()) sched_post(SCHED_EVT_TOUCH);
+
+  // Event coordinates are screen-mapped by the affine calibration (raw while calibrating)
+  TouchEvent ev;
+  bool any = false;
+  while (touch_input_pop(&ev)) {
+    process_touch(ev); // Process the touch input based on current mode and UI
+    any = true;
+  }
+  if (any) sched_post(SCHED_EVT_RENDER);
+}
+
+static void task_scope(uint8_t event, void* ctx) {
+  if (current_mode != MODE_OSCILLOSCOPE || !myScope.is_running()) return;
+  uint32_t frames_before = myScope.frame_count();
+  myScope.process(); // Consumes the half that was just filled
+  if (myScope.is_frozen()) scope_stream.on_scope_frozen(); // A requested frame: send it
+  if (myScope.frame_count() != frames_before) {
+    tft.bus().endFrame(); // Latch per-frame command/byte counters (tft.bus().frameStats())
+  }
+}
+
+static void task_la(uint8_t event, void* ctx) {
+  // The stack or heap reached into the capture memory (or the capture ran past it):
+  // stop repeating captures; the status line reports it (capture_arena_faults())
+  if (event == SCHED_EVT_LA_DONE && !capture_arena_check()) {
+    myLogicAnalyzer.set_live(false);
+    sched_post(SCHED_EVT_RENDER);
+  }
+  if (current_mode != MODE_LOGIC_ANALYZER || !myLogicAnalyzer.is_display_pending()) return;
+  if (la_decoder_cfg.type != LA_DECODER_NONE) {
+    uint32_t start = DWT->CYCCNT;
+    la_decoder.decode(myLogicAnalyzer.samples(), myLogicAnalyzer.capture_stats().timer_hz, la_decoder_cfg);
+    loop_stats.la_decode_cycles = DWT->CYCCNT - start;
+  }
+  myLogicAnalyzer.set_annotations(la_decoder.annotations(), la_decoder.count(),
+                                  la_decoder_cfg.type != LA_DECODER_NONE ? la_decoder.rows() : 0);
+  myLogicAnalyzer.display(); // Render captured waveforms
+  tft.bus().endFrame();
+  myLogicAnalyzer.acknowledge_display_done(); // Change status to LA_DONE_DISPLAYED
+  if (myLogicAnalyzer.is_live()) myLogicAnalyzer.rearm(); // Next capture, drawn incrementally
+  sched_post(SCHED_EVT_RENDER); // Status shows "Done"
+}
+
+// After "la": a host-armed capture is drawn before it is held for sending
+static void task_host(uint8_t event, void* ctx) {
+  switch (event) {
+    case SCHED_EVT_HOST_RX: {
+      uint8_t buf[HOST_LINK_RX_SIZE];
+      uint16_t n = host_link_read(buf, sizeof(buf));
+      for (uint16_t i = 0; i < n; ++i) {
+        if (scpi_server.wants(buf[i])) scpi_server.feed(buf[i]);
+        else sump_server.feed(buf[i]);
+      }
+      sched_post(SCHED_EVT_RENDER); // A run command turns the live view off, commands change settings
+      break;
+    }
+    case SCHED_EVT_LA_DONE:
+      sump_server.on_la_done();
+      break;
+    case SCHED_EVT_HOST_TX:
+      sump_server.on_tx_done();
+      scope_stream.on_tx_done();
+      scpi_server.on_tx_done(); // Replies that waited for the link
+      break;
+  }
+}
+
+static void task_ui(uint8_t event, void* ctx) {
+  switch (current_mode) {
+    case MODE_MENU:
+      if (!initial_mode_drawn) {
+        draw_main_menu();
+        initial_mode_drawn = true;
+      }
+      break;
+
+    case MODE_OSCILLOSCOPE:
+      if (!initial_mode_drawn) { // Switched to this mode
+        myScope.drawGrid(); // Draw background
+        initial_mode_drawn = true;
+      }
+      draw_oscilloscope_ui(&myScope); // Repaints only widgets whose content changed
+      break;
+
+    case MODE_LOGIC_ANALYZER:
+      if (!initial_mode_drawn) { // Switched to this mode
+        tft.fillScreen(LA_BG_COLOR); // Clear screen for LA
+        myLogicAnalyzer.draw_grid_static(); // Draw static LA grid
+        myLogicAnalyzer.invalidate_frame();
+        initial_mode_drawn = true;
+      }
+      draw_logic_analyzer_ui(&myLogicAnalyzer);
+      break;
+
+    case MODE_CALIBRATE:
+      break; // The crosshair flow draws its own screen
+
+    default:
+      // Should not happen, reset to menu
+      current_mode = MODE_MENU;
+      initial_mode_drawn = false;
+      sched_post(SCHED_EVT_RENDER);
+      break;
+  }
+}
+
+static void task_stats(uint8_t event, void* ctx) {
+  static uint32_t last_frames = 0;
+  uint32_t frames = myScope.frame_count();
+  loop_stats.scope_frames_per_s = frames - last_frames;
+  last_frames = frames;
+  static uint32_t last_la_frames = 0;
+  uint32_t la_frames = myLogicAnalyzer.frame_count();
+  loop_stats.la_frames_per_s = la_frames - last_la_frames;
+  last_la_frames = la_frames;
+  loop_stats.busy_permille = sched_busy_cycles() / (HAL_RCC_GetHCLKFreq() / 1000);
+  loop_stats.queue_max_depth = sched_queue_stats().max_depth;
+  sched_stats_window_reset(); // Per-task window_cycles/window_runs restart here
+}
+
 
 int main(void) {
   /* MCU Configuration & Peripheral Init */
@@ -72,6 +331,10 @@ int main(void) {
   MX_SPI1_Init();  // For TFT (via ArduinoHAL's SPI object)
   MX_ADC1_Init();  // For Oscilloscope
   MX_TIM2_Init();  // For Logic Analyzer (ensure TIM2 is configured in CubeMX)
+  MX_TIM3_Init();  // For Logic Analyzer triggers (sample counter; registers set per capture)
+  MX_TIM4_Init();  // For Logic Analyzer edge timestamps (clock and pins; registers set per capture)
+  MX_TIM1_Init();  // For Logic Analyzer state mode (ETR pin and clock; registers set per capture)
+  MX_USART1_UART_Init(); // Host link (SUMP), 115200 8N1
 
 
   /* USER CODE BEGIN 2 */
@@ -81,95 +344,74 @@ int main(void) {
   tft.begin(); // Initializes ILI9341 display
   
   ts.begin(); // Initialize XPT2046 Touchscreen
-  // ts.setCalibration(...); // Load or perform calibration if needed
-  // For now, assume raw touch coordinates map reasonably to screen or use placeholder calibration.
-  // Example: ts.setCalibration(200, 3800, 250, 3750, SCREEN_WIDTH_HW, SCREEN_HEIGHT_HW, false);
+  touch_input_init(&ts);
 
 
   init_ui(&tft); // Pass TFT handle to UI drawing functions
 
+  // Waveform areas sit between the status bar and the button bar so the retained
+  // widgets are never overdrawn and only need repainting when their content changes.
+  myScope.setWaveArea(5, UI_WAVE_AREA_Y, SCREEN_WIDTH_HW - 10, UI_WAVE_AREA_H);
+  myLogicAnalyzer.set_display_area(UI_WAVE_AREA_Y, LA_WAVE_AREA_H); // Readout lines below
+
   // Initialize application modules
   myScope.begin(); // Prepares oscilloscope, doesn't start ADC yet
   // myLogicAnalyzer.begin(1000000); // LA starts on user command via UI
 
-  // Initial UI draw is handled by the main loop's mode check.
+  // LA capture depth is whatever RAM the rest of the firmware leaves free
+  capture_arena_init();
+  myLogicAnalyzer.set_capture_buffer(capture_arena_base(), capture_arena_size());
+
+  // LA samples are moved by DMA; measure the fastest rate it sustains on this board
+  // (myLogicAnalyzer.rate_probe() has the rate and jitter, begin() clamps to it)
+  hdma_tim2_up.XferHalfCpltCallback = la_dma_half;
+  hdma_tim2_up.XferCpltCallback = la_dma_complete;
+  myLogicAnalyzer.probe_max_rate();
+  myLogicAnalyzer.set_edge_timer(&htim4);
+  myLogicAnalyzer.set_dma_lender(la_dma_lender); // Edge and state captures take the link's DMA channels
+  myLogicAnalyzer.set_trigger_timer(&htim3);
+  myLogicAnalyzer.set_state_timer(&htim1); // Samples on rising clock edges unless set_state_edge(false)
+  // Captures start at once until a trigger is set, e.g. CH0 rising while CH1 is high:
+  // LA_TriggerCondition cond[LA_NUM_CHANNELS] = { LA_TRIG_RISING, LA_TRIG_HIGH, LA_TRIG_DONT_CARE, LA_TRIG_DONT_CARE };
+  // LA_TriggerStage stage = LogicAnalyzer::make_trigger_stage(cond);
+  // myLogicAnalyzer.set_trigger(&stage, 1);
+  // myLogicAnalyzer.set_pretrigger_percent(25);
+  // Mixed signal: PB0 alongside the channels, one conversion per 4 samples (raised as the
+  // rate needs); the Mode button ("Mixed") or LA:MIXed turns it on. Optionally triggered
+  // where it rises through mid-scale:
+  myLogicAnalyzer.set_mixed_adc(&hadc1, 4);
+  // myLogicAnalyzer.set_analog_trigger(true, 2048, true);
+
+  // Commands from the host are seen on the UART idle line; timestamp and state captures
+  // borrow the link's DMA channels (la_dma_lender)
+  host_link_init(&huart1);
+
+  // Initial UI draw is handled by the UI task's mode check.
   initial_mode_drawn = false; 
   current_mode = MODE_MENU; // Start with main menu
 
+  // Use the stored touch calibration; without one, start with the crosshair flow
+  touch_cal_init(&ts, &tft);
+  if (!touch_cal_load()) {
+    current_mode = MODE_CALIBRATE;
+    touch_cal_begin();
+  }
+
+  sched_add_task("touch", SCHED_EVT_BIT(SCHED_EVT_TOUCH), task_touch, nullptr);
+  sched_add_task("scope", SCHED_EVT_BIT(SCHED_EVT_ADC_HALF) | SCHED_EVT_BIT(SCHED_EVT_ADC_FULL), task_scope, nullptr);
+  sched_add_task("la", SCHED_EVT_BIT(SCHED_EVT_LA_DONE), task_la, nullptr);
+  sched_add_task("ui", SCHED_EVT_BIT(SCHED_EVT_RENDER), task_ui, nullptr);
+  sched_add_task("stats", SCHED_EVT_BIT(SCHED_EVT_STATS), task_stats, nullptr);
+  sched_add_task("host", SCHED_EVT_BIT(SCHED_EVT_HOST_RX) | SCHED_EVT_BIT(SCHED_EVT_LA_DONE) | SCHED_EVT_BIT(SCHED_EVT_HOST_TX),
+                 task_host, nullptr);
+  sched_post(SCHED_EVT_RENDER); // Draw the main menu
+
   /* USER CODE END 2 */
 
   /* Infinite loop */
-  while (1) {
-    /* USER CODE END WHILE */
-    /* USER CODE BEGIN 3 */
-
-    // Handle touch input
-    if (ts.touched()) { // Check for touch press
-        TS_Point p = ts.getPoint(); // Get touch coordinates
-        if (p.z > 50) { // Basic pressure check, adjust threshold as needed
-            // Map XPT2046 raw ADC to screen coordinates if not done by library's getPoint()
-            // Assuming p.x and p.y are already screen-mapped for now based on task note.
-            // If using Adafruit_TouchScreen, map may be needed:
-            // p.x = map(p.x, TS_MINX, TS_MAXX, 0, tft.width());
-            // p.y = map(p.y, TS_MINY, TS_MAXY, 0, tft.height());
-            process_touch(p.x, p.y); // Process the touch input based on current mode and UI
-            
-            // Simple debounce: wait for touch release
-            while (ts.touched()) {
-                HAL_Delay(10); // Small delay
-            }
-        }
-    }
-
-    // Mode-specific processing and UI updates
-    switch (current_mode) {
-        case MODE_MENU:
-            if (!initial_mode_drawn) {
-                draw_main_menu();
-                initial_mode_drawn = true;
-            }
-            // No continuous processing for menu
-            break;
-
-        case MODE_OSCILLOSCOPE:
-            if (!initial_mode_drawn) { // Switched to this mode
-                myScope.drawGrid(); // Draw background
-                draw_oscilloscope_ui(&myScope); // Draw buttons and status
-                initial_mode_drawn = true;
-            }
-            if (myScope.is_running()) {
-                myScope.process(); // Process ADC data and draw waveform if running
-            }
-            // draw_oscilloscope_ui(&myScope); // Could be called periodically to update status if it changes outside touch events.
-            break;
-
-        case MODE_LOGIC_ANALYZER:
-            if (!initial_mode_drawn) { // Switched to this mode
-                tft.fillScreen(LA_BG_COLOR); // Clear screen for LA
-                myLogicAnalyzer.draw_grid_static(); // Draw static LA grid
-                draw_logic_analyzer_ui(&myLogicAnalyzer); // Draw buttons and initial status
-                initial_mode_drawn = true;
-            }
-
-            if (myLogicAnalyzer.get_status() == LogicAnalyzer::LA_CAPTURING) {
-                // Optionally update a "Capturing..." status or sample count on screen
-                // draw_logic_analyzer_ui(&myLogicAnalyzer); // Redraws buttons and status
-            } else if (myLogicAnalyzer.get_status() == LogicAnalyzer::LA_DONE_PENDING_DISPLAY) {
-                myLogicAnalyzer.display(); // Render captured waveforms
-                myLogicAnalyzer.acknowledge_display_done(); // Change status to LA_DONE_DISPLAYED
-                draw_logic_analyzer_ui(&myLogicAnalyzer); // Update UI to show "Done" and reflect new state for "Arm"
-            }
-            break;
-        
-        default:
-            // Should not happen, reset to menu
-            current_mode = MODE_MENU;
-            initial_mode_drawn = false;
-            break;
-    }
-    
-    HAL_Delay(10); // General delay for loop responsiveness
-  }
+  // Each ADC half is handled as soon as its DMA event arrives (no 10 ms poll period),
+  // and the core sleeps in WFI whenever there is nothing to do.
+  sched_run();
   /* USER CODE END 3 */
 }
 
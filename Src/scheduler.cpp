@@ -0,0 +1,137 @@
+#include "scheduler.h"
+
+struct SchedTask {
+    uint32_t event_mask;
+    SchedTaskFn fn;
+    void* ctx;
+};
+
+static SchedTask tasks[SCHED_MAX_TASKS];
+static SchedTaskStats task_stats[SCHED_MAX_TASKS];
+static uint8_t num_tasks = 0;
+
+// Event FIFO. Written by ISRs and tasks, read by the main loop; all accesses to the
+// indices and the pending mask happen with interrupts masked.
+static volatile uint8_t queue[SCHED_QUEUE_LEN];
+static volatile uint8_t q_head = 0; // Next slot to read
+static volatile uint8_t q_tail = 0; // Next slot to write
+static volatile uint32_t pending_mask = 0;
+
+static SchedQueueStats q_stats = { 0, 0, 0, 0, 0 };
+static uint32_t busy_cycles = 0;
+
+bool sched_add_task(const char* name, uint32_t event_mask, SchedTaskFn fn, void* ctx) {
+    if (num_tasks >= SCHED_MAX_TASKS || !fn) return false;
+    tasks[num_tasks].event_mask = event_mask;
+    tasks[num_tasks].fn = fn;
+    tasks[num_tasks].ctx = ctx;
+    task_stats[num_tasks] = SchedTaskStats{ name, 0, 0, 0, 0, 0 };
+    num_tasks++;
+    return true;
+}
+
+bool sched_post(uint8_t event) {
+    if (event >= SCHED_EVT_COUNT) return false;
+    bool queued = true;
+
+    uint32_t primask = __get_PRIMASK();
+    __disable_irq();
+    if (pending_mask & SCHED_EVT_BIT(event)) {
+        q_stats.coalesced++;
+    } else {
+        uint8_t depth = (uint8_t)(q_tail - q_head);
+        if (depth >= SCHED_QUEUE_LEN) {
+            q_stats.dropped++;
+            queued = false;
+        } else {
+            queue[q_tail & (SCHED_QUEUE_LEN - 1)] = event;
+            q_tail++;
+            pending_mask |= SCHED_EVT_BIT(event);
+            q_stats.posted++;
+            if (depth + 1 > q_stats.max_depth) q_stats.max_depth = depth + 1;
+        }
+    }
+    __set_PRIMASK(primask);
+    return queued;
+}
+
+// Pop one event, or return SCHED_EVT_COUNT if the queue is empty
+static uint8_t pop_event() {
+    uint8_t event = SCHED_EVT_COUNT;
+    __disable_irq();
+    if (q_head != q_tail) {
+        event = queue[q_head & (SCHED_QUEUE_LEN - 1)];
+        q_head++;
+        // Cleared before the task runs, so an ISR firing during the task queues it again
+        pending_mask &= ~SCHED_EVT_BIT(event);
+    }
+    __enable_irq();
+    return event;
+}
+
+static void dispatch(uint8_t event) {
+    for (uint8_t i = 0; i < num_tasks; ++i) {
+        if (!(tasks[i].event_mask & SCHED_EVT_BIT(event))) continue;
+
+        uint32_t start = DWT->CYCCNT;
+        tasks[i].fn(event, tasks[i].ctx);
+        uint32_t cycles = DWT->CYCCNT - start;
+
+        SchedTaskStats& st = task_stats[i];
+        st.runs++;
+        st.window_runs++;
+        st.last_cycles = cycles;
+        st.window_cycles += cycles;
+        if (cycles > st.max_cycles) st.max_cycles = cycles;
+        busy_cycles += cycles;
+    }
+}
+
+void sched_dispatch_pending() {
+    uint8_t event;
+    while ((event = pop_event()) != SCHED_EVT_COUNT) {
+        dispatch(event);
+    }
+}
+
+void sched_run() {
+    while (1) {
+        sched_dispatch_pending();
+
+        // Check-then-sleep with interrupts masked: an event posted between the check and
+        // WFI leaves its interrupt pending, and a pending interrupt makes WFI return at once.
+        __disable_irq();
+        if (q_head == q_tail) {
+            __WFI();
+        }
+        __enable_irq(); // The waking ISR runs here
+    }
+}
+
+uint8_t sched_task_count() {
+    return num_tasks;
+}
+
+const SchedTaskStats* sched_task_stats(uint8_t index) {
+    return (index < num_tasks) ? &task_stats[index] : nullptr;
+}
+
+SchedQueueStats sched_queue_stats() {
+    __disable_irq();
+    SchedQueueStats s = q_stats;
+    s.depth = (uint8_t)(q_tail - q_head);
+    __enable_irq();
+    return s;
+}
+
+uint32_t sched_busy_cycles() {
+    return busy_cycles;
+}
+
+void sched_stats_window_reset() {
+    for (uint8_t i = 0; i < num_tasks; ++i) {
+        task_stats[i].window_cycles = 0;
+        task_stats[i].window_runs = 0;
+    }
+    busy_cycles = 0;
+}
@@ -0,0 +1,68 @@
+#ifndef SCHEDULER_H
+#define SCHEDULER_H
+
+#include <stdint.h>
+#include "stm32f1xx_hal.h" // For __WFI, PRIMASK and DWT
+
+// Run-to-completion scheduler. ISRs post events into a small queue; the main loop
+// dispatches each event to the tasks subscribed to it and sleeps (WFI) when the queue
+// is empty. Tasks never block: they do their work and return.
+
+#define SCHED_QUEUE_LEN 16 // Power of two. Must be >= SCHED_EVT_COUNT (duplicates are coalesced).
+#define SCHED_MAX_TASKS 8
+
+// Events (one bit each in a task's subscription mask)
+enum SchedEvent {
+    SCHED_EVT_ADC_HALF,  // Scope DMA filled the first half of the ADC buffer
+    SCHED_EVT_ADC_FULL,  // Scope DMA filled the second half
+    SCHED_EVT_LA_DONE,   // Logic analyzer buffer is full
+    SCHED_EVT_TOUCH,     // XPT2046 PENIRQ went low
+    SCHED_EVT_RENDER,    // UI state changed, widgets need a render pass
+    SCHED_EVT_STATS,     // Once per second, from the SysTick
+    SCHED_EVT_HOST_RX,   // Host link received bytes (UART idle line, or the ring's half/full point)
+    SCHED_EVT_HOST_TX,   // Host link finished sending a buffer
+    SCHED_EVT_COUNT
+};
+
+#define SCHED_EVT_BIT(e) (1UL << (e))
+
+typedef void (*SchedTaskFn)(uint8_t event, void* ctx);
+
+struct SchedTaskStats {
+    const char* name;
+    uint32_t runs;          // Total dispatches
+    uint32_t last_cycles;   // DWT cycles of the last run
+    uint32_t max_cycles;    // Worst run since boot
+    uint32_t window_cycles; // Cycles spent in the current stats window
+    uint32_t window_runs;
+};
+
+struct SchedQueueStats {
+    uint8_t depth;          // Events waiting now
+    uint8_t max_depth;      // Deepest the queue has been since boot
+    uint32_t posted;        // Events accepted into the queue
+    uint32_t coalesced;     // Posts of an event that was already queued
+    uint32_t dropped;       // Posts lost to a full queue (should stay 0)
+};
+
+// Register a task for the events in event_mask. Returns false if the table is full.
+bool sched_add_task(const char* name, uint32_t event_mask, SchedTaskFn fn, void* ctx);
+
+// Queue an event. Safe from any ISR and from tasks. An event that is already
+// queued is not queued twice; its task will see the latest state anyway.
+bool sched_post(uint8_t event);
+
+// Dispatch everything queued, including events posted while doing so
+void sched_dispatch_pending();
+
+// Main loop: dispatch, then WFI until the next interrupt. Never returns.
+void sched_run();
+
+// Statistics
+uint8_t sched_task_count();
+const SchedTaskStats* sched_task_stats(uint8_t index);
+SchedQueueStats sched_queue_stats();
+uint32_t sched_busy_cycles();      // Cycles spent in tasks during the current window
+void sched_stats_window_reset();   // Start a new window (call once per SCHED_EVT_STATS)
+
+#endif // SCHEDULER_H
@@ -0,0 +1,123 @@
+#include "touch_calibration.h"
+#include "ui_config.h" // For screen size and colors
+#include "ui_text.h"   // For the instruction line
+#include "stm32f1xx_hal.h" // For the flash driver
+
+// Stored record: magic, matrix, checksum (whole words, programmed one word at a time)
+struct TouchCalRecord {
+    uint32_t magic;
+    XPT2046_Calibration cal;
+    uint32_t checksum;
+};
+
+#define TOUCH_CAL_RECORD_WORDS (sizeof(TouchCalRecord) / 4)
+
+// Targets at 10%/90% of the screen, far apart and not collinear
+static const int16_t cal_targets[3][2] = {
+    { SCREEN_WIDTH_HW / 10,     SCREEN_HEIGHT_HW / 10 },
+    { SCREEN_WIDTH_HW * 9 / 10, SCREEN_HEIGHT_HW / 2 },
+    { SCREEN_WIDTH_HW / 2,      SCREEN_HEIGHT_HW * 9 / 10 },
+};
+
+static XPT2046_Touchscreen* _ts = nullptr;
+static ILI9341_Display* _tft = nullptr;
+static uint8_t cal_step = 0;
+static int16_t cal_raw[3][2];
+
+static uint32_t record_checksum(const TouchCalRecord& rec) {
+    const uint32_t* w = (const uint32_t*)&rec;
+    uint32_t sum = 0;
+    for (uint8_t i = 0; i < TOUCH_CAL_RECORD_WORDS - 1; ++i) sum += w[i]; // Everything but the checksum
+    return ~sum;
+}
+
+void touch_cal_init(XPT2046_Touchscreen* ts_handle, ILI9341_Display* tft_handle) {
+    _ts = ts_handle;
+    _tft = tft_handle;
+}
+
+bool touch_cal_load() {
+    if (!_ts) return false;
+    const TouchCalRecord* rec = (const TouchCalRecord*)TOUCH_CAL_FLASH_ADDR;
+    if (rec->magic != TOUCH_CAL_MAGIC || rec->checksum != record_checksum(*rec)) return false;
+    _ts->setAffineCalibration(rec->cal, SCREEN_WIDTH_HW, SCREEN_HEIGHT_HW);
+    return true;
+}
+
+bool touch_cal_save(const XPT2046_Calibration& cal) {
+    TouchCalRecord rec;
+    rec.magic = TOUCH_CAL_MAGIC;
+    rec.cal = cal;
+    rec.checksum = record_checksum(rec);
+
+    HAL_FLASH_Unlock();
+    FLASH_EraseInitTypeDef erase = {0};
+    erase.TypeErase = FLASH_TYPEERASE_PAGES;
+    erase.PageAddress = TOUCH_CAL_FLASH_ADDR;
+    erase.NbPages = 1;
+    uint32_t page_error = 0;
+    bool ok = (HAL_FLASHEx_Erase(&erase, &page_error) == HAL_OK);
+
+    const uint32_t* w = (const uint32_t*)&rec;
+    for (uint8_t i = 0; ok && i < TOUCH_CAL_RECORD_WORDS; ++i) {
+        ok = (HAL_FLASH_Program(FLASH_TYPEPROGRAM_WORD, TOUCH_CAL_FLASH_ADDR + 4 * i, w[i]) == HAL_OK);
+    }
+    HAL_FLASH_Lock();
+    return ok;
+}
+
+// --- Crosshair flow ---
+static void draw_cross(uint8_t index, uint16_t color) {
+    int16_t x = cal_targets[index][0];
+    int16_t y = cal_targets[index][1];
+    _tft->drawFastHLine(x - TOUCH_CAL_CROSS_SIZE, y, 2 * TOUCH_CAL_CROSS_SIZE + 1, color);
+    _tft->drawFastVLine(x, y - TOUCH_CAL_CROSS_SIZE, 2 * TOUCH_CAL_CROSS_SIZE + 1, color);
+}
+
+static void show_message(const char* text) {
+    // Fixed-width line so a shorter message blanks the previous one
+    char line[28];
+    uint8_t n = 0;
+    while (text[n] && n < sizeof(line) - 1) { line[n] = text[n]; n++; }
+    while (n < sizeof(line) - 1) line[n++] = ' ';
+    line[n] = '\0';
+    int16_t x = (SCREEN_WIDTH_HW - ui_text_width(line, 1)) / 2;
+    ui_text_draw(x, SCREEN_HEIGHT_HW / 2 - 20, line, 1, UI_TEXT_COLOR, UI_BG_COLOR);
+}
+
+void touch_cal_begin() {
+    if (!_ts || !_tft) return;
+    _ts->clearCalibration(); // Events carry raw coordinates from here on
+    cal_step = 0;
+    _tft->fillScreen(UI_BG_COLOR);
+    show_message("Touch the crosshair");
+    draw_cross(0, TOUCH_CAL_COLOR);
+}
+
+bool touch_cal_handle(const TouchEvent& ev) {
+    if (!_ts || !_tft || cal_step >= 3) return false;
+    // The release carries the last stable point of the hold
+    if (ev.type != TOUCH_RELEASE) return false;
+
+    cal_raw[cal_step][0] = ev.x;
+    cal_raw[cal_step][1] = ev.y;
+    draw_cross(cal_step, UI_BG_COLOR);
+    cal_step++;
+
+    if (cal_step < 3) {
+        draw_cross(cal_step, TOUCH_CAL_COLOR);
+        return false;
+    }
+
+    XPT2046_Calibration cal;
+    if (!xpt2046SolveCalibration(cal_raw, cal_targets, &cal)) {
+        // Targets were hit at (nearly) collinear raw points: start over
+        cal_step = 0;
+        show_message("Not accepted, try again");
+        draw_cross(0, TOUCH_CAL_COLOR);
+        return false;
+    }
+    _ts->setAffineCalibration(cal, SCREEN_WIDTH_HW, SCREEN_HEIGHT_HW);
+    touch_cal_save(cal); // If this fails the matrix still applies until reset
+    return true;
+}
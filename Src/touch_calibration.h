@@ -0,0 +1,28 @@
+#ifndef TOUCH_CALIBRATION_H
+#define TOUCH_CALIBRATION_H
+
+#include <stdint.h>
+#include "Middlewares/XPT2046/XPT2046_Touchscreen.h"
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // For ILI9341_Display
+#include "touch_input.h" // For TouchEvent
+
+// Stored matrix lives in the last 1 KB page of the 64 KB flash. The linker script's
+// FLASH region must end below this address (LENGTH = 63K) so code never lands there.
+#define TOUCH_CAL_FLASH_ADDR  0x0800FC00UL
+#define TOUCH_CAL_MAGIC       0x4C414354UL // "TCAL"
+#define TOUCH_CAL_CROSS_SIZE  10           // Crosshair arm length (px)
+#define TOUCH_CAL_COLOR       ILI9341_WHITE
+
+void touch_cal_init(XPT2046_Touchscreen* ts_handle, ILI9341_Display* tft_handle);
+
+// Apply the matrix stored in flash. Returns false if there is none (or it is corrupt).
+bool touch_cal_load();
+bool touch_cal_save(const XPT2046_Calibration& cal);
+
+// Three-point crosshair flow. touch_cal_begin() switches the driver to raw coordinates
+// and draws the first target; each release on a target advances to the next. After the
+// third, the matrix is solved, applied and saved, and touch_cal_handle() returns true.
+void touch_cal_begin();
+bool touch_cal_handle(const TouchEvent& ev);
+
+#endif // TOUCH_CALIBRATION_H
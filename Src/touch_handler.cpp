@@ -3,84 +3,302 @@
 #include "ui_draw.h"
 #include "Scope.h"
 #include "LogicAnalyzer.h"
+#include "ui_widgets.h" // For ui_hit_test
+#include "touch_calibration.h" // Crosshair flow in MODE_CALIBRATE
 
 // These are expected to be defined in main.cpp
 extern OperatingMode current_mode;
 extern Oscilloscope myScope;
 extern LogicAnalyzer myLogicAnalyzer;
-extern Adafruit_ILI9341 tft; // Used by draw functions, init_ui should have set it
+extern ILI9341_Display tft; // Used by draw functions, init_ui should have set it
 
-// Helper function to check if touch is within a button area
-bool is_touch_in_rect(int16_t tx, int16_t ty, int16_t x, int16_t y, int16_t w, int16_t h) {
-    return (tx >= x && tx <= (x + w) && ty >= y && ty <= (y + h));
+// --- Drag gestures on the scope waveform area ---
+// Vertical drag moves the trigger level, horizontal drag the trigger position. The axis
+// is chosen once the finger has moved DRAG_LOCK_PX, so a drag never changes both.
+enum DragAxis {
+    DRAG_NONE,
+    DRAG_UNDECIDED,
+    DRAG_LEVEL,
+    DRAG_POSITION,
+    DRAG_CURSOR // LA time cursor (no axis lock)
+};
+
+static uint8_t drag_axis = DRAG_NONE;
+static int16_t drag_x0, drag_y0;
+static int drag_level0;
+static int16_t drag_pos0;
+
+// Returns true if the event belongs to a drag (and must not be treated as a button press)
+static bool handle_scope_drag(const TouchEvent& ev) {
+    switch (ev.type) {
+        case TOUCH_PRESS:
+            if (!myScope.inWaveArea(ev.x, ev.y)) return false;
+            drag_axis = DRAG_UNDECIDED;
+            drag_x0 = ev.x;
+            drag_y0 = ev.y;
+            drag_level0 = myScope.getTriggerLevel();
+            drag_pos0 = myScope.getTriggerPosition();
+            return true;
+
+        case TOUCH_MOVE: {
+            if (drag_axis == DRAG_NONE) return false;
+            int16_t dx = ev.x - drag_x0;
+            int16_t dy = ev.y - drag_y0;
+            if (drag_axis == DRAG_UNDECIDED) {
+                int16_t adx = (dx < 0) ? -dx : dx;
+                int16_t ady = (dy < 0) ? -dy : dy;
+                if (adx < DRAG_LOCK_PX && ady < DRAG_LOCK_PX) return true;
+                drag_axis = (ady > adx) ? DRAG_LEVEL : DRAG_POSITION;
+            }
+            // Only the marker rows and the matching status field are repainted
+            if (drag_axis == DRAG_LEVEL) {
+                // Up is a higher level; the full area height spans the ADC range
+                myScope.moveTriggerLevel(drag_level0 - (int32_t)dy * 4095 / myScope.waveHeight());
+            } else {
+                myScope.moveTriggerPosition(drag_pos0 + dx);
+            }
+            return true;
+        }
+
+        case TOUCH_RELEASE:
+            if (drag_axis == DRAG_NONE) return false;
+            drag_axis = DRAG_NONE;
+            return true;
+    }
+    return false;
+}
+
+// --- Drag gestures on the LA waveform area ---
+// Horizontal drag pans the view, vertical drag zooms around the sample first touched (up
+// zooms in, x2 per LA_ZOOM_DRAG_PX). Same axis lock as the scope; a finished capture is
+// redrawn as the view changes, a running one picks the view up when it is displayed.
+// A press on a time cursor drags that cursor instead; only its columns are repainted.
+static uint32_t drag_first0, drag_span0, drag_anchor;
+static int drag_steps;
+static uint8_t drag_cursor;
+
+static bool near_cursor(uint8_t which, int16_t x) {
+    int16_t cx = myLogicAnalyzer.cursor_x(which);
+    return cx >= 0 && x >= cx - LA_CURSOR_GRAB_PX && x <= cx + LA_CURSOR_GRAB_PX;
 }
 
-void process_touch(int16_t tx, int16_t ty) {
-    // Debounce: A simple way is to wait for touch release after processing one touch.
-    // More advanced debouncing might be needed. For now, action on press.
+static bool handle_la_drag(const TouchEvent& ev) {
+    switch (ev.type) {
+        case TOUCH_PRESS:
+            if (!myLogicAnalyzer.in_wave_area(ev.x, ev.y)) return false;
+            if (myLogicAnalyzer.is_capture_done() && (near_cursor(0, ev.x) || near_cursor(1, ev.x))) {
+                drag_axis = DRAG_CURSOR;
+                drag_cursor = near_cursor(0, ev.x) ? 0 : 1;
+                return true;
+            }
+            drag_axis = DRAG_UNDECIDED;
+            drag_x0 = ev.x;
+            drag_y0 = ev.y;
+            drag_first0 = myLogicAnalyzer.view_first();
+            drag_span0 = myLogicAnalyzer.view_span();
+            drag_anchor = myLogicAnalyzer.sample_at(ev.x);
+            drag_steps = 0;
+            return true;
 
-    if (current_mode == MODE_MENU) {
-        if (is_touch_in_rect(tx, ty, BTN_MENU_SCOPE_X, BTN_MENU_SCOPE_Y, BTN_MENU_SCOPE_W, BTN_MENU_SCOPE_H)) {
-            current_mode = MODE_OSCILLOSCOPE;
-            // myScope.begin(); // Start() is now separate from begin(), begin() is for one-time init
+        case TOUCH_MOVE: {
+            if (drag_axis == DRAG_NONE) return false;
+            if (drag_axis == DRAG_CURSOR) {
+                myLogicAnalyzer.set_cursor(drag_cursor, myLogicAnalyzer.sample_at(ev.x));
+                draw_logic_analyzer_ui(&myLogicAnalyzer); // Readout fields only
+                return true;
+            }
+            int16_t dx = ev.x - drag_x0;
+            int16_t dy = ev.y - drag_y0;
+            if (drag_axis == DRAG_UNDECIDED) {
+                int16_t adx = (dx < 0) ? -dx : dx;
+                int16_t ady = (dy < 0) ? -dy : dy;
+                if (adx < DRAG_LOCK_PX && ady < DRAG_LOCK_PX) return true;
+                drag_axis = (ady > adx) ? DRAG_LEVEL : DRAG_POSITION;
+            }
+            if (drag_axis == DRAG_LEVEL) { // Vertical: zoom
+                int steps = -dy / LA_ZOOM_DRAG_PX;
+                if (steps == drag_steps) return true;
+                drag_steps = steps;
+                myLogicAnalyzer.set_view(drag_first0, drag_span0);
+                myLogicAnalyzer.zoom(steps, drag_anchor);
+            } else { // Horizontal: pan, the content follows the finger
+                int64_t first = (int64_t)drag_first0 - (int64_t)dx * drag_span0 / myLogicAnalyzer.view_columns();
+                myLogicAnalyzer.set_view(first < 0 ? 0 : (uint32_t)first, drag_span0);
+            }
+            myLogicAnalyzer.display(); // Nothing to draw while capturing
+            return true;
+        }
+
+        case TOUCH_RELEASE:
+            if (drag_axis == DRAG_NONE) return false;
+            drag_axis = DRAG_NONE;
+            return true;
+    }
+    return false;
+}
+
+// --- Actions shared with remote commands ---
+static uint32_t la_rate = LA_DEFAULT_RATE_HZ;
+
+void set_la_rate_hz(uint32_t hz) {
+    if (hz) la_rate = hz;
+}
+
+uint32_t la_rate_hz() {
+    return la_rate;
+}
+
+void ui_enter_mode(OperatingMode mode) {
+    // What runs in the mode being left stops with it
+    if (current_mode == MODE_OSCILLOSCOPE && mode != MODE_OSCILLOSCOPE) myScope.stop();
+    if (current_mode == MODE_LOGIC_ANALYZER && mode != MODE_LOGIC_ANALYZER) myLogicAnalyzer.stop();
+    current_mode = mode;
+    switch (mode) {
+        case MODE_OSCILLOSCOPE:
+            tft.fillScreen(SCOPE_BG_COLOR); // Status/button bars are outside the waveform area
             myScope.start();    // Ensure ADC is running
-            myScope.drawGrid(); // Redraw scope background (clears screen too)
+            myScope.drawGrid(); // Draw scope background
             draw_oscilloscope_ui(&myScope); // Draw specific UI
-        } else if (is_touch_in_rect(tx, ty, BTN_MENU_LA_X, BTN_MENU_LA_Y, BTN_MENU_LA_W, BTN_MENU_LA_H)) {
-            current_mode = MODE_LOGIC_ANALYZER;
-            // For LA, draw_grid is part of its display() method usually.
-            // We need an initial screen setup.
-            // myLogicAnalyzer.draw_grid_background(); // A new method perhaps, or ensure display() can draw empty grid.
-            // For now, let draw_logic_analyzer_ui handle the initial clear & button draw.
+            break;
+
+        case MODE_LOGIC_ANALYZER:
             // The LA will be in idle state initially.
             tft.fillScreen(LA_BG_COLOR); // Clear screen for LA mode
             myLogicAnalyzer.draw_grid_static(); // A method to draw just the static grid lines and channel names
+            myLogicAnalyzer.invalidate_frame();
+            myLogicAnalyzer.display(); // The last capture, if there is one
             draw_logic_analyzer_ui(&myLogicAnalyzer);
-        }
-    } else if (current_mode == MODE_OSCILLOSCOPE) {
-        if (is_touch_in_rect(tx, ty, BTN_SCOPE_MENU_X, BTN_SCOPE_MENU_Y, BTN_SCOPE_MENU_W, BTN_SCOPE_MENU_H)) {
-            myScope.stop(); // Stop ADC when leaving scope mode
+            break;
+
+        case MODE_CALIBRATE:
+            ui_screen_enter(UI_SCREEN_NONE); // No widgets on the crosshair screen
+            touch_cal_begin();
+            break;
+
+        default:
+            draw_main_menu();
+            break;
+    }
+}
+
+void la_arm() {
+    // Arm (re)starts a capture, discarding any previous result. While one is
+    // running it cancels it instead: a trigger condition may never occur.
+    if (!myLogicAnalyzer.is_capturing()) {
+        if (current_mode == MODE_LOGIC_ANALYZER) myLogicAnalyzer.draw_grid_static(); // Redraw background grid
+        myLogicAnalyzer.begin(la_rate);
+    } else {
+        myLogicAnalyzer.stop();
+    }
+}
+
+void process_touch(const TouchEvent& ev) {
+    // The calibration flow gets every event (in raw coordinates) until it is done
+    if (current_mode == MODE_CALIBRATE) {
+        if (touch_cal_handle(ev)) {
             current_mode = MODE_MENU;
             draw_main_menu();
-        } else if (is_touch_in_rect(tx, ty, BTN_SCOPE_RUNSTOP_X, BTN_SCOPE_RUNSTOP_Y, BTN_SCOPE_RUNSTOP_W, BTN_SCOPE_RUNSTOP_H)) {
+        }
+        return;
+    }
+
+    if (current_mode == MODE_OSCILLOSCOPE && handle_scope_drag(ev)) return;
+    if (current_mode == MODE_LOGIC_ANALYZER && handle_la_drag(ev)) return;
+
+    // Debouncing happens in the touch_input state machine. Buttons act on press.
+    if (ev.type != TOUCH_PRESS) return;
+
+    // A tap on an LA channel name selects the channel whose measurements are shown
+    if (current_mode == MODE_LOGIC_ANALYZER) {
+        int8_t ch = myLogicAnalyzer.channel_at(ev.x, ev.y);
+        if (ch >= 0) {
+            myLogicAnalyzer.set_measure_channel((uint8_t)ch);
+            draw_logic_analyzer_ui(&myLogicAnalyzer);
+            return;
+        }
+    }
+
+    // Buttons are hit-tested against the same widget table they are drawn from
+    switch (ui_hit_test(ev.x, ev.y)) {
+        // --- Main menu ---
+        case UI_ID_MENU_SCOPE:
+            ui_enter_mode(MODE_OSCILLOSCOPE);
+            break;
+
+        case UI_ID_MENU_LA:
+            ui_enter_mode(MODE_LOGIC_ANALYZER);
+            break;
+
+        case UI_ID_MENU_CAL:
+            ui_enter_mode(MODE_CALIBRATE);
+            break;
+
+        // --- Oscilloscope ---
+        case UI_ID_SCOPE_MENU:
+            ui_enter_mode(MODE_MENU); // Stops the ADC
+            break;
+
+        case UI_ID_SCOPE_RUNSTOP:
             if (myScope.is_running()) {
                 myScope.stop();
             } else {
                 myScope.start();
             }
-            draw_oscilloscope_ui(&myScope); // Redraw to update button label and status
-        } else if (is_touch_in_rect(tx, ty, BTN_SCOPE_TRIGEDGE_X, BTN_SCOPE_TRIGEDGE_Y, BTN_SCOPE_TRIGEDGE_W, BTN_SCOPE_TRIGEDGE_H)) {
+            draw_oscilloscope_ui(&myScope); // Only the button label and status field change
+            break;
+
+        case UI_ID_SCOPE_TRIGEDGE: {
             Oscilloscope::TriggerEdge current_edge = myScope.getTriggerEdge();
             Oscilloscope::TriggerEdge next_edge = (current_edge == Oscilloscope::RISING) ? Oscilloscope::FALLING : Oscilloscope::RISING;
             myScope.setTrigger(myScope.getTriggerLevel(), next_edge); // Level remains same, edge changes
-            draw_oscilloscope_ui(&myScope); // Redraw to update button label
+            draw_oscilloscope_ui(&myScope); // Only the edge button changes
+            break;
         }
-        // Add more buttons here: Trigger Level Up/Down etc.
-        // Example:
-        // else if (is_touch_in_rect(tx, ty, BTN_SCOPE_TRIG_LVL_UP_X, ...)) {
-        //    myScope.setTrigger(myScope.getTriggerLevel() + 100, myScope.getTriggerEdge());
-        //    draw_oscilloscope_ui(&myScope);
-        // }
-
-    } else if (current_mode == MODE_LOGIC_ANALYZER) {
-        if (is_touch_in_rect(tx, ty, BTN_LA_MENU_X, BTN_LA_MENU_Y, BTN_LA_MENU_W, BTN_LA_MENU_H)) {
-            myLogicAnalyzer.stop(); // Stop LA timer when leaving mode
-            current_mode = MODE_MENU;
-            draw_main_menu();
-        } else if (is_touch_in_rect(tx, ty, BTN_LA_ARM_X, BTN_LA_ARM_Y, BTN_LA_ARM_W, BTN_LA_ARM_H)) {
-            // Only arm if not already capturing and not pending display from a finished capture
-            if (!myLogicAnalyzer.is_capturing() && !myLogicAnalyzer.is_display_pending()) {
-                // Before starting a new capture, clear the old waveform area by drawing the grid
-                // This assumes draw_grid_static clears the waveform portion.
-                myLogicAnalyzer.draw_grid_static(); // Redraw background grid
-                myLogicAnalyzer.begin(1000000); // Start 1MHz capture (or last used frequency)
-            } else if (myLogicAnalyzer.is_capture_done() && myLogicAnalyzer.is_display_pending()){
-                // If capture is done and pending display, this button could act as "show results"
-                // or "clear display and re-arm". Current logic in main loop handles display.
-                // This button press could clear the "display pending" state to allow re-arming.
-                myLogicAnalyzer.acknowledge_display_done_btn_press(); // New function to allow re-arm via button
+        // Add more buttons here: add a widget to the scope table in ui_widgets.cpp and a case here.
+
+        // --- Logic Analyzer ---
+        case UI_ID_LA_MENU:
+            ui_enter_mode(MODE_MENU); // Stops the LA timer
+            break;
+
+        case UI_ID_LA_ARM:
+            la_arm();
+            draw_logic_analyzer_ui(&myLogicAnalyzer); // Update button label and status
+            break;
+
+        case UI_ID_LA_MODE:
+            // Every sample (deep, fixed time), the same with PB0 on ADC1 alongside (mixed
+            // signal, when wired), transitions only (long, sparse signals), timer
+            // timestamps of each edge (PB6/PB8 only, 13.9 ns resolution) or one sample per
+            // edge of the target's clock on PA12
+            if (!myLogicAnalyzer.is_capturing()) {
+                LogicAnalyzer::LA_CaptureMode mode = myLogicAnalyzer.capture_mode();
+                if (mode == LogicAnalyzer::LA_MODE_SAMPLES && !myLogicAnalyzer.mixed_enabled() &&
+                    myLogicAnalyzer.mixed_available()) {
+                    myLogicAnalyzer.set_mixed_signal(true);
+                    draw_logic_analyzer_ui(&myLogicAnalyzer);
+                    break;
+                }
+                myLogicAnalyzer.set_capture_mode(mode == LogicAnalyzer::LA_MODE_SAMPLES ? LogicAnalyzer::LA_MODE_TRANSITIONS
+                                                 : mode == LogicAnalyzer::LA_MODE_TRANSITIONS ? LogicAnalyzer::LA_MODE_EDGES
+                                                 : mode == LogicAnalyzer::LA_MODE_EDGES ? LogicAnalyzer::LA_MODE_STATE
+                                                 : LogicAnalyzer::LA_MODE_SAMPLES);
             }
-            draw_logic_analyzer_ui(&myLogicAnalyzer); // Redraw to update button label and status
-        }
+            draw_logic_analyzer_ui(&myLogicAnalyzer);
+            break;
+
+        case UI_ID_LA_LIVE:
+            // Repeat captures until Live is pressed again (the one running then still
+            // completes), or Arm stops the one in progress
+            myLogicAnalyzer.set_live(!myLogicAnalyzer.is_live());
+            if (myLogicAnalyzer.is_live() && !myLogicAnalyzer.is_capturing()) {
+                myLogicAnalyzer.draw_grid_static();
+                myLogicAnalyzer.begin(la_rate);
+            }
+            draw_logic_analyzer_ui(&myLogicAnalyzer);
+            break;
+
+        default:
+            break; // Touch outside any button of the current screen
     }
 }
@@ -5,12 +5,21 @@
 #include "Scope.h"         // For myScope
 #include "LogicAnalyzer.h" // For myLogicAnalyzer
 #include "ui_draw.h"       // For draw_... functions
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // For ILI9341_Display
+#include "touch_input.h"   // For TouchEvent
 
 // Forward declarations of global objects (defined in main.cpp)
 extern Oscilloscope myScope;
 extern LogicAnalyzer myLogicAnalyzer;
-extern Adafruit_ILI9341 tft; // For direct tft operations if needed by UI updates
+extern ILI9341_Display tft;  // For direct tft operations if needed by UI updates
 
-void process_touch(int16_t tx, int16_t ty); // Use int16_t for coordinates
+void process_touch(const TouchEvent& ev); // Consumes events from touch_input_pop()
+
+// Actions of the buttons, shared with remote commands (ScpiServer)
+#define LA_DEFAULT_RATE_HZ 1000000
+void ui_enter_mode(OperatingMode mode); // Screen of a mode; what ran in the old one stops
+void la_arm();                          // Start a capture at la_rate_hz(), or cancel the running one
+void set_la_rate_hz(uint32_t hz);       // Rate of the captures Arm and Live start
+uint32_t la_rate_hz();
 
 #endif // TOUCH_HANDLER_H
@@ -0,0 +1,131 @@
+#include "touch_input.h"
+#include "stm32f1xx_hal.h" // For HAL_GetTick, EXTI
+
+enum TouchState {
+    TS_IDLE,     // Waiting for PENIRQ
+    TS_DEBOUNCE, // PENIRQ seen, waiting for it to settle
+    TS_DOWN      // Press reported, tracking moves until release
+};
+
+static XPT2046_Touchscreen* _ts = nullptr;
+static volatile uint8_t state = TS_IDLE;
+static uint32_t state_since = 0; // Tick at which the current debounce/release wait started
+static bool release_pending = false;
+static bool sampling = false;    // A filtered sample burst is in progress
+static TS_Point last_point;
+
+static TouchEvent events[TOUCH_EVENT_QUEUE_LEN];
+static uint8_t ev_head = 0;
+static uint8_t ev_tail = 0;
+static uint32_t ev_dropped = 0;
+
+static void push_event(uint8_t type, const TS_Point& p) {
+    if ((uint8_t)(ev_tail - ev_head) >= TOUCH_EVENT_QUEUE_LEN) {
+        ev_dropped++;
+        return;
+    }
+    TouchEvent& ev = events[ev_tail & (TOUCH_EVENT_QUEUE_LEN - 1)];
+    ev.type = type;
+    ev.x = p.x;
+    ev.y = p.y;
+    ev.z = p.z;
+    ev_tail++;
+}
+
+// One axis burst of the driver's filtered sample. Returns true when the point is
+// complete. PENIRQ toggles while the XPT2046 converts, so its EXTI line is masked for
+// the duration and the edges it produced are discarded.
+static bool sample_step() {
+    if (!sampling) {
+        _ts->startSample();
+        sampling = true;
+    }
+    EXTI->IMR &= ~XPT2046_IRQ_PIN;
+    bool done = _ts->sampleStep();
+    __HAL_GPIO_EXTI_CLEAR_IT(XPT2046_IRQ_PIN);
+    EXTI->IMR |= XPT2046_IRQ_PIN;
+    if (done) sampling = false;
+    return done;
+}
+
+static bool moved(const TS_Point& a, const TS_Point& b) {
+    int16_t dx = a.x - b.x;
+    int16_t dy = a.y - b.y;
+    if (dx < 0) dx = -dx;
+    if (dy < 0) dy = -dy;
+    return dx >= TOUCH_MOVE_THRESHOLD || dy >= TOUCH_MOVE_THRESHOLD;
+}
+
+void touch_input_init(XPT2046_Touchscreen* ts_handle) {
+    _ts = ts_handle;
+    state = TS_IDLE;
+    ev_head = ev_tail = 0;
+}
+
+bool touch_input_step() {
+    if (!_ts) return false;
+    uint32_t now = HAL_GetTick();
+    bool pen = _ts->touched(); // PENIRQ level, no conversion
+    if (!pen) sampling = false; // Abandon a burst the pen lifted out of
+
+    switch (state) {
+        case TS_IDLE:
+            if (pen) {
+                state = TS_DEBOUNCE;
+                state_since = now;
+            }
+            break;
+
+        case TS_DEBOUNCE: {
+            if (!pen) { state = TS_IDLE; break; } // Glitch
+            if (now - state_since < TOUCH_DEBOUNCE_MS) break;
+            if (!sample_step()) return true;
+            TS_Point p = _ts->sampledPoint();
+            if (p.z == 0) break; // Too light or unstable, keep waiting
+            last_point = p;
+            release_pending = false;
+            push_event(TOUCH_PRESS, p);
+            state = TS_DOWN;
+            break;
+        }
+
+        case TS_DOWN:
+            if (pen) {
+                if (!sample_step()) return true;
+                TS_Point p = _ts->sampledPoint();
+                if (p.z != 0) {
+                    release_pending = false;
+                    if (moved(p, last_point)) {
+                        last_point = p;
+                        push_event(TOUCH_MOVE, p);
+                    }
+                    break;
+                }
+            }
+            // Pen up (or too light): report the release once it has stayed up
+            if (!release_pending) {
+                release_pending = true;
+                state_since = now;
+            } else if (now - state_since >= TOUCH_RELEASE_MS) {
+                push_event(TOUCH_RELEASE, last_point);
+                state = TS_IDLE;
+            }
+            break;
+    }
+    return false;
+}
+
+bool touch_input_active() {
+    return state != TS_IDLE;
+}
+
+bool touch_input_pop(TouchEvent* ev) {
+    if (ev_head == ev_tail) return false;
+    *ev = events[ev_head & (TOUCH_EVENT_QUEUE_LEN - 1)];
+    ev_head++;
+    return true;
+}
+
+uint32_t touch_input_dropped() {
+    return ev_dropped;
+}
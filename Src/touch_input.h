@@ -0,0 +1,39 @@
+#ifndef TOUCH_INPUT_H
+#define TOUCH_INPUT_H
+
+#include <stdint.h>
+#include "Middlewares/XPT2046/XPT2046_Touchscreen.h"
+
+// Touch state machine timing
+#define TOUCH_SAMPLE_PERIOD_MS  8   // Point rate while the pen is down (125 Hz, drags stay smooth)
+#define TOUCH_DEBOUNCE_MS       20  // PENIRQ must stay low this long before a press is reported
+#define TOUCH_RELEASE_MS        30  // Pen must stay up this long before a release is reported
+#define TOUCH_MOVE_THRESHOLD    3   // Minimum displacement (px) for a MOVE event
+#define TOUCH_EVENT_QUEUE_LEN   8   // Power of two
+
+enum TouchEventType {
+    TOUCH_PRESS,
+    TOUCH_MOVE,
+    TOUCH_RELEASE
+};
+
+struct TouchEvent {
+    uint8_t type;   // TouchEventType
+    int16_t x, y;   // Screen coordinates (raw until a calibration is set on the driver)
+    int16_t z;      // Pressure of the sample
+};
+
+// PENIRQ (PA8, EXTI falling edge) wakes the state machine; while the pen is down it
+// takes a filtered point every TOUCH_SAMPLE_PERIOD_MS. A point is read one axis burst
+// per step, so the scope keeps triggering and drawing in between.
+void touch_input_init(XPT2046_Touchscreen* ts_handle);
+// Advance the state machine (call on every touch event). Returns true while a sample
+// burst is in progress and the caller should step again as soon as possible.
+bool touch_input_step();
+bool touch_input_active(); // True while a touch is in progress and periodic steps are needed
+
+// Events produced by touch_input_step(), oldest first
+bool touch_input_pop(TouchEvent* ev);
+uint32_t touch_input_dropped(); // Events lost because the consumer fell behind
+
+#endif // TOUCH_INPUT_H
@@ -7,7 +7,8 @@
 enum OperatingMode {
     MODE_MENU,
     MODE_OSCILLOSCOPE,
-    MODE_LOGIC_ANALYZER
+    MODE_LOGIC_ANALYZER,
+    MODE_CALIBRATE      // Touch calibration crosshairs
 };
 
 // Global current mode variable (defined in main.cpp)
@@ -31,6 +32,13 @@ extern OperatingMode current_mode;
 #define SCREEN_WIDTH_HW  240 // Hardware screen width (e.g. ILI9341 portrait)
 #define SCREEN_HEIGHT_HW 320 // Hardware screen height
 
+// Screen bands shared by all modes: status text on top, buttons at the bottom.
+// Waveform areas live strictly in between so they never overdraw the widgets.
+#define UI_STATUS_BAR_H   (BTN_PADDING + 10)
+#define UI_BUTTON_BAR_Y   (SCREEN_HEIGHT_HW - BTN_HEIGHT - BTN_PADDING * 2)
+#define UI_WAVE_AREA_Y    UI_STATUS_BAR_H
+#define UI_WAVE_AREA_H    (UI_BUTTON_BAR_Y - UI_STATUS_BAR_H)
+
 // --- Main Menu Button Coordinates ---
 // (Assuming a 240x320 portrait screen)
 #define BTN_MENU_CENTER_X (SCREEN_WIDTH_HW / 2)
@@ -45,6 +53,17 @@ extern OperatingMode current_mode;
 #define BTN_MENU_LA_W     BTN_WIDTH
 #define BTN_MENU_LA_H     BTN_HEIGHT
 
+#define BTN_MENU_CAL_X    (BTN_MENU_CENTER_X - BTN_WIDTH / 2)
+#define BTN_MENU_CAL_Y    (BTN_MENU_LA_Y + BTN_HEIGHT + BTN_PADDING)
+#define BTN_MENU_CAL_W    BTN_WIDTH
+#define BTN_MENU_CAL_H    BTN_HEIGHT
+
+// Title (text size 2: 12x16 px per character)
+#define MENU_TITLE_X      (BTN_MENU_CENTER_X - 50)
+#define MENU_TITLE_Y      (BTN_MENU_SCOPE_Y - 40)
+#define MENU_TITLE_W      (9 * 12)
+#define MENU_TITLE_H      16
+
 // --- Oscilloscope UI Button Coordinates ---
 // (Bottom row buttons)
 #define SCOPE_BTN_Y       (SCREEN_HEIGHT_HW - BTN_HEIGHT - BTN_PADDING)
@@ -66,13 +85,26 @@ extern OperatingMode current_mode;
 #define BTN_SCOPE_TRIGEDGE_W SCOPE_BTN_WIDTH
 #define BTN_SCOPE_TRIGEDGE_H SCOPE_BTN_HEIGHT
 
-// Status text area for Scope
+// Status text area for Scope: run state and trigger level, then trigger position.
+// Separate fields so a drag only repaints the one it changes.
 #define SCOPE_STATUS_X    BTN_PADDING
 #define SCOPE_STATUS_Y    BTN_PADDING // Top of screen
+#define SCOPE_STATUS_W    (26 * 6)    // "Scope: Stopped | Lvl: 4095"
+#define SCOPE_STATUS_H    8 // One line of size-1 text
+
+#define SCOPE_TRIGPOS_X   (SCOPE_STATUS_X + SCOPE_STATUS_W + 6)
+#define SCOPE_TRIGPOS_Y   SCOPE_STATUS_Y
+#define SCOPE_TRIGPOS_W   (8 * 6)     // "Pos: 229"
+#define SCOPE_TRIGPOS_H   8
+
+// Drag gestures on the scope waveform area
+#define DRAG_LOCK_PX      6 // Movement before a drag commits to vertical (level) or horizontal (position)
+#define LA_ZOOM_DRAG_PX   20 // Vertical drag per x2 zoom step on the LA waveform area
+#define LA_CURSOR_GRAB_PX 6  // A press this close to an LA time cursor drags the cursor
 
 // --- Logic Analyzer UI Button Coordinates ---
 #define LA_BTN_Y          (SCREEN_HEIGHT_HW - BTN_HEIGHT - BTN_PADDING)
-#define LA_BTN_WIDTH      100
+#define LA_BTN_WIDTH      ((SCREEN_WIDTH_HW - 5 * BTN_PADDING) / 4) // Four buttons across (7 characters each)
 
 #define BTN_LA_MENU_X     (BTN_PADDING)
 #define BTN_LA_MENU_Y     LA_BTN_Y
@@ -84,8 +116,28 @@ extern OperatingMode current_mode;
 #define BTN_LA_ARM_W      LA_BTN_WIDTH
 #define BTN_LA_ARM_H      BTN_HEIGHT
 
+#define BTN_LA_MODE_X     (BTN_LA_ARM_X + LA_BTN_WIDTH + BTN_PADDING)
+#define BTN_LA_MODE_Y     LA_BTN_Y
+#define BTN_LA_MODE_W     LA_BTN_WIDTH
+#define BTN_LA_MODE_H     BTN_HEIGHT
+
+#define BTN_LA_LIVE_X     (BTN_LA_MODE_X + LA_BTN_WIDTH + BTN_PADDING)
+#define BTN_LA_LIVE_Y     LA_BTN_Y
+#define BTN_LA_LIVE_W     LA_BTN_WIDTH
+#define BTN_LA_LIVE_H     BTN_HEIGHT
+
+// Cursor and measurement readouts: three text lines between the LA waveform area and the buttons
+#define LA_READOUT_LINES  3
+#define LA_WAVE_AREA_H    (UI_WAVE_AREA_H - LA_READOUT_LINES * 10)
+#define LA_READOUT_X      BTN_PADDING
+#define LA_READOUT_Y      (UI_WAVE_AREA_Y + LA_WAVE_AREA_H + 2)
+#define LA_READOUT_W      (SCREEN_WIDTH_HW - 2 * BTN_PADDING)
+#define LA_READOUT_H      8
+
 // Status text area for LA
 #define LA_STATUS_X       BTN_PADDING
 #define LA_STATUS_Y       BTN_PADDING // Top of screen (adjust if LA grid starts high)
+#define LA_STATUS_W       (SCREEN_WIDTH_HW - 2 * BTN_PADDING)
+#define LA_STATUS_H       8
 
 #endif // UI_CONFIG_H
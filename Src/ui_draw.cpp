@@ -1,12 +1,16 @@
 #include "ui_draw.h"
 #include "ui_config.h" // For constants
-#include <stdio.h> // For sprintf
+#include "ui_widgets.h" // Retained widgets: only changed labels/fields are repainted
+#include "ui_text.h"    // Glyph-cache text engine and printf-free formatting
+#include "capture_arena.h" // Guard faults of the LA capture memory
 
 // Global static pointer to the TFT object
-static Adafruit_ILI9341* _tft = nullptr;
+static ILI9341_Display* _tft = nullptr;
 
-void init_ui(Adafruit_ILI9341* tft_handle) {
+void init_ui(ILI9341_Display* tft_handle) {
     _tft = tft_handle;
+    ui_text_init(tft_handle);
+    ui_widgets_init(tft_handle);
 }
 
 void draw_button(int16_t x, int16_t y, int16_t w, int16_t h, const char* label, bool inverted) {
@@ -18,51 +22,31 @@ void draw_button(int16_t x, int16_t y, int16_t w, int16_t h, const char* label,
     _tft->fillRect(x, y, w, h, bg_color);
     _tft->drawRect(x, y, w, h, UI_BUTTON_TEXT_COLOR); // Border
 
-    _tft->setTextColor(text_color);
-    _tft->setTextSize(1); // Adjust size as needed
-    
-    // Calculate text position to center it
-    int16_t text_x, text_y;
-    uint16_t text_w, text_h;
-    _tft->getTextBounds(label, 0, 0, &text_x, &text_y, &text_w, &text_h);
-    text_x = x + (w - text_w) / 2;
-    text_y = y + (h - text_h) / 2;
-    
-    _tft->setCursor(text_x, text_y);
-    _tft->print(label);
+    // Calculate text position to center it (fixed 6x8 cells, size 1)
+    int16_t text_w = ui_text_width(label, 1);
+    int16_t text_x = x + (w - text_w) / 2;
+    int16_t text_y = y + (h - UI_TEXT_GLYPH_H) / 2;
+
+    ui_text_draw(text_x, text_y, label, 1, text_color, bg_color);
 }
 
 void draw_main_menu() {
     if (!_tft) return;
 
     _tft->fillScreen(UI_BG_COLOR);
-    _tft->setCursor(BTN_MENU_CENTER_X - 50, BTN_MENU_SCOPE_Y - 40); // Adjust position
-    _tft->setTextColor(UI_TEXT_COLOR);
-    _tft->setTextSize(2);
-    _tft->println("Main Menu");
-
-    draw_button(BTN_MENU_SCOPE_X, BTN_MENU_SCOPE_Y, BTN_MENU_SCOPE_W, BTN_MENU_SCOPE_H, "Oscilloscope", false);
-    draw_button(BTN_MENU_LA_X, BTN_MENU_LA_Y, BTN_MENU_LA_W, BTN_MENU_LA_H, "Logic Analyzer", false);
+    ui_screen_enter(UI_SCREEN_MENU);
+    ui_invalidate(); // Screen was just cleared, even if we were already on the menu
+    ui_render();
 }
 
 void draw_oscilloscope_ui(Oscilloscope* scope) {
     if (!_tft || !scope) return;
 
-    // No full screen clear here, assume scope.drawGrid() handles the waveform area.
-    // Clear only the button area if necessary, or rely on buttons overwriting.
-    // For simplicity, we'll redraw all UI elements.
-    // A more optimized version might only update changed elements.
-
-    // Clear bottom button bar area
-    _tft->fillRect(0, SCREEN_HEIGHT_HW - BTN_HEIGHT - BTN_PADDING * 2, SCREEN_WIDTH_HW, BTN_HEIGHT + BTN_PADDING * 2, UI_BG_COLOR);
-    // Clear top status bar area
-    _tft->fillRect(0, 0, SCREEN_WIDTH_HW, BTN_PADDING + 10, UI_BG_COLOR);
+    // The waveform area sits between the status and button bars, so nothing here is
+    // ever overdrawn by the scope. Widgets only repaint when their content changes.
+    ui_screen_enter(UI_SCREEN_SCOPE);
 
-
-    draw_button(BTN_SCOPE_MENU_X, BTN_SCOPE_MENU_Y, BTN_SCOPE_MENU_W, BTN_SCOPE_MENU_H, "Menu", false);
-    
-    const char* run_stop_label = scope->is_running() ? "Stop" : "Run";
-    draw_button(BTN_SCOPE_RUNSTOP_X, BTN_SCOPE_RUNSTOP_Y, BTN_SCOPE_RUNSTOP_W, BTN_SCOPE_RUNSTOP_H, run_stop_label, false);
+    ui_set_text(UI_ID_SCOPE_RUNSTOP, scope->is_running() ? "Stop" : "Run");
 
     const char* edge_label;
     switch (scope->getTriggerEdge()) {
@@ -70,46 +54,147 @@ void draw_oscilloscope_ui(Oscilloscope* scope) {
         case Oscilloscope::FALLING: edge_label = "Falling"; break;
         default: edge_label = "N/A"; break;
     }
-    draw_button(BTN_SCOPE_TRIGEDGE_X, BTN_SCOPE_TRIGEDGE_Y, BTN_SCOPE_TRIGEDGE_W, BTN_SCOPE_TRIGEDGE_H, edge_label, false);
+    ui_set_text(UI_ID_SCOPE_TRIGEDGE, edge_label);
 
     // Display Status
-    _tft->setCursor(SCOPE_STATUS_X, SCOPE_STATUS_Y);
-    _tft->setTextColor(UI_TEXT_COLOR);
-    _tft->setTextSize(1);
-    char status_buf[50];
-    sprintf(status_buf, "Scope: %s | Trig Lvl: %d",
-            scope->is_running() ? "Running" : "Stopped",
-            scope->getTriggerLevel());
-    _tft->print(status_buf);
+    // "Scope: Running | Lvl: 2048" and "Pos: 57" without pulling in printf
+    char status_buf[UI_WIDGET_TEXT_MAX];
+    char* p = ui_fmt_str(status_buf, "Scope: ");
+    p = ui_fmt_str(p, scope->is_running() ? "Running" : "Stopped");
+    p = ui_fmt_str(p, " | Lvl: ");
+    ui_fmt_int(p, scope->getTriggerLevel());
+    ui_set_text(UI_ID_SCOPE_STATUS, status_buf);
+
+    ui_fmt_int(ui_fmt_str(status_buf, "Pos: "), scope->getTriggerPosition());
+    ui_set_text(UI_ID_SCOPE_TRIGPOS, status_buf);
+
+    ui_render();
+}
+
+// Time with three decimals in the largest unit that keeps it >= 1 ("12.345us")
+static char* fmt_time(char* out, uint64_t ns) {
+    if (ns < 1000) return ui_fmt_str(ui_fmt_uint(out, (uint32_t)ns), "ns");
+    if (ns < 1000000ULL) return ui_fmt_str(ui_fmt_fixed(out, (int32_t)ns, 3), "us");
+    if (ns < 1000000000ULL) return ui_fmt_str(ui_fmt_fixed(out, (int32_t)(ns / 1000), 3), "ms");
+    uint64_t us = ns / 1000000;
+    return ui_fmt_str(ui_fmt_fixed(out, (int32_t)(us > 0x7FFFFFFF ? 0x7FFFFFFF : us), 3), "s");
+}
+
+// Frequency from millihertz, same style ("81.030kHz")
+static char* fmt_freq(char* out, uint64_t mhz) {
+    if (mhz < 1000000ULL) return ui_fmt_str(ui_fmt_fixed(out, (int32_t)mhz, 3), "Hz");
+    if (mhz < 1000000000ULL) return ui_fmt_str(ui_fmt_fixed(out, (int32_t)(mhz / 1000), 3), "kHz");
+    return ui_fmt_str(ui_fmt_fixed(out, (int32_t)(mhz / 1000000), 3), "MHz");
+}
+
+// Cursor and measurement lines below the waveforms (empty until a capture is shown)
+static void draw_la_readouts(LogicAnalyzer* la) {
+    char buf[UI_WIDGET_TEXT_MAX];
+    if (!la->is_capture_done()) {
+        ui_set_text(UI_ID_LA_CURSORS, "");
+        ui_set_text(UI_ID_LA_MEASURE, "");
+        ui_set_text(UI_ID_LA_PULSES, "");
+        return;
+    }
+    uint32_t hz = la->capture_stats().timer_hz;
+
+    uint32_t a = la->cursor(0), b = la->cursor(1);
+    uint32_t dt = (a > b) ? a - b : b - a;
+    char* p = ui_fmt_str(buf, "A-B ");
+    if (hz == 0) {
+        ui_fmt_str(ui_fmt_uint(p, dt), " samples");
+    } else {
+        p = fmt_time(p, la->samples_to_ns(dt));
+        if (dt) fmt_freq(ui_fmt_str(p, "  "), (uint64_t)hz * 1000 / dt);
+    }
+    ui_set_text(UI_ID_LA_CURSORS, buf);
+
+    uint8_t ch = la->measure_channel();
+    const LA_ChannelMeasure& m = la->measure(ch);
+    p = ui_fmt_uint(ui_fmt_str(buf, "CH"), ch);
+    if (m.periods && m.period_span && hz) {
+        p = fmt_freq(ui_fmt_str(p, " "), (uint64_t)hz * 1000 * m.periods / m.period_span);
+        p = ui_fmt_fixed(ui_fmt_str(p, " "), (int32_t)((uint64_t)m.high_in_span * 1000 / m.period_span), 1);
+        p = ui_fmt_str(p, "%");
+    }
+    ui_fmt_str(ui_fmt_uint(ui_fmt_str(p, " "), m.edges), " edges");
+    ui_set_text(UI_ID_LA_MEASURE, buf);
+
+    if (m.max_pulse && hz) {
+        p = fmt_time(ui_fmt_str(buf, "Pulse "), la->samples_to_ns(m.min_pulse));
+        fmt_time(ui_fmt_str(p, " .. "), la->samples_to_ns(m.max_pulse));
+    } else {
+        ui_fmt_str(buf, "Pulse -");
+    }
+    ui_set_text(UI_ID_LA_PULSES, buf);
 }
 
 void draw_logic_analyzer_ui(LogicAnalyzer* la) {
     if (!_tft || !la) return;
 
-    // Clear bottom button bar area
-    _tft->fillRect(0, SCREEN_HEIGHT_HW - BTN_HEIGHT - BTN_PADDING * 2, SCREEN_WIDTH_HW, BTN_HEIGHT + BTN_PADDING * 2, UI_BG_COLOR);
-    // Clear top status bar area
-    _tft->fillRect(0, 0, SCREEN_WIDTH_HW, BTN_PADDING + 10, UI_BG_COLOR);
+    ui_screen_enter(UI_SCREEN_LA);
+
+    bool refused = !la->is_capturing() && la->arm_fault() != LogicAnalyzer::LA_ARM_OK; // Last Arm did not start
+    const char* arm_label = la->is_capturing() ? "Stop" : refused ? "Busy" : (la->is_capture_done() ? "Done" : "Arm");
+    ui_set_text(UI_ID_LA_ARM, arm_label);
+    ui_set_inverted(UI_ID_LA_ARM, la->is_capturing()); // Invert if capturing
+    ui_set_inverted(UI_ID_LA_LIVE, la->is_live());      // ...and while captures repeat
 
-    draw_button(BTN_LA_MENU_X, BTN_LA_MENU_Y, BTN_LA_MENU_W, BTN_LA_MENU_H, "Menu", false);
-    
-    const char* arm_label = la->is_capturing() ? "Capturing" : (la->is_capture_done() ? "Done" : "Arm");
-    draw_button(BTN_LA_ARM_X, BTN_LA_ARM_Y, BTN_LA_ARM_W, BTN_LA_ARM_H, arm_label, la->is_capturing()); // Invert if capturing
+    LogicAnalyzer::LA_CaptureMode mode = la->capture_mode();
+    bool state = (mode == LogicAnalyzer::LA_MODE_STATE);
+    bool transitions = (mode == LogicAnalyzer::LA_MODE_TRANSITIONS || mode == LogicAnalyzer::LA_MODE_EDGES); // Both store records
+    ui_set_text(UI_ID_LA_MODE, mode == LogicAnalyzer::LA_MODE_EDGES ? "Stamps"
+                               : state ? "State" : transitions ? "Changes"
+                               : la->mixed_enabled() ? "Mixed" : "Samples");
 
     // Display Status
-    _tft->setCursor(LA_STATUS_X, LA_STATUS_Y);
-    _tft->setTextColor(UI_TEXT_COLOR);
-    _tft->setTextSize(1);
     const char* status_str;
-    if (la->is_capturing()) {
-        status_str = "LA: Capturing...";
+    char status_buf[UI_WIDGET_TEXT_MAX];
+    if (capture_arena_faults() && !la->is_capturing()) {
+        status_str = "LA: RAM overrun, capture unsafe"; // Stack/heap met the capture memory
+    } else if (refused) { // A DMA channel the mode borrows was in use (LogicAnalyzer.h)
+        status_str = state ? "LA: Host TX holds DMA Ch4, not armed" : "LA: DMA busy (scope/host TX), not armed";
+    } else if (la->is_waiting_for_trigger()) {
+        status_str = "LA: Waiting for trigger...";
+    } else if (la->is_capturing()) {
+        status_str = state ? "LA: Capturing on PA12 clock..." : "LA: Capturing...";
+    } else if (la->is_capture_done() && state) {
+        // Measured clock rate, and how many edges came too fast to be stored
+        const LA_StateStats& ss = la->state_stats();
+        char* p = ui_fmt_fixed(ui_fmt_str(status_buf, "LA: "), ss.clock_hz / 1000, 3);
+        p = ui_fmt_str(p, " MHz clock");
+        if (ss.lost) {
+            p = ui_fmt_uint(ui_fmt_str(p, ", "), ss.lost);
+            ui_fmt_str(p, " lost");
+        }
+        status_str = status_buf;
+    } else if (la->is_capture_done() && transitions) {
+        // Edge count and the size ratio to a raw capture (or how many edges were lost)
+        const LA_TransitionStats& ts = la->transition_stats();
+        char* p = ui_fmt_uint(ui_fmt_str(status_buf, "LA: "), ts.transitions);
+        if (ts.overruns) {
+            p = ui_fmt_uint(ui_fmt_str(p, " edges, "), ts.dropped_transitions);
+            ui_fmt_str(p, " lost");
+        } else {
+            p = ui_fmt_fixed(ui_fmt_str(p, " edges, "), la->compression_x100(), 2);
+            ui_fmt_str(p, "x");
+        }
+        status_str = status_buf;
     } else if (la->is_capture_done()) {
         status_str = "LA: Capture Done. Pending Display.";
         if(!la->is_display_pending()){ // If display has been handled
              status_str = "LA: Capture Done. Press Arm.";
         }
+    } else if (state) {
+        // Fastest clock that state mode keeps up with on this board
+        char* p = ui_fmt_fixed(ui_fmt_str(status_buf, "LA: PA12 clock up to "), la->state_max_hz() / 1000, 3);
+        ui_fmt_str(p, " MHz");
+        status_str = status_buf;
     } else {
         status_str = "LA: Idle. Press Arm.";
     }
-    _tft->print(status_str);
+    ui_set_text(UI_ID_LA_STATUS, status_str);
+    draw_la_readouts(la);
+
+    ui_render();
 }
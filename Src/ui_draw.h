@@ -3,12 +3,13 @@
 
 #include "Middlewares/Adafruit/GFX/Adafruit_GFX.h"
 #include "Middlewares/Adafruit/ILI9341/Adafruit_ILI9341.h"
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // For ILI9341_Display
 #include "ui_config.h" // For color and dimension constants
 #include "Scope.h" // For Oscilloscope status
 #include "LogicAnalyzer.h" // For LogicAnalyzer status
 
 // Initialization
-void init_ui(Adafruit_ILI9341* tft_handle);
+void init_ui(ILI9341_Display* tft_handle);
 
 // Main drawing functions for each mode
 void draw_main_menu();
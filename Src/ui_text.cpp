@@ -0,0 +1,209 @@
+#include "ui_text.h"
+#include <string.h> // For strlen
+
+// Classic 5x7 GFX font (glcdfont.c): 5 column bytes per character, bit 0 = top row
+extern const unsigned char font[];
+
+#define UI_TEXT_NUM_GLYPHS (UI_TEXT_LAST_CHAR - UI_TEXT_FIRST_CHAR + 1)
+
+static ILI9341_Display* _tft = nullptr;
+
+// Row-packed glyph cache: glyph_rows[g][row] has bit n set if column n is lit
+static uint8_t glyph_rows[UI_TEXT_NUM_GLYPHS][UI_TEXT_GLYPH_H];
+
+// Ping-pong RGB565 (big-endian) lines for SPI DMA
+static uint16_t line_buf[2][UI_TEXT_LINE_MAX_PX];
+
+static uint32_t last_cycles = 0;
+static uint32_t max_cycles = 0;
+
+// --- Formatting ---
+char* ui_fmt_str(char* out, const char* s) {
+    while (*s) *out++ = *s++;
+    *out = '\0';
+    return out;
+}
+
+char* ui_fmt_uint(char* out, uint32_t value) {
+    char tmp[10];
+    uint8_t n = 0;
+    do {
+        tmp[n++] = (char)('0' + value % 10);
+        value /= 10;
+    } while (value);
+    while (n) *out++ = tmp[--n];
+    *out = '\0';
+    return out;
+}
+
+char* ui_fmt_int(char* out, int32_t value) {
+    if (value < 0) {
+        *out++ = '-';
+        return ui_fmt_uint(out, (uint32_t)(-(value + 1)) + 1); // Safe for INT32_MIN
+    }
+    return ui_fmt_uint(out, (uint32_t)value);
+}
+
+char* ui_fmt_fixed(char* out, int32_t value, uint8_t decimals) {
+    uint32_t scale = 1;
+    for (uint8_t i = 0; i < decimals; ++i) scale *= 10;
+
+    uint32_t mag;
+    if (value < 0) {
+        *out++ = '-';
+        mag = (uint32_t)(-(value + 1)) + 1;
+    } else {
+        mag = (uint32_t)value;
+    }
+    out = ui_fmt_uint(out, mag / scale);
+    if (decimals == 0) return out;
+
+    *out++ = '.';
+    uint32_t frac = mag % scale;
+    for (uint32_t div = scale / 10; div > 0; div /= 10) { // Keep leading zeros of the fraction
+        *out++ = (char)('0' + (frac / div) % 10);
+    }
+    *out = '\0';
+    return out;
+}
+
+// --- Glyph cache ---
+void ui_text_init(ILI9341_Display* tft_handle) {
+    _tft = tft_handle;
+    for (uint8_t g = 0; g < UI_TEXT_NUM_GLYPHS; ++g) {
+        const unsigned char* cols = &font[(g + UI_TEXT_FIRST_CHAR) * 5];
+        for (uint8_t row = 0; row < UI_TEXT_GLYPH_H; ++row) {
+            uint8_t bits = 0;
+            for (uint8_t col = 0; col < 5; ++col) {
+                if (cols[col] & (1 << row)) bits |= (1 << col);
+            }
+            glyph_rows[g][row] = bits;
+        }
+    }
+}
+
+static inline const uint8_t* glyph_for(char c) {
+    if (c < UI_TEXT_FIRST_CHAR || c > UI_TEXT_LAST_CHAR) c = ' ';
+    return glyph_rows[c - UI_TEXT_FIRST_CHAR];
+}
+
+int16_t ui_text_width(const char* text, uint8_t size) {
+    return (int16_t)(strlen(text) * UI_TEXT_GLYPH_W * size);
+}
+
+// Push n characters starting at text as one window (split only if wider than a line buffer)
+static void blit_run(int16_t x, int16_t y, const char* text, uint8_t n, uint8_t size,
+                     uint16_t fg_be, uint16_t bg_be) {
+    ILI9341_Bus& bus = _tft->bus();
+    uint8_t max_chars = UI_TEXT_LINE_MAX_PX / (UI_TEXT_GLYPH_W * size);
+
+    while (n > 0) {
+        uint8_t chunk = (n < max_chars) ? n : max_chars;
+        int16_t run_w = chunk * UI_TEXT_GLYPH_W * size;
+
+        bus.beginRect(x, y, run_w, UI_TEXT_GLYPH_H * size);
+        uint8_t sel = 0;
+        for (uint8_t row = 0; row < UI_TEXT_GLYPH_H; ++row) {
+            uint16_t* dst = line_buf[sel];
+            for (uint8_t i = 0; i < chunk; ++i) {
+                uint8_t bits = glyph_for(text[i])[row]; // Bit 5 (spacing column) is always clear
+                for (uint8_t col = 0; col < UI_TEXT_GLYPH_W; ++col) {
+                    uint16_t px = (bits & (1 << col)) ? fg_be : bg_be;
+                    for (uint8_t s = 0; s < size; ++s) *dst++ = px;
+                }
+            }
+            // Scaled text repeats the same line; the buffer is not touched while in flight
+            for (uint8_t s = 0; s < size; ++s) {
+                bus.writeRawAsync((const uint8_t*)line_buf[sel], (uint32_t)run_w * 2);
+            }
+            sel ^= 1;
+        }
+        x += run_w;
+        text += chunk;
+        n -= chunk;
+    }
+    bus.waitIdle(); // line_buf is reused by the next call
+}
+
+static inline uint16_t swap565(uint16_t c) {
+    return (uint16_t)((c << 8) | (c >> 8));
+}
+
+static void account(uint32_t start) {
+    last_cycles = DWT->CYCCNT - start;
+    if (last_cycles > max_cycles) max_cycles = last_cycles;
+}
+
+void ui_text_draw(int16_t x, int16_t y, const char* text, uint8_t size, uint16_t fg, uint16_t bg) {
+    if (!_tft || !text || size == 0) return;
+    uint32_t start = DWT->CYCCNT;
+    size_t n = strlen(text);
+    _tft->startWrite();
+    if (n > 0) blit_run(x, y, text, (uint8_t)(n > 255 ? 255 : n), size, swap565(fg), swap565(bg));
+    _tft->endWrite();
+    account(start);
+}
+
+void ui_text_update(int16_t x, int16_t y, const char* old_text, const char* new_text,
+                    uint8_t size, uint16_t fg, uint16_t bg) {
+    if (!_tft || !new_text || size == 0) return;
+    if (!old_text) old_text = "";
+    uint32_t start = DWT->CYCCNT;
+    uint16_t fg_be = swap565(fg);
+    uint16_t bg_be = swap565(bg);
+    int16_t cell_w = UI_TEXT_GLYPH_W * size;
+
+    size_t old_len = strlen(old_text);
+    size_t new_len = strlen(new_text);
+    size_t len = (old_len > new_len) ? old_len : new_len;
+
+    // Scratch for runs that include blanked trailing cells
+    static char blanks[UI_TEXT_LINE_MAX_PX / UI_TEXT_GLYPH_W + 1];
+
+    _tft->startWrite();
+    size_t i = 0;
+    while (i < len) {
+        char o = (i < old_len) ? old_text[i] : ' ';
+        char c = (i < new_len) ? new_text[i] : ' ';
+        if (o == c) { i++; continue; }
+
+        // Grow the run while cells differ (a single equal cell in between is cheaper
+        // to redraw than to open a new window for)
+        size_t run_start = i;
+        size_t run_end = i + 1;
+        while (run_end < len) {
+            char o2 = (run_end < old_len) ? old_text[run_end] : ' ';
+            char c2 = (run_end < new_len) ? new_text[run_end] : ' ';
+            if (o2 != c2) { run_end++; continue; }
+            char o3 = (run_end + 1 < old_len) ? old_text[run_end + 1] : ' ';
+            char c3 = (run_end + 1 < new_len) ? new_text[run_end + 1] : ' ';
+            if (run_end + 1 < len && o3 != c3) { run_end += 2; continue; }
+            break;
+        }
+
+        int16_t run_x = x + (int16_t)run_start * cell_w;
+        if (run_end <= new_len) {
+            blit_run(run_x, y, &new_text[run_start], (uint8_t)(run_end - run_start), size, fg_be, bg_be);
+        } else {
+            // Run extends past the new text: copy what is left and pad with spaces
+            size_t n = run_end - run_start;
+            if (n >= sizeof(blanks)) n = sizeof(blanks) - 1;
+            for (size_t k = 0; k < n; ++k) {
+                size_t idx = run_start + k;
+                blanks[k] = (idx < new_len) ? new_text[idx] : ' ';
+            }
+            blit_run(run_x, y, blanks, (uint8_t)n, size, fg_be, bg_be);
+        }
+        i = run_end;
+    }
+    _tft->endWrite();
+    account(start);
+}
+
+uint32_t ui_text_last_cycles() {
+    return last_cycles;
+}
+
+uint32_t ui_text_max_cycles() {
+    return max_cycles;
+}
@@ -0,0 +1,37 @@
+#ifndef UI_TEXT_H
+#define UI_TEXT_H
+
+#include <stdint.h>
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // For ILI9341_Display
+
+// Glyph cache covers printable ASCII; anything else is drawn as a space
+#define UI_TEXT_FIRST_CHAR  0x20
+#define UI_TEXT_LAST_CHAR   0x7E
+#define UI_TEXT_GLYPH_W     6   // 5 font columns + 1 spacing column
+#define UI_TEXT_GLYPH_H     8
+#define UI_TEXT_LINE_MAX_PX 240 // Widest run blitted in one window (longer text is split)
+
+// Integer / fixed-point formatting without printf.
+// Each writes at out, NUL-terminates, and returns a pointer to the terminator so calls
+// can be chained. out must have room for 12 chars (sign + 10 digits + NUL) per number.
+char* ui_fmt_str(char* out, const char* s);
+char* ui_fmt_uint(char* out, uint32_t value);
+char* ui_fmt_int(char* out, int32_t value);
+char* ui_fmt_fixed(char* out, int32_t value, uint8_t decimals); // value / 10^decimals, e.g. (1234, 3) -> "1.234"
+
+// Text engine. Glyphs come from a row-packed copy of the GFX 5x7 font built once at init,
+// and every run of characters is pushed as a single ILI9341 window (background included),
+// so there is no per-pixel command traffic and no need to clear before drawing.
+void ui_text_init(ILI9341_Display* tft_handle);
+void ui_text_draw(int16_t x, int16_t y, const char* text, uint8_t size, uint16_t fg, uint16_t bg);
+// Redraw only the character cells that differ between old_text and new_text
+// (trailing cells of a longer old_text are blanked).
+void ui_text_update(int16_t x, int16_t y, const char* old_text, const char* new_text,
+                    uint8_t size, uint16_t fg, uint16_t bg);
+int16_t ui_text_width(const char* text, uint8_t size);
+
+// Timing of the text engine (DWT cycles), for before/after comparisons
+uint32_t ui_text_last_cycles(); // Last ui_text_draw/ui_text_update call
+uint32_t ui_text_max_cycles();  // Worst case since boot
+
+#endif // UI_TEXT_H
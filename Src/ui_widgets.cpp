@@ -0,0 +1,149 @@
+#include "ui_widgets.h"
+#include "ui_draw.h" // For draw_button
+#include "ui_text.h" // For per-character text field updates
+#include <string.h>  // For strncmp, strncpy, memcpy
+
+static ILI9341_Display* _tft = nullptr;
+static UiScreen _active_screen = UI_SCREEN_NONE;
+
+// --- Widget tables ---
+// Initial text is the first label shown; dynamic widgets are updated through ui_set_text().
+static UiWidget menu_widgets[] = {
+    { UI_ID_MENU_TITLE, UI_WIDGET_LABEL, MENU_TITLE_X, MENU_TITLE_Y, MENU_TITLE_W, MENU_TITLE_H, 2, "Main Menu", false, true, true, "" },
+    { UI_ID_MENU_SCOPE, UI_WIDGET_BUTTON, BTN_MENU_SCOPE_X, BTN_MENU_SCOPE_Y, BTN_MENU_SCOPE_W, BTN_MENU_SCOPE_H, 1, "Oscilloscope", false, true, true, "" },
+    { UI_ID_MENU_LA, UI_WIDGET_BUTTON, BTN_MENU_LA_X, BTN_MENU_LA_Y, BTN_MENU_LA_W, BTN_MENU_LA_H, 1, "Logic Analyzer", false, true, true, "" },
+    { UI_ID_MENU_CAL, UI_WIDGET_BUTTON, BTN_MENU_CAL_X, BTN_MENU_CAL_Y, BTN_MENU_CAL_W, BTN_MENU_CAL_H, 1, "Calibrate Touch", false, true, true, "" },
+};
+
+static UiWidget scope_widgets[] = {
+    { UI_ID_SCOPE_STATUS, UI_WIDGET_STATUS, SCOPE_STATUS_X, SCOPE_STATUS_Y, SCOPE_STATUS_W, SCOPE_STATUS_H, 1, "", false, true, true, "" },
+    { UI_ID_SCOPE_TRIGPOS, UI_WIDGET_STATUS, SCOPE_TRIGPOS_X, SCOPE_TRIGPOS_Y, SCOPE_TRIGPOS_W, SCOPE_TRIGPOS_H, 1, "", false, true, true, "" },
+    { UI_ID_SCOPE_MENU, UI_WIDGET_BUTTON, BTN_SCOPE_MENU_X, BTN_SCOPE_MENU_Y, BTN_SCOPE_MENU_W, BTN_SCOPE_MENU_H, 1, "Menu", false, true, true, "" },
+    { UI_ID_SCOPE_RUNSTOP, UI_WIDGET_BUTTON, BTN_SCOPE_RUNSTOP_X, BTN_SCOPE_RUNSTOP_Y, BTN_SCOPE_RUNSTOP_W, BTN_SCOPE_RUNSTOP_H, 1, "Run", false, true, true, "" },
+    { UI_ID_SCOPE_TRIGEDGE, UI_WIDGET_BUTTON, BTN_SCOPE_TRIGEDGE_X, BTN_SCOPE_TRIGEDGE_Y, BTN_SCOPE_TRIGEDGE_W, BTN_SCOPE_TRIGEDGE_H, 1, "Rising", false, true, true, "" },
+};
+
+static UiWidget la_widgets[] = {
+    { UI_ID_LA_STATUS, UI_WIDGET_STATUS, LA_STATUS_X, LA_STATUS_Y, LA_STATUS_W, LA_STATUS_H, 1, "", false, true, true, "" },
+    { UI_ID_LA_CURSORS, UI_WIDGET_STATUS, LA_READOUT_X, LA_READOUT_Y, LA_READOUT_W, LA_READOUT_H, 1, "", false, true, true, "" },
+    { UI_ID_LA_MEASURE, UI_WIDGET_STATUS, LA_READOUT_X, LA_READOUT_Y + 10, LA_READOUT_W, LA_READOUT_H, 1, "", false, true, true, "" },
+    { UI_ID_LA_PULSES, UI_WIDGET_STATUS, LA_READOUT_X, LA_READOUT_Y + 20, LA_READOUT_W, LA_READOUT_H, 1, "", false, true, true, "" },
+    { UI_ID_LA_MENU, UI_WIDGET_BUTTON, BTN_LA_MENU_X, BTN_LA_MENU_Y, BTN_LA_MENU_W, BTN_LA_MENU_H, 1, "Menu", false, true, true, "" },
+    { UI_ID_LA_ARM, UI_WIDGET_BUTTON, BTN_LA_ARM_X, BTN_LA_ARM_Y, BTN_LA_ARM_W, BTN_LA_ARM_H, 1, "Arm", false, true, true, "" },
+    { UI_ID_LA_MODE, UI_WIDGET_BUTTON, BTN_LA_MODE_X, BTN_LA_MODE_Y, BTN_LA_MODE_W, BTN_LA_MODE_H, 1, "Samples", false, true, true, "" },
+    { UI_ID_LA_LIVE, UI_WIDGET_BUTTON, BTN_LA_LIVE_X, BTN_LA_LIVE_Y, BTN_LA_LIVE_W, BTN_LA_LIVE_H, 1, "Live", false, true, true, "" },
+};
+
+#define UI_COUNT(a) (sizeof(a) / sizeof((a)[0]))
+
+// Widget table of the active screen
+static UiWidget* active_table(uint8_t* count) {
+    switch (_active_screen) {
+        case UI_SCREEN_MENU:  *count = UI_COUNT(menu_widgets);  return menu_widgets;
+        case UI_SCREEN_SCOPE: *count = UI_COUNT(scope_widgets); return scope_widgets;
+        case UI_SCREEN_LA:    *count = UI_COUNT(la_widgets);    return la_widgets;
+        default:              *count = 0;                       return nullptr;
+    }
+}
+
+static UiWidget* find_widget(uint8_t id) {
+    uint8_t count;
+    UiWidget* table = active_table(&count);
+    for (uint8_t i = 0; i < count; ++i) {
+        if (table[i].id == id) return &table[i];
+    }
+    return nullptr;
+}
+
+// Helper function to check if touch is within a widget area
+static bool is_touch_in_rect(int16_t tx, int16_t ty, int16_t x, int16_t y, int16_t w, int16_t h) {
+    return (tx >= x && tx <= (x + w) && ty >= y && ty <= (y + h));
+}
+
+// --- Public API ---
+void ui_widgets_init(ILI9341_Display* tft_handle) {
+    _tft = tft_handle;
+}
+
+void ui_screen_enter(UiScreen screen) {
+    if (screen == _active_screen) return;
+    _active_screen = screen;
+    ui_invalidate();
+}
+
+UiScreen ui_active_screen() {
+    return _active_screen;
+}
+
+void ui_invalidate() {
+    uint8_t count;
+    UiWidget* table = active_table(&count);
+    for (uint8_t i = 0; i < count; ++i) {
+        table[i].dirty = true;
+        table[i].stale = true;
+    }
+}
+
+void ui_set_text(uint8_t id, const char* text) {
+    UiWidget* wd = find_widget(id);
+    if (!wd || !text) return;
+    if (strncmp(wd->text, text, UI_WIDGET_TEXT_MAX - 1) == 0) return; // Unchanged, nothing to repaint
+    strncpy(wd->text, text, UI_WIDGET_TEXT_MAX - 1);
+    wd->text[UI_WIDGET_TEXT_MAX - 1] = '\0';
+    wd->dirty = true;
+}
+
+void ui_set_inverted(uint8_t id, bool inverted) {
+    UiWidget* wd = find_widget(id);
+    if (!wd || wd->inverted == inverted) return;
+    wd->inverted = inverted;
+    wd->dirty = true;
+}
+
+static void paint_widget(UiWidget* wd) {
+    switch (wd->kind) {
+        case UI_WIDGET_BUTTON:
+            draw_button(wd->x, wd->y, wd->w, wd->h, wd->text, wd->inverted);
+            break;
+        case UI_WIDGET_LABEL:
+        case UI_WIDGET_STATUS:
+            if (wd->stale) {
+                // Background is gone: clear the field's rectangle and draw it whole
+                _tft->fillRect(wd->x, wd->y, wd->w, wd->h, UI_BG_COLOR);
+                ui_text_draw(wd->x, wd->y, wd->text, wd->text_size, UI_TEXT_COLOR, UI_BG_COLOR);
+            } else {
+                // Only the characters that changed (e.g. the digits of "Lvl")
+                ui_text_update(wd->x, wd->y, wd->drawn, wd->text, wd->text_size, UI_TEXT_COLOR, UI_BG_COLOR);
+            }
+            memcpy(wd->drawn, wd->text, UI_WIDGET_TEXT_MAX);
+            break;
+    }
+    wd->dirty = false;
+    wd->stale = false;
+}
+
+uint8_t ui_render() {
+    if (!_tft) return 0;
+    uint8_t count;
+    uint8_t painted = 0;
+    UiWidget* table = active_table(&count);
+    for (uint8_t i = 0; i < count; ++i) {
+        if (table[i].dirty) {
+            paint_widget(&table[i]);
+            painted++;
+        }
+    }
+    return painted;
+}
+
+uint8_t ui_hit_test(int16_t tx, int16_t ty) {
+    uint8_t count;
+    UiWidget* table = active_table(&count);
+    for (uint8_t i = 0; i < count; ++i) {
+        const UiWidget& wd = table[i];
+        if (wd.kind == UI_WIDGET_BUTTON && is_touch_in_rect(tx, ty, wd.x, wd.y, wd.w, wd.h)) {
+            return wd.id;
+        }
+    }
+    return UI_ID_NONE;
+}
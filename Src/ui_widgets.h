@@ -0,0 +1,79 @@
+#ifndef UI_WIDGETS_H
+#define UI_WIDGETS_H
+
+#include <stdint.h>
+#include "Middlewares/ILI9341_Bus/ILI9341_Bus.h" // For ILI9341_Display
+#include "ui_config.h" // For button geometry and colors
+
+#define UI_WIDGET_TEXT_MAX 40 // Longest label/status string incl. terminator
+
+// Screens (one widget table each). Mirrors OperatingMode.
+enum UiScreen {
+    UI_SCREEN_NONE,
+    UI_SCREEN_MENU,
+    UI_SCREEN_SCOPE,
+    UI_SCREEN_LA
+};
+
+// Widget identifiers. Buttons are what ui_hit_test() reports to process_touch().
+enum UiWidgetId {
+    UI_ID_NONE = 0,
+    UI_ID_MENU_TITLE,
+    UI_ID_MENU_SCOPE,
+    UI_ID_MENU_LA,
+    UI_ID_MENU_CAL,
+    UI_ID_SCOPE_MENU,
+    UI_ID_SCOPE_RUNSTOP,
+    UI_ID_SCOPE_TRIGEDGE,
+    UI_ID_SCOPE_STATUS,
+    UI_ID_SCOPE_TRIGPOS,
+    UI_ID_LA_MENU,
+    UI_ID_LA_ARM,
+    UI_ID_LA_MODE,
+    UI_ID_LA_LIVE,
+    UI_ID_LA_STATUS,
+    UI_ID_LA_CURSORS, // Cursor readout
+    UI_ID_LA_MEASURE, // Selected channel: frequency, duty, edges
+    UI_ID_LA_PULSES   // ...and its shortest/longest pulse
+};
+
+enum UiWidgetKind {
+    UI_WIDGET_BUTTON, // Framed, centered label, can be inverted, hit-testable
+    UI_WIDGET_LABEL,  // Static text
+    UI_WIDGET_STATUS  // Text field that is cleared and reprinted when its content changes
+};
+
+// Retained widget: knows its rectangle and what it currently shows on the panel.
+// Setters only mark a widget dirty when the new content differs from what is there,
+// and ui_render() repaints dirty widgets only.
+struct UiWidget {
+    uint8_t id;
+    uint8_t kind;
+    int16_t x, y, w, h;
+    uint8_t text_size;
+    char text[UI_WIDGET_TEXT_MAX];  // Content to show
+    bool inverted;
+    bool dirty;                     // Content differs from what is on the panel
+    bool stale;                     // Background was overdrawn, repaint the whole widget
+    char drawn[UI_WIDGET_TEXT_MAX]; // Text fields: what is on the panel (for per-character updates)
+};
+
+void ui_widgets_init(ILI9341_Display* tft_handle);
+
+// Switch the active widget table. Entering a different screen marks all of its
+// widgets dirty, since the caller is expected to have cleared/redrawn the background.
+void ui_screen_enter(UiScreen screen);
+UiScreen ui_active_screen();
+void ui_invalidate(); // Force a full repaint of the active screen (background was overdrawn)
+
+// Content setters (no drawing happens here)
+void ui_set_text(uint8_t id, const char* text);
+void ui_set_inverted(uint8_t id, bool inverted);
+
+// Paint every dirty widget of the active screen. Returns the number repainted.
+uint8_t ui_render();
+
+// Button under the touch point on the active screen, or UI_ID_NONE
+uint8_t ui_hit_test(int16_t tx, int16_t ty);
+
+#endif // UI_WIDGETS_H
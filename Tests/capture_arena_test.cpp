@@ -0,0 +1,28 @@
+// Guard words of the capture arena (static-array build): a write just past either edge
+// of the capture memory is reported once by capture_arena_check(), then re-armed.
+#include "capture_arena.h"
+#include "test_check.h"
+
+int main() {
+    capture_arena_init();
+    uint8_t* base = capture_arena_base();
+    uint32_t size = capture_arena_size();
+    CHECK(base != nullptr);
+    CHECK_EQ(size, CAPTURE_ARENA_STATIC_BYTES - 2 * CAPTURE_ARENA_GUARD_WORDS * 4);
+    CHECK_EQ((uintptr_t)base & 3, 0);
+
+    for (uint32_t i = 0; i < size; ++i) base[i] = 0xA5; // A full capture stays inside
+    CHECK(capture_arena_check());
+    CHECK_EQ(capture_arena_faults(), 0);
+
+    ((uint32_t*)(base + size))[0] = 0; // Past the end (a deeper stack comes from there)
+    CHECK(!capture_arena_check());
+    CHECK_EQ(capture_arena_faults(), 1);
+    CHECK(capture_arena_check()); // Guard written again
+
+    base[-1] = 0; // Below the start (the heap side)
+    CHECK(!capture_arena_check());
+    CHECK_EQ(capture_arena_faults(), 2);
+    CHECK(capture_arena_check());
+    return test_result();
+}
@@ -0,0 +1,282 @@
+// UART, SPI and I2C decoders against synthesized bit streams. Every stream is checked
+// through a raw view and through transition records built from it, as both storages
+// reach the decoders through the same LogicSamplesT calls.
+#include "LogicDecoder.h"
+#include "test_check.h"
+#include <stdio.h>
+#include <vector>
+
+// Builds a capture sample by sample: set() changes lines, hold() repeats the state
+template <typename T>
+struct Stream {
+    std::vector<T> s;
+    T state;
+    explicit Stream(T idle) : state(idle) {}
+    void set(uint8_t ch, int level) { state = level ? (T)(state | (1u << ch)) : (T)(state & ~(1u << ch)); }
+    void hold(uint32_t n) { s.insert(s.end(), n, state); }
+    uint32_t pos() const { return (uint32_t)s.size(); }
+};
+
+template <typename T>
+static std::vector<uint32_t> to_records(const std::vector<T>& s) {
+    typedef LA_RecordFormat<T> R;
+    std::vector<uint32_t> recs;
+    uint32_t last = 0;
+    for (uint32_t i = 0; i < s.size(); ++i) {
+        if (i == 0 || s[i] != s[i - 1]) {
+            recs.push_back(R::make(i - last, s[i]));
+            last = i;
+        }
+    }
+    return recs;
+}
+
+struct Expected {
+    uint8_t type;
+    uint16_t value;
+    uint8_t flags;
+};
+
+template <typename T>
+static void check_decode(const char* name, const std::vector<T>& s, uint32_t hz, const LA_DecoderConfig& cfg,
+                         const Expected* want, uint16_t n, const uint32_t* starts = nullptr) {
+    std::vector<uint32_t> recs = to_records(s);
+    LogicSamplesT<T> raw(s.data(), (uint32_t)s.size());
+    LogicSamplesT<T> runs(recs.data(), (uint32_t)recs.size(), (uint32_t)s.size());
+    const LogicSamplesT<T>* views[2] = { &raw, &runs };
+    for (int v = 0; v < 2; ++v) {
+        LogicDecoder d;
+        uint16_t got = d.decode(*views[v], hz, cfg);
+        if (got != n) {
+            fprintf(stderr, "%s (%s): %u annotations, expected %u\n", name, v ? "transitions" : "raw", got, n);
+            test_failures++;
+            continue;
+        }
+        for (uint16_t i = 0; i < n; ++i) {
+            const LA_Annotation& a = d.annotations()[i];
+            if (a.type != want[i].type || a.value != want[i].value || a.flags != want[i].flags ||
+                (starts && a.start != starts[i])) {
+                fprintf(stderr, "%s (%s) #%u: type %u value 0x%X flags 0x%X start %u, expected %u 0x%X 0x%X %u\n",
+                        name, v ? "transitions" : "raw", i, a.type, a.value, a.flags, a.start, want[i].type,
+                        want[i].value, want[i].flags, starts ? starts[i] : a.start);
+                test_failures++;
+            }
+        }
+    }
+}
+
+/* UART */
+template <typename T>
+static uint32_t uart_frame(Stream<T>& st, uint8_t ch, double spb, uint16_t value, uint8_t data_bits,
+                           uint8_t parity, uint8_t stop_bits, bool bad_stop, bool inverted) {
+    uint32_t start = st.pos();
+    std::vector<int> bits;
+    bits.push_back(0);
+    int ones = 0;
+    for (uint8_t i = 0; i < data_bits; ++i) {
+        bits.push_back((value >> i) & 1);
+        ones += (value >> i) & 1;
+    }
+    if (parity) bits.push_back(parity == 1 ? !(ones & 1) : (ones & 1)); // Odd / even
+    for (uint8_t i = 0; i < stop_bits; ++i) bits.push_back(bad_stop ? 0 : 1);
+    for (size_t b = 0; b < bits.size(); ++b) { // Bit b covers [start + b * spb, start + (b + 1) * spb)
+        st.set(ch, bits[b] ^ inverted);
+        st.hold((uint32_t)(start + (b + 1) * spb) - st.pos());
+    }
+    st.set(ch, !inverted);
+    st.hold((uint32_t)(3 * spb)); // Idle between frames
+    return start;
+}
+
+static void test_uart() {
+    const uint32_t hz = 1000000, baud = 115200;
+    const double spb = (double)hz / baud;
+    LA_DecoderConfig cfg = { LA_DECODER_UART };
+
+    { // 8N1, start positions checked too
+        Stream<uint8_t> st(0xFF);
+        st.hold(20);
+        uint32_t starts[3];
+        const uint8_t bytes[3] = { 0x55, 0xA3, 'H' };
+        for (int i = 0; i < 3; ++i) starts[i] = uart_frame(st, 2, spb, bytes[i], 8, 0, 1, false, false);
+        cfg.uart = { 2, baud, 8, 0, 1, false };
+        const Expected want[3] = { { LA_ANN_DATA, 0x55, 0 }, { LA_ANN_DATA, 0xA3, 0 }, { LA_ANN_DATA, 'H', 0 } };
+        check_decode("uart 8N1", st.s, hz, cfg, want, 3, starts);
+    }
+    { // 8E1 and 7O2 with good and bad parity
+        Stream<uint8_t> st(0xFF);
+        st.hold(20);
+        uart_frame(st, 0, spb, 0x31, 8, 2, 1, false, false);
+        uart_frame(st, 0, spb, 0x31 ^ 0x80, 8, 2, 1, false, false);
+        cfg.uart = { 0, baud, 8, 2, 1, false };
+        const Expected want[2] = { { LA_ANN_DATA, 0x31, 0 }, { LA_ANN_DATA, 0xB1, 0 } };
+        check_decode("uart 8E1", st.s, hz, cfg, want, 2);
+
+        // The same frames with the parity bit flipped: sent as odd, decoded as even
+        Stream<uint8_t> bad(0xFF);
+        bad.hold(20);
+        uart_frame(bad, 0, spb, 0x31, 8, 1, 1, false, false);
+        const Expected err[1] = { { LA_ANN_DATA, 0x31, LA_ANN_ERROR } };
+        check_decode("uart 8E1 parity error", bad.s, hz, cfg, err, 1);
+
+        Stream<uint8_t> o72(0xFF);
+        o72.hold(20);
+        uart_frame(o72, 1, spb, 0x5A, 7, 1, 2, false, false);
+        cfg.uart = { 1, baud, 7, 1, 2, false };
+        const Expected want72[1] = { { LA_ANN_DATA, 0x5A, 0 } };
+        check_decode("uart 7O2", o72.s, hz, cfg, want72, 1);
+    }
+    { // Framing error: stop bit low, then a good frame after the line returns to idle
+        Stream<uint8_t> st(0xFF);
+        st.hold(20);
+        uart_frame(st, 3, spb, 0x7E, 8, 0, 1, true, false);
+        uart_frame(st, 3, spb, 0x42, 8, 0, 1, false, false);
+        cfg.uart = { 3, baud, 8, 0, 1, false };
+        const Expected want[2] = { { LA_ANN_DATA, 0x7E, LA_ANN_ERROR }, { LA_ANN_DATA, 0x42, 0 } };
+        check_decode("uart framing error", st.s, hz, cfg, want, 2);
+    }
+    { // Inverted line, 9 data bits, 16-bit samples on channel 12
+        Stream<uint16_t> st(0x0000);
+        st.hold(20);
+        uart_frame(st, 12, spb, 0x1C5, 9, 0, 1, false, true);
+        cfg.uart = { 12, baud, 9, 0, 1, true };
+        const Expected want[1] = { { LA_ANN_DATA, 0x1C5, 0 } };
+        check_decode("uart 9N1 inverted, 16-bit samples", st.s, hz, cfg, want, 1);
+    }
+}
+
+/* SPI */
+enum { SPI_CLK = 0, SPI_MOSI = 1, SPI_MISO = 2, SPI_CS = 3 };
+
+static void spi_word(Stream<uint8_t>& st, uint8_t mode, uint16_t mosi, uint16_t miso, uint8_t bits, bool msb_first) {
+    int idle = (mode >> 1) & 1, cpha = mode & 1;
+    for (uint8_t i = 0; i < bits; ++i) {
+        uint8_t b = msb_first ? (uint8_t)(bits - 1 - i) : i;
+        if (!cpha) { // Data ahead of the leading edge, sampled on it
+            st.set(SPI_MOSI, (mosi >> b) & 1);
+            st.set(SPI_MISO, (miso >> b) & 1);
+            st.hold(3);
+            st.set(SPI_CLK, !idle);
+            st.hold(3);
+            st.set(SPI_CLK, idle);
+        } else { // Data changes on the leading edge, sampled on the trailing one
+            st.set(SPI_CLK, !idle);
+            st.set(SPI_MOSI, (mosi >> b) & 1);
+            st.set(SPI_MISO, (miso >> b) & 1);
+            st.hold(3);
+            st.set(SPI_CLK, idle);
+            st.hold(3);
+        }
+    }
+    st.hold(3);
+}
+
+static void test_spi() {
+    for (uint8_t mode = 0; mode < 4; ++mode) {
+        Stream<uint8_t> st((uint8_t)((1 << SPI_CS) | (((mode >> 1) & 1) << SPI_CLK)));
+        st.hold(10);
+        st.set(SPI_CS, 0);
+        st.hold(4);
+        spi_word(st, mode, 0xA5, 0x3C, 8, true);
+        spi_word(st, mode, 0x01, 0xFE, 8, true);
+        st.set(SPI_CS, 1);
+        st.hold(10);
+        // A word cut short by CS is dropped
+        st.set(SPI_CS, 0);
+        st.hold(4);
+        spi_word(st, mode, 0xFF, 0xFF, 5, true);
+        st.set(SPI_CS, 1);
+        st.hold(10);
+
+        LA_DecoderConfig cfg = { LA_DECODER_SPI };
+        cfg.spi = { SPI_CLK, SPI_MOSI, SPI_MISO, SPI_CS, mode, 8, true };
+        const Expected want[4] = {
+            { LA_ANN_DATA, 0xA5, 0 }, { LA_ANN_DATA, 0x3C, LA_ANN_ROW2 },
+            { LA_ANN_DATA, 0x01, 0 }, { LA_ANN_DATA, 0xFE, LA_ANN_ROW2 },
+        };
+        char name[32];
+        snprintf(name, sizeof(name), "spi mode %u", mode);
+        check_decode(name, st.s, 1000000, cfg, want, 4);
+    }
+    { // LSB first, 12-bit words, no MISO or CS
+        Stream<uint8_t> st(0x00);
+        st.hold(10);
+        spi_word(st, 0, 0xABC, 0, 12, false);
+        LA_DecoderConfig cfg = { LA_DECODER_SPI };
+        cfg.spi = { SPI_CLK, SPI_MOSI, LA_DECODE_NO_CHANNEL, LA_DECODE_NO_CHANNEL, 0, 12, false };
+        const Expected want[1] = { { LA_ANN_DATA, 0xABC, 0 } };
+        check_decode("spi lsb first 12-bit", st.s, 1000000, cfg, want, 1);
+    }
+}
+
+/* I2C */
+enum { I2C_SCL = 4, I2C_SDA = 5 };
+
+static void i2c_start(Stream<uint8_t>& st) { // From idle or after an ACK (repeated start)
+    st.set(I2C_SDA, 1);
+    st.hold(3);
+    st.set(I2C_SCL, 1);
+    st.hold(3);
+    st.set(I2C_SDA, 0);
+    st.hold(3);
+    st.set(I2C_SCL, 0);
+    st.hold(3);
+}
+
+static void i2c_bit(Stream<uint8_t>& st, int b) {
+    st.set(I2C_SDA, b);
+    st.hold(3);
+    st.set(I2C_SCL, 1);
+    st.hold(3);
+    st.set(I2C_SCL, 0);
+    st.hold(3);
+}
+
+static void i2c_byte(Stream<uint8_t>& st, uint8_t v, bool ack) {
+    for (int i = 7; i >= 0; --i) i2c_bit(st, (v >> i) & 1);
+    i2c_bit(st, ack ? 0 : 1);
+}
+
+static void i2c_stop(Stream<uint8_t>& st) {
+    st.set(I2C_SDA, 0);
+    st.hold(3);
+    st.set(I2C_SCL, 1);
+    st.hold(3);
+    st.set(I2C_SDA, 1);
+    st.hold(6);
+}
+
+static void test_i2c() {
+    // Register read: write the register address, repeated start, read one byte (NACKed)
+    Stream<uint8_t> st((uint8_t)((1 << I2C_SCL) | (1 << I2C_SDA)));
+    st.hold(10);
+    i2c_start(st);
+    i2c_byte(st, 0x50 << 1, true);
+    i2c_byte(st, 0x10, true);
+    i2c_start(st);
+    i2c_byte(st, (0x50 << 1) | 1, true);
+    i2c_byte(st, 0xAB, false);
+    i2c_stop(st);
+    // A second transaction to an absent device: address NACKed, then stop
+    i2c_start(st);
+    i2c_byte(st, 0x23 << 1, false);
+    i2c_stop(st);
+
+    LA_DecoderConfig cfg = { LA_DECODER_I2C };
+    cfg.i2c = { I2C_SCL, I2C_SDA };
+    const Expected want[10] = {
+        { LA_ANN_START, 0, 0 },    { LA_ANN_ADDRESS, 0x50, 0 },           { LA_ANN_DATA, 0x10, 0 },
+        { LA_ANN_START, 0, 0 },    { LA_ANN_ADDRESS, 0x50, LA_ANN_READ }, { LA_ANN_DATA, 0xAB, LA_ANN_NACK },
+        { LA_ANN_STOP, 0, 0 },     { LA_ANN_START, 0, 0 },                { LA_ANN_ADDRESS, 0x23, LA_ANN_NACK },
+        { LA_ANN_STOP, 0, 0 },
+    };
+    check_decode("i2c", st.s, 1000000, cfg, want, 10);
+}
+
+int main() {
+    test_uart();
+    test_spi();
+    test_i2c();
+    printf("logic_decoder_test: UART, SPI (modes 0-3), I2C\n");
+    return test_result();
+}
@@ -0,0 +1,70 @@
+#ifndef PTY_LINK_H
+#define PTY_LINK_H
+
+// Stand-in for the USART1 host link in the host tests: a pseudo-terminal pair in raw
+// mode. The test writes what a PC tool sends to 'host', runs the device side on what
+// arrives at 'dev' (as task_host does with the RX ring), and reads the replies back from
+// 'host'. Both ends are non-blocking; reads wait until the line has been quiet a while.
+#ifndef _XOPEN_SOURCE
+#define _XOPEN_SOURCE 600
+#endif
+#include <fcntl.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <termios.h>
+#include <unistd.h>
+
+struct PtyLink {
+    int host;
+    int dev;
+
+    bool open_pair() {
+        host = posix_openpt(O_RDWR | O_NOCTTY);
+        if (host < 0 || grantpt(host) || unlockpt(host)) return false;
+        dev = open(ptsname(host), O_RDWR | O_NOCTTY);
+        if (dev < 0) return false;
+        struct termios t;
+        tcgetattr(dev, &t);
+        cfmakeraw(&t); // 8-bit clean, no echo or line editing
+        tcsetattr(dev, TCSANOW, &t);
+        fcntl(host, F_SETFL, O_NONBLOCK);
+        fcntl(dev, F_SETFL, O_NONBLOCK);
+        return true;
+    }
+
+    void close_pair() {
+        close(dev);
+        close(host);
+    }
+
+    // Everything available on fd, waiting up to quiet_ms after the last byte
+    static size_t drain(int fd, uint8_t* out, size_t max, int quiet_ms = 20) {
+        size_t n = 0;
+        for (int idle = 0; idle < quiet_ms && n < max;) {
+            ssize_t r = read(fd, out + n, max - n);
+            if (r > 0) {
+                n += (size_t)r;
+                idle = 0;
+            } else {
+                usleep(1000);
+                idle++;
+            }
+        }
+        return n;
+    }
+
+    static void write_all(int fd, const void* data, size_t len) {
+        const uint8_t* p = (const uint8_t*)data;
+        while (len) {
+            ssize_t r = write(fd, p, len);
+            if (r > 0) {
+                p += r;
+                len -= (size_t)r;
+            } else {
+                usleep(100); // Pty buffer full: the other side has not read yet
+            }
+        }
+    }
+};
+
+#endif // PTY_LINK_H
@@ -0,0 +1,183 @@
+// ScopeFrame: CRC-32 against the zlib check values, header and 12-bit payload round trips,
+// then Tools/scope_decode (path given as the argument) on a stream of frames built the way
+// ScopeStream sends them: junk before the first frame, one frame with a corrupted payload.
+#include "ScopeFrame.h"
+#include "test_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <string>
+#include <sys/wait.h>
+#include <vector>
+
+static uint32_t crc_of(const char* s) {
+    return scope_crc_final(scope_crc_update(SCOPE_CRC_INIT, (const uint8_t*)s, (uint32_t)strlen(s)));
+}
+
+static void test_crc() {
+    CHECK_EQ(crc_of(""), 0x00000000u);
+    CHECK_EQ(crc_of("123456789"), 0xCBF43926u); // The CRC-32/IEEE check value
+    CHECK_EQ(crc_of("The quick brown fox jumps over the lazy dog"), 0x414FA339u);
+    // Running over pieces gives the same as one pass
+    const char* s = "The quick brown fox jumps over the lazy dog";
+    uint32_t c = scope_crc_update(SCOPE_CRC_INIT, (const uint8_t*)s, 10);
+    c = scope_crc_update(c, (const uint8_t*)s + 10, (uint32_t)strlen(s) - 10);
+    CHECK_EQ(scope_crc_final(c), 0x414FA339u);
+}
+
+static void test_header() {
+    ScopeFrameHeader h = { 600000, 1023, 256, 805664, 2048, 12, SCOPE_FRAME_TRIGGERED | SCOPE_FRAME_FALLING };
+    uint8_t raw[SCOPE_FRAME_HEADER_LEN + 8];
+    CHECK_EQ(scope_frame_write_header(raw, h), SCOPE_FRAME_HEADER_LEN);
+    CHECK(memcmp(raw, "SCP1", 4) == 0);
+    CHECK_EQ(raw[28] | (raw[29] << 8), scope_frame_payload_len(1023));
+    CHECK_EQ(scope_frame_payload_len(1023), 1536u); // Odd count padded to 1024 samples
+    CHECK_EQ(scope_frame_payload_len(1024), 1536u);
+
+    ScopeFrameHeader r;
+    uint16_t len = 0;
+    CHECK(scope_frame_read_header(raw, &r, &len));
+    CHECK_EQ(len, SCOPE_FRAME_HEADER_LEN);
+    CHECK_EQ(r.sample_rate_hz, h.sample_rate_hz);
+    CHECK_EQ(r.sample_count, h.sample_count);
+    CHECK_EQ(r.trigger_index, h.trigger_index);
+    CHECK_EQ(r.nv_per_lsb, h.nv_per_lsb);
+    CHECK_EQ(r.offset_code, h.offset_code);
+    CHECK_EQ(r.bits, h.bits);
+    CHECK_EQ(r.flags, h.flags);
+
+    // A longer header from a later sender is accepted and reported
+    raw[6] = SCOPE_FRAME_HEADER_LEN + 8;
+    CHECK(scope_frame_read_header(raw, &r, &len) && len == SCOPE_FRAME_HEADER_LEN + 8);
+    raw[6] = SCOPE_FRAME_HEADER_LEN;
+    // Rejected: other magic, other version, short header, payload length that does not fit
+    uint8_t bad[SCOPE_FRAME_HEADER_LEN];
+    const int offsets[4] = { 0, 4, 6, 28 };
+    for (int k = 0; k < 4; ++k) {
+        memcpy(bad, raw, sizeof(bad));
+        bad[offsets[k]] ^= (k == 2) ? 0x30 : 0x01; // header_len 32 -> 16
+        CHECK(!scope_frame_read_header(bad, &r, &len));
+    }
+}
+
+static void test_pack() {
+    // Byte layout: a[7:0], a[11:8] | b[3:0] << 4, b[11:4]
+    uint16_t pair[3] = { 0x0ABC, 0x0123, 0x0FFF };
+    uint32_t crc = SCOPE_CRC_INIT;
+    CHECK_EQ(scope_frame_pack(pair, 3, &crc), 6u);
+    const uint8_t* b = (const uint8_t*)pair;
+    const uint8_t want[6] = { 0xBC, 0x3A, 0x12, 0xFF, 0x0F, 0x00 }; // Odd count: zero pad
+    CHECK(memcmp(b, want, 6) == 0);
+    CHECK_EQ(scope_crc_final(crc), scope_crc_final(scope_crc_update(SCOPE_CRC_INIT, want, 6)));
+
+    // In place over a full buffer, all codes, odd and even counts
+    for (uint32_t count = 4095; count <= 4096; ++count) {
+        std::vector<uint16_t> s(count), orig(count), back(count);
+        for (uint32_t i = 0; i < count; ++i) orig[i] = s[i] = (uint16_t)((i * 2897u) & 0x0FFF);
+        s[0] = orig[0] = 0;
+        s[1] = orig[1] = 0x0FFF;
+        crc = SCOPE_CRC_INIT;
+        uint32_t len = scope_frame_pack(s.data(), count, &crc);
+        CHECK_EQ(len, scope_frame_payload_len(count));
+        CHECK_EQ(scope_crc_final(crc),
+                 scope_crc_final(scope_crc_update(SCOPE_CRC_INIT, (const uint8_t*)s.data(), len)));
+        scope_frame_unpack((const uint8_t*)s.data(), count, back.data());
+        CHECK(back == orig);
+    }
+}
+
+/* Stream through Tools/scope_decode */
+#define STREAM_FRAMES  3
+#define STREAM_SAMPLES 1024
+#define STREAM_BAD     1 // Frame with a flipped payload bit
+
+static const ScopeFrameHeader stream_header = { 600000, STREAM_SAMPLES, 256, 805664, 2048, 12, SCOPE_FRAME_TRIGGERED };
+
+static uint16_t stream_sample(int frame, uint32_t i) { return (uint16_t)(2048 + lround(2000 * sin(i * 0.05 + frame))); }
+
+static bool write_stream(const char* path) {
+    FILE* f = fopen(path, "wb");
+    if (!f) return false;
+    fputs("junk\x01\x02SCP", f); // Resynchronised on
+    for (int fr = 0; fr < STREAM_FRAMES; ++fr) {
+        uint16_t s[STREAM_SAMPLES];
+        for (uint32_t i = 0; i < STREAM_SAMPLES; ++i) s[i] = stream_sample(fr, i);
+        uint8_t hdr[SCOPE_FRAME_HEADER_LEN];
+        scope_frame_write_header(hdr, stream_header);
+        uint32_t crc = scope_crc_update(SCOPE_CRC_INIT, hdr, sizeof(hdr));
+        uint32_t len = scope_frame_pack(s, STREAM_SAMPLES, &crc);
+        crc = scope_crc_final(crc);
+        if (fr == STREAM_BAD) ((uint8_t*)s)[100] ^= 0x01;
+        fwrite(hdr, 1, sizeof(hdr), f);
+        fwrite(s, 1, len, f);
+        for (int k = 0; k < 4; ++k) fputc((crc >> (8 * k)) & 0xFF, f);
+    }
+    return fclose(f) == 0;
+}
+
+static void check_csv(const char* path) {
+    FILE* f = fopen(path, "r");
+    CHECK(f != nullptr);
+    if (!f) return;
+    char line[128];
+    CHECK(fgets(line, sizeof(line), f) && strcmp(line, "frame,index,time_s,code,volts\n") == 0);
+    uint32_t rows = 0, bad = 0;
+    long frame;
+    unsigned index, code;
+    double time, volts;
+    while (fscanf(f, "%ld,%u,%lf,%u,%lf\n", &frame, &index, &time, &code, &volts) == 5) { // %.9g times, %.6f volts
+        int sent = (frame >= STREAM_BAD) ? (int)frame + 1 : (int)frame; // The bad frame is skipped
+        double want_t = ((double)index - stream_header.trigger_index) / stream_header.sample_rate_hz;
+        double want_v = ((double)code - stream_header.offset_code) * stream_header.nv_per_lsb * 1e-9;
+        if (index != rows % STREAM_SAMPLES || code != stream_sample(sent, index) || fabs(time - want_t) > 1e-8 * fabs(want_t) ||
+            fabs(volts - want_v) > 1e-6) {
+            bad++;
+        }
+        rows++;
+    }
+    fclose(f);
+    CHECK_EQ(rows, (uint32_t)(STREAM_FRAMES - 1) * STREAM_SAMPLES);
+    CHECK_EQ(bad, 0u);
+}
+
+static void check_wav(const char* path) {
+    FILE* f = fopen(path, "rb");
+    CHECK(f != nullptr);
+    if (!f) return;
+    uint8_t h[44];
+    CHECK_EQ(fread(h, 1, sizeof(h), f), sizeof(h));
+    uint32_t rate = h[24] | (h[25] << 8) | (h[26] << 16) | ((uint32_t)h[27] << 24);
+    uint32_t data_len = h[40] | (h[41] << 8) | (h[42] << 16) | ((uint32_t)h[43] << 24);
+    CHECK(memcmp(h, "RIFF", 4) == 0 && memcmp(h + 36, "data", 4) == 0);
+    CHECK_EQ(rate, stream_header.sample_rate_hz);
+    CHECK_EQ(data_len, (uint32_t)(STREAM_FRAMES - 1) * STREAM_SAMPLES * 2);
+    uint8_t s[2];
+    CHECK(fread(s, 1, 2, f) == 2 && (int16_t)(s[0] | (s[1] << 8)) == (stream_sample(0, 0) - 2048) * 16);
+    fclose(f);
+}
+
+static void test_decode_tool(const char* tool) {
+    const char* stream = "scope_frame_test.bin";
+    const char* csv = "scope_frame_test.csv";
+    const char* wav = "scope_frame_test.wav";
+    CHECK(write_stream(stream));
+    std::string cmd = std::string(tool) + " -c " + csv + " -w " + wav + " " + stream + " 2>/dev/null";
+    int status = system(cmd.c_str());
+    CHECK(WIFEXITED(status) && WEXITSTATUS(status) == 1); // A frame failed its CRC
+    check_csv(csv);
+    check_wav(wav);
+    remove(stream);
+    remove(csv);
+    remove(wav);
+}
+
+int main(int argc, char** argv) {
+    test_crc();
+    test_header();
+    test_pack();
+    if (argc > 1) test_decode_tool(argv[1]);
+    else fprintf(stderr, "scope_frame_test: no scope_decode path given, tool not tested\n");
+    printf("scope_frame_test: CRC, header, payload%s\n", argc > 1 ? ", scope_decode" : "");
+    return test_result();
+}
@@ -0,0 +1,33 @@
+// Command throughput of ScpiParser on the host: a mix of settings and queries fed byte by
+// byte, as the host task does, without the link. Prints commands/s and ns per byte; the
+// firmware figure is SYSTem:STATistics? (cycles per line) on the board.
+#include "ScpiParser.h"
+#include "scpi_stand_in.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+
+int main(int argc, char** argv) {
+    static ScpiParser parser(scpi_test_commands, SCPI_TEST_COMMANDS, nullptr);
+    const char* lines[] = { "SCOP:TRIG:LEV 1234\n", "SCOP:TRIG:LEV?\n", "LA:RATE 2E6;:LA:RATE?\n",
+                            "LA:MEAS:PWID? 1\n", "*IDN?\n" };
+    const int kinds = sizeof(lines) / sizeof(lines[0]);
+    long n = (argc > 1) ? atol(argv[1]) : 2000000; // Lines
+
+    struct timespec a, b;
+    clock_gettime(CLOCK_MONOTONIC, &a);
+    size_t bytes = 0;
+    uint32_t replies = 0;
+    for (long i = 0; i < n; ++i) {
+        for (const char* l = lines[i % kinds]; *l; ++l, ++bytes) {
+            if (parser.feed((uint8_t)*l)) replies += parser.reply_len();
+        }
+    }
+    clock_gettime(CLOCK_MONOTONIC, &b);
+
+    double s = (b.tv_sec - a.tv_sec) + (b.tv_nsec - a.tv_nsec) * 1e-9;
+    printf("scpi_bench: %u commands in %u lines, %zu bytes in %.3f s: %.0f commands/s, %.1f ns/byte (%u reply bytes)\n",
+           parser.commands(), parser.lines(), bytes, s, parser.commands() / s, s * 1e9 / bytes, replies);
+    return 0;
+}
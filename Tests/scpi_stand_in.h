@@ -0,0 +1,92 @@
+#ifndef SCPI_STAND_IN_H
+#define SCPI_STAND_IN_H
+
+// ScpiServer's command table for the host tests: the firmware's list (ScpiCommands.h) with
+// stand-ins for its handlers, which keep a few settings in variables instead of acting on
+// the scope and logic analyzer (which need the HAL). A stand-in has the name of the handler
+// it replaces; commands without one are accepted and do nothing. Errors and replies are
+// formatted as ScpiServer does.
+#include "ScpiCommands.h"
+#include "ScpiParser.h"
+#include <string.h>
+
+#define SCPI_TEST_IDN "STM32 custom boards,Scope-LA,0,1.0"
+
+struct ScpiTestState {
+    uint32_t level;
+    uint32_t la_rate;
+    int8_t slope; // 0 positive, 1 negative
+};
+
+static ScpiTestState scpi_state = { 2048, 1000000, 0 };
+
+// Every handler of the list, doing nothing; found when scpi_stand_in has none of the name
+namespace scpi_nop {
+#define SCPI_NOP_HANDLER(pattern, handler) inline void handler(ScpiParser&, void*) {}
+SCPI_COMMAND_LIST(SCPI_NOP_HANDLER)
+#undef SCPI_NOP_HANDLER
+}
+
+namespace scpi_stand_in {
+using namespace scpi_nop;
+
+static void cmd_idn(ScpiParser& p, void*) { p.out_str(SCPI_TEST_IDN); }
+static void cmd_cls(ScpiParser& p, void*) { p.clear_errors(); }
+
+static void cmd_err_q(ScpiParser& p, void*) {
+    const char* msg;
+    p.out_int(p.pop_error(&msg));
+    char quoted[32];
+    uint8_t n = 0;
+    quoted[n++] = '"';
+    while (*msg && n < sizeof(quoted) - 2) quoted[n++] = *msg++;
+    quoted[n++] = '"';
+    quoted[n] = '\0';
+    p.out_str(quoted);
+}
+
+static void cmd_trig_level(ScpiParser& p, void*) {
+    uint32_t v;
+    if (!p.arg_uint(&v)) return;
+    if (v > 4095) {
+        p.error(SCPI_ERR_RANGE);
+        return;
+    }
+    scpi_state.level = v;
+}
+static void cmd_trig_level_q(ScpiParser& p, void*) { p.out_uint(scpi_state.level); }
+
+static const char* const slopes[] = { "POSitive", "NEGative" };
+static void cmd_trig_slope(ScpiParser& p, void*) {
+    int8_t s = p.arg_choice(slopes, 2);
+    if (s >= 0) scpi_state.slope = s;
+}
+static void cmd_trig_slope_q(ScpiParser& p, void*) { p.out_str(scpi_state.slope ? "NEG" : "POS"); }
+
+static void cmd_la_rate(ScpiParser& p, void*) {
+    uint32_t v;
+    if (p.arg_uint(&v)) scpi_state.la_rate = v;
+}
+static void cmd_la_rate_q(ScpiParser& p, void*) { p.out_uint(scpi_state.la_rate); }
+
+// Fixed pulse widths for channels 0..3, in ns
+static void cmd_meas_pwidth_q(ScpiParser& p, void*) {
+    uint32_t ch;
+    if (!p.arg_uint(&ch)) return;
+    if (ch > 3) {
+        p.error(SCPI_ERR_RANGE);
+        return;
+    }
+    p.out_uint(125);
+    p.out_uint(875);
+}
+
+} // namespace scpi_stand_in
+
+#define SCPI_STAND_IN_ENTRY(pattern, handler) { pattern, scpi_stand_in::handler },
+static const ScpiCommand scpi_test_commands[] = {
+    SCPI_COMMAND_LIST(SCPI_STAND_IN_ENTRY)
+};
+#define SCPI_TEST_COMMANDS (uint8_t)(sizeof(scpi_test_commands) / sizeof(scpi_test_commands[0]))
+
+#endif // SCPI_STAND_IN_H
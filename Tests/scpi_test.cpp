@@ -0,0 +1,106 @@
+// SCPI lines over a pty, demultiplexed from SUMP bytes the way task_host does it
+// (ScpiServer::wants()): replies, the error queue and its overflow, overlong lines, and
+// SUMP commands between lines, including a long command whose arguments are printable.
+#include "ScpiParser.h"
+#include "SumpProtocol.h"
+#include "pty_link.h"
+#include "scpi_stand_in.h"
+#include "test_check.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+static ScpiParser parser(scpi_test_commands, SCPI_TEST_COMMANDS, nullptr);
+static SumpProtocol sump;
+static int sump_commands[SUMP_CMD_UNKNOWN + 1];
+
+// Device side: what task_host does with a chunk from the RX ring
+static void device_rx(int fd) {
+    uint8_t buf[64];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            if (parser.in_line() || (!sump.in_command() && ScpiParser::starts_line(buf[i]))) {
+                if (parser.feed(buf[i]) && parser.reply_len()) PtyLink::write_all(fd, parser.reply(), parser.reply_len());
+            } else {
+                sump_commands[sump.feed(buf[i])]++;
+            }
+        }
+    }
+}
+
+// Send, let the device run, compare what comes back
+static void expect(PtyLink& link, const char* send, const char* want, int line) {
+    PtyLink::write_all(link.host, send, strlen(send));
+    usleep(2000);
+    device_rx(link.dev);
+    char got[256];
+    size_t n = PtyLink::drain(link.host, (uint8_t*)got, sizeof(got) - 1, 5);
+    got[n] = '\0';
+    if (strcmp(got, want)) {
+        fprintf(stderr, "%s:%d: \"%s\" replied \"%s\", expected \"%s\"\n", __FILE__, line, send, got, want);
+        test_failures++;
+    }
+}
+#define EXPECT(send, want) expect(link, send, want, __LINE__)
+
+int main() {
+    PtyLink link;
+    if (!link.open_pair()) {
+        fprintf(stderr, "scpi_test: no pty available\n");
+        return 1;
+    }
+
+    // Replies: long and short forms, any case, ';' back to the root, CR LF endings
+    EXPECT("*IDN?\n", SCPI_TEST_IDN "\n");
+    EXPECT("scop:trig:lev 1000;:SCOPE:TRIGGER:LEVEL?\n", "1000\n");
+    EXPECT("SCOP:TRIG:SLOP neg;:SCOP:TRIG:SLOP?;:LA:RATE 2.5E6;:LA:RATE?\n", "NEG;2500000\n");
+    EXPECT("LA:MEAS:PWID? 2\r\n", "125,875\n");
+    // Every header of the firmware's list is known, with or without a stand-in
+    EXPECT("LA:MIX ON;:LA:MIXED?;:LA:CURS:DELT?;:SYST:ERR?\n", "0,\"No error\"\n");
+
+    // Error queue: in order, then "No error"
+    EXPECT("SCOP:TRIG:LEV?;SLOP?\n", "1000\n"); // SLOP? from the root: undefined
+    EXPECT("SYST:ERR?\n", "-113,\"Undefined header\"\n");
+    EXPECT("SYST:ERR?\n", "0,\"No error\"\n");
+    EXPECT("LA:MEAS:PWID? 7\n", "");
+    EXPECT("SCOP:TRIG:LEV\n", "");
+    EXPECT("SCOP:TRIG:SLOP UP\n", "");
+    EXPECT("SYST:ERR?;:SYST:ERR?;:SYST:ERR?;:SYST:ERR?\n",
+           "-222,\"Data out of range\";-109,\"Missing parameter\";-224,\"Illegal parameter value\";0,\"No error\"\n");
+    CHECK_EQ(scpi_state.level, 1000u); // Rejected settings leave the value alone
+    EXPECT("SCOP:TRIG:LEV 5000;:*CLS;:SYST:ERR?\n", "0,\"No error\"\n");
+
+    // A reply longer than SCPI_REPLY_MAX keeps the items that fit
+    EXPECT("*IDN?;*IDN?;*IDN?\n", SCPI_TEST_IDN ";" SCPI_TEST_IDN "\n");
+    EXPECT("SYST:ERR?;:SYST:ERR?\n", "-223,\"Too much data\";0,\"No error\"\n");
+
+    // Overflow: the oldest errors are kept, the last slot becomes -350
+    EXPECT("X1;X2;X3;X4;X5\n", "");
+    EXPECT("SYST:ERR?;:SYST:ERR?;:SYST:ERR?\n",
+           "-113,\"Undefined header\";-113,\"Undefined header\";-113,\"Undefined header\"\n");
+    EXPECT("SYST:ERR?;:SYST:ERR?\n", "-350,\"Queue overflow\";0,\"No error\"\n");
+
+    // An overlong line is dropped whole (nothing in it runs), and the next one is fine
+    std::string overlong = "SCOP:TRIG:LEV 7;:";
+    while (overlong.size() <= SCPI_LINE_MAX) overlong += "LA:RATE?;:";
+    overlong += "\n";
+    EXPECT(overlong.c_str(), "");
+    EXPECT("SYST:ERR?;:SCOP:TRIG:LEV?\n", "-363,\"Input buffer overrun\";1000\n");
+
+    // SUMP between lines: five resets, ID, a divider whose argument bytes are printable
+    // ("ABCD" must not start a line), metadata; then a line again
+    const uint8_t sump_bytes[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x02, 0x80, 'A', 'B', 'C', 'D', 0x04 };
+    PtyLink::write_all(link.host, sump_bytes, sizeof(sump_bytes));
+    EXPECT("*IDN?\n", SCPI_TEST_IDN "\n");
+    CHECK_EQ(sump_commands[SUMP_CMD_RESET], 5);
+    CHECK_EQ(sump_commands[SUMP_CMD_ID], 1);
+    CHECK_EQ(sump_commands[SUMP_CMD_METADATA], 1);
+    CHECK_EQ(sump_commands[SUMP_CMD_SETTING], 1);
+    CHECK_EQ(sump.settings().divider, 0x434241u); // 24 bits of "ABCD"
+    EXPECT("SYST:ERR?\n", "0,\"No error\"\n");
+
+    link.close_pair();
+    printf("scpi_test: %u lines, %u commands\n", parser.lines(), parser.commands());
+    return test_result();
+}
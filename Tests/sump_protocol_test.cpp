@@ -0,0 +1,222 @@
+// A sigrok "ols" session against SumpProtocol over a pty: the five resets, ID, metadata,
+// four trigger stages, divider, counts, flags and run, as PulseView sends them. The device
+// side answers the way SumpServer does: it plans the run with plan_run() and lays a
+// synthesized 16-channel capture out with sump_stream_prepare(), sending it the way
+// host_link_send() does, in place of the logic analyzer.
+#include "SumpProtocol.h"
+#include "pty_link.h"
+#include "test_check.h"
+#include <stdio.h>
+#include <string.h>
+#include <string>
+
+#define DEV_NAME     "STM32 LA"
+#define DEV_CHANNELS 16
+#define DEV_MASK     0xFFFFu
+#define DEV_MEMORY   20000
+#define DEV_MAX_HZ   18000000
+#define CAPTURE_MAX  2048
+
+static SumpProtocol proto;
+static int commands[SUMP_CMD_UNKNOWN + 1];
+static SumpSettings run_settings; // As they were at the run command
+static SumpRunPlan run_plan;
+static bool run_armed;
+static uint32_t not_restored; // Samples not back in order after the stream went out
+
+static uint16_t capture_sample(uint32_t i) { return (uint16_t)(i * 0x0101u + 0x3A05u); }
+
+// host_link_send(): width 1 sends bytes, width 2 the low byte of each halfword
+static void link_send(int fd, const SumpStream& st) {
+    static uint8_t out[CAPTURE_MAX * 2];
+    const uint8_t* p = (const uint8_t*)st.data;
+    uint32_t len = 0;
+    for (uint32_t i = 0; i < st.count; ++i) out[len++] = p[i * st.width];
+    PtyLink::write_all(fd, out, len);
+}
+
+// Device side: what task_host and SumpServer do with a chunk from the RX ring
+static void device_rx(int fd) {
+    uint8_t buf[64];
+    ssize_t n;
+    while ((n = read(fd, buf, sizeof(buf))) > 0) {
+        for (ssize_t i = 0; i < n; ++i) {
+            uint8_t c = proto.feed(buf[i]);
+            commands[c]++;
+            if (c == SUMP_CMD_ID) {
+                PtyLink::write_all(fd, "1ALS", 4);
+            } else if (c == SUMP_CMD_METADATA) {
+                uint8_t reply[32];
+                uint16_t len = SumpProtocol::metadata(reply, sizeof(reply), DEV_NAME, DEV_CHANNELS, DEV_MEMORY, DEV_MAX_HZ);
+                PtyLink::write_all(fd, reply, len);
+            } else if (c == SUMP_CMD_RUN) {
+                run_settings = proto.settings();
+                run_armed = proto.plan_run(sizeof(uint16_t), DEV_MASK, &run_plan);
+                if (!run_armed) continue; // No group enabled: nothing armed, nothing sent
+                static uint16_t capture[CAPTURE_MAX];
+                uint32_t count = run_plan.depth < CAPTURE_MAX ? run_plan.depth : CAPTURE_MAX;
+                for (uint32_t k = 0; k < count; ++k) capture[k] = capture_sample(k);
+                SumpStream st = sump_stream_prepare(capture, count, run_plan.lanes);
+                link_send(fd, st);
+                sump_stream_restore(capture, count, run_plan.lanes);
+                for (uint32_t k = 0; k < count; ++k) {
+                    if (capture[k] != capture_sample(k)) not_restored++;
+                }
+            }
+        }
+    }
+}
+
+// Host side: send, let the device answer, collect the reply
+static size_t exchange(PtyLink& link, const uint8_t* cmd, size_t len, uint8_t* reply, size_t max) {
+    PtyLink::write_all(link.host, cmd, len);
+    usleep(2000);
+    device_rx(link.dev);
+    return PtyLink::drain(link.host, reply, max);
+}
+
+static void put_long(std::string& s, uint8_t cmd, uint32_t arg) {
+    s += (char)cmd;
+    for (int k = 0; k < 4; ++k) s += (char)(arg >> (8 * k));
+}
+
+static uint32_t be32(const uint8_t* p) { return ((uint32_t)p[0] << 24) | ((uint32_t)p[1] << 16) | ((uint32_t)p[2] << 8) | p[3]; }
+
+// The ols driver's metadata parser: 0x00 ends, 0x01..0x1F strings, 0x20..0x3F 32-bit values
+static void check_metadata(const uint8_t* m, size_t len) {
+    std::string name;
+    uint32_t probes = 0, memory = 0, rate = 0, version = 0;
+    size_t i = 0;
+    bool ended = false;
+    while (i < len && !ended) {
+        uint8_t key = m[i++];
+        if (key == 0x00) {
+            ended = true;
+        } else if (key <= 0x1F) {
+            while (i < len && m[i]) name += (char)m[i++];
+            i++;
+        } else if (key <= 0x3F && i + 4 <= len) {
+            uint32_t v = be32(m + i);
+            i += 4;
+            if (key == 0x20) probes = v;
+            if (key == 0x21) memory = v;
+            if (key == 0x23) rate = v;
+            if (key == 0x24) version = v;
+        } else {
+            break;
+        }
+    }
+    CHECK(ended && i == len);
+    CHECK(name == DEV_NAME);
+    CHECK_EQ(probes, (uint32_t)DEV_CHANNELS);
+    CHECK_EQ(memory, (uint32_t)DEV_MEMORY);
+    CHECK_EQ(rate, (uint32_t)DEV_MAX_HZ);
+    CHECK_EQ(version, 2u);
+}
+
+// Configure and run one capture; flags as the driver computes them from the enabled groups.
+// lanes: the groups expected back (0: the run is refused)
+static void run_capture(PtyLink& link, uint32_t read_count, uint32_t delay_count, uint32_t flags,
+                        uint8_t lanes) {
+    std::string cfg;
+    // Stage 0: CH0 high and CH1 low (the value bit of CH7 is outside the mask); stage 1:
+    // channels this device lacks; stage 2 (level 1, starts the capture): CH2 high; stage 3
+    // after the start. The driver writes all four stages.
+    const uint32_t mask[SUMP_MAX_STAGES] = { 0x03, 0x30000, 0x04, 0x08 };
+    const uint32_t value[SUMP_MAX_STAGES] = { 0x81, 0x10000, 0x04, 0x08 };
+    const uint32_t config[SUMP_MAX_STAGES] = { 0, 0, (1UL << 16) | SUMP_TRIG_START, 2UL << 16 };
+    for (int k = 0; k < SUMP_MAX_STAGES; ++k) {
+        put_long(cfg, SUMP_TRIG_MASK + 4 * k, mask[k]);
+        put_long(cfg, SUMP_TRIG_VALUES + 4 * k, value[k]);
+        put_long(cfg, SUMP_TRIG_CONFIG + 4 * k, config[k]);
+    }
+    put_long(cfg, SUMP_SET_DIVIDER, SUMP_CLOCK_HZ / 1000000 - 1); // 1 MHz
+    put_long(cfg, SUMP_SET_COUNTS, (read_count / 4 - 1) | ((delay_count / 4 - 1) << 16));
+    put_long(cfg, SUMP_SET_FLAGS, flags);
+    cfg += (char)0x01; // Run
+
+    static uint8_t data[CAPTURE_MAX * 2 + 16];
+    not_restored = 0;
+    size_t n = exchange(link, (const uint8_t*)cfg.data(), cfg.size(), data, sizeof(data));
+
+    CHECK_EQ(run_settings.read_count, read_count);
+    CHECK_EQ(run_settings.delay_count, delay_count);
+    CHECK_EQ(run_settings.flags, flags);
+    for (int k = 0; k < SUMP_MAX_STAGES; ++k) {
+        CHECK_EQ(run_settings.stages[k].mask, mask[k]);
+        CHECK_EQ(run_settings.stages[k].value, value[k]);
+        CHECK_EQ(run_settings.stages[k].config, config[k]);
+    }
+
+    // The plan: stages 0 and 2, values within their masks, stage 3 dropped
+    CHECK_EQ(run_armed, lanes != 0);
+    CHECK_EQ(run_plan.lanes, lanes);
+    if (!lanes) {
+        CHECK_EQ(n, (size_t)0);
+        return;
+    }
+    CHECK_EQ(run_plan.rate_hz, 1000000u);
+    CHECK_EQ(run_plan.depth, read_count);
+    CHECK_EQ(run_plan.stages, 2);
+    CHECK_EQ(run_plan.stage_mask[0], 0x03u);
+    CHECK_EQ(run_plan.stage_value[0], 0x01u);
+    CHECK_EQ(run_plan.stage_mask[1], 0x04u);
+    CHECK_EQ(run_plan.stage_value[1], 0x04u);
+    CHECK_EQ(run_plan.pretrigger_pct, (uint8_t)((read_count - delay_count) * 100 / read_count));
+    CHECK_EQ(not_restored, 0u);
+
+    // Samples come newest first: put them back in order, one byte per enabled group
+    uint8_t groups = (lanes == 3) ? 2 : 1;
+    CHECK_EQ(n, (size_t)read_count * groups);
+    if (n != (size_t)read_count * groups) return;
+    uint32_t bad = 0;
+    for (uint32_t k = 0; k < read_count; ++k) {
+        const uint8_t* p = data + (size_t)(read_count - 1 - k) * groups;
+        uint16_t want = capture_sample(k);
+        if (lanes == 1) want &= 0xFF;
+        if (lanes == 2) want >>= 8;
+        uint16_t got = (groups == 2) ? (uint16_t)(p[0] | (p[1] << 8)) : p[0];
+        if (got != want) bad++;
+    }
+    CHECK_EQ(bad, 0u);
+}
+
+int main() {
+    PtyLink link;
+    if (!link.open_pair()) {
+        fprintf(stderr, "sump_protocol_test: no pty available\n");
+        return 1;
+    }
+    uint8_t reply[64];
+
+    // Probe: five resets flush any partial long command, then the ID
+    const uint8_t probe[] = { 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    size_t n = exchange(link, probe, sizeof(probe), reply, sizeof(reply));
+    CHECK_EQ(commands[SUMP_CMD_RESET], 5);
+    CHECK(n == 4 && memcmp(reply, "1ALS", 4) == 0);
+
+    // The five resets also bring back a parser left inside a long command (here by a host
+    // that stopped after its first argument byte): three of them complete it
+    const uint8_t cut[] = { SUMP_SET_DIVIDER, 0x12, 0x00, 0x00, 0x00, 0x00, 0x00, 0x02 };
+    n = exchange(link, cut, sizeof(cut), reply, sizeof(reply));
+    CHECK(n == 4 && memcmp(reply, "1ALS", 4) == 0);
+    CHECK(!proto.in_command());
+
+    const uint8_t meta[] = { 0x04 };
+    n = exchange(link, meta, sizeof(meta), reply, sizeof(reply));
+    check_metadata(reply, n);
+
+    run_capture(link, 1024, 768, 0, 0x3);                                      // Both groups
+    run_capture(link, 2048, 1024, 2u << SUMP_FLAG_GROUPS_OFF_SHIFT, 0x1);      // Group 0 only: low bytes
+    run_capture(link, 512, 256, 1u << SUMP_FLAG_GROUPS_OFF_SHIFT, 0x2);        // Group 1 only: high bytes
+    run_capture(link, 256, 128, 3u << SUMP_FLAG_GROUPS_OFF_SHIFT, 0x0);        // None: refused
+    // Channel groups 2 and 3 are not on this device: their flags do not matter
+    run_capture(link, 1024, 512, 0xCu << SUMP_FLAG_GROUPS_OFF_SHIFT, 0x3);
+    CHECK_EQ(commands[SUMP_CMD_RUN], 5);
+    CHECK_EQ(commands[SUMP_CMD_UNKNOWN], 0);
+
+    link.close_pair();
+    printf("sump_protocol_test: %d commands\n", commands[SUMP_CMD_RESET] + commands[SUMP_CMD_ID] +
+           commands[SUMP_CMD_METADATA] + commands[SUMP_CMD_SETTING] + commands[SUMP_CMD_RUN]);
+    return test_result();
+}
@@ -0,0 +1,32 @@
+#ifndef TEST_CHECK_H
+#define TEST_CHECK_H
+
+// Minimal checks for the host tests: a failure is reported with its line and the
+// test goes on; test_result() is the exit code.
+#include <stdio.h>
+
+static int test_failures;
+
+#define CHECK(cond) \
+    do { \
+        if (!(cond)) { \
+            fprintf(stderr, "%s:%d: check failed: %s\n", __FILE__, __LINE__, #cond); \
+            test_failures++; \
+        } \
+    } while (0)
+
+#define CHECK_EQ(a, b) \
+    do { \
+        long long a_ = (long long)(a), b_ = (long long)(b); \
+        if (a_ != b_) { \
+            fprintf(stderr, "%s:%d: %s == %lld, expected %lld\n", __FILE__, __LINE__, #a, a_, b_); \
+            test_failures++; \
+        } \
+    } while (0)
+
+static inline int test_result() {
+    if (test_failures) fprintf(stderr, "%d check(s) failed\n", test_failures);
+    return test_failures ? 1 : 0;
+}
+
+#endif // TEST_CHECK_H
@@ -0,0 +1,116 @@
+// Affine touch calibration solver against synthetic distortions: the three calibration
+// targets are mapped to raw readings through a known transform (plus noise), and the
+// solved matrix must give back the transform's inverse and land every point of a screen
+// grid within a pixel or two. Collinear target sets must be rejected.
+#include "XPT2046_Calibration.h"
+#include "test_check.h"
+#include <math.h>
+#include <stdio.h>
+#include <stdlib.h>
+
+#define SCREEN_W 240
+#define SCREEN_H 320
+
+// Same targets as touch_calibration.cpp (10%/90% of the screen)
+static const int16_t targets[3][2] = {
+    { SCREEN_W / 10, SCREEN_H / 10 },
+    { SCREEN_W * 9 / 10, SCREEN_H / 2 },
+    { SCREEN_W / 2, SCREEN_H * 9 / 10 },
+};
+
+// raw = M * screen + t: what the panel reports for a screen position
+struct Distortion {
+    const char* name;
+    double m[2][2];
+    double t[2];
+};
+
+static const Distortion distortions[] = {
+    { "scale + offset, Y inverted", { { 15.2, 0.0 }, { 0.0, -11.3 } }, { 200.0, 3850.0 } },
+    { "axes swapped (panel rotated)", { { 0.0, 11.6 }, { 15.0, 0.0 } }, { 300.0, 250.0 } },
+    { "3 degree rotation + skew", { { 15.1, 0.9 }, { -0.6, 11.4 } }, { 180.0, 220.0 } },
+    { "X mirrored", { { -14.8, 0.0 }, { 0.0, 11.9 } }, { 3900.0, 160.0 } },
+};
+
+static uint32_t lcg = 12345;
+static int noise(int amplitude) { // Uniform in [-amplitude, amplitude]
+    if (amplitude == 0) return 0;
+    lcg = lcg * 1103515245u + 12345u;
+    return (int)((lcg >> 16) % (2 * amplitude + 1)) - amplitude;
+}
+
+static void to_raw(const Distortion& d, double sx, double sy, double* rx, double* ry) {
+    *rx = d.m[0][0] * sx + d.m[0][1] * sy + d.t[0];
+    *ry = d.m[1][0] * sx + d.m[1][1] * sy + d.t[1];
+}
+
+// Returns the largest screen error (px) over a grid of points
+static double check_distortion(const Distortion& d, int noise_counts, double coef_tol, double max_px) {
+    int16_t raw[3][2];
+    for (int i = 0; i < 3; ++i) {
+        double rx, ry;
+        to_raw(d, targets[i][0], targets[i][1], &rx, &ry);
+        raw[i][0] = (int16_t)lround(rx) + noise(noise_counts);
+        raw[i][1] = (int16_t)lround(ry) + noise(noise_counts);
+    }
+    XPT2046_Calibration cal;
+    bool ok = xpt2046SolveCalibration(raw, targets, &cal);
+    CHECK(ok);
+    if (!ok) return 1e9;
+
+    // Expected coefficients: the inverse of M, in Q16
+    double det = d.m[0][0] * d.m[1][1] - d.m[0][1] * d.m[1][0];
+    double inv[2][2] = { { d.m[1][1] / det, -d.m[0][1] / det }, { -d.m[1][0] / det, d.m[0][0] / det } };
+    const double one = 1 << XPT2046_CAL_SHIFT;
+    double got[2][2] = { { cal.a / one, cal.b / one }, { cal.d / one, cal.e / one } };
+    double scale = fmax(fmax(fabs(inv[0][0]), fabs(inv[0][1])), fmax(fabs(inv[1][0]), fabs(inv[1][1])));
+    for (int r = 0; r < 2; ++r) {
+        for (int c = 0; c < 2; ++c) {
+            if (fabs(got[r][c] - inv[r][c]) > coef_tol * scale) {
+                fprintf(stderr, "%s, noise %d: coefficient [%d][%d] = %.6f, expected %.6f\n", d.name,
+                        noise_counts, r, c, got[r][c], inv[r][c]);
+                test_failures++;
+            }
+        }
+    }
+
+    // Residual over the screen, from noise-free readings
+    double worst = 0;
+    for (int sy = 0; sy < SCREEN_H; sy += 16) {
+        for (int sx = 0; sx < SCREEN_W; sx += 16) {
+            double rx, ry;
+            to_raw(d, sx, sy, &rx, &ry);
+            int16_t px, py;
+            xpt2046ApplyCalibration(cal, (int16_t)lround(rx), (int16_t)lround(ry), &px, &py);
+            worst = fmax(worst, fmax(fabs(px - sx), fabs(py - sy)));
+        }
+    }
+    if (worst > max_px) {
+        fprintf(stderr, "%s, noise %d: residual %.0f px, limit %.0f\n", d.name, noise_counts, worst, max_px);
+        test_failures++;
+    }
+    printf("  %-30s noise +-%d: worst residual %.0f px\n", d.name, noise_counts, worst);
+    return worst;
+}
+
+static void check_degenerate() {
+    XPT2046_Calibration cal;
+    const int16_t collinear[3][2] = { { 400, 500 }, { 1900, 2000 }, { 3400, 3500 } }; // On one line
+    CHECK(!xpt2046SolveCalibration(collinear, targets, &cal));
+    const int16_t repeated[3][2] = { { 400, 500 }, { 400, 500 }, { 3400, 1200 } }; // Same point twice
+    CHECK(!xpt2046SolveCalibration(repeated, targets, &cal));
+    const int16_t nearly[3][2] = { { 1000, 1000 }, { 1200, 1201 }, { 1400, 1400 } }; // 1 count off a line
+    CHECK(!xpt2046SolveCalibration(nearly, targets, &cal));
+}
+
+int main() {
+    printf("touch_calibration_test:\n");
+    for (const Distortion& d : distortions) {
+        check_distortion(d, 0, 0.005, 1.0); // Only the rounding of the raw readings
+        check_distortion(d, 2, 0.02, 2.0);
+        check_distortion(d, 5, 0.05, 4.0);
+        check_distortion(d, 20, 0.2, 10.0); // Sloppy taps
+    }
+    check_degenerate();
+    return test_result();
+}
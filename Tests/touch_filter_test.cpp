@@ -0,0 +1,74 @@
+// Replays raw XPT2046 bursts (fixtures/touch_traces.txt) through the touch filter and
+// checks each published point, and that rejected bursts come out as z == 0 at (0, 0).
+#include "XPT2046_Filter.h"
+#include "test_check.h"
+#include <stdio.h>
+#include <string.h>
+
+static void check_helpers() {
+    uint16_t v[5] = { 30, 10, 50, 20, 40 };
+    xpt2046SortSamples(v, 5);
+    CHECK(v[0] == 10 && v[4] == 50);
+    uint16_t m[5] = { 100, 4000, 102, 98, 0 }; // Both outliers dropped
+    CHECK_EQ(xpt2046TrimmedMean(m, 5), 100);
+    CHECK_EQ(xpt2046TrimmedSpread(m, 5), 4);
+    CHECK_EQ(xpt2046TouchResistance(2048, 0, 100, 400), 0xFFFF); // No contact
+    CHECK_EQ(xpt2046TouchResistance(2048, 500, 400, 400), 0);    // Z2 <= Z1
+    CHECK_EQ(xpt2046TouchResistance(2048, 500, 1500, 400), 400); // 400 * 1/2 * (3 - 1)
+}
+
+int main(int argc, char** argv) {
+    check_helpers();
+
+    const char* path = argc > 1 ? argv[1] : "fixtures/touch_traces.txt";
+    FILE* f = fopen(path, "r");
+    if (!f) {
+        perror(path);
+        return 1;
+    }
+    char line[256];
+    int bursts = 0, rejected = 0, traces = 0;
+    while (fgets(line, sizeof(line), f)) {
+        if (line[0] == '#' || line[0] == '\n') continue;
+        if (!strncmp(line, "trace ", 6)) {
+            traces++;
+            continue;
+        }
+        uint16_t xs[XPT2046_AXIS_SAMPLES], ys[XPT2046_AXIS_SAMPLES];
+        uint16_t z1s[XPT2046_Z_SAMPLES], z2s[XPT2046_Z_SAMPLES];
+        unsigned v[2 * XPT2046_AXIS_SAMPLES + 2 * XPT2046_Z_SAMPLES], ex, ey;
+        int ez;
+        int n = sscanf(line, "%u %u %u %u %u %u %u %u %u %u %u %u %u %u %u %u -> %u %u %d",
+                       &v[0], &v[1], &v[2], &v[3], &v[4], &v[5], &v[6], &v[7], &v[8], &v[9],
+                       &v[10], &v[11], &v[12], &v[13], &v[14], &v[15], &ex, &ey, &ez);
+        if (n != 19) {
+            fprintf(stderr, "%s: bad line: %s", path, line);
+            return 1;
+        }
+        for (int i = 0; i < XPT2046_AXIS_SAMPLES; ++i) {
+            xs[i] = (uint16_t)v[i];
+            ys[i] = (uint16_t)v[XPT2046_AXIS_SAMPLES + i];
+        }
+        for (int i = 0; i < XPT2046_Z_SAMPLES; ++i) {
+            z1s[i] = (uint16_t)v[2 * XPT2046_AXIS_SAMPLES + i];
+            z2s[i] = (uint16_t)v[2 * XPT2046_AXIS_SAMPLES + XPT2046_Z_SAMPLES + i];
+        }
+        uint16_t x, y;
+        int16_t z;
+        xpt2046ReduceBurst(xs, ys, z1s, z2s, XPT2046_DEFAULT_PRESSURE_THRESHOLD, &x, &y, &z);
+        CHECK_EQ(x, ex);
+        CHECK_EQ(y, ey);
+        CHECK_EQ(z, ez);
+        if (z == 0) {
+            CHECK(x == 0 && y == 0);
+            rejected++;
+        } else {
+            CHECK(z >= XPT2046_DEFAULT_PRESSURE_THRESHOLD);
+        }
+        bursts++;
+    }
+    fclose(f);
+    CHECK(traces > 0 && bursts > 0);
+    printf("touch_filter_test: %d traces, %d bursts, %d rejected\n", traces, bursts, rejected);
+    return test_result();
+}
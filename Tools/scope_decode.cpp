@@ -0,0 +1,143 @@
+// Host-side decoder for the scope frames sent by ScopeStream (format in Src/ScopeFrame.h).
+// Reads a byte stream (a capture file, or the serial port set to raw mode), finds the
+// frames in it, checks their CRC and writes the samples as CSV and/or a WAV file.
+//
+//   g++ -O2 -std=c++11 -ISrc Tools/scope_decode.cpp Src/ScopeFrame.cpp -o scope_decode
+//   stty -F /dev/ttyUSB0 115200 raw && scope_decode -c capture.csv -n 1 /dev/ttyUSB0
+//
+// CSV: one row per sample (frame, index, time from the trigger in s, ADC code, volts).
+// WAV: 16-bit mono at the first frame's sample rate, frames back to back, code 2048 = 0.
+#include "ScopeFrame.h"
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <unistd.h> // read(): returns what a serial port has, where fread() would wait for a full chunk
+#include <vector>
+
+static void usage() {
+    fprintf(stderr, "usage: scope_decode [-c out.csv] [-w out.wav] [-n frames] [input]\n");
+    exit(2);
+}
+
+static void put_le(FILE* f, uint32_t v, int bytes) {
+    for (int i = 0; i < bytes; ++i) fputc((v >> (8 * i)) & 0xFF, f);
+}
+
+static void wav_header(FILE* f, uint32_t rate, uint32_t samples) {
+    uint32_t data_len = samples * 2;
+    fwrite("RIFF", 1, 4, f);
+    put_le(f, 36 + data_len, 4);
+    fwrite("WAVEfmt ", 1, 8, f);
+    put_le(f, 16, 4);       // fmt chunk size
+    put_le(f, 1, 2);        // PCM
+    put_le(f, 1, 2);        // Mono
+    put_le(f, rate, 4);
+    put_le(f, rate * 2, 4); // Bytes per second
+    put_le(f, 2, 2);        // Block align
+    put_le(f, 16, 2);       // Bits per sample
+    fwrite("data", 1, 4, f);
+    put_le(f, data_len, 4);
+}
+
+int main(int argc, char** argv) {
+    const char* csv_path = nullptr;
+    const char* wav_path = nullptr;
+    const char* in_path = nullptr;
+    long max_frames = 0; // 0 = until the input ends
+    for (int i = 1; i < argc; ++i) {
+        if (!strcmp(argv[i], "-c") && i + 1 < argc) csv_path = argv[++i];
+        else if (!strcmp(argv[i], "-w") && i + 1 < argc) wav_path = argv[++i];
+        else if (!strcmp(argv[i], "-n") && i + 1 < argc) max_frames = atol(argv[++i]);
+        else if (argv[i][0] == '-' && argv[i][1]) usage();
+        else in_path = argv[i];
+    }
+
+    FILE* in = in_path ? fopen(in_path, "rb") : stdin;
+    if (!in) {
+        perror(in_path);
+        return 1;
+    }
+    FILE* csv = csv_path ? fopen(csv_path, "w") : nullptr;
+    FILE* wav = wav_path ? fopen(wav_path, "wb") : nullptr;
+    if ((csv_path && !csv) || (wav_path && !wav)) {
+        perror(csv_path && !csv ? csv_path : wav_path);
+        return 1;
+    }
+    if (csv) fprintf(csv, "frame,index,time_s,code,volts\n");
+    if (wav) wav_header(wav, 0, 0); // Sizes and rate are patched at the end
+
+    std::vector<uint8_t> buf;
+    std::vector<uint16_t> samples;
+    uint8_t chunk[4096];
+    long frames = 0, bad = 0;
+    uint32_t wav_rate = 0, wav_samples = 0;
+    bool eof = false;
+
+    while (!eof && (max_frames == 0 || frames < max_frames)) {
+        ssize_t got = read(fileno(in), chunk, sizeof(chunk));
+        if (got <= 0) {
+            eof = true;
+            got = 0;
+        }
+        buf.insert(buf.end(), chunk, chunk + got);
+
+        // Take every complete frame in the buffer; keep a partial one for the next read
+        size_t pos = 0;
+        while (buf.size() - pos >= SCOPE_FRAME_HEADER_LEN) {
+            ScopeFrameHeader h;
+            uint16_t header_len;
+            if (!scope_frame_read_header(&buf[pos], &h, &header_len)) {
+                pos++; // Not a frame start: resynchronise on the next byte
+                continue;
+            }
+            uint32_t payload_len = scope_frame_payload_len(h.sample_count);
+            size_t frame_len = (size_t)header_len + payload_len + SCOPE_FRAME_CRC_LEN;
+            if (buf.size() - pos < frame_len) break;
+
+            const uint8_t* frame = &buf[pos];
+            uint32_t crc = scope_crc_final(scope_crc_update(SCOPE_CRC_INIT, frame, header_len + payload_len));
+            const uint8_t* t = frame + header_len + payload_len;
+            uint32_t sent = t[0] | (t[1] << 8) | (t[2] << 16) | ((uint32_t)t[3] << 24);
+            if (crc != sent) {
+                fprintf(stderr, "frame at byte %zu: CRC %08x, expected %08x; skipped\n", pos, crc, sent);
+                bad++;
+                pos++;
+                continue;
+            }
+
+            samples.resize(h.sample_count);
+            scope_frame_unpack(frame + header_len, h.sample_count, samples.data());
+            fprintf(stderr, "frame %ld: %u samples at %u Hz, trigger at %u%s\n", frames, h.sample_count,
+                    h.sample_rate_hz, h.trigger_index,
+                    (h.flags & SCOPE_FRAME_TRIGGERED) ? ((h.flags & SCOPE_FRAME_FALLING) ? " (falling)" : " (rising)") : "");
+            if (csv) {
+                for (uint32_t i = 0; i < h.sample_count; ++i) {
+                    double time = h.sample_rate_hz ? ((double)i - h.trigger_index) / h.sample_rate_hz : 0.0;
+                    double volts = ((double)samples[i] - h.offset_code) * h.nv_per_lsb * 1e-9;
+                    fprintf(csv, "%ld,%u,%.9g,%u,%.6f\n", frames, i, time, samples[i], volts);
+                }
+            }
+            if (wav) {
+                if (wav_rate == 0) wav_rate = h.sample_rate_hz;
+                if (h.sample_rate_hz != wav_rate) fprintf(stderr, "frame %ld: rate differs from the WAV's\n", frames);
+                for (uint32_t i = 0; i < h.sample_count; ++i) {
+                    int32_t v = ((int32_t)samples[i] - (1 << (h.bits - 1))) << (16 - h.bits);
+                    put_le(wav, (uint16_t)(int16_t)v, 2);
+                }
+                wav_samples += h.sample_count;
+            }
+            pos += frame_len;
+            if (++frames == max_frames) break;
+        }
+        buf.erase(buf.begin(), buf.begin() + pos);
+    }
+
+    if (wav) {
+        fseek(wav, 0, SEEK_SET);
+        wav_header(wav, wav_rate, wav_samples);
+        fclose(wav);
+    }
+    if (csv) fclose(csv);
+    fprintf(stderr, "%ld frames, %ld with a bad CRC\n", frames, bad);
+    return (frames > 0 && bad == 0) ? 0 : 1;
+}